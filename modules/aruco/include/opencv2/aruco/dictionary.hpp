@@ -22,6 +22,10 @@ namespace aruco {
  * - each row contains all 4 rotations of the marker, so its length is `4*nbytes`
  *
  * `bytesList.ptr(i)[k*nbytes + j]` is then the j-th byte of i-th marker, in its k-th rotation.
+ *
+ * identify() looks the codewords up in a hash index built on first use for the bytesList data, markerSize and
+ * maxCorrectionBits. To change the markers of a dictionary already used for identification, assign a new matrix
+ * to bytesList: in-place changes of its elements are not seen by the index.
  */
 class CV_EXPORTS_W Dictionary {
 
@@ -102,6 +106,7 @@ class CV_EXPORTS_W Dictionary {
       * @brief Transform list of bytes to matrix of bits
       */
     CV_WRAP static Mat getBitsFromByteList(const Mat &byteList, int markerSize);
+
 };
 
 
@@ -392,6 +392,98 @@ public:
     }
 };
 
+/**
+ * @brief Timing and counters of ArucoTracker, see ArucoTracker::getStats()
+ *
+ * Times are given in milliseconds and refer to the last processed frame, counters are accumulated since the last
+ * ArucoTracker::reset().
+ */
+struct CV_EXPORTS_W_SIMPLE ArucoTrackerStats {
+    CV_WRAP ArucoTrackerStats() {}
+
+    /// time spent predicting marker positions and building the search regions
+    CV_PROP_RW double predictionTime = 0.;
+    /// time spent detecting markers inside the search regions
+    CV_PROP_RW double roiDetectionTime = 0.;
+    /// time spent in full-frame detection (zero if the frame was tracked)
+    CV_PROP_RW double fullDetectionTime = 0.;
+    /// true if the last frame was processed by full-frame detection
+    CV_PROP_RW bool fullDetection = false;
+    /// number of search regions used for the last frame
+    CV_PROP_RW int numRois = 0;
+    /// number of processed frames
+    CV_PROP_RW int frames = 0;
+    /// number of frames processed by full-frame detection
+    CV_PROP_RW int fullDetections = 0;
+    /// number of frames where a tracked marker was lost inside its search region
+    CV_PROP_RW int trackingLosses = 0;
+};
+
+/**
+ * @brief Temporal marker detection for video streams
+ *
+ * The tracker keeps the markers found in the previous frames and, for the next frame, predicts their corners with
+ * a constant velocity model. Detection is then run by the wrapped ArucoDetector only inside the bounding boxes of
+ * the predicted quads expanded by roiMargin times the marker side (overlapping regions are merged). A full-frame
+ * detection is done on the first frame, every fullDetectionInterval frames to pick up new markers, and whenever a
+ * tracked marker is not found again in its search region.
+ *
+ * Every detection is tracked on its own, so several markers with the same id can be tracked at the same time. The
+ * detections of the next frame are associated to the tracks with the same id by nearest predicted center.
+ *
+ * For ChArUco boards the tracked marker corners and ids can be passed directly to interpolateCornersCharuco().
+ * @sa ArucoDetector
+ */
+class CV_EXPORTS_W ArucoTracker
+{
+public:
+    /// detector used both for full-frame and for region detection
+    CV_PROP_RW Ptr<ArucoDetector> detector;
+
+    /// number of frames between two forced full-frame detections, values <= 1 disable tracking
+    CV_PROP_RW int fullDetectionInterval;
+
+    /// margin added around each predicted marker quad, relative to the marker side
+    CV_PROP_RW float roiMargin;
+
+    /**
+     * @brief ArucoTracker constructor
+     * @param _detector marker detector, its parameters are used for every detection
+     * @param _fullDetectionInterval number of frames between two forced full-frame detections
+     * @param _roiMargin margin around each predicted marker quad, relative to the marker side
+     */
+    CV_WRAP ArucoTracker(const Ptr<ArucoDetector> &_detector = makePtr<ArucoDetector>(),
+                         int _fullDetectionInterval = 30, float _roiMargin = 0.5f);
+
+    /**
+     * @brief Detects markers in the next frame of the stream
+     *
+     * @param image next video frame, all frames must have the same size
+     * @param corners vector of detected marker corners, in the same format as ArucoDetector::detectMarkers()
+     * @param ids vector of identifiers of the detected markers
+     */
+    CV_WRAP void track(InputArray image, OutputArrayOfArrays corners, OutputArray ids);
+
+    /** @brief Forgets the tracked markers, the next frame is processed by full-frame detection
+     */
+    CV_WRAP void reset();
+
+    /** @brief Returns timing of the last frame and counters since the last reset()
+     */
+    CV_WRAP ArucoTrackerStats getStats() const;
+
+private:
+    struct TrackedMarker {
+        int id;
+        std::vector<Point2f> corners, prevCorners;
+        bool hasVelocity;
+    };
+    std::vector<TrackedMarker> markers;
+    Size frameSize;
+    int framesSinceFull;
+    ArucoTrackerStats stats;
+};
+
 /**
  * @brief Draw detected markers in image
  *
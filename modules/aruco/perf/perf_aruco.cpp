@@ -297,4 +297,140 @@ PERF_TEST_P(EstimateLargeAruco, ArucoFHD, ESTIMATE_FHD_PARAMS)
     SANITY_CHECK_NOTHING();
 }
 
+typedef TestBaseWithParam<int> EstimateAprilTag;
+
+PERF_TEST_P(EstimateAprilTag, Aruco4K, Values(1, 3, 6))
+{
+    Ptr<aruco::Dictionary> dictionary = aruco::getPredefinedDictionary(aruco::DICT_6X6_250);
+    Ptr<aruco::DetectorParameters> detectorParams = aruco::DetectorParameters::create();
+    detectorParams->minDistanceToBorder = 1;
+    detectorParams->cornerRefinementMethod = cv::aruco::CORNER_REFINE_APRILTAG;
+    aruco::ArucoDetector detector(dictionary, detectorParams);
+
+    // the tile fills the height of a 3840x2160 frame
+    const int numMarkersInRow = GetParam();
+    MarkerPainter painter(2160 / numMarkersInRow);
+    auto image_map = painter.getProjectMarkersTile(numMarkersInRow, detectorParams, dictionary);
+    Mat frame(2160, 3840, CV_8UC1, Scalar::all(255));
+    const Point2f offset(840.f, 0.f);
+    image_map.first.copyTo(frame(Rect(Point(offset), image_map.first.size())));
+    for (auto& gold : image_map.second)
+        for (Point2f& point : gold.second)
+            point += offset;
+
+    declare.in(frame).time(120);
+
+    vector<vector<Point2f> > corners;
+    vector<int> ids;
+    TEST_CYCLE()
+    {
+        detector.detectMarkers(frame, corners, ids);
+    }
+    ASSERT_EQ(numMarkersInRow*numMarkersInRow, static_cast<int>(ids.size()));
+    double maxDistance = getMaxDistance(image_map.second, ids, corners);
+    ASSERT_LT(maxDistance, 3.);
+    SANITY_CHECK_NOTHING();
+}
+
+typedef tuple<int, int> DictionaryParams;
+typedef TestBaseWithParam<DictionaryParams> ArucoDictionary;
+#define DICTIONARY_PARAMS Combine(Values(1000, 5000, 10000), Values(0, 3))
+
+PERF_TEST_P(ArucoDictionary, identify, DICTIONARY_PARAMS)
+{
+    const int nMarkers = get<0>(GetParam());
+    const int maxCorrectionBits = get<1>(GetParam());
+    const int markerSize = 6;
+    RNG& rng = theRNG();
+
+    // random codewords, generateCustomDictionary is too slow for such sizes
+    Mat bytesList;
+    for (int i = 0; i < nMarkers; i++)
+    {
+        Mat bits(markerSize, markerSize, CV_8UC1);
+        rng.fill(bits, RNG::UNIFORM, 0, 2);
+        bytesList.push_back(aruco::Dictionary::getByteListFromBits(bits));
+    }
+    aruco::Dictionary dictionary(bytesList, markerSize, maxCorrectionBits);
+
+    // half of the candidates are rotated markers with a few wrong bits, the rest is noise
+    const int nCandidates = 1000;
+    vector<Mat> candidates(nCandidates);
+    for (int i = 0; i < nCandidates; i++)
+    {
+        Mat bits(markerSize, markerSize, CV_8UC1);
+        if (i % 2 == 0)
+        {
+            bits = aruco::Dictionary::getBitsFromByteList(bytesList.row(rng.uniform(0, nMarkers)), markerSize);
+            for (int r = rng.uniform(0, 4); r > 0; r--)
+                rotate(bits, bits, ROTATE_90_CLOCKWISE);
+            for (int e = rng.uniform(0, maxCorrectionBits + 1); e > 0; e--)
+                bits.at<uchar>(rng.uniform(0, markerSize), rng.uniform(0, markerSize)) ^= 1;
+        }
+        else
+            rng.fill(bits, RNG::UNIFORM, 0, 2);
+        candidates[i] = bits;
+    }
+
+    // the codeword index is built once per dictionary, on first use
+    int idx = -1, rotation = -1;
+    dictionary.identify(candidates[0], idx, rotation, 1.);
+
+    int found = 0;
+    TEST_CYCLE()
+    {
+        found = 0;
+        for (int i = 0; i < nCandidates; i++)
+            found += dictionary.identify(candidates[i], idx, rotation, 1.);
+    }
+    ASSERT_GE(found, nCandidates / 2);
+    SANITY_CHECK_NOTHING();
+}
+
+typedef tuple<bool, int> TrackerParams;
+typedef TestBaseWithParam<TrackerParams> ArucoTrackerSequence;
+#define TRACKER_PARAMS Combine(Values(false, true), Values(1, 3))
+
+PERF_TEST_P(ArucoTrackerSequence, track, TRACKER_PARAMS)
+{
+    const bool useTracker = get<0>(GetParam());
+    const int numMarkersInRow = get<1>(GetParam());
+    Ptr<aruco::Dictionary> dictionary = aruco::getPredefinedDictionary(aruco::DICT_6X6_250);
+    Ptr<aruco::DetectorParameters> detectorParams = aruco::DetectorParameters::create();
+    detectorParams->minDistanceToBorder = 1;
+    detectorParams->cornerRefinementMethod = cv::aruco::CORNER_REFINE_SUBPIX;
+    Ptr<aruco::ArucoDetector> detector = makePtr<aruco::ArucoDetector>(dictionary, detectorParams);
+
+    // FHD sequence with the marker tile moving across the frame
+    MarkerPainter painter(900 / numMarkersInRow);
+    auto image_map = painter.getProjectMarkersTile(numMarkersInRow, detectorParams, dictionary);
+    const Mat& tile = image_map.first;
+    const int numFrames = 30, step = 8;
+    vector<Mat> frames(numFrames);
+    for (int i = 0; i < numFrames; i++)
+    {
+        frames[i] = Mat(1080, 1920, CV_8UC1, Scalar::all(255));
+        tile.copyTo(frames[i](Rect(100 + i*step, 20 + i*step/4, tile.cols, tile.rows)));
+    }
+
+    aruco::ArucoTracker tracker(detector, numFrames);
+    vector<vector<Point2f> > corners;
+    vector<int> ids;
+    TEST_CYCLE()
+    {
+        tracker.reset();
+        for (int i = 0; i < numFrames; i++)
+        {
+            if (useTracker)
+                tracker.track(frames[i], corners, ids);
+            else
+                detector->detectMarkers(frames[i], corners, ids);
+        }
+    }
+    ASSERT_EQ(numMarkersInRow*numMarkersInRow, static_cast<int>(ids.size()));
+    if (useTracker)
+        ASSERT_EQ(1, tracker.getStats().fullDetections);
+    SANITY_CHECK_NOTHING();
+}
+
 }
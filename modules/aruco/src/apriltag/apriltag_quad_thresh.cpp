@@ -18,6 +18,7 @@
 
 #include "../precomp.hpp"
 #include "apriltag_quad_thresh.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 
 //#define APRIL_DEBUG
 #ifdef APRIL_DEBUG
@@ -1106,105 +1107,100 @@ void threshold(const Mat mIm, const Ptr<DetectorParameters> &parameters, Mat& mT
     int tw = w / tilesz;
     int th = h / tilesz;
 
-    uint8_t *im_max = (uint8_t*)calloc(tw*th, sizeof(uint8_t));
-    uint8_t *im_min = (uint8_t*)calloc(tw*th, sizeof(uint8_t));
-
+    Mat im_max(th, tw, CV_8UC1), im_min(th, tw, CV_8UC1);
 
     // first, collect min/max statistics for each tile
-    for (int ty = 0; ty < th; ty++) {
-        for (int tx = 0; tx < tw; tx++) {
-            uint8_t max = 0, min = 255;
+    parallel_for_(Range(0, th), [&](const Range& range) {
+        for (int ty = range.start; ty < range.end; ty++) {
+            uint8_t *max_row = im_max.ptr<uint8_t>(ty), *min_row = im_min.ptr<uint8_t>(ty);
+            int tx = 0;
+#if CV_SIMD128
+            // deinterleaving by 4 puts each column of 16 consecutive tiles into its own vector
+            static_assert(tilesz == 4, "the vectorized tile statistics assume 4 pixel wide tiles");
+            for (; tx <= tw - v_uint8x16::nlanes; tx += v_uint8x16::nlanes) {
+                v_uint8x16 vmax = v_setzero_u8(), vmin = v_setall_u8(255);
+                for (int dy = 0; dy < tilesz; dy++) {
+                    v_uint8x16 a, b, c, d;
+                    v_load_deinterleave(mIm.ptr<uint8_t>(ty*tilesz + dy) + tx*tilesz, a, b, c, d);
+                    vmax = v_max(vmax, v_max(v_max(a, b), v_max(c, d)));
+                    vmin = v_min(vmin, v_min(v_min(a, b), v_min(c, d)));
+                }
+                v_store(max_row + tx, vmax);
+                v_store(min_row + tx, vmin);
+            }
+#endif
+            for (; tx < tw; tx++) {
+                uint8_t max = 0, min = 255;
 
-            for (int dy = 0; dy < tilesz; dy++) {
+                for (int dy = 0; dy < tilesz; dy++) {
 
-                for (int dx = 0; dx < tilesz; dx++) {
+                    for (int dx = 0; dx < tilesz; dx++) {
 
-                    uint8_t v = mIm.data[(ty*tilesz+dy)*s + tx*tilesz + dx];
-                    if (v < min)
-                        min = v;
-                    if (v > max)
-                        max = v;
+                        uint8_t v = mIm.data[(ty*tilesz+dy)*s + tx*tilesz + dx];
+                        if (v < min)
+                            min = v;
+                        if (v > max)
+                            max = v;
+                    }
                 }
+                max_row[tx] = max;
+                min_row[tx] = min;
             }
-            im_max[ty*tw+tx] = max;
-            im_min[ty*tw+tx] = min;
         }
-    }
+    });
 
     // second, apply 3x3 max/min convolution to "blur" these values
     // over larger areas. This reduces artifacts due to abrupt changes
-    // in the threshold value.
-    uint8_t *im_max_tmp = (uint8_t*)calloc(tw*th, sizeof(uint8_t));
-    uint8_t *im_min_tmp = (uint8_t*)calloc(tw*th, sizeof(uint8_t));
-
-    for (int ty = 0; ty < th; ty++) {
-        for (int tx = 0; tx < tw; tx++) {
-            uint8_t max = 0, min = 255;
-
-            for (int dy = -1; dy <= 1; dy++) {
-                if (ty+dy < 0 || ty+dy >= th)
-                    continue;
-                for (int dx = -1; dx <= 1; dx++) {
-                    if (tx+dx < 0 || tx+dx >= tw)
-                        continue;
-
-                    uint8_t m = im_max[(ty+dy)*tw+tx+dx];
-                    if (m > max)
-                        max = m;
-                    m = im_min[(ty+dy)*tw+tx+dx];
-                    if (m < min)
-                        min = m;
-                }
-            }
-
-            im_max_tmp[ty*tw + tx] = max;
-            im_min_tmp[ty*tw + tx] = min;
-        }
+    // in the threshold value. The default border of dilate/erode ignores
+    // the tiles outside of the image.
+    if (!im_max.empty()) {
+        dilate(im_max, im_max, Mat());
+        erode(im_min, im_min, Mat());
     }
-    free(im_max);
-    free(im_min);
-    im_max = im_max_tmp;
-    im_min = im_min_tmp;
-
-    for (int ty = 0; ty < th; ty++) {
-        for (int tx = 0; tx < tw; tx++) {
 
-            int min_ = im_min[ty*tw + tx];
-            int max_ = im_max[ty*tw + tx];
+    const int minWhiteBlackDiff = parameters->aprilTagMinWhiteBlackDiff;
+    parallel_for_(Range(0, th), [&](const Range& range) {
+        // per-pixel threshold and low contrast mask of a row of tiles
+        AutoBuffer<uint8_t> _buf(2*tw*tilesz + 1);
+        uint8_t *thresh_row = _buf.data(), *low_row = thresh_row + tw*tilesz;
 
-            // low contrast region? (no edges)
-            if (max_ - min_ < parameters->aprilTagMinWhiteBlackDiff) {
-                for (int dy = 0; dy < tilesz; dy++) {
-                    int y = ty*tilesz + dy;
+        for (int ty = range.start; ty < range.end; ty++) {
+            const uint8_t *max_row = im_max.ptr<uint8_t>(ty), *min_row = im_min.ptr<uint8_t>(ty);
+            for (int tx = 0; tx < tw; tx++) {
+                int min_ = min_row[tx];
+                int max_ = max_row[tx];
 
-                    for (int dx = 0; dx < tilesz; dx++) {
-                        int x = tx*tilesz + dx;
+                // low contrast region? (no edges)
+                uint8_t low = (max_ - min_ < minWhiteBlackDiff) ? 255 : 0;
 
-                        //threshim->buf[y*s+x] = 127;
-                        mThresh.data[y*s+x] = 127;
-                    }
+                // argument for biasing towards dark; specular highlights
+                // can be substantially brighter than white tag parts
+                uint8_t thresh = saturate_cast<uint8_t>((max_ + min_) / 2);
+                for (int dx = 0; dx < tilesz; dx++) {
+                    thresh_row[tx*tilesz + dx] = thresh;
+                    low_row[tx*tilesz + dx] = low;
                 }
-                continue;
             }
 
-            // otherwise, actually threshold this tile.
-
-            // argument for biasing towards dark; specular highlights
-            // can be substantially brighter than white tag parts
-            uint8_t thresh = saturate_cast<uint8_t>((max_ + min_) / 2);
-
+            // low contrast tiles are marked with 127, the others are actually thresholded
             for (int dy = 0; dy < tilesz; dy++) {
                 int y = ty*tilesz + dy;
-
-                for (int dx = 0; dx < tilesz; dx++) {
-                    int x = tx*tilesz + dx;
-
-                    uint8_t v = mIm.data[y*s+x];
-                    mThresh.data[y*s+x] = (v > thresh) ? 255 : 0;
+                const uint8_t *src = mIm.ptr<uint8_t>(y);
+                uint8_t *dst = mThresh.ptr<uint8_t>(y);
+                int x = 0;
+#if CV_SIMD128
+                const v_uint8x16 v127 = v_setall_u8(127);
+                for (; x <= tw*tilesz - v_uint8x16::nlanes; x += v_uint8x16::nlanes) {
+                    v_uint8x16 v = v_load(src + x);
+                    v_uint8x16 bin = v > v_load(thresh_row + x);
+                    v_store(dst + x, v_select(v_load(low_row + x), v127, bin));
                 }
+#endif
+                for (; x < tw*tilesz; x++)
+                    dst[x] = low_row[x] ? 127 : ((src[x] > thresh_row[x]) ? 255 : 0);
             }
         }
-    }
+    });
 
     // we skipped over the non-full-sized tiles above. Fix those now.
     for (int y = 0; y < h; y++) {
@@ -1229,8 +1225,8 @@ void threshold(const Mat mIm, const Ptr<DetectorParameters> &parameters, Mat& mT
             if (tx >= tw)
                 tx = tw - 1;
 
-            int max = im_max[ty*tw + tx];
-            int min = im_min[ty*tw + tx];
+            int max = im_max.at<uint8_t>(ty, tx);
+            int min = im_min.at<uint8_t>(ty, tx);
             int thresh = min + (max - min) / 2;
 
             uint8_t v = mIm.data[y*s+x];
@@ -1242,8 +1238,6 @@ void threshold(const Mat mIm, const Ptr<DetectorParameters> &parameters, Mat& mT
             }
         }
     }
-    free(im_min);
-    free(im_max);
 
     // this is a dilate/erode deglitching scheme that does not improve
     // anything as far as I can tell.
@@ -1311,8 +1305,22 @@ zarray_t *apriltag_quad_thresh(const Ptr<DetectorParameters> &parameters, const
 
     unionfind_t *uf = unionfind_create(w * h);
 
-    // TODO PARALLELIZE
-    for (int y = 0; y < h - 1; y++) {
+    // Each strip only links the pixels of its own rows, so the trees of
+    // different strips never share nodes and the strips can be processed
+    // concurrently without any locking. The rows on the strip seams are
+    // linked afterwards. The strip height is fixed to keep the
+    // representatives (and thus the cluster order) independent of the
+    // number of threads.
+    const int strip_height = 64;
+    parallel_for_(Range(0, (h + strip_height - 1) / strip_height), [&](const Range& range) {
+        for (int i = range.start; i < range.end; i++) {
+            int y1 = std::min((i + 1) * strip_height, h);
+            for (int y = i * strip_height; y < y1 - 1; y++) {
+                do_unionfind_line(uf, thold, w, ts, y);
+            }
+        }
+    });
+    for (int y = strip_height - 1; y < h - 1; y += strip_height) {
         do_unionfind_line(uf, thold, w, ts, y);
     }
 
@@ -1321,15 +1329,37 @@ zarray_t *apriltag_quad_thresh(const Ptr<DetectorParameters> &parameters, const
 
     struct uint64_zarray_entry **clustermap = (struct uint64_zarray_entry**)calloc(nclustermap, sizeof(struct uint64_zarray_entry*));
 
-    for (int y = 1; y < h-1; y++) {
+    // the representatives are resolved once per pixel, a band of rows at a
+    // time. The finds do not compress the paths so they only read the
+    // union-find data. DO_CONN also reads the labels of the row below the
+    // band and of the border columns.
+    const int band_height = 64;
+    std::vector<uint32_t> labels((band_height + 1) * w);
+    for (int band_y = 1; band_y < h-1; band_y += band_height) {
+        int band_end = std::min(band_y + band_height, h-1);
+        parallel_for_(Range(band_y, band_end + 1), [&](const Range& range) {
+            for (int y = range.start; y < range.end; y++) {
+                uint32_t *label_row = &labels[(y - band_y)*w];
+                for (int x = 0; x < w; x++) {
+                    if (thold.data[y*ts + x] == 127)
+                        continue;
+                    uint32_t root = y*w + x;
+                    while (uf->data[root].parent != root)
+                        root = uf->data[root].parent;
+                    label_row[x] = root;
+                }
+            }
+        });
+
+    for (int y = band_y; y < band_end; y++) {
+        const uint32_t *label_row = &labels[(y - band_y)*w];
         for (int x = 1; x < w-1; x++) {
 
             uint8_t v0 = thold.data[y*ts + x];
             if (v0 == 127)
                 continue;
 
-            // XXX don't query this until we know we need it?
-            uint64_t rep0 = unionfind_get_representative(uf, y*w + x);
+            uint64_t rep0 = label_row[x];
 
             // whenever we find two adjacent pixels such that one is
             // white and the other black, we add the point half-way
@@ -1356,7 +1386,7 @@ zarray_t *apriltag_quad_thresh(const Ptr<DetectorParameters> &parameters, const
             uint8_t v1 = thold.data[y*ts + dy*ts + x + dx];         \
             \
             if (v0 + v1 == 255) {                                   \
-                uint64_t rep1 = unionfind_get_representative(uf, y*w + dy*w + x + dx); \
+                uint64_t rep1 = label_row[dy*w + x + dx];           \
                 uint64_t clusterid;                                 \
                 if (rep0 < rep1)                                    \
                 clusterid = (rep1 << 32) + rep0;                \
@@ -1396,6 +1426,7 @@ zarray_t *apriltag_quad_thresh(const Ptr<DetectorParameters> &parameters, const
     DO_CONN(1, 1);
 }
 }
+}
 #undef DO_CONN
 
 #ifdef APRIL_DEBUG
@@ -1499,14 +1530,27 @@ out = Mat::zeros(h, w, CV_8UC3);
 
     zarray_t *quads = _zarray_create(sizeof(struct sQuad));
 
-    //int chunksize = 1 + sz / (APRILTAG_TASKS_PER_THREAD_TARGET * numberOfThreads);
-    int chunksize = std::max(1, h / (10 * getNumThreads()));
     int sz = _zarray_size(clusters);
-
-    // TODO PARALLELIZE
-    for (int i = 0; i < sz; i += chunksize) {
-        int min = sz < (i+chunksize)? sz: (i+chunksize);
-        do_quad(i, min, *clusters, w, h, quads, parameters, mImg);
+    int chunksize = std::max(1, sz / (10 * getNumThreads()));
+    int nchunks = (sz + chunksize - 1) / chunksize;
+
+    // quads of every chunk are collected separately and appended in the
+    // cluster order, so the result does not depend on the scheduling
+    std::vector<zarray_t*> chunk_quads(nchunks);
+    parallel_for_(Range(0, nchunks), [&](const Range& range) {
+        for (int i = range.start; i < range.end; i++) {
+            int min = sz < (i+1)*chunksize ? sz : (i+1)*chunksize;
+            chunk_quads[i] = _zarray_create(sizeof(struct sQuad));
+            do_quad(i*chunksize, min, *clusters, w, h, chunk_quads[i], parameters, mImg);
+        }
+    });
+    for (int i = 0; i < nchunks; i++) {
+        for (int j = 0; j < _zarray_size(chunk_quads[i]); j++) {
+            struct sQuad *quad;
+            _zarray_get_volatile(chunk_quads[i], j, &quad);
+            _zarray_add(quads, quad);
+        }
+        _zarray_destroy(chunk_quads[i]);
     }
 
 #ifdef APRIL_DEBUG
@@ -509,8 +509,8 @@ static int _getBorderErrors(const Mat &bits, int markerSize, int borderSize) {
  *                           1 if the candidate is a black candidate (default candidate)
  *                           2 if the candidate is a white candidate
  */
-static uint8_t _identifyOneCandidate(const Ptr<Dictionary>& dictionary, InputArray _image,
-                                  const vector<Point2f>& _corners, int& idx,
+static uint8_t _identifyOneCandidate(const Ptr<Dictionary>& dictionary, const DictionaryIndex& dictionaryIndex,
+                                  InputArray _image, const vector<Point2f>& _corners, int& idx,
                                   const Ptr<DetectorParameters>& params, int& rotation,
                                   const float scale = 1.f) {
     CV_DbgAssert(_corners.size() == 4);
@@ -557,7 +557,7 @@ static uint8_t _identifyOneCandidate(const Ptr<Dictionary>& dictionary, InputArr
             .colRange(params->markerBorderBits, candidateBits.cols - params->markerBorderBits);
 
     // try to indentify the marker
-    if(!dictionary->identify(onlyBits, idx, rotation, params->errorCorrectionRate))
+    if(!_identify(*dictionary, dictionaryIndex, onlyBits, idx, rotation, params->errorCorrectionRate))
         return 0;
 
     return typ;
@@ -614,6 +614,9 @@ static void _identifyCandidates(InputArray grey,
     vector< int > rotated(ncandidates, 0);
     vector< uint8_t > validCandidates(ncandidates, 0);
 
+    // the codeword index is looked up once for all the candidates
+    Ptr<const DictionaryIndex> dictionaryIndex = _getDictionaryIndex(*_dictionary);
+
     //// Analyze each of the candidates
     parallel_for_(Range(0, ncandidates), [&](const Range &range) {
         const int begin = range.start;
@@ -631,10 +634,10 @@ static void _identifyCandidates(InputArray grey,
                 const size_t nearestImgId = _findOptPyrImageForCanonicalImg(image_pyr, grey.cols(), perimeterOfContour, min_perimeter);
                 const float scale = image_pyr[nearestImgId].cols / static_cast<float>(grey.cols());
 
-                validCandidates[i] = _identifyOneCandidate(_dictionary, image_pyr[nearestImgId], candidates[i], currId, params, rotated[i], scale);
+                validCandidates[i] = _identifyOneCandidate(_dictionary, *dictionaryIndex, image_pyr[nearestImgId], candidates[i], currId, params, rotated[i], scale);
             }
             else {
-                validCandidates[i] = _identifyOneCandidate(_dictionary, grey, candidates[i], currId, params, rotated[i]);
+                validCandidates[i] = _identifyOneCandidate(_dictionary, *dictionaryIndex, grey, candidates[i], currId, params, rotated[i]);
             }
 
             if(validCandidates[i] > 0)
@@ -0,0 +1,200 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html
+
+#include "precomp.hpp"
+#include "opencv2/aruco_detector.hpp"
+#include "aruco_utils.hpp"
+
+namespace cv {
+namespace aruco {
+
+using namespace std;
+
+static inline double ticksToMs(int64 ticks) {
+    return ticks * 1000. / getTickFrequency();
+}
+
+/**
+  * @brief Merge overlapping rectangles until all of them are disjoint
+  */
+static void _mergeRois(vector<Rect>& rois) {
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (size_t i = 0; i < rois.size() && !merged; i++) {
+            for (size_t j = i + 1; j < rois.size(); j++) {
+                if ((rois[i] & rois[j]).area() > 0) {
+                    rois[i] |= rois[j];
+                    rois.erase(rois.begin() + j);
+                    merged = true;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+static inline Point2f _quadCenter(const vector<Point2f>& quad) {
+    return 0.25f * (quad[0] + quad[1] + quad[2] + quad[3]);
+}
+
+/**
+  * @brief Associates detections to tracks with the same id, closest pairs first
+  *
+  * Returns the index of the track of each detection, -1 for the detections which start a new track.
+  */
+static vector<int> _associate(const vector<int>& trackIds, const vector<Point2f>& trackCenters,
+                              const vector<int>& ids, const vector<vector<Point2f> >& corners) {
+    vector<pair<float, pair<int, int> > > pairs;
+    for (size_t d = 0; d < ids.size(); d++) {
+        const Point2f center = _quadCenter(corners[d]);
+        for (size_t t = 0; t < trackIds.size(); t++)
+            if (trackIds[t] == ids[d])
+                pairs.push_back(make_pair((float)norm(center - trackCenters[t]), make_pair((int)t, (int)d)));
+    }
+    sort(pairs.begin(), pairs.end());
+
+    vector<int> trackOf(ids.size(), -1);
+    vector<bool> trackUsed(trackIds.size(), false);
+    for (const auto& p : pairs) {
+        const int t = p.second.first, d = p.second.second;
+        if (trackUsed[t] || trackOf[d] >= 0)
+            continue;
+        trackUsed[t] = true;
+        trackOf[d] = t;
+    }
+    return trackOf;
+}
+
+ArucoTracker::ArucoTracker(const Ptr<ArucoDetector> &_detector, int _fullDetectionInterval, float _roiMargin):
+    detector(_detector), fullDetectionInterval(_fullDetectionInterval), roiMargin(_roiMargin), framesSinceFull(0) {}
+
+void ArucoTracker::reset() {
+    markers.clear();
+    frameSize = Size();
+    framesSinceFull = 0;
+    stats = ArucoTrackerStats();
+}
+
+ArucoTrackerStats ArucoTracker::getStats() const {
+    return stats;
+}
+
+void ArucoTracker::track(InputArray _image, OutputArrayOfArrays _corners, OutputArray _ids) {
+    CV_Assert(!_image.empty());
+    CV_Assert(!detector.empty());
+    CV_Assert(roiMargin >= 0.f);
+
+    Mat image = _image.getMat();
+    if (image.size() != frameSize) {
+        markers.clear();
+        frameSize = image.size();
+    }
+
+    stats.predictionTime = stats.roiDetectionTime = stats.fullDetectionTime = 0.;
+    stats.numRois = 0;
+    stats.frames++;
+
+    vector<vector<Point2f> > corners;
+    vector<int> ids;
+    bool fullDetection = markers.empty() || fullDetectionInterval <= 1 || framesSinceFull + 1 >= fullDetectionInterval;
+
+    // constant velocity prediction of every track
+    vector<int> trackIds(markers.size());
+    vector<Point2f> trackCenters(markers.size());
+    for (size_t t = 0; t < markers.size(); t++) {
+        trackIds[t] = markers[t].id;
+        trackCenters[t] = _quadCenter(markers[t].corners);
+        if (markers[t].hasVelocity)
+            trackCenters[t] = 2.f * trackCenters[t] - _quadCenter(markers[t].prevCorners);
+    }
+
+    if (!fullDetection) {
+        int64 t0 = getTickCount();
+
+        // the search region also covers the previous position
+        const Rect imageRect(Point(0, 0), frameSize);
+        vector<Rect> rois;
+        rois.reserve(markers.size());
+        for (const TrackedMarker& marker : markers) {
+            const vector<Point2f>& cur = marker.corners;
+            vector<Point2f> pts(cur);
+            float side = 0.f;
+            for (int c = 0; c < 4; c++) {
+                side = max(side, (float)norm(cur[c] - cur[(c + 1) % 4]));
+                if (marker.hasVelocity)
+                    pts.push_back(2.f * cur[c] - marker.prevCorners[c]);
+            }
+            Rect roi = boundingRect(pts);
+            const int margin = cvCeil(roiMargin * side);
+            roi.x -= margin;
+            roi.y -= margin;
+            roi.width += 2 * margin;
+            roi.height += 2 * margin;
+            roi &= imageRect;
+            if (roi.area() > 0)
+                rois.push_back(roi);
+        }
+        _mergeRois(rois);
+        stats.numRois = (int)rois.size();
+
+        int64 t1 = getTickCount();
+        stats.predictionTime = ticksToMs(t1 - t0);
+
+        // regions are processed sequentially: detectMarkers() adjusts the shared detector parameters,
+        // they are disjoint so every marker is found at most once
+        for (const Rect& roi : rois) {
+            vector<vector<Point2f> > roiCorners;
+            vector<int> roiIds;
+            detector->detectMarkers(image(roi), roiCorners, roiIds);
+            const Point2f offset((float)roi.x, (float)roi.y);
+            for (size_t i = 0; i < roiIds.size(); i++) {
+                for (Point2f& pt : roiCorners[i])
+                    pt += offset;
+                ids.push_back(roiIds[i]);
+                corners.push_back(roiCorners[i]);
+            }
+        }
+        stats.roiDetectionTime = ticksToMs(getTickCount() - t1);
+
+        // a lost marker may have left its search region, look for it in the whole frame
+        vector<int> trackOf = _associate(trackIds, trackCenters, ids, corners);
+        if (count_if(trackOf.begin(), trackOf.end(), [](int t) { return t >= 0; }) < (int)markers.size()) {
+            stats.trackingLosses++;
+            fullDetection = true;
+        }
+    }
+
+    if (fullDetection) {
+        int64 t0 = getTickCount();
+        corners.clear();
+        ids.clear();
+        detector->detectMarkers(image, corners, ids);
+        stats.fullDetectionTime = ticksToMs(getTickCount() - t0);
+        stats.fullDetections++;
+        framesSinceFull = 0;
+    }
+    else
+        framesSinceFull++;
+    stats.fullDetection = fullDetection;
+
+    // update the state, markers which are not detected anymore are dropped
+    vector<int> trackOf = _associate(trackIds, trackCenters, ids, corners);
+    vector<TrackedMarker> updated(ids.size());
+    for (size_t i = 0; i < ids.size(); i++) {
+        TrackedMarker& marker = updated[i];
+        marker.id = ids[i];
+        marker.corners = corners[i];
+        marker.hasVelocity = trackOf[i] >= 0;
+        if (marker.hasVelocity)
+            marker.prevCorners = markers[trackOf[i]].corners;
+    }
+    markers.swap(updated);
+
+    _copyVector2Output(corners, _corners);
+    Mat(ids).copyTo(_ids);
+}
+
+}
+}
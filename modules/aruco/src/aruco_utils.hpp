@@ -5,6 +5,7 @@
 #define __OPENCV_ARUCO_UTILS_HPP__
 
 #include <opencv2/core.hpp>
+#include <opencv2/aruco/dictionary.hpp>
 #include <vector>
 
 namespace cv {
@@ -20,6 +21,22 @@ void _copyVector2Output(std::vector<std::vector<Point2f> > &vec, OutputArrayOfAr
   */
 void _convertToGrey(InputArray _in, OutputArray _out);
 
+struct DictionaryIndex;
+
+/**
+ * @brief Returns the hash index of the dictionary codewords used by Dictionary::identify()
+ *
+ * The indexes are cached for the most recently used dictionaries and shared by the dictionaries with the same
+ * bytesList data, dimensions, markerSize and maxCorrectionBits.
+ */
+Ptr<const DictionaryIndex> _getDictionaryIndex(const Dictionary& dictionary);
+
+/**
+ * @brief Same as Dictionary::identify(), with an index returned by _getDictionaryIndex() for the dictionary
+ */
+bool _identify(const Dictionary& dictionary, const DictionaryIndex& index, const Mat& onlyBits, int& idx,
+               int& rotation, double maxCorrectionRate);
+
 template<typename T>
 inline bool readParameter(const std::string& name, T& parameter, const FileNode& node)
 {
@@ -4,6 +4,7 @@
 
 #include <opencv2/imgproc.hpp>
 #include "opencv2/core/hal/hal.hpp"
+#include <unordered_map>
 
 #include "precomp.hpp"
 #include "aruco_utils.hpp"
@@ -88,16 +89,170 @@ Ptr<Dictionary> Dictionary::get(int dict) {
 }
 
 
+/**
+ * @brief Hash index of the dictionary codewords, for codewords of up to 64 bits.
+ * Every marker rotation is packed into a 64-bit code. Exact matches are looked up in one table.
+ * Matches within maxCorrectionBits are found by multi-index hashing: the code bits are split into
+ * maxCorrectionBits+1 disjoint parts, so any codeword within that distance is equal to the
+ * candidate on at least one part, and is found in the table of that part.
+ */
+struct DictionaryIndex {
+    // dictionary state the index was built from, the header keeps the data alive so that
+    // its address can't be reused by another dictionary while the index is cached
+    Mat bytes;
+    int markerSize, maxCorrectionBits;
+
+    // packed codes, codes[4*m + r] is marker m in rotation r
+    std::vector<uint64> codes;
+    // masks of the bit parts, empty if codes do not fit in 64 bits
+    std::vector<uint64> partMasks;
+    // code (or code part) -> sorted list of 4*m + r
+    std::unordered_map<uint64, std::vector<int> > exact;
+    std::vector<std::unordered_map<uint64, std::vector<int> > > parts;
+
+    bool isValidFor(const Dictionary& d) const {
+        return bytes.data == d.bytesList.data && bytes.rows == d.bytesList.rows && bytes.cols == d.bytesList.cols &&
+               bytes.type() == d.bytesList.type() && bytes.step == d.bytesList.step &&
+               markerSize == d.markerSize && maxCorrectionBits == d.maxCorrectionBits;
+    }
+
+    static uint64 pack(const uchar* bytes, int nbytes) {
+        uint64 code = 0;
+        for(int j = 0; j < nbytes; j++)
+            code |= (uint64)bytes[j] << (8 * j);
+        return code;
+    }
+
+    static int distance(uint64 a, uint64 b) {
+        uint64 x = a ^ b;
+        return cv::hal::normHamming((const uchar*)&x, sizeof(x));
+    }
+};
+
+
+static Ptr<DictionaryIndex> _buildDictionaryIndex(const Dictionary& dictionary) {
+    Ptr<DictionaryIndex> index = makePtr<DictionaryIndex>();
+    index->bytes = dictionary.bytesList;
+    index->markerSize = dictionary.markerSize;
+    index->maxCorrectionBits = dictionary.maxCorrectionBits;
+
+    const Mat& bytes = index->bytes;
+    const int nbits = dictionary.markerSize * dictionary.markerSize;
+    const int nbytes = (nbits + 8 - 1) / 8;
+    if(bytes.empty() || nbits > 64 || bytes.cols * bytes.channels() != 4 * nbytes)
+        return index;
+
+    index->codes.resize(4 * bytes.rows);
+    for(int m = 0; m < bytes.rows; m++)
+        for(int r = 0; r < 4; r++)
+            index->codes[4 * m + r] = DictionaryIndex::pack(bytes.ptr(m) + r * nbytes, nbytes);
+
+    // bits in use: whole bytes, then the low bits of the last byte
+    std::vector<int> usedBits;
+    for(int b = 0; b < 8 * nbytes; b++)
+        if(b < 8 * (nbytes - 1) || b % 8 < nbits - 8 * (nbytes - 1))
+            usedBits.push_back(b);
+
+    // parts of less than 4 bits would hit most of the dictionary, use the linear search instead
+    const int nparts = dictionary.maxCorrectionBits + 1;
+    if(dictionary.maxCorrectionBits > 0 && nbits / nparts >= 4) {
+        index->partMasks.assign(nparts, 0);
+        for(int k = 0; k < nbits; k++)
+            index->partMasks[k * nparts / nbits] |= (uint64)1 << usedBits[k];
+        index->parts.resize(nparts);
+    }
+
+    for(int i = 0; i < (int)index->codes.size(); i++) {
+        uint64 code = index->codes[i];
+        index->exact[code].push_back(i);
+        for(int p = 0; p < (int)index->partMasks.size(); p++)
+            index->parts[p][code & index->partMasks[p]].push_back(i);
+    }
+    return index;
+}
+
+
+Ptr<const DictionaryIndex> _getDictionaryIndex(const Dictionary& dictionary) {
+    // most recently used first, the lookup only compares pointers and sizes
+    static const size_t maxCachedIndexes = 16;
+    static std::vector<Ptr<DictionaryIndex> > cache;
+    static Mutex cacheMutex;
+
+    AutoLock lock(cacheMutex);
+    for(size_t i = 0; i < cache.size(); i++) {
+        if(cache[i]->isValidFor(dictionary)) {
+            std::rotate(cache.begin(), cache.begin() + i, cache.begin() + i + 1);
+            return cache[0];
+        }
+    }
+
+    if(cache.size() >= maxCachedIndexes)
+        cache.pop_back();
+    cache.insert(cache.begin(), _buildDictionaryIndex(dictionary));
+    return cache[0];
+}
+
+
 bool Dictionary::identify(const Mat &onlyBits, int &idx, int &rotation, double maxCorrectionRate) const {
+    return _identify(*this, *_getDictionaryIndex(*this), onlyBits, idx, rotation, maxCorrectionRate);
+}
+
+
+bool _identify(const Dictionary& dictionary, const DictionaryIndex& index, const Mat &onlyBits, int &idx,
+               int &rotation, double maxCorrectionRate) {
+    const int markerSize = dictionary.markerSize, maxCorrectionBits = dictionary.maxCorrectionBits;
+    const Mat& bytesList = dictionary.bytesList;
     CV_Assert(onlyBits.rows == markerSize && onlyBits.cols == markerSize);
+    CV_DbgAssert(index.isValidFor(dictionary));
 
     int maxCorrectionRecalculed = int(double(maxCorrectionBits) * maxCorrectionRate);
 
     // get as a byte list
-    Mat candidateBytes = getByteListFromBits(onlyBits);
+    Mat candidateBytes = Dictionary::getByteListFromBits(onlyBits);
 
     idx = -1; // by default, not found
 
+    // indexed search, it returns the same marker as the linear search below:
+    // the lowest id within the correction distance, in its closest rotation
+    if(!index.codes.empty() && maxCorrectionRecalculed <= maxCorrectionBits &&
+       (maxCorrectionRecalculed <= 0 || !index.partMasks.empty())) {
+        uint64 code = DictionaryIndex::pack(candidateBytes.ptr(), candidateBytes.cols);
+
+        std::vector<int> candidates;
+        std::unordered_map<uint64, std::vector<int> >::const_iterator it = index.exact.find(code);
+        if(it != index.exact.end())
+            candidates = it->second;
+        if(maxCorrectionRecalculed > 0) {
+            for(size_t p = 0; p < index.partMasks.size(); p++) {
+                it = index.parts[p].find(code & index.partMasks[p]);
+                if(it != index.parts[p].end())
+                    candidates.insert(candidates.end(), it->second.begin(), it->second.end());
+            }
+            std::sort(candidates.begin(), candidates.end());
+        }
+
+        for(size_t c = 0; c < candidates.size(); c++) {
+            int m = candidates[c] / 4;
+            if(c > 0 && m == candidates[c - 1] / 4)
+                continue;
+            int currentMinDistance = markerSize * markerSize + 1;
+            int currentRotation = -1;
+            for(int r = 0; r < 4; r++) {
+                int currentHamming = DictionaryIndex::distance(index.codes[4 * m + r], code);
+                if(currentHamming < currentMinDistance) {
+                    currentMinDistance = currentHamming;
+                    currentRotation = r;
+                }
+            }
+            if(currentMinDistance <= maxCorrectionRecalculed) {
+                idx = m;
+                rotation = currentRotation;
+                break;
+            }
+        }
+        return idx != -1;
+    }
+
     // search closest marker in dict
     for(int m = 0; m < bytesList.rows; m++) {
         int currentMinDistance = markerSize * markerSize + 1;
@@ -725,6 +725,113 @@ TEST(CV_ArucoDetectMarkers, regression_2492)
     }
 }
 
+TEST(CV_ArucoDetectMarkers, apriltag_marker_at_image_border)
+{
+    // the marker border is one pixel away from the right and bottom image borders,
+    // the quad edges are built from the labels of the last column and the last row
+    aruco::ArucoDetector detector(aruco::getPredefinedDictionary(aruco::DICT_APRILTAG_36h11));
+    detector.params->cornerRefinementMethod = aruco::CORNER_REFINE_APRILTAG;
+    const int markerSide = 120, id = 7;
+    Mat marker, img(200, 200, CV_8UC1, Scalar::all(255));
+    aruco::drawMarker(detector.dictionary, id, markerSide, marker);
+    const Point tl(img.cols - 1 - markerSide, img.rows - 1 - markerSide);
+    marker.copyTo(img(Rect(tl, Size(markerSide, markerSide))));
+
+    vector<vector<Point2f> > corners;
+    vector<int> ids;
+    detector.detectMarkers(img, corners, ids);
+
+    ASSERT_EQ(1ull, ids.size());
+    EXPECT_EQ(id, ids[0]);
+    const Point2f goldCorners[4] = { Point2f(tl), Point2f(tl + Point(markerSide, 0)),
+                                     Point2f(tl + Point(markerSide, markerSide)), Point2f(tl + Point(0, markerSide)) };
+    for (int j = 0; j < 4; j++)
+        EXPECT_LE(cv::norm(goldCorners[j] - corners[0][j]), 2.) << "corner " << j;
+}
+
+TEST(CV_ArucoTracker, moving_markers_match_detection)
+{
+    Ptr<aruco::ArucoDetector> detector = makePtr<aruco::ArucoDetector>(aruco::getPredefinedDictionary(aruco::DICT_4X4_50));
+    aruco::ArucoTracker tracker(detector, 10);
+    const int markerSide = 80, numMarkers = 3, numFrames = 12;
+    vector<Mat> markerImgs(numMarkers);
+    for (int id = 0; id < numMarkers; id++)
+        aruco::drawMarker(detector->dictionary, id, markerSide, markerImgs[id]);
+
+    for (int frame = 0; frame < numFrames; frame++)
+    {
+        // markers move with different speeds, marker 2 disappears at frame 6
+        Mat img(480, 640, CV_8UC1, Scalar::all(255));
+        for (int id = 0; id < numMarkers; id++)
+        {
+            if (id == 2 && frame >= 6)
+                continue;
+            Point tl(40 + 180*id + frame*(id + 1), 100 + 60*id + frame*3);
+            markerImgs[id].copyTo(img(Rect(tl, Size(markerSide, markerSide))));
+        }
+
+        vector<vector<Point2f> > goldCorners, corners;
+        vector<int> goldIds, ids;
+        detector->detectMarkers(img, goldCorners, goldIds);
+        tracker.track(img, corners, ids);
+
+        aruco::ArucoTrackerStats stats = tracker.getStats();
+        EXPECT_EQ(frame == 0 || frame == 6, stats.fullDetection) << "frame " << frame;
+        ASSERT_EQ(goldIds.size(), ids.size()) << "frame " << frame;
+        for (size_t i = 0; i < goldIds.size(); i++)
+        {
+            size_t j = std::find(ids.begin(), ids.end(), goldIds[i]) - ids.begin();
+            ASSERT_LT(j, ids.size()) << "frame " << frame;
+            for (int c = 0; c < 4; c++)
+                EXPECT_LE(cv::norm(goldCorners[i][c] - corners[j][c]), 1.) << "frame " << frame;
+        }
+    }
+    EXPECT_EQ(1, tracker.getStats().trackingLosses);
+    EXPECT_EQ(2, tracker.getStats().fullDetections);
+}
+
+TEST(CV_ArucoTracker, markers_sharing_id)
+{
+    Ptr<aruco::ArucoDetector> detector = makePtr<aruco::ArucoDetector>(aruco::getPredefinedDictionary(aruco::DICT_4X4_50));
+    aruco::ArucoTracker tracker(detector, 20);
+    const int markerSide = 80, numFrames = 10, id = 5;
+    Mat markerImg;
+    aruco::drawMarker(detector->dictionary, id, markerSide, markerImg);
+
+    for (int frame = 0; frame < numFrames; frame++)
+    {
+        // two copies of the same marker move in opposite directions
+        Mat img(480, 640, CV_8UC1, Scalar::all(255));
+        markerImg.copyTo(img(Rect(Point(60 + 6*frame, 80 + 2*frame), Size(markerSide, markerSide))));
+        markerImg.copyTo(img(Rect(Point(480 - 6*frame, 300 - 2*frame), Size(markerSide, markerSide))));
+
+        vector<vector<Point2f> > goldCorners, corners;
+        vector<int> goldIds, ids;
+        detector->detectMarkers(img, goldCorners, goldIds);
+        tracker.track(img, corners, ids);
+
+        ASSERT_EQ(2ull, goldIds.size()) << "frame " << frame;
+        ASSERT_EQ(goldIds.size(), ids.size()) << "frame " << frame;
+        EXPECT_EQ(frame == 0, tracker.getStats().fullDetection) << "frame " << frame;
+        for (size_t i = 0; i < goldIds.size(); i++)
+        {
+            // both detections have the same id, compare with the closest one
+            double minDist = DBL_MAX;
+            for (size_t j = 0; j < ids.size(); j++)
+            {
+                EXPECT_EQ(id, ids[j]);
+                double dist = 0.;
+                for (int c = 0; c < 4; c++)
+                    dist = max(dist, cv::norm(goldCorners[i][c] - corners[j][c]));
+                minDist = min(minDist, dist);
+            }
+            EXPECT_LE(minDist, 1.) << "frame " << frame;
+        }
+    }
+    EXPECT_EQ(0, tracker.getStats().trackingLosses);
+    EXPECT_EQ(1, tracker.getStats().fullDetections);
+}
+
 struct ArucoThreading: public testing::TestWithParam<cv::aruco::CornerRefineMethod>
 {
     struct NumThreadsSetter {
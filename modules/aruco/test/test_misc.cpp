@@ -24,4 +24,81 @@ TEST(CV_ArucoDrawMarker, regression_1226)
     });
 }
 
+TEST(CV_ArucoDictionary, identify_matches_linear_search)
+{
+    RNG& rng = theRNG();
+    const int dicts[] = { cv::aruco::DICT_4X4_1000, cv::aruco::DICT_5X5_50, cv::aruco::DICT_6X6_250,
+                          cv::aruco::DICT_7X7_50, cv::aruco::DICT_ARUCO_ORIGINAL, cv::aruco::DICT_APRILTAG_36h11 };
+    for (size_t d = 0; d < sizeof(dicts)/sizeof(dicts[0]); d++)
+    {
+        cv::Ptr<cv::aruco::Dictionary> dict = cv::aruco::getPredefinedDictionary(dicts[d]);
+        const int markerSize = dict->markerSize;
+        for (int i = 0; i < 500; i++)
+        {
+            cv::Mat bits;
+            if (i % 2 == 0)
+            {
+                bits = cv::aruco::Dictionary::getBitsFromByteList(dict->bytesList.row(rng.uniform(0, dict->bytesList.rows)), markerSize);
+                for (int e = rng.uniform(0, dict->maxCorrectionBits + 2); e > 0; e--)
+                    bits.at<uchar>(rng.uniform(0, markerSize), rng.uniform(0, markerSize)) ^= 1;
+            }
+            else
+            {
+                bits.create(markerSize, markerSize, CV_8UC1);
+                rng.fill(bits, RNG::UNIFORM, 0, 2);
+            }
+
+            for (double rate = 0.; rate <= 1.; rate += 0.5)
+            {
+                // reference: first marker within the correction distance
+                const int maxCorrection = int(double(dict->maxCorrectionBits) * rate);
+                int expectedIdx = -1;
+                for (int m = 0; m < dict->bytesList.rows && expectedIdx < 0; m++)
+                    if (dict->getDistanceToId(bits, m) <= maxCorrection)
+                        expectedIdx = m;
+
+                int idx = -1, rotation = -1;
+                bool found = dict->identify(bits, idx, rotation, rate);
+                ASSERT_EQ(expectedIdx >= 0, found) << "dictionary " << dicts[d] << ", candidate " << i;
+                ASSERT_EQ(expectedIdx, idx) << "dictionary " << dicts[d] << ", candidate " << i;
+                if (found)
+                {
+                    EXPECT_GE(rotation, 0);
+                    EXPECT_LT(rotation, 4);
+                }
+            }
+        }
+    }
+}
+
+TEST(CV_ArucoDictionary, identify_after_bytes_list_assignment)
+{
+    cv::Ptr<cv::aruco::Dictionary> dict = cv::aruco::Dictionary::create(10, 5, 0);
+    cv::Mat bits = cv::aruco::Dictionary::getBitsFromByteList(dict->bytesList.row(3), dict->markerSize);
+    int idx = -1, rotation = -1;
+    ASSERT_TRUE(dict->identify(bits, idx, rotation, 0.));
+    EXPECT_EQ(3, idx);
+
+    // marker 1 gets the codes of marker 3 in a new bytesList
+    cv::Mat bytesList = dict->bytesList.clone();
+    bytesList.row(3).copyTo(bytesList.row(1));
+    dict->bytesList = bytesList;
+    ASSERT_TRUE(dict->identify(bits, idx, rotation, 0.));
+    EXPECT_EQ(1, idx);
+
+    // marker 3 changes, its old codes are now only found as marker 1
+    cv::Mat otherBits = bits.clone();
+    otherBits.at<uchar>(0, 0) ^= 1;
+    bytesList = dict->bytesList.clone();
+    cv::aruco::Dictionary::getByteListFromBits(otherBits).copyTo(bytesList.row(3));
+    dict->bytesList = bytesList;
+    ASSERT_TRUE(dict->identify(otherBits, idx, rotation, 0.));
+    EXPECT_EQ(3, idx);
+    EXPECT_EQ(0, rotation);
+
+    // a smaller dictionary sharing the data of the first rows
+    dict->bytesList = bytesList.rowRange(0, 2);
+    EXPECT_FALSE(dict->identify(otherBits, idx, rotation, 0.));
+}
+
 }} // namespace
@@ -123,6 +123,14 @@ public:
     */
     virtual void detect(cv::Mat &image, CV_OUT std::vector<ObjectDetection> &objects) = 0;
 
+    /** @brief Find rectangular regions in a batch of images, e.g. consecutive video frames.
+
+    The feature pyramids and the cascade buffers are allocated once and reused for all the images.
+    @param images Input images, unlike detect(cv::Mat&, std::vector<ObjectDetection>&) they are not modified.
+    @param objects The detections of each image: rectangulars, scores and class IDs.
+    */
+    virtual void detect(const std::vector<cv::Mat> &images, CV_OUT std::vector< std::vector<ObjectDetection> > &objects) = 0;
+
     /** @brief Return the class (model) names that were passed in constructor or method load or extracted from
     models filenames in those methods.
      */
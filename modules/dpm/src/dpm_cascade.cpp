@@ -218,21 +218,21 @@ void DPMCascade::computeRootPCAScores(vector< vector< Mat > > &rootScores)
     int interval = params.interval;
 
     for (int comp = 0; comp < model.numComponents; comp++)
-    {
         rootScores[comp].resize(nlevels);
-        ParalComputeRootPCAScores paralTask(pcaPyramid, model.rootPCAFilters[comp],
-                model.pcaDim, rootScores[comp]);
-        parallel_for_(Range(interval, nlevels), paralTask);
-    }
+
+    // all the components are convolved in a single pass per level
+    ParalComputeRootPCAScores paralTask(pcaPyramid, model.rootPCAFilters,
+            model.pcaDim, rootScores);
+    parallel_for_(Range(interval, nlevels), paralTask);
 }
 
 ParalComputeRootPCAScores::ParalComputeRootPCAScores(
         const vector< Mat > &pcaPyrad,
-        const Mat &f,
+        const vector< Mat > &f,
         int dim,
-        vector< Mat > &sc):
+        vector< vector< Mat > > &sc):
     pcaPyramid(pcaPyrad),
-    filter(f),
+    filters(f),
     pcaDim(dim),
     scores(sc)
 {
@@ -240,19 +240,14 @@ ParalComputeRootPCAScores::ParalComputeRootPCAScores(
 
 void ParalComputeRootPCAScores::operator() (const Range &range) const
 {
+    // convolution engine
+    ConvolutionEngine convEngine;
     for (int level = range.start; level != range.end; level++)
     {
-        Mat feat = pcaPyramid[level];
-
-        // compute size of output
-        int height = feat.rows - filter.rows + 1;
-        int width = (feat.cols - filter.cols) / pcaDim + 1;
-
-        Mat result = Mat::zeros(Size(width, height), CV_64F);
-        // convolution engine
-        ConvolutionEngine convEngine;
-        convEngine.convolve(feat, filter, pcaDim, result);
-        scores[level] = result;
+        vector< Mat > results;
+        convEngine.convolve(pcaPyramid[level], filters, pcaDim, results);
+        for (size_t comp = 0; comp < results.size(); comp++)
+            scores[comp][level] = results[comp];
     }
 }
 
@@ -267,11 +262,6 @@ void DPMCascade::process( vector< vector<double> > &dets)
     int nlevels = (int)pyramid.size() - interval;
     CV_Assert(nlevels > 0);
 
-    // keep track of the PCA scores for each PCA filter
-    vector< vector< double > > pcaScore(model.numComponents);
-    for (int comp = 0; comp < model.numComponents; comp++)
-        pcaScore[comp].resize(model.numParts[comp]+1);
-
     // compute location scores
     vector< vector< double > > locationScores;
     computeLocationScores(locationScores);
@@ -280,143 +270,159 @@ void DPMCascade::process( vector< vector<double> > &dets)
     vector< vector< Mat > > rootPCAScores;
     computeRootPCAScores(rootPCAScores);
 
-    // process each model component and pyramid level
-    for (int comp = 0; comp < model.numComponents; comp++)
+    // the part scores of a pyramid level only use the convolution and
+    // distance transform caches of this level, so the levels are evaluated
+    // concurrently, each component and level into its own detection buffer
+    vector< vector< vector<double> > > levelDets(model.numComponents*nlevels);
+    parallel_for_(Range(0, nlevels), [&](const Range &range)
     {
-        for (int plevel = 0; plevel < nlevels; plevel++)
+        // keep track of the PCA scores for each PCA filter
+        vector< vector< double > > pcaScore(model.numComponents);
+        for (int comp = 0; comp < model.numComponents; comp++)
+            pcaScore[comp].resize(model.numParts[comp]+1);
+
+        for (int plevel = range.start; plevel < range.end; plevel++)
         {
-            // root filter pyramid level
-            int rlevel = plevel + interval;
-            double bias = model.bias[comp] + locationScores[comp][rlevel];
-            // get the scores of the first PCA filter
-            Mat rtscore = rootPCAScores[comp][rlevel];
-            // process each location in the current pyramid level
-            for (int rx = (int)ceil(padx/2.0); rx < rtscore.cols - (int)ceil(padx/2.0); rx++)
+            for (int comp = 0; comp < model.numComponents; comp++)
             {
-                for (int ry = (int)ceil(pady/2.0); ry < rtscore.rows - (int)ceil(pady/2.0); ry++)
+                vector< vector<double> > &compDets = levelDets[comp*nlevels + plevel];
+                // root filter pyramid level
+                int rlevel = plevel + interval;
+                double bias = model.bias[comp] + locationScores[comp][rlevel];
+                // get the scores of the first PCA filter
+                Mat rtscore = rootPCAScores[comp][rlevel];
+                // process each location in the current pyramid level
+                for (int rx = (int)ceil(padx/2.0); rx < rtscore.cols - (int)ceil(padx/2.0); rx++)
                 {
-                    // get stage 0 score
-                    double score = rtscore.at<double>(ry, rx) + bias;
-                    // record PCA score
-                    pcaScore[comp][0] = score - bias;
-                    // cascade stage 1 through 2*numparts + 2
-                    int stage = 1;
-                    int numstages = 2*model.numParts[comp] + 2;
-                    for(; stage < numstages; stage++)
+                    for (int ry = (int)ceil(pady/2.0); ry < rtscore.rows - (int)ceil(pady/2.0); ry++)
                     {
-                        double t = model.prunThreshold[comp][2*stage-1];
-                        // check for hypothesis pruning
-                        if (score < t)
-                            break;
-
-                        // pca == 1 if place filters
-                        // pca == 0 if place non-pca filters
-                        bool isPCA = (stage < model.numParts[comp] + 1 ? true : false);
-                        // get the part index
-                        // root parts have index -1, none-root part are indexed 0:numParts-1
-                        int part = model.partOrder[comp][stage] - 1;// partOrder
-
-                        if (part == -1)
+                        // get stage 0 score
+                        double score = rtscore.at<double>(ry, rx) + bias;
+                        // record PCA score
+                        pcaScore[comp][0] = score - bias;
+                        // cascade stage 1 through 2*numparts + 2
+                        int stage = 1;
+                        int numstages = 2*model.numParts[comp] + 2;
+                        for(; stage < numstages; stage++)
                         {
-                            // calculate the root non-pca score
-                            // and replace the PCA score
-                            double rscore = 0.0;
-                            if (isPCA)
+                            double t = model.prunThreshold[comp][2*stage-1];
+                            // check for hypothesis pruning
+                            if (score < t)
+                                break;
+
+                            // pca == 1 if place filters
+                            // pca == 0 if place non-pca filters
+                            bool isPCA = (stage < model.numParts[comp] + 1 ? true : false);
+                            // get the part index
+                            // root parts have index -1, none-root part are indexed 0:numParts-1
+                            int part = model.partOrder[comp][stage] - 1;// partOrder
+
+                            if (part == -1)
                             {
-                                rscore = convolutionEngine.convolve(pcaPyramid[rlevel],
-                                        model.rootPCAFilters[comp],
-                                        model.pcaDim, rx, ry);
+                                // calculate the root non-pca score
+                                // and replace the PCA score
+                                double rscore = 0.0;
+                                if (isPCA)
+                                {
+                                    rscore = convolutionEngine.convolve(pcaPyramid[rlevel],
+                                            model.rootPCAFilters[comp],
+                                            model.pcaDim, rx, ry);
+                                }
+                                else
+                                {
+                                    rscore = convolutionEngine.convolve(pyramid[rlevel],
+                                            model.rootFilters[comp],
+                                            model.numFeatures, rx, ry);
+                                }
+                                score += rscore - pcaScore[comp][0];
                             }
                             else
                             {
-                                rscore = convolutionEngine.convolve(pyramid[rlevel],
-                                        model.rootFilters[comp],
-                                        model.numFeatures, rx, ry);
-                            }
-                            score += rscore - pcaScore[comp][0];
-                        }
-                        else
+                                // place a non-root filter
+                                int pId = model.pFind[comp][part];
+                                int px = 2*rx + (int)model.anchors[pId][0];
+                                int py = 2*ry + (int)model.anchors[pId][1];
+
+                                // look up the filter and deformation model
+                                double defThreshold =
+                                    model.prunThreshold[comp][2*stage] - score;
+
+                                double ps = computePartScore(plevel, pId, px, py,
+                                        isPCA, defThreshold);
+
+                                if (isPCA)
+                                {
+                                    // record PCA filter score
+                                    pcaScore[comp][part+1] = ps;
+                                    // update the hypothesis score
+                                    score += ps;
+                                }
+                                else
+                                {
+                                    // update the hypothesis score by replacing
+                                    // the PCA score
+                                    score += ps - pcaScore[comp][part+1];
+                                } // isPCA == false
+                            } // part != -1
+
+                        } // stages
+
+                        // check if the hypothesis passed all stages with a
+                        // final score over the global threshold
+                        if (stage == numstages && score >= model.scoreThresh)
                         {
-                            // place a non-root filter
-                            int pId = model.pFind[comp][part];
-                            int px = 2*rx + (int)model.anchors[pId][0];
-                            int py = 2*ry + (int)model.anchors[pId][1];
+                            vector<double> coords;
+                            // compute and record image coordinates of the detection window
+                            double scale = model.sBin/scales[rlevel];
+                            double x1 = (rx-padx)*scale;
+                            double y1 = (ry-pady)*scale;
+                            double x2 = x1 + model.rootFilterDims[comp].width*scale - 1;
+                            double y2 = y1 + model.rootFilterDims[comp].height*scale - 1;
 
-                            // look up the filter and deformation model
-                            double defThreshold =
-                                model.prunThreshold[comp][2*stage] - score;
-
-                            double ps = computePartScore(plevel, pId, px, py,
-                                    isPCA, defThreshold);
-
-                            if (isPCA)
-                            {
-                                // record PCA filter score
-                                pcaScore[comp][part+1] = ps;
-                                // update the hypothesis score
-                                score += ps;
-                            }
-                            else
-                            {
-                                // update the hypothesis score by replacing
-                                // the PCA score
-                                score += ps - pcaScore[comp][part+1];
-                            } // isPCA == false
-                        } // part != -1
-
-                    } // stages
-
-                    // check if the hypothesis passed all stages with a
-                    // final score over the global threshold
-                    if (stage == numstages && score >= model.scoreThresh)
-                    {
-                        vector<double> coords;
-                        // compute and record image coordinates of the detection window
-                        double scale = model.sBin/scales[rlevel];
-                        double x1 = (rx-padx)*scale;
-                        double y1 = (ry-pady)*scale;
-                        double x2 = x1 + model.rootFilterDims[comp].width*scale - 1;
-                        double y2 = y1 + model.rootFilterDims[comp].height*scale - 1;
-
-                        coords.push_back(x1);
-                        coords.push_back(y1);
-                        coords.push_back(x2);
-                        coords.push_back(y2);
-
-                        // compute and record image coordinates of the part filters
-                        scale = model.sBin/scales[plevel];
-                        int featWidth = pyramid[plevel].cols/feature.dimHOG;
-                        for (int p = 0; p < model.numParts[comp]; p++)
-                        {
-                            int pId = model.pFind[comp][p];
-                            int probx = 2*rx + (int)model.anchors[pId][0];
-                            int proby = 2*ry + (int)model.anchors[pId][1];
-                            int offset = dtLevelOffset[plevel] +
-                                pId*featDimsProd[plevel] +
-                                (proby - pady)*featWidth +
-                                probx - padx;
-                            int px = dtArgmaxX[offset] + padx;
-                            int py = dtArgmaxY[offset] + pady;
-                            x1 = (px - 2*padx)*scale;
-                            y1 = (py - 2*pady)*scale;
-                            x2 = x1 + model.partFilterDims[p].width*scale - 1;
-                            y2 = y1 + model.partFilterDims[p].height*scale - 1;
                             coords.push_back(x1);
                             coords.push_back(y1);
                             coords.push_back(x2);
                             coords.push_back(y2);
-                        }
 
-                        // record component number and score
-                        coords.push_back(comp + 1);
-                        coords.push_back(score);
+                            // compute and record image coordinates of the part filters
+                            scale = model.sBin/scales[plevel];
+                            int featWidth = pyramid[plevel].cols/feature.dimHOG;
+                            for (int p = 0; p < model.numParts[comp]; p++)
+                            {
+                                int pId = model.pFind[comp][p];
+                                int probx = 2*rx + (int)model.anchors[pId][0];
+                                int proby = 2*ry + (int)model.anchors[pId][1];
+                                int offset = dtLevelOffset[plevel] +
+                                    pId*featDimsProd[plevel] +
+                                    (proby - pady)*featWidth +
+                                    probx - padx;
+                                int px = dtArgmaxX[offset] + padx;
+                                int py = dtArgmaxY[offset] + pady;
+                                x1 = (px - 2*padx)*scale;
+                                y1 = (py - 2*pady)*scale;
+                                x2 = x1 + model.partFilterDims[p].width*scale - 1;
+                                y2 = y1 + model.partFilterDims[p].height*scale - 1;
+                                coords.push_back(x1);
+                                coords.push_back(y1);
+                                coords.push_back(x2);
+                                coords.push_back(y2);
+                            }
+
+                            // record component number and score
+                            coords.push_back(comp + 1);
+                            coords.push_back(score);
 
-                        dets.push_back(coords);
-                    }
-                } // ry
-            } // rx
+                            compDets.push_back(coords);
+                        }
+                    } // ry
+                } // rx
+            } // for each component
         } // for each pyramid level
-    } // for each component
+    });
+
+    // gather the detections in the component and level order
+    for (size_t i = 0; i < levelDets.size(); i++)
+        dets.insert(dets.end(), levelDets[i].begin(), levelDets[i].end());
 }
 
 double DPMCascade::computePartScore(int plevel, int pId, int px, int py, bool isPCA, double defThreshold)
@@ -129,15 +129,15 @@ class DPMCascade
 };
 
 /** @brief This class convolves root PCA feature pyramid
- * and root PCA filters in parallel using Intel Threading
- * Building Blocks (TBB)
+ * and the root PCA filters of all components in parallel
+ * over the pyramid levels
  */
 class ParalComputeRootPCAScores : public ParallelLoopBody
 {
     public:
         // constructor
-        ParalComputeRootPCAScores(const std::vector< Mat > &pcaPyramid, const Mat &filter,\
-                int dim, std::vector< Mat > &scores);
+        ParalComputeRootPCAScores(const std::vector< Mat > &pcaPyramid, const std::vector< Mat > &filters,\
+                int dim, std::vector< std::vector< Mat > > &scores);
 
         // parallel loop body
         void operator() (const Range &range) const CV_OVERRIDE;
@@ -146,9 +146,9 @@ class ParalComputeRootPCAScores : public ParallelLoopBody
 
     private:
         const std::vector< Mat > &pcaPyramid;
-        const Mat &filter;
+        const std::vector< Mat > &filters;
         int pcaDim;
-        std::vector< Mat > &scores;
+        std::vector< std::vector< Mat > > &scores;
 };
 } // namespace dpm
 } // namespace cv
@@ -60,6 +60,8 @@ public:
 
     void detect(Mat &image, CV_OUT vector<ObjectDetection>& objects) CV_OVERRIDE;
 
+    void detect(const vector<Mat> &images, CV_OUT vector< vector<ObjectDetection> >& objects) CV_OVERRIDE;
+
     const vector<string>& getClassNames() const CV_OVERRIDE;
     size_t getClassCount() const CV_OVERRIDE;
     string extractModelName( const string& filename );
@@ -174,5 +176,20 @@ void DPMDetectorImpl::detect( Mat &image,
     }
 }
 
+void DPMDetectorImpl::detect( const vector<Mat> &images,
+        vector< vector<ObjectDetection> > &objectDetections)
+{
+    objectDetections.resize(images.size());
+
+    // the cascades keep their pyramids and buffers between the images
+    for( size_t i = 0; i < images.size(); i++ )
+    {
+        // only the header is copied, the color and depth conversions done
+        // by the cascade allocate new data and leave the input untouched
+        Mat image = images[i];
+        detect(image, objectDetections[i]);
+    }
+}
+
 } // namespace cv
 }
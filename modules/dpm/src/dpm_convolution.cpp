@@ -40,25 +40,41 @@
 //M*/
 
 #include "dpm_convolution.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 
 namespace cv
 {
 namespace dpm
 {
+// Every response is accumulated in the same order, whether it is computed
+// alone or as part of a block, so that the cascade can replace a score
+// computed over the whole level by a score computed at a single location.
 double ConvolutionEngine::convolve(const Mat &feat, const Mat &filter,
         int dimHOG, int x, int y)
 {
+    const int len = filter.cols;
     double val = 0;
+#if CV_SIMD128_64F
+    v_float64x2 vval = v_setzero_f64();
+#endif
     for (int yp = 0; yp < filter.rows; yp++)
     {
-        const double *pfeat = (double*)feat.ptr(y + yp) + x * dimHOG;
-        const double *pfilter = (double*)filter.ptr(yp);
+        const double *pfeat = feat.ptr<double>(y + yp) + x * dimHOG;
+        const double *pfilter = filter.ptr<double>(yp);
 
-        for (int xp = 0; xp < filter.cols; xp++)
+        int xp = 0;
+#if CV_SIMD128_64F
+        for (; xp <= len - 2; xp += 2)
+            vval = v_fma(v_load(pfeat + xp), v_load(pfilter + xp), vval);
+#endif
+        for (; xp < len; xp++)
         {
             val += pfeat[xp] * pfilter[xp];
         }
     }
+#if CV_SIMD128_64F
+    val += v_reduce_sum(vval);
+#endif
 
     return val;
 }
@@ -66,26 +82,89 @@ double ConvolutionEngine::convolve(const Mat &feat, const Mat &filter,
 void ConvolutionEngine::convolve(const Mat &feat, const Mat &filter,
         int dimHOG, Mat &result)
 {
+    const int len = filter.cols;
+
     for (int y = 0; y < result.rows; y++)
     {
-        double *presult = (double*)result.ptr(y);
-        for (int x = 0; x < result.cols; x++)
+        double *presult = result.ptr<double>(y);
+        int x = 0;
+        // blocks of 4 neighbouring locations share the filter loads
+        for (; x <= result.cols - 4; x += 4)
         {
-            double val = 0;
+            double val[4] = { 0, 0, 0, 0 };
+#if CV_SIMD128_64F
+            v_float64x2 v0 = v_setzero_f64(), v1 = v_setzero_f64();
+            v_float64x2 v2 = v_setzero_f64(), v3 = v_setzero_f64();
+#endif
             for (int yp = 0; yp < filter.rows; yp++)
             {
-                const double *pfeat = (double*)feat.ptr(y + yp) + x * dimHOG;
-                const double *pfilter = (double*)filter.ptr(yp);
+                const double *pfeat = feat.ptr<double>(y + yp) + x * dimHOG;
+                const double *pfilter = filter.ptr<double>(yp);
 
-                for (int xp = 0; xp < filter.cols; xp++)
+                int xp = 0;
+#if CV_SIMD128_64F
+                for (; xp <= len - 2; xp += 2)
+                {
+                    v_float64x2 f = v_load(pfilter + xp);
+                    v0 = v_fma(v_load(pfeat + xp), f, v0);
+                    v1 = v_fma(v_load(pfeat + dimHOG + xp), f, v1);
+                    v2 = v_fma(v_load(pfeat + 2*dimHOG + xp), f, v2);
+                    v3 = v_fma(v_load(pfeat + 3*dimHOG + xp), f, v3);
+                }
+#endif
+                for (; xp < len; xp++)
                 {
-                    val += pfeat[xp] * pfilter[xp];
+                    for (int k = 0; k < 4; k++)
+                        val[k] += pfeat[k*dimHOG + xp] * pfilter[xp];
                 }
             } // yp
-
-            presult[x] = val;
+#if CV_SIMD128_64F
+            val[0] += v_reduce_sum(v0);
+            val[1] += v_reduce_sum(v1);
+            val[2] += v_reduce_sum(v2);
+            val[3] += v_reduce_sum(v3);
+#endif
+            for (int k = 0; k < 4; k++)
+                presult[x + k] = val[k];
         } // x
+
+        for (; x < result.cols; x++)
+            presult[x] = convolve(feat, filter, dimHOG, x, y);
     } // y
 }
+
+void ConvolutionEngine::convolve(const Mat &feat, const std::vector< Mat > &filters,
+        int dimHOG, std::vector< Mat > &results)
+{
+    results.resize(filters.size());
+    for (size_t i = 0; i < filters.size(); i++)
+    {
+        // compute size of output
+        int height = feat.rows - filters[i].rows + 1;
+        int width = (feat.cols - filters[i].cols) / dimHOG + 1;
+        if (height <= 0 || width <= 0)
+        {
+            results[i] = Mat::zeros(Size(std::max(width, 0), std::max(height, 0)), CV_64F);
+            continue;
+        }
+        results[i].create(Size(width, height), CV_64F);
+    }
+
+    // process bands of result rows so that the feature rows of a band are
+    // reused by all the filters while they are still in cache
+    const int bandHeight = 8;
+    for (int y0 = 0; y0 < feat.rows; y0 += bandHeight)
+    {
+        for (size_t i = 0; i < filters.size(); i++)
+        {
+            Mat &result = results[i];
+            if (y0 >= result.rows)
+                continue;
+            int y1 = std::min(y0 + bandHeight, result.rows);
+            Mat band = result.rowRange(y0, y1);
+            convolve(feat.rowRange(y0, y1 + filters[i].rows - 1), filters[i], dimHOG, band);
+        }
+    }
+}
 } // namespace cv
 } // namespace dpm
@@ -64,10 +64,15 @@ class ConvolutionEngine
         double convolve(const Mat &feat, const Mat &filter,
                 int dimHOG, int x, int y);
 
-        // compute convolution of a feature map and multiple filters
-        // sum the filter convolution values into results
+        // compute convolution of a feature map and a filter
+        // at all the locations of result
         void convolve(const Mat &feat, const Mat &filter,
                 int dimHOG, Mat &result);
+
+        // compute convolution of a feature map and multiple filters
+        // in a single pass over the feature map
+        void convolve(const Mat &feat, const std::vector< Mat > &filters,
+                int dimHOG, std::vector< Mat > &results);
 };
 } // namespace dpm
 } // namespace cv
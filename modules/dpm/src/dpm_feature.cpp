@@ -58,15 +58,35 @@ Feature::Feature (PyramidParameter p):params(p)
 
 void Feature::computeFeaturePyramid(const Mat &imageM, vector< Mat > &pyramid)
 {
-    ParalComputePyramid paralTask(imageM, pyramid, params);
+    // the rescaled images of every level are computed first, one octave
+    // chain per task, then the HOG features of all the levels concurrently
+    vector< Mat > images;
+    ParalComputePyramid paralTask(imageM, images, params);
     paralTask.initialize();
     parallel_for_(Range(0, params.interval), paralTask);
+
+    pyramid.resize(images.size());
+    parallel_for_(Range(0, (int)images.size()), [&](const Range &range)
+    {
+        for (int i = range.start; i != range.end; i++)
+        {
+            if (images[i].empty())
+            {
+                pyramid[i].release();
+                continue;
+            }
+
+            // the first octave uses half-sized cells, i.e. twice the image resolution
+            int sbin = i < params.interval ? params.binSize/2 : params.binSize;
+            computeHOG32D(images[i], pyramid[i], sbin, params.padx + 1, params.pady + 1);
+        }
+    });
 }
 
 ParalComputePyramid::ParalComputePyramid(const Mat &inputImage, \
-        vector< Mat > &outputPyramid,\
+        vector< Mat > &outputImages,\
         PyramidParameter &p):
-    imageM(inputImage), pyramid(outputPyramid), params(p)
+    imageM(inputImage), images(outputImages), params(p)
 {
 }
 
@@ -85,7 +105,7 @@ void ParalComputePyramid::initialize()
         return;
     }
 
-    pyramid.resize(params.maxScale + params.interval);
+    images.resize(params.maxScale + params.interval);
     params.scales.resize(params.maxScale + params.interval);
 }
 
@@ -100,13 +120,11 @@ void ParalComputePyramid::operator() (const Range &range) const
         params.scales[i] = 2*scale;
 
         // First octave at twice the image resolution
-        Feature::computeHOG32D(imScaled, pyramid[i],
-                params.binSize/2, params.padx + 1, params.pady + 1);
+        images[i] = imScaled;
 
         // Second octave at the original resolution
         if (i + params.interval <= params.maxScale)
-            Feature::computeHOG32D(imScaled, pyramid[i+params.interval],
-                    params.binSize, params.padx + 1, params.pady + 1);
+            images[i+params.interval] = imScaled;
 
         params.scales[i+params.interval] = scale;
 
@@ -117,8 +135,7 @@ void ParalComputePyramid::operator() (const Range &range) const
             Size_<double> imScaledSize = imScaled.size();
             resize(imScaled, imScaled2, imScaledSize*0.5);
             imScaled = imScaled2;
-            Feature::computeHOG32D(imScaled2, pyramid[j+params.interval],
-                    params.binSize, params.padx + 1, params.pady + 1);
+            images[j+params.interval] = imScaled2;
             params.scales[j+params.interval] = params.scales[j]*0.5;
         }
     }
@@ -155,7 +172,9 @@ void Feature::computeHOG32D(const Mat &imageM, Mat &featM, const int sbin, const
     // initialize historgram, norm, output feature matrices
     Mat histM = Mat::zeros(Size(blockSize.width*numOrient, blockSize.height), CV_64F);
     Mat normM = Mat::zeros(Size(blockSize.width, blockSize.height), CV_64F);
-    featM = Mat::zeros(Size(outSize.width*dimHOG, outSize.height), CV_64F);
+    // the feature matrix is reused when the pyramid is computed again
+    featM.create(Size(outSize.width*dimHOG, outSize.height), CV_64F);
+    featM.setTo(Scalar::all(0));
 
     // get the stride of each matrix
     const size_t imStride = imageM.step1();
@@ -345,44 +364,29 @@ void Feature::projectFeaturePyramid(const Mat &pcaCoeff, const std::vector< Mat
     projPyramid.resize(pyramid.size());
 
     // loop for each level of the pyramid
-    for (unsigned int i = 0; i < pyramid.size(); i++)
+    parallel_for_(Range(0, (int)pyramid.size()), [&](const Range &range)
     {
-        Mat orgM = pyramid[i];
-        // note that the features are stored in 32-32-32
-        int width = orgM.cols/dimHOG;
-        int height = orgM.rows;
-        // initialize the project feature matrix
-        Mat projM = Mat::zeros(height, width*dimPCA, CV_64F);
-        //get the pointer of the matrix
-        double* const featOrg = orgM.ptr<double>(0);
-        double* const featProj = projM.ptr<double>(0);
-
-        // get the stride of each matrix
-        const size_t orgStride = orgM.step1();
-        const size_t projStride = projM.step1();
-
-        for (int y = 0; y < height; y++)
+        for (int i = range.start; i != range.end; i++)
         {
-            for (int x = 0; x < width; x++)
+            const Mat &orgM = pyramid[i];
+            if (orgM.empty())
             {
-                double* proj = featProj + y*projStride + x*dimPCA;
-                // for each pca dimension
-                for (int c = 0; c < dimPCA; c++)
-                {
-                    double* org = featOrg + y*orgStride + x*dimHOG;
-                    // dot product 32d HOG feature with the coefficient vector
-                    for (int r = 0; r < dimHOG; r++)
-                    {
-                        *proj += *org * pcaCoeff.at<double>(r, c);
-                        org++;
-                    }
-                    proj++;
-                }
-
-            } // for x
-        } // for y
-        projPyramid[i] = projM;
-    } // for each level of the pyramid
+                projPyramid[i].release();
+                continue;
+            }
+            CV_Assert(orgM.isContinuous());
+
+            // note that the features are stored in 32-32-32, so every
+            // cell is a row of the reshaped matrix and the projection
+            // of the whole level is a single matrix product
+            int width = orgM.cols/dimHOG;
+            int height = orgM.rows;
+            // the projected matrix is reused when the pyramid is projected again
+            projPyramid[i].create(height, width*dimPCA, CV_64F);
+            Mat projM = projPyramid[i].reshape(1, width*height);
+            gemm(orgM.reshape(1, width*height), pcaCoeff, 1, noArray(), 0, projM);
+        }
+    });
 }
 
 void Feature::computeLocationFeatures(const int numLevels, Mat &locFeature)
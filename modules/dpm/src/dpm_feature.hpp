@@ -137,15 +137,15 @@ class Feature
 
 };
 
-/** @brief This class computes feature pyramid in parallel
- * using Intel Threading Building Blocks (TBB)
+/** @brief This class computes the rescaled images of the
+ * feature pyramid in parallel, one octave chain per task
  */
 class ParalComputePyramid : public ParallelLoopBody
 {
     public:
         // constructor
         ParalComputePyramid(const Mat &inputImage, \
-                std::vector< Mat > &outputPyramid,\
+                std::vector< Mat > &outputImages,\
                 PyramidParameter &p);
 
         // initializate parameters
@@ -159,8 +159,8 @@ class ParalComputePyramid : public ParallelLoopBody
         const Mat &imageM;
         // image size
         Size_<double> imSize;
-        // output feature pyramid
-        std::vector< Mat > &pyramid;
+        // rescaled image of each pyramid level
+        std::vector< Mat > &images;
         // pyramid parameters
         PyramidParameter &params;
 };
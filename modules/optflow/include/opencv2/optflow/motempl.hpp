@@ -102,6 +102,29 @@ valid.
 CV_EXPORTS_W void calcMotionGradient( InputArray mhi, OutputArray mask, OutputArray orientation,
                                       double delta1, double delta2, int apertureSize = 3 );
 
+/** @brief Updates the motion history image and calculates its gradient orientation in a single pass.
+
+@param silhouette Silhouette mask that has non-zero pixels where the motion occurs.
+@param mhi Motion history image that is updated by the function (single-channel, 32-bit
+floating-point).
+@param mask Output mask image of the valid gradient pixels, see calcMotionGradient .
+@param orientation Output motion gradient orientation image, see calcMotionGradient .
+@param timestamp Current time in milliseconds or other units.
+@param duration Maximal duration of the motion track in the same units as timestamp .
+@param delta1 Minimal (or maximal) allowed difference between mhi values within a pixel
+neighborhood.
+@param delta2 Maximal (or minimal) allowed difference between mhi values within a pixel
+neighborhood.
+@param apertureSize Aperture size of the Sobel operator.
+
+The result is the same as of updateMotionHistory followed by calcMotionGradient , but the motion
+history image is traversed only once.
+ */
+CV_EXPORTS_W void updateMotionHistoryAndGradient( InputArray silhouette, InputOutputArray mhi,
+                                                  OutputArray mask, OutputArray orientation,
+                                                  double timestamp, double duration,
+                                                  double delta1, double delta2, int apertureSize = 3 );
+
 /** @brief Calculates a global motion orientation in a selected region.
 
 @param orientation Motion gradient orientation image calculated by the function calcMotionGradient
@@ -119,6 +142,23 @@ smaller weight, as recorded in mhi .
 CV_EXPORTS_W double calcGlobalOrientation( InputArray orientation, InputArray mask, InputArray mhi,
                                            double timestamp, double duration );
 
+/** @brief Calculates global motion orientations in a set of regions.
+
+@param orientation Motion gradient orientation image calculated by the function calcMotionGradient
+@param mask Mask image, see the single region variant of calcGlobalOrientation .
+@param mhi Motion history image calculated by updateMotionHistory .
+@param rois Regions (zones) of the image, each of them must lie inside the image.
+@param timestamp Timestamp passed to updateMotionHistory .
+@param duration Maximum duration of a motion track in milliseconds, passed to updateMotionHistory
+@param orientations Output vector with the motion direction of every region, in degrees.
+
+The regions are processed in parallel. The result for every region is the same as of
+calcGlobalOrientation called on the corresponding submatrices.
+ */
+CV_EXPORTS_W void calcGlobalOrientation( InputArray orientation, InputArray mask, InputArray mhi,
+                                         const std::vector<Rect>& rois, double timestamp, double duration,
+                                         CV_OUT std::vector<double>& orientations );
+
 /** @brief Splits a motion history image into a few parts corresponding to separate independent motions (for
 example, left hand, right hand).
 
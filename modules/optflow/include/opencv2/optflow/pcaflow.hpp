@@ -121,19 +121,22 @@ public:
   void collectGarbage() CV_OVERRIDE;
 
 private:
-  void findSparseFeatures( UMat &from, UMat &to, std::vector<Point2f> &features,
+  Size basisCacheSize;      // frame size the sampled DCT basis below was computed for
+  Mat basisCosX, basisCosY; // per-axis DCT basis functions sampled at pixel centers
+  Mat priorA1, priorA2, priorB1, priorB2;
+  Mat systemBuffer;         // reused storage for the sampled basis of the sparse matches
+
+  void updateCache( const Size size );
+
+  void findSparseFeatures( UMat &from, InputArray fromLK, InputArray toLK, std::vector<Point2f> &features,
                            std::vector<Point2f> &predictedFeatures ) const;
 
-  void removeOcclusions( UMat &from, UMat &to, std::vector<Point2f> &features,
+  void removeOcclusions( InputArray fromLK, InputArray toLK, const Size size, std::vector<Point2f> &features,
                          std::vector<Point2f> &predictedFeatures ) const;
 
-  void getSystem( OutputArray AOut, OutputArray b1Out, OutputArray b2Out, const std::vector<Point2f> &features,
+  void getSystem( Mat &A, Mat &b1, Mat &b2, const std::vector<Point2f> &features,
                   const std::vector<Point2f> &predictedFeatures, const Size size );
 
-  void getSystem( OutputArray A1Out, OutputArray A2Out, OutputArray b1Out, OutputArray b2Out,
-                  const std::vector<Point2f> &features, const std::vector<Point2f> &predictedFeatures,
-                  const Size size );
-
   OpticalFlowPCAFlow& operator=( const OpticalFlowPCAFlow& ); // make it non-assignable
 };
 
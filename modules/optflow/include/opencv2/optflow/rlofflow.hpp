@@ -444,6 +444,64 @@ public:
 
 };
 
+/** @brief Stateful sparse feature tracker for video sequences based on the robust local optical flow (RLOF).
+*
+* SparseRLOFOpticalFlow::calc builds the image pyramids of both frames on every call. This tracker keeps the
+* pyramids and the gradient images of the last frame passed to track(), so every frame of a sequence is
+* decomposed only once: when it is the next frame of one call and the previous frame of the following call.
+* Several independent point sets (e.g. of different objects) can be tracked per frame, they are processed
+* in a single parallel pass.
+*
+* For the RLOF configuration see optflow::RLOFOpticalFlowParameter for further details.
+* @see optflow::SparseRLOFOpticalFlow, optflow::RLOFOpticalFlowParameter
+*/
+class CV_EXPORTS_W SparseRLOFTracker : public Algorithm
+{
+public:
+    /** @copydoc DenseRLOFOpticalFlow::setRLOFOpticalFlowParameter
+    */
+    CV_WRAP virtual void setRLOFOpticalFlowParameter(Ptr<RLOFOpticalFlowParameter> val) = 0;
+    /** @copybrief setRLOFOpticalFlowParameter
+     *    @see setRLOFOpticalFlowParameter
+    */
+    CV_WRAP virtual Ptr<RLOFOpticalFlowParameter>  getRLOFOpticalFlowParameter() const = 0;
+    /** @copydoc SparseRLOFOpticalFlow::setForwardBackward
+    */
+    CV_WRAP virtual void setForwardBackward(float val) = 0;
+    /** @copybrief setForwardBackward
+     *    @see setForwardBackward
+    */
+    CV_WRAP virtual float getForwardBackward() const = 0;
+
+    /** @brief Tracks the point sets from the previous frame to nextImg, which becomes the previous frame.
+     *
+     * If no previous frame is stored (first call, after reset() or if the size or type of the frames changes)
+     * nextImg is only stored: nextPts are set to prevPts, status to 1 and err to 0.
+     *
+     * @param nextImg 8-bit input image, 3 channels if optflow::RLOFOpticalFlowParameter::supportRegionType is SR_CROSS.
+     * @param prevPts vector of point sets in the previous frame; point coordinates must be single-precision
+     * floating-point numbers.
+     * @param nextPts output vector of point sets in nextImg, one for each set of prevPts; when
+     * optflow::RLOFOpticalFlowParameter::useInitialFlow is true it must contain the initial estimates.
+     * @param status output vector of status vectors; an element is set to 0 if the point has failed the forward
+     * backward check.
+     * @param err output vector of error vectors containing the forward backward error of each point.
+     */
+    CV_WRAP virtual void track(InputArray nextImg, InputArrayOfArrays prevPts, InputOutputArrayOfArrays nextPts,
+        OutputArrayOfArrays status = noArray(), OutputArrayOfArrays err = noArray()) = 0;
+    //! @brief Releases the stored frame, the next call of track() starts a new sequence.
+    CV_WRAP virtual void reset() = 0;
+
+    //! @brief Creates instance of SparseRLOFTracker
+    /**
+     *    @param rlofParam see setRLOFOpticalFlowParameter
+     *    @param forwardBackwardThreshold see setForwardBackward
+    */
+    CV_WRAP static Ptr<SparseRLOFTracker> create(
+        Ptr<RLOFOpticalFlowParameter> rlofParam = Ptr<RLOFOpticalFlowParameter>(),
+        float forwardBackwardThreshold = 1.f);
+};
+
 /** @brief Fast dense optical flow computation based on robust local optical flow (RLOF) algorithms and sparse-to-dense interpolation scheme.
  *
  * The RLOF is a fast local optical flow approach described in @cite Senst2012 @cite Senst2013 @cite Senst2014
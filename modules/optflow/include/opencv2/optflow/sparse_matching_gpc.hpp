@@ -150,6 +150,8 @@ struct GPCMatchingParams
 };
 
 /** @brief Class for individual tree.
+ *
+ * Trained trees are stored as a flat array of nodes in breadth-first order, the root being the first one.
  */
 class CV_EXPORTS_W GPCTree : public Algorithm
 {
@@ -170,15 +172,28 @@ private:
   std::vector< Node > nodes;
   GPCTrainingParams params;
 
-  bool trainNode( size_t nodeId, SIter begin, SIter end, unsigned depth );
+  unsigned trainNode( SIter begin, SIter end, unsigned depth, RNG &rng );
 
 public:
   void train( GPCTrainingSamples &samples, const GPCTrainingParams params = GPCTrainingParams() );
 
+  /** @brief Train the tree with an explicit seed for the random hyperplane search.
+   * The result doesn't depend on the number of threads or on other trees trained at the same time.
+   */
+  void train( GPCTrainingSamples &samples, const GPCTrainingParams params, uint64 seed );
+
   void write( FileStorage &fs ) const CV_OVERRIDE;
 
   void read( const FileNode &fn ) CV_OVERRIDE;
 
+  /** @brief Append the tree to a buffer in the binary model format (native byte order).
+   */
+  void writeBinary( std::vector< uchar > &buf ) const;
+
+  /** @brief Read the tree from the binary model format, ptr is moved past it.
+   */
+  void readBinary( const uchar *&ptr, const uchar *end );
+
   unsigned findLeafForPatch( const GPCPatchDescriptor &descr ) const;
 
   static Ptr< GPCTree > create() { return makePtr< GPCTree >(); }
@@ -228,16 +243,57 @@ private:
     }
   };
 
+  class ParallelTraining : public ParallelLoopBody
+  {
+  private:
+    GPCTree *trees;
+    const GPCTrainingSamples *shared;                        //!< Set copied by every tree, or
+    const std::vector< Ptr< GPCTrainingSamples > > *samples; //!< one set per tree.
+    const std::vector< uint64 > *seeds;
+    GPCTrainingParams params;
+
+    ParallelTraining &operator=( const ParallelTraining & );
+
+  public:
+    ParallelTraining( GPCTree *_trees, const GPCTrainingSamples *_shared, const std::vector< Ptr< GPCTrainingSamples > > *_samples,
+                      const std::vector< uint64 > *_seeds, const GPCTrainingParams &_params )
+        : trees( _trees ), shared( _shared ), samples( _samples ), seeds( _seeds ), params( _params ){};
+
+    void operator()( const Range &range ) const CV_OVERRIDE
+    {
+      for ( int t = range.start; t < range.end; ++t )
+      {
+        if ( shared )
+        {
+          GPCTrainingSamples copy( *shared ); // Training reorders and marks the samples.
+          trees[t].train( copy, params, seeds->at( t ) );
+        }
+        else
+          trees[t].train( *samples->at( t ), params, seeds->at( t ) );
+      }
+    }
+  };
+
   GPCTree tree[T];
 
+  /** Trees are trained concurrently. The seeds are drawn from theRNG() beforehand, so the result is reproducible. */
+  void trainTrees( const GPCTrainingSamples *shared, const std::vector< Ptr< GPCTrainingSamples > > *samples,
+                   const GPCTrainingParams &params )
+  {
+    std::vector< uint64 > seeds( T );
+    for ( int i = 0; i < T; ++i )
+      seeds[i] = theRNG().next();
+    parallel_for_( Range( 0, T ), ParallelTraining( tree, shared, samples, &seeds, params ) );
+  }
+
 public:
   /** @brief Train the forest using one sample set for every tree.
    * Please, consider using the next method instead of this one for better quality.
+   * Every tree is trained on its own copy of the samples.
    */
   void train( GPCTrainingSamples &samples, const GPCTrainingParams params = GPCTrainingParams() )
   {
-    for ( int i = 0; i < T; ++i )
-      tree[i].train( samples, params );
+    trainTrees( &samples, 0, params );
   }
 
   /** @brief Train the forest using individual samples for each tree.
@@ -246,23 +302,19 @@ public:
   void train( const std::vector< String > &imagesFrom, const std::vector< String > &imagesTo, const std::vector< String > &gt,
               const GPCTrainingParams params = GPCTrainingParams() )
   {
+    std::vector< Ptr< GPCTrainingSamples > > samples( T );
     for ( int i = 0; i < T; ++i )
-    {
-      Ptr< GPCTrainingSamples > samples =
-        GPCTrainingSamples::create( imagesFrom, imagesTo, gt, params.descriptorType ); // Create training set for the tree
-      tree[i].train( *samples, params );
-    }
+      samples[i] = GPCTrainingSamples::create( imagesFrom, imagesTo, gt, params.descriptorType ); // Create training set for the tree
+    trainTrees( 0, &samples, params );
   }
 
   void train( InputArrayOfArrays imagesFrom, InputArrayOfArrays imagesTo, InputArrayOfArrays gt,
               const GPCTrainingParams params = GPCTrainingParams() )
   {
+    std::vector< Ptr< GPCTrainingSamples > > samples( T );
     for ( int i = 0; i < T; ++i )
-    {
-      Ptr< GPCTrainingSamples > samples =
-        GPCTrainingSamples::create( imagesFrom, imagesTo, gt, params.descriptorType ); // Create training set for the tree
-      tree[i].train( *samples, params );
-    }
+      samples[i] = GPCTrainingSamples::create( imagesFrom, imagesTo, gt, params.descriptorType ); // Create training set for the tree
+    trainTrees( 0, &samples, params );
   }
 
   void write( FileStorage &fs ) const CV_OVERRIDE
@@ -286,6 +338,15 @@ public:
       tree[i].read( *it );
   }
 
+  /** @brief Save the forest in the binary model format.
+   * Unlike the FileStorage format, it is loaded without any parsing.
+   */
+  void saveBinary( const String &filename ) const;
+
+  /** @brief Load the forest saved with saveBinary().
+   */
+  void loadBinary( const String &filename );
+
   /** @brief Find correspondences between two images.
    * @param[in] imgFrom First image in a sequence.
    * @param[in] imgTo Second image in a sequence.
@@ -307,8 +368,30 @@ public:
                                          int type );
 
   static void getCoordinatesFromIndex( size_t index, Size sz, int &x, int &y );
+
+  static void writeBinaryModel( const String &filename, const std::vector< uchar > &trees, int nTrees );
+
+  /** Returns the number of trees, trees receives their data. */
+  static int readBinaryModel( const String &filename, std::vector< uchar > &trees );
 };
 
+template < int T > void GPCForest< T >::saveBinary( const String &filename ) const
+{
+  std::vector< uchar > buf;
+  for ( int i = 0; i < T; ++i )
+    tree[i].writeBinary( buf );
+  GPCDetails::writeBinaryModel( filename, buf, T );
+}
+
+template < int T > void GPCForest< T >::loadBinary( const String &filename )
+{
+  std::vector< uchar > buf;
+  CV_Assert( T <= GPCDetails::readBinaryModel( filename, buf ) );
+  const uchar *ptr = buf.empty() ? 0 : &buf[0], *end = ptr + buf.size();
+  for ( int i = 0; i < T; ++i )
+    tree[i].readBinary( ptr, end );
+}
+
 template < int T >
 void GPCForest< T >::findCorrespondences( InputArray imgFrom, InputArray imgTo, std::vector< std::pair< Point2i, Point2i > > &corr,
                                           const GPCMatchingParams params ) const
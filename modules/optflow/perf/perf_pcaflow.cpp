@@ -0,0 +1,34 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+#include "perf_precomp.hpp"
+
+namespace opencv_test { namespace {
+
+typedef tuple<Size> PCAFlowParams;
+typedef TestBaseWithParam<PCAFlowParams> DenseOpticalFlow_PCAFlow;
+
+PERF_TEST_P(DenseOpticalFlow_PCAFlow, perf, Values(szVGA, sz1080p))
+{
+    Size sz = get<0>(GetParam());
+
+    Mat frame1 = imread(getDataPath("cv/optflow/RubberWhale1.png"), IMREAD_COLOR);
+    Mat frame2 = imread(getDataPath("cv/optflow/RubberWhale2.png"), IMREAD_COLOR);
+    ASSERT_FALSE(frame1.empty());
+    ASSERT_FALSE(frame2.empty());
+    resize(frame1, frame1, sz, 0, 0, INTER_LINEAR);
+    resize(frame2, frame2, sz, 0, 0, INTER_LINEAR);
+
+    declare.time(120);
+
+    // the same instance is used across the frames of a video, so the cached basis is reused
+    Ptr<DenseOpticalFlow> algo = createOptFlow_PCAFlow();
+    Mat flow;
+    algo->calc(frame1, frame2, flow);
+
+    TEST_CYCLE() algo->calc(frame1, frame2, flow);
+
+    SANITY_CHECK_NOTHING();
+}
+
+}} // namespace
@@ -43,6 +43,49 @@ PERF_TEST_P(ST_SR_IM_Sparse, OpticalFlow_SparseRLOF,
     SANITY_CHECK_NOTHING();
 }
 
+// a video sequence alternating between two frames, four point sets are tracked per frame
+typedef TestBaseWithParam<bool> Tracker_Sequence;
+PERF_TEST_P(Tracker_Sequence, OpticalFlow_SparseRLOFTracker, testing::Bool())
+{
+    Mat frames[2];
+    frames[0] = imread(getDataPath("cv/optflow/RubberWhale1.png"));
+    frames[1] = imread(getDataPath("cv/optflow/RubberWhale2.png"));
+    ASSERT_FALSE(frames[0].empty());
+    ASSERT_FALSE(frames[1].empty());
+    vector<vector<Point2f> > prevPts(4), currPts(4);
+    vector<vector<uchar> > status(4);
+    vector<vector<float> > err(4);
+    for (int r = 0; r < frames[0].rows; r += 10)
+    {
+        for (int c = 0; c < frames[0].cols; c += 10)
+        {
+            prevPts[(c / 10) % 4].push_back(Point2f(static_cast<float>(c), static_cast<float>(r)));
+        }
+    }
+
+    const bool useTracker = GetParam();
+    Ptr<SparseRLOFOpticalFlow> algo = SparseRLOFOpticalFlow::create();
+    Ptr<SparseRLOFTracker> tracker = SparseRLOFTracker::create();
+    tracker->track(frames[0], prevPts, currPts, status, err);
+    int frameIdx = 0;
+
+    TEST_CYCLE()
+    {
+        const Mat & prevFrame = frames[frameIdx % 2];
+        const Mat & nextFrame = frames[(frameIdx + 1) % 2];
+        if (useTracker)
+            tracker->track(nextFrame, prevPts, currPts, status, err);
+        else
+        {
+            for (size_t i = 0; i < prevPts.size(); i++)
+                algo->calc(prevFrame, nextFrame, prevPts[i], currPts[i], status[i], err[i]);
+        }
+        frameIdx++;
+    }
+
+    SANITY_CHECK_NOTHING();
+}
+
 typedef tuple<std::string, int> INTERP_GRID_Dense_t;
 typedef TestBaseWithParam<INTERP_GRID_Dense_t> INTERP_GRID_Dense;
 PERF_TEST_P(INTERP_GRID_Dense, OpticalFlow_DenseRLOF,
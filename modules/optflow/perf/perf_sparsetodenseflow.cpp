@@ -0,0 +1,59 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+#include "perf_precomp.hpp"
+
+namespace opencv_test { namespace {
+
+typedef tuple<Size> STDParams;
+typedef TestBaseWithParam<STDParams> DenseOpticalFlow_SparseToDense;
+
+static void loadFrames(Size sz, Mat frames[2])
+{
+    const char* names[2] = { "cv/optflow/RubberWhale1.png", "cv/optflow/RubberWhale2.png" };
+    for (int i = 0; i < 2; i++)
+    {
+        frames[i] = imread(TestBase::getDataPath(names[i]), IMREAD_COLOR);
+        if (!frames[i].empty())
+            resize(frames[i], frames[i], sz, 0, 0, INTER_LINEAR);
+    }
+}
+
+PERF_TEST_P(DenseOpticalFlow_SparseToDense, perf, Values(szVGA, sz720p))
+{
+    Size sz = get<0>(GetParam());
+    Mat frames[2];
+    loadFrames(sz, frames);
+    ASSERT_FALSE(frames[0].empty());
+    ASSERT_FALSE(frames[1].empty());
+
+    Mat flow;
+    TEST_CYCLE() calcOpticalFlowSparseToDense(frames[0], frames[1], flow);
+
+    SANITY_CHECK_NOTHING();
+}
+
+// the same instance is used across the frames of a video, each frame is decomposed once
+PERF_TEST_P(DenseOpticalFlow_SparseToDense, sequence, Values(szVGA, sz720p))
+{
+    Size sz = get<0>(GetParam());
+    Mat frames[2];
+    loadFrames(sz, frames);
+    ASSERT_FALSE(frames[0].empty());
+    ASSERT_FALSE(frames[1].empty());
+
+    Ptr<DenseOpticalFlow> algo = createOptFlow_SparseToDense();
+    Mat flow;
+    algo->calc(frames[1], frames[0], flow);
+    int frameIdx = 0;
+
+    TEST_CYCLE()
+    {
+        algo->calc(frames[frameIdx % 2], frames[(frameIdx + 1) % 2], flow);
+        frameIdx++;
+    }
+
+    SANITY_CHECK_NOTHING();
+}
+
+}} // namespace
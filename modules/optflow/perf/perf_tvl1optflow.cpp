@@ -28,4 +28,31 @@ PERF_TEST_P(ImagePair, OpticalFlowDual_TVL1, testing::Values(impair("cv/optflow/
     SANITY_CHECK_NOTHING();
 }
 
+typedef TestBaseWithParam<Size> TVL1_LargeFrame;
+
+// 4K and 8K frames, the finest scales run the blocked iterations
+PERF_TEST_P(TVL1_LargeFrame, OpticalFlowDual_TVL1, testing::Values(Size(3840, 2160), Size(7680, 4320)))
+{
+    declare.time(600);
+
+    const Size sz = GetParam();
+    Mat frame1 = imread(getDataPath("cv/optflow/RubberWhale1.png"), IMREAD_GRAYSCALE);
+    Mat frame2 = imread(getDataPath("cv/optflow/RubberWhale2.png"), IMREAD_GRAYSCALE);
+    ASSERT_FALSE(frame1.empty());
+    ASSERT_FALSE(frame2.empty());
+    resize(frame1, frame1, sz, 0, 0, INTER_LINEAR);
+    resize(frame2, frame2, sz, 0, 0, INTER_LINEAR);
+
+    Mat flow;
+
+    // a single warping keeps the run time of the large frames reasonable
+    Ptr<DualTVL1OpticalFlow> tvl1 = createOptFlow_DualTVL1();
+    tvl1->setWarpingsNumber(1);
+    tvl1->setOuterIterations(2);
+
+    TEST_CYCLE_N(1) tvl1->calc(frame1, frame2, flow);
+
+    SANITY_CHECK_NOTHING();
+}
+
 }} // namespace
@@ -42,6 +42,7 @@
 #include "precomp.hpp"
 #include "opencv2/core/utility.hpp"
 #include "opencv2/core/hal/hal.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 #include "opencv2/core/private.hpp"
 #include "opencl_kernels_optflow.hpp"
 
@@ -50,6 +51,37 @@ namespace motempl {
 
 using std::vector;
 
+// The row-parallel loops below work on stripes of a fixed height, so that the reductions
+// over them don't depend on the number of threads.
+static const int stripeRows = 64;
+
+static inline int stripeCount( int rows )
+{
+    return (rows + stripeRows - 1) / stripeRows;
+}
+
+static inline Range stripeRange( int first, int last, int rows )
+{
+    return Range(first * stripeRows, std::min(rows, last * stripeRows));
+}
+
+template<typename Body>
+static void forEachStripe( int nstripes, bool parallel, const Body& body )
+{
+    if( parallel && nstripes > 1 )
+    {
+        parallel_for_(Range(0, nstripes), [&](const Range& range) {
+            for( int i = range.start; i < range.end; i++ )
+                body(i);
+        });
+    }
+    else
+    {
+        for( int i = 0; i < nstripes; i++ )
+            body(i);
+    }
+}
+
 #ifdef HAVE_OPENCL
 
 static bool ocl_updateMotionHistory( InputArray _silhouette, InputOutputArray _mhi,
@@ -70,6 +102,31 @@ static bool ocl_updateMotionHistory( InputArray _silhouette, InputOutputArray _m
 
 #endif
 
+static void updateMotionHistoryRow( const uchar* silhData, float* mhiData, int width,
+                                    float ts, float delbound )
+{
+    int x = 0;
+
+#if CV_SIMD128
+    v_float32x4 ts4 = v_setall_f32(ts), db4 = v_setall_f32(delbound);
+    v_uint32x4 z4 = v_setzero_u32();
+    for( ; x <= width - 4; x += 4 )
+    {
+        v_float32x4 v = v_load(mhiData + x);
+        v_float32x4 s = v_reinterpret_as_f32(v_load_expand_q(silhData + x) != z4);
+        v = v & (v >= db4);
+        v_store(mhiData + x, v_select(s, ts4, v));
+    }
+#endif
+
+    for( ; x < width; x++ )
+    {
+        float val = mhiData[x];
+        val = silhData[x] ? ts : val < delbound ? 0 : val;
+        mhiData[x] = val;
+    }
+}
+
 void updateMotionHistory( InputArray _silhouette, InputOutputArray _mhi,
                               double timestamp, double duration )
 {
@@ -84,81 +141,121 @@ void updateMotionHistory( InputArray _silhouette, InputOutputArray _mhi,
 
     Mat silh = _silhouette.getMat(), mhi = _mhi.getMat();
     Size size = silh.size();
-#if defined(HAVE_IPP)
-    int silhstep = (int)silh.step, mhistep = (int)mhi.step;
-#endif
 
-    if( silh.isContinuous() && mhi.isContinuous() )
-    {
-        size.width *= size.height;
-        size.height = 1;
 #if defined(HAVE_IPP)
-        silhstep = (int)silh.total();
-        mhistep = (int)mhi.total() * sizeof(Ipp32f);
-#endif
-    }
+    {
+        Size ippSize = size;
+        int silhstep = (int)silh.step, mhistep = (int)mhi.step;
+        if( silh.isContinuous() && mhi.isContinuous() )
+        {
+            ippSize.width *= ippSize.height;
+            ippSize.height = 1;
+            silhstep = (int)silh.total();
+            mhistep = (int)mhi.total() * sizeof(Ipp32f);
+        }
 
-#if defined(HAVE_IPP)
-    IppStatus status = ippiUpdateMotionHistory_8u32f_C1IR((const Ipp8u *)silh.data, silhstep, (Ipp32f *)mhi.data, mhistep,
-                                                          ippiSize(size.width, size.height), (Ipp32f)timestamp, (Ipp32f)duration);
-    if (status >= 0)
-        return;
+        IppStatus status = ippiUpdateMotionHistory_8u32f_C1IR((const Ipp8u *)silh.data, silhstep, (Ipp32f *)mhi.data, mhistep,
+                                                              ippiSize(ippSize.width, ippSize.height), (Ipp32f)timestamp, (Ipp32f)duration);
+        if (status >= 0)
+            return;
+    }
 #endif
 
-#if CV_SSE2
-    volatile bool useSIMD = checkHardwareSupport(CV_CPU_SSE2);
-#endif
+    parallel_for_(Range(0, size.height), [&](const Range& range) {
+        for( int y = range.start; y < range.end; y++ )
+            updateMotionHistoryRow(silh.ptr<uchar>(y), mhi.ptr<float>(y), size.width, ts, delbound);
+    }, size.area() / (double)(1 << 16));
+}
 
-    for(int y = 0; y < size.height; y++ )
-    {
-        const uchar* silhData = silh.ptr<uchar>(y);
-        float* mhiData = mhi.ptr<float>(y);
-        int x = 0;
 
-#if CV_SSE2
-        if( useSIMD )
-        {
-            __m128 ts4 = _mm_set1_ps(ts), db4 = _mm_set1_ps(delbound);
-            for( ; x <= size.width - 8; x += 8 )
-            {
-                __m128i z = _mm_setzero_si128();
-                __m128i s = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(silhData + x)), z);
-                __m128 s0 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(s, z)), s1 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(s, z));
-                __m128 v0 = _mm_loadu_ps(mhiData + x), v1 = _mm_loadu_ps(mhiData + x + 4);
-                __m128 fz = _mm_setzero_ps();
+static void checkMotionGradientParams( double& delta1, double& delta2, int aperture_size )
+{
+    if( aperture_size < 3 || aperture_size > 7 || (aperture_size & 1) == 0 )
+        CV_Error( Error::StsOutOfRange, "aperture_size must be 3, 5 or 7" );
+
+    if( delta1 <= 0 || delta2 <= 0 )
+        CV_Error( Error::StsOutOfRange, "both delta's must be positive" );
+
+    if( delta1 > delta2 )
+        std::swap(delta1, delta2);
+}
 
-                v0 = _mm_and_ps(v0, _mm_cmpge_ps(v0, db4));
-                v1 = _mm_and_ps(v1, _mm_cmpge_ps(v1, db4));
+// Computes the motion gradient for the rows of mhi. The neighborhoods of the border rows are taken
+// from the parent matrix of mhi when there is one, so a horizontal stripe of the image gives
+// exactly the same result as the whole image would.
+static void calcMotionGradientRows( const Mat& mhi, Mat& mask, Mat& orient,
+                                    float min_delta, float max_delta, int aperture_size )
+{
+    float gradient_epsilon = 1e-4f * aperture_size * aperture_size;
+    Mat dX, dY, mhiMin, mhiMax;
 
-                __m128 m0 = _mm_and_ps(_mm_xor_ps(v0, ts4), _mm_cmpneq_ps(s0, fz));
-                __m128 m1 = _mm_and_ps(_mm_xor_ps(v1, ts4), _mm_cmpneq_ps(s1, fz));
+    // calc Dx and Dy
+    Sobel( mhi, dX, CV_32F, 1, 0, aperture_size, 1, 0, BORDER_REPLICATE );
+    Sobel( mhi, dY, CV_32F, 0, 1, aperture_size, 1, 0, BORDER_REPLICATE );
+
+    // (aperture_size-1)/2 iterations of the 3x3 erosion/dilation in a single pass
+    Mat kernel = getStructuringElement( MORPH_RECT, Size(aperture_size, aperture_size) );
+    erode( mhi, mhiMin, kernel, Point(-1,-1), 1, BORDER_REPLICATE );
+    dilate( mhi, mhiMax, kernel, Point(-1,-1), 1, BORDER_REPLICATE );
+
+    const int width = mhi.cols;
+    for( int y = 0; y < mhi.rows; y++ )
+    {
+        const float* dX_row = dX.ptr<float>(y);
+        const float* dY_row = dY.ptr<float>(y);
+        const float* min_row = mhiMin.ptr<float>(y);
+        const float* max_row = mhiMax.ptr<float>(y);
+        float* orient_row = orient.ptr<float>(y);
+        uchar* mask_row = mask.ptr<uchar>(y);
 
-                v0 = _mm_xor_ps(v0, m0);
-                v1 = _mm_xor_ps(v1, m1);
+        cv::hal::fastAtan2(dY_row, dX_row, orient_row, width, true);
 
-                _mm_storeu_ps(mhiData + x, v0);
-                _mm_storeu_ps(mhiData + x + 4, v1);
+        // make orientation zero where the gradient is very small
+        // or where there is little motion difference in the neighborhood
+        int x = 0;
+#if CV_SIMD128
+        v_float32x4 eps4 = v_setall_f32(gradient_epsilon);
+        v_float32x4 min4 = v_setall_f32(min_delta), max4 = v_setall_f32(max_delta);
+        v_uint8x16 one16 = v_setall_u8(1);
+        for( ; x <= width - 16; x += 16 )
+        {
+            v_int32x4 valid[4];
+            for( int k = 0; k < 4; k++ )
+            {
+                const int xk = x + k*4;
+                v_float32x4 d0 = v_load(max_row + xk) - v_load(min_row + xk);
+                v_float32x4 m = ((v_abs(v_load(dX_row + xk)) >= eps4) | (v_abs(v_load(dY_row + xk)) >= eps4)) &
+                                (d0 >= min4) & (d0 <= max4);
+                v_store(orient_row + xk, v_load(orient_row + xk) & m);
+                valid[k] = v_reinterpret_as_s32(m);
             }
+            v_int8x16 m8 = v_pack(v_pack(valid[0], valid[1]), v_pack(valid[2], valid[3]));
+            v_store(mask_row + x, v_reinterpret_as_u8(m8) & one16);
         }
 #endif
-
-        for( ; x < size.width; x++ )
+        for( ; x < width; x++ )
         {
-            float val = mhiData[x];
-            val = silhData[x] ? ts : val < delbound ? 0 : val;
-            mhiData[x] = val;
+            float dY = dY_row[x];
+            float dX = dX_row[x];
+            float d0 = max_row[x] - min_row[x];
+
+            if( (std::abs(dX) < gradient_epsilon && std::abs(dY) < gradient_epsilon) ||
+                d0 < min_delta || max_delta < d0 )
+            {
+                mask_row[x] = (uchar)0;
+                orient_row[x] = 0.f;
+            }
+            else
+                mask_row[x] = (uchar)1;
         }
     }
 }
 
-
 void calcMotionGradient( InputArray _mhi, OutputArray _mask,
                              OutputArray _orientation,
                              double delta1, double delta2,
                              int aperture_size )
 {
-    static int runcase = 0; runcase++;
-
     Mat mhi = _mhi.getMat();
     Size size = mhi.size();
 
@@ -168,11 +265,7 @@ void calcMotionGradient( InputArray _mhi, OutputArray _mask,
     Mat mask = _mask.getMat();
     Mat orient = _orientation.getMat();
 
-    if( aperture_size < 3 || aperture_size > 7 || (aperture_size & 1) == 0 )
-        CV_Error( Error::StsOutOfRange, "aperture_size must be 3, 5 or 7" );
-
-    if( delta1 <= 0 || delta2 <= 0 )
-        CV_Error( Error::StsOutOfRange, "both delta's must be positive" );
+    checkMotionGradientParams( delta1, delta2, aperture_size );
 
     if( mhi.type() != CV_32FC1 )
         CV_Error( Error::StsUnsupportedFormat,
@@ -185,134 +278,189 @@ void calcMotionGradient( InputArray _mhi, OutputArray _mask,
         orient = _orientation.getMat();
     }
 
-    if( delta1 > delta2 )
-        std::swap(delta1, delta2);
+    parallel_for_(Range(0, stripeCount(size.height)), [&](const Range& range) {
+        Range rows = stripeRange(range.start, range.end, size.height);
+        Mat maskRows = mask.rowRange(rows), orientRows = orient.rowRange(rows);
+        calcMotionGradientRows( mhi.rowRange(rows), maskRows, orientRows,
+                                (float)delta1, (float)delta2, aperture_size );
+    });
+}
 
-    float gradient_epsilon = 1e-4f * aperture_size * aperture_size;
-    float min_delta = (float)delta1;
-    float max_delta = (float)delta2;
+void updateMotionHistoryAndGradient( InputArray _silhouette, InputOutputArray _mhi,
+                                     OutputArray _mask, OutputArray _orientation,
+                                     double timestamp, double duration,
+                                     double delta1, double delta2, int aperture_size )
+{
+    CV_Assert( _silhouette.type() == CV_8UC1 && _mhi.type() == CV_32FC1 );
+    CV_Assert( _silhouette.sameSize(_mhi) );
 
-    Mat dX_min, dY_max;
+    if( _mhi.isUMat() )
+    {
+        updateMotionHistory( _silhouette, _mhi, timestamp, duration );
+        calcMotionGradient( _mhi, _mask, _orientation, delta1, delta2, aperture_size );
+        return;
+    }
 
-    // calc Dx and Dy
-    Sobel( mhi, dX_min, CV_32F, 1, 0, aperture_size, 1, 0, BORDER_REPLICATE );
-    Sobel( mhi, dY_max, CV_32F, 0, 1, aperture_size, 1, 0, BORDER_REPLICATE );
+    checkMotionGradientParams( delta1, delta2, aperture_size );
 
-    int x, y;
+    Mat silh = _silhouette.getMat(), mhi = _mhi.getMat();
+    Size size = mhi.size();
+
+    _mask.create(size, CV_8U);
+    _orientation.create(size, CV_32F);
 
-    if( mhi.isContinuous() && orient.isContinuous() && mask.isContinuous() )
+    Mat mask = _mask.getMat();
+    Mat orient = _orientation.getMat();
+
+    if( orient.data == mhi.data )
     {
-        size.width *= size.height;
-        size.height = 1;
+        _orientation.release();
+        _orientation.create(size, CV_32F);
+        orient = _orientation.getMat();
     }
 
-    // calc gradient
-    for( y = 0; y < size.height; y++ )
-    {
-        const float* dX_min_row = dX_min.ptr<float>(y);
-        const float* dY_max_row = dY_max.ptr<float>(y);
-        float* orient_row = orient.ptr<float>(y);
-        uchar* mask_row = mask.ptr<uchar>(y);
+    float ts = (float)timestamp;
+    float delbound = (float)(timestamp - duration);
+    const int radius = aperture_size / 2;
+    const int nstripes = stripeCount(size.height);
 
-        cv::hal::fastAtan2(dY_max_row, dX_min_row, orient_row, size.width, true);
+    // Every stripe updates its own rows in place, but the gradient near its borders also needs the
+    // neighbouring rows. Those are saved beforehand and updated once more by each stripe that reads them.
+    vector<Mat> boundaries(nstripes);
+    for( int i = 1; i < nstripes; i++ )
+        boundaries[i] = mhi.rowRange(i * stripeRows - radius, std::min(size.height, i * stripeRows + radius)).clone();
 
-        // make orientation zero where the gradient is very small
-        for( x = 0; x < size.width; x++ )
-        {
-            float dY = dY_max_row[x];
-            float dX = dX_min_row[x];
+    forEachStripe(nstripes, true, [&](int i) {
+        const Range rows = stripeRange(i, i + 1, size.height);
+        const int first = std::max(0, rows.start - radius), last = std::min(size.height, rows.end + radius);
+        Mat band(last - first, size.width, CV_32F);
 
-            if( std::abs(dX) < gradient_epsilon && std::abs(dY) < gradient_epsilon )
-            {
-                mask_row[x] = (uchar)0;
-                orient_row[x] = 0.f;
-            }
+        for( int y = first; y < last; y++ )
+        {
+            const float* src;
+            if( y < rows.start )
+                src = boundaries[i].ptr<float>(y - (rows.start - radius));
+            else if( y >= rows.end )
+                src = boundaries[i + 1].ptr<float>(y - (rows.end - radius));
             else
-                mask_row[x] = (uchar)1;
+                src = mhi.ptr<float>(y);
+
+            float* dst = band.ptr<float>(y - first);
+            memcpy(dst, src, size.width * sizeof(float));
+            updateMotionHistoryRow(silh.ptr<uchar>(y), dst, size.width, ts, delbound);
         }
+
+        Mat ownRows = band.rowRange(rows.start - first, rows.end - first);
+        Mat maskRows = mask.rowRange(rows), orientRows = orient.rowRange(rows);
+        calcMotionGradientRows( ownRows, maskRows, orientRows, (float)delta1, (float)delta2, aperture_size );
+        ownRows.copyTo(mhi.rowRange(rows));
+    });
+}
+
+
+static const int orientationHistSize = 12;
+
+struct OrientationStats
+{
+    OrientationStats() : maxTime(0.f), hasTime(false)
+    {
+        std::fill(hist, hist + orientationHistSize, 0);
+    }
+
+    void merge( const OrientationStats& other )
+    {
+        for( int i = 0; i < orientationHistSize; i++ )
+            hist[i] += other.hist[i];
+        if( other.hasTime && (!hasTime || other.maxTime > maxTime) )
+            maxTime = other.maxTime;
+        hasTime |= other.hasTime;
     }
 
-    erode( mhi, dX_min, noArray(), Point(-1,-1), (aperture_size-1)/2, BORDER_REPLICATE );
-    dilate( mhi, dY_max, noArray(), Point(-1,-1), (aperture_size-1)/2, BORDER_REPLICATE );
+    int hist[orientationHistSize];
+    float maxTime;
+    bool hasTime;
+};
 
-    // mask off pixels which have little motion difference in their neighborhood
-    for( y = 0; y < size.height; y++ )
+// Orientation histogram and the latest timestamp over the masked pixels
+static void accumulateOrientationStats( const Mat& orient, const Mat& mask, const Mat& mhi,
+                                        const Range& rows, OrientationStats& stats )
+{
+    const double scale = orientationHistSize / 360.;
+
+    for( int y = rows.start; y < rows.end; y++ )
     {
-        const float* dX_min_row = dX_min.ptr<float>(y);
-        const float* dY_max_row = dY_max.ptr<float>(y);
-        float* orient_row = orient.ptr<float>(y);
-        uchar* mask_row = mask.ptr<uchar>(y);
+        const float* mhiptr = mhi.ptr<float>(y);
+        const float* oriptr = orient.ptr<float>(y);
+        const uchar* maskptr = mask.ptr<uchar>(y);
 
-        for( x = 0; x < size.width; x++ )
+        for( int x = 0; x < mhi.cols; x++ )
         {
-            float d0 = dY_max_row[x] - dX_min_row[x];
+            if( maskptr[x] == 0 )
+                continue;
 
-            if( mask_row[x] == 0 || d0 < min_delta || max_delta < d0 )
+            int idx = cvFloor(oriptr[x] * scale);
+            if( (unsigned)idx < (unsigned)orientationHistSize )
+                stats.hist[idx]++;
+
+            if( !stats.hasTime || mhiptr[x] > stats.maxTime )
             {
-                mask_row[x] = (uchar)0;
-                orient_row[x] = 0.f;
+                stats.maxTime = mhiptr[x];
+                stats.hasTime = true;
             }
         }
     }
 }
 
-double calcGlobalOrientation( InputArray _orientation, InputArray _mask,
-                                  InputArray _mhi, double /*timestamp*/,
-                                  double duration )
+/*
+ a = 254/(255*dt)
+ b = 1 - t*a = 1 - 254*t/(255*dur) =
+ (255*dt - 254*t)/(255*dt) =
+ (dt - (t - dt)*254)/(255*dt);
+ --------------------------------------------------------
+ ax + b = 254*x/(255*dt) + (dt - (t - dt)*254)/(255*dt) =
+ (254*x + dt - (t - dt)*254)/(255*dt) =
+ ((x - (t - dt))*254 + dt)/(255*dt) =
+ (((x - (t - dt))/dt)*254 + 1)/255 = (((x - low_time)/dt)*254 + 1)/255
+ */
+static void accumulateOrientationShift( const Mat& orient, const Mat& mask, const Mat& mhi,
+                                        const Range& rows, float baseOrient, float a, float b,
+                                        float delbound, float& shiftOrient, float& shiftWeight )
 {
-    Mat orient = _orientation.getMat(), mask = _mask.getMat(), mhi = _mhi.getMat();
-    Size size = mhi.size();
+    shiftOrient = shiftWeight = 0.f;
 
-    CV_Assert( mask.type() == CV_8U && orient.type() == CV_32F && mhi.type() == CV_32F );
-    CV_Assert( mask.size() == size && orient.size() == size );
-    CV_Assert( duration > 0 );
-
-    int histSize = 12;
-    float _ranges[] = { 0.f, 360.f };
-    const float* ranges = _ranges;
-    Mat hist;
-
-    calcHist(&orient, 1, 0, mask, hist, 1, &histSize, &ranges);
-
-    // find the maximum index (the dominant orientation)
-    Point baseOrientPt;
-    minMaxLoc(hist, 0, 0, 0, &baseOrientPt);
-    float fbaseOrient = (baseOrientPt.x + baseOrientPt.y)*360.f/histSize;
-
-    // override timestamp with the maximum value in MHI
-    double timestamp = 0;
-    minMaxLoc( mhi, 0, &timestamp, 0, 0, mask );
-
-    // find the shift relative to the dominant orientation as weighted sum of relative angles
-    float a = (float)(254. / 255. / duration);
-    float b = (float)(1. - timestamp * a);
-    float delbound = (float)(timestamp - duration);
-
-    if( mhi.isContinuous() && mask.isContinuous() && orient.isContinuous() )
-    {
-        size.width *= size.height;
-        size.height = 1;
-    }
-
-    /*
-     a = 254/(255*dt)
-     b = 1 - t*a = 1 - 254*t/(255*dur) =
-     (255*dt - 254*t)/(255*dt) =
-     (dt - (t - dt)*254)/(255*dt);
-     --------------------------------------------------------
-     ax + b = 254*x/(255*dt) + (dt - (t - dt)*254)/(255*dt) =
-     (254*x + dt - (t - dt)*254)/(255*dt) =
-     ((x - (t - dt))*254 + dt)/(255*dt) =
-     (((x - (t - dt))/dt)*254 + 1)/255 = (((x - low_time)/dt)*254 + 1)/255
-     */
-    float shiftOrient = 0, shiftWeight = 0;
-    for( int y = 0; y < size.height; y++ )
+    for( int y = rows.start; y < rows.end; y++ )
     {
         const float* mhiptr = mhi.ptr<float>(y);
         const float* oriptr = orient.ptr<float>(y);
         const uchar* maskptr = mask.ptr<uchar>(y);
+        int x = 0;
+
+#if CV_SIMD128
+        v_float32x4 a4 = v_setall_f32(a), b4 = v_setall_f32(b), db4 = v_setall_f32(delbound);
+        v_float32x4 base4 = v_setall_f32(baseOrient);
+        v_float32x4 lo4 = v_setall_f32(-180.f), hi4 = v_setall_f32(180.f), full4 = v_setall_f32(360.f);
+        v_float32x4 range4 = v_setall_f32(45.f);
+        v_float32x4 sumOrient = v_setzero_f32(), sumWeight = v_setzero_f32();
+        v_uint32x4 z4 = v_setzero_u32();
+        for( ; x <= mhi.cols - 4; x += 4 )
+        {
+            v_float32x4 t = v_load(mhiptr + x);
+            v_float32x4 m = v_reinterpret_as_f32(v_load_expand_q(maskptr + x) != z4) & (t > db4);
+            v_float32x4 weight = v_muladd(t, a4, b4);
+            v_float32x4 relAngle = v_load(oriptr + x) - base4;
+
+            relAngle += full4 & (relAngle < lo4);
+            relAngle -= full4 & (relAngle > hi4);
+            m = m & (v_abs(relAngle) < range4);
 
-        for( int x = 0; x < size.width; x++ )
+            sumOrient += (weight * relAngle) & m;
+            sumWeight += weight & m;
+        }
+        shiftOrient += v_reduce_sum(sumOrient);
+        shiftWeight += v_reduce_sum(sumWeight);
+#endif
+
+        for( ; x < mhi.cols; x++ )
         {
             if( maskptr[x] != 0 && mhiptr[x] > delbound )
             {
@@ -322,7 +470,7 @@ double calcGlobalOrientation( InputArray _orientation, InputArray _mask,
                  rel_angle is translated to -180..180
                  */
                 float weight = mhiptr[x] * a + b;
-                float relAngle = oriptr[x] - fbaseOrient;
+                float relAngle = oriptr[x] - baseOrient;
 
                 relAngle += (relAngle < -180 ? 360 : 0);
                 relAngle += (relAngle > 180 ? -360 : 0);
@@ -335,6 +483,46 @@ double calcGlobalOrientation( InputArray _orientation, InputArray _mask,
             }
         }
     }
+}
+
+static double calcGlobalOrientation_( const Mat& orient, const Mat& mask, const Mat& mhi,
+                                      double duration, bool parallel )
+{
+    const int nstripes = stripeCount(mhi.rows);
+
+    vector<OrientationStats> stripeStats(nstripes);
+    forEachStripe(nstripes, parallel, [&](int i) {
+        accumulateOrientationStats(orient, mask, mhi, stripeRange(i, i + 1, mhi.rows), stripeStats[i]);
+    });
+
+    OrientationStats stats;
+    for( int i = 0; i < nstripes; i++ )
+        stats.merge(stripeStats[i]);
+
+    // find the maximum index (the dominant orientation)
+    int baseOrientIdx = (int)(std::max_element(stats.hist, stats.hist + orientationHistSize) - stats.hist);
+    float fbaseOrient = baseOrientIdx*360.f/orientationHistSize;
+
+    // override timestamp with the maximum value in MHI
+    double timestamp = stats.hasTime ? stats.maxTime : 0.;
+
+    // find the shift relative to the dominant orientation as weighted sum of relative angles
+    float a = (float)(254. / 255. / duration);
+    float b = (float)(1. - timestamp * a);
+    float delbound = (float)(timestamp - duration);
+
+    vector<Vec2f> stripeShifts(nstripes);
+    forEachStripe(nstripes, parallel, [&](int i) {
+        accumulateOrientationShift(orient, mask, mhi, stripeRange(i, i + 1, mhi.rows), fbaseOrient, a, b, delbound,
+                                   stripeShifts[i][0], stripeShifts[i][1]);
+    });
+
+    float shiftOrient = 0, shiftWeight = 0;
+    for( int i = 0; i < nstripes; i++ )
+    {
+        shiftOrient += stripeShifts[i][0];
+        shiftWeight += stripeShifts[i][1];
+    }
 
     // add the dominant orientation and the relative shift
     if( shiftWeight == 0 )
@@ -347,6 +535,60 @@ double calcGlobalOrientation( InputArray _orientation, InputArray _mask,
     return fbaseOrient;
 }
 
+double calcGlobalOrientation( InputArray _orientation, InputArray _mask,
+                                  InputArray _mhi, double /*timestamp*/,
+                                  double duration )
+{
+    Mat orient = _orientation.getMat(), mask = _mask.getMat(), mhi = _mhi.getMat();
+    Size size = mhi.size();
+
+    CV_Assert( mask.type() == CV_8U && orient.type() == CV_32F && mhi.type() == CV_32F );
+    CV_Assert( mask.size() == size && orient.size() == size );
+    CV_Assert( duration > 0 );
+
+    return calcGlobalOrientation_( orient, mask, mhi, duration, true );
+}
+
+void calcGlobalOrientation( InputArray _orientation, InputArray _mask, InputArray _mhi,
+                            const vector<Rect>& rois, double /*timestamp*/, double duration,
+                            vector<double>& orientations )
+{
+    Mat orient = _orientation.getMat(), mask = _mask.getMat(), mhi = _mhi.getMat();
+    Size size = mhi.size();
+
+    CV_Assert( mask.type() == CV_8U && orient.type() == CV_32F && mhi.type() == CV_32F );
+    CV_Assert( mask.size() == size && orient.size() == size );
+    CV_Assert( duration > 0 );
+
+    const Rect imageRect(Point(0, 0), size);
+    for( size_t i = 0; i < rois.size(); i++ )
+        CV_Assert( (rois[i] & imageRect) == rois[i] );
+
+    orientations.resize(rois.size());
+
+    // with enough zones every thread gets whole zones, otherwise the zones are split into stripes;
+    // the result is the same either way
+    const bool parallelZones = (int)rois.size() >= getNumThreads();
+    const int nzones = (int)rois.size();
+    auto processZone = [&](int i) {
+        const Rect& roi = rois[i];
+        orientations[i] = calcGlobalOrientation_( orient(roi), mask(roi), mhi(roi), duration, !parallelZones );
+    };
+
+    if( parallelZones )
+    {
+        parallel_for_(Range(0, nzones), [&](const Range& range) {
+            for( int i = range.start; i < range.end; i++ )
+                processZone(i);
+        });
+    }
+    else
+    {
+        for( int i = 0; i < nzones; i++ )
+            processZone(i);
+    }
+}
+
 
 void segmentMotion(InputArray _mhi, OutputArray _segmask,
                    vector<Rect>& boundingRects,
@@ -366,17 +608,33 @@ void segmentMotion(InputArray _mhi, OutputArray _segmask,
     int x, y;
 
     // protect zero mhi pixels from floodfill.
-    for( y = 0; y < mhi.rows; y++ )
-    {
-        const float* mhiptr = mhi.ptr<float>(y);
-        uchar* maskptr = mask.ptr<uchar>(y+1) + 1;
-
-        for( x = 0; x < mhi.cols; x++ )
+    parallel_for_(Range(0, mhi.rows), [&](const Range& range) {
+        for( int yy = range.start; yy < range.end; yy++ )
         {
-            if( mhiptr[x] == 0 )
-                maskptr[x] = 1;
+            const float* mhiptr = mhi.ptr<float>(yy);
+            uchar* maskptr = mask.ptr<uchar>(yy+1) + 1;
+            int xx = 0;
+
+#if CV_SIMD128
+            v_float32x4 z4 = v_setzero_f32();
+            v_uint8x16 one16 = v_setall_u8(1);
+            for( ; xx <= mhi.cols - 16; xx += 16 )
+            {
+                v_int32x4 m0 = v_reinterpret_as_s32(v_load(mhiptr + xx) == z4);
+                v_int32x4 m1 = v_reinterpret_as_s32(v_load(mhiptr + xx + 4) == z4);
+                v_int32x4 m2 = v_reinterpret_as_s32(v_load(mhiptr + xx + 8) == z4);
+                v_int32x4 m3 = v_reinterpret_as_s32(v_load(mhiptr + xx + 12) == z4);
+                v_int8x16 m8 = v_pack(v_pack(m0, m1), v_pack(m2, m3));
+                v_store(maskptr + xx, v_reinterpret_as_u8(m8) & one16);
+            }
+#endif
+            for( ; xx < mhi.cols; xx++ )
+            {
+                if( mhiptr[xx] == 0 )
+                    maskptr[xx] = 1;
+            }
         }
-    }
+    }, mhi.total() / (double)(1 << 16));
 
     float ts = (float)timestamp;
     float comp_idx = 1.f;
@@ -65,6 +65,10 @@ namespace
 const float M_SQRT2 = 1.41421356237309504880;
 #endif
 
+// Parameters of the pyramidal Lucas-Kanade matching (calcOpticalFlowPyrLK defaults)
+const Size lkWinSize( 21, 21 );
+const int lkMaxLevel = 3;
+
 template <typename T> inline int mathSign( T val ) { return ( T( 0 ) < val ) - ( val < T( 0 ) ); }
 
 /* Stable symmetric Householder reflection that gives c and s such that
@@ -107,96 +111,237 @@ inline void symOrtho( double a, double b, double &c, double &s, double &r )
   }
 }
 
+/* Stacked system matrix [F; P] of the two least squares problems solved for the flow components.
+ * The sampled basis F is shared by both of them, only the prior constraints P differ (P is empty when
+ * there is no prior). Products with F are evaluated for both problems in a single parallel pass over its rows.
+ */
+class PairedSystem
+{
+public:
+  PairedSystem( const Mat &_F, const Mat &P1, const Mat &P2 ) : F( _F )
+  {
+    CV_Assert( F.type() == CV_32F );
+    CV_Assert( P1.rows == P2.rows );
+    P[0] = P1;
+    P[1] = P2;
+  }
+
+  int rows() const { return F.rows + P[0].rows; }
+
+  int cols() const { return F.cols; }
+
+  // y[k] = A[k] * x[k]
+  void multiply( const Mat ( &x )[2], Mat ( &y )[2] ) const
+  {
+    const int m = F.cols;
+    y[0].create( rows(), 1, CV_32F );
+    y[1].create( rows(), 1, CV_32F );
+    const float *x0 = x[0].ptr<float>(), *x1 = x[1].ptr<float>();
+    float *y0 = y[0].ptr<float>(), *y1 = y[1].ptr<float>();
+
+    parallel_for_( Range( 0, F.rows ), [&]( const Range &range ) {
+      for ( int i = range.start; i < range.end; ++i )
+      {
+        const float *row = F.ptr<float>( i );
+        double s0 = 0, s1 = 0;
+        for ( int j = 0; j < m; ++j )
+        {
+          s0 += row[j] * x0[j];
+          s1 += row[j] * x1[j];
+        }
+        y0[i] = s0;
+        y1[i] = s1;
+      }
+    } );
+
+    for ( int k = 0; k < 2; ++k )
+      if ( !P[k].empty() )
+        Mat( P[k] * x[k] ).copyTo( y[k].rowRange( F.rows, rows() ) );
+  }
+
+  // y[k] = A[k]^T * x[k]
+  void multiplyTransposed( const Mat ( &x )[2], Mat ( &y )[2] ) const
+  {
+    const int m = F.cols;
+    const int nBlocks = ( F.rows + blockRows - 1 ) / blockRows;
+    const float *x0 = x[0].ptr<float>(), *x1 = x[1].ptr<float>();
+
+    // Partial sums are kept per block of rows and reduced in order, so the result doesn't depend on threading
+    partialSums.assign( (size_t)nBlocks * 2 * m, 0.0 );
+    parallel_for_( Range( 0, nBlocks ), [&]( const Range &range ) {
+      for ( int blk = range.start; blk < range.end; ++blk )
+      {
+        double *s0 = &partialSums[(size_t)blk * 2 * m];
+        double *s1 = s0 + m;
+        const int end = std::min( F.rows, ( blk + 1 ) * blockRows );
+        for ( int i = blk * blockRows; i < end; ++i )
+        {
+          const float *row = F.ptr<float>( i );
+          const double u0 = x0[i], u1 = x1[i];
+          for ( int j = 0; j < m; ++j )
+          {
+            s0[j] += row[j] * u0;
+            s1[j] += row[j] * u1;
+          }
+        }
+      }
+    } );
+
+    for ( int k = 0; k < 2; ++k )
+    {
+      y[k].create( m, 1, CV_32F );
+      float *out = y[k].ptr<float>();
+      for ( int j = 0; j < m; ++j )
+      {
+        double s = 0;
+        for ( int blk = 0; blk < nBlocks; ++blk )
+          s += partialSums[( (size_t)blk * 2 + k ) * m + j];
+        out[j] = s;
+      }
+      if ( !P[k].empty() )
+      {
+        Mat priorPart;
+        gemm( P[k], x[k].rowRange( F.rows, rows() ), 1, noArray(), 0, priorPart, GEMM_1_T );
+        y[k] += priorPart;
+      }
+    }
+  }
+
+private:
+  static const int blockRows = 512;
+
+  Mat F;
+  Mat P[2];
+  mutable std::vector<double> partialSums;
+};
+
 /* Iterative LSQR algorithm for solving least squares problems.
  *
  * [1] Paige, C. C. and M. A. Saunders,
  * LSQR: An Algorithm for Sparse Linear Equations And Sparse Least Squares
  * ACM Trans. Math. Soft., Vol.8, 1982, pp. 43-71.
  *
- * Solves the following problem:
- *   argmin_x ||Ax - b|| + damp||x||
+ * Solves the following pair of problems in lockstep:
+ *   argmin_x ||A[k]x - b[k]|| + damp||x||, k = 0, 1
  *
  * Output:
- *   x -- approximate solution
+ *   x -- approximate solutions
  */
-void solveLSQR( const Mat &A, const Mat &b, OutputArray xOut, const double damp = 0.0, const unsigned iter_lim = 10 )
+void solveLSQR( const PairedSystem &A, const Mat ( &b )[2], Mat ( &x )[2], const double damp = 0.0,
+                const unsigned iter_lim = 10 )
 {
-  const int n = A.size().width;
-  CV_Assert( A.size().height == b.size().height );
-  CV_Assert( A.type() == CV_32F );
-  CV_Assert( b.type() == CV_32F );
-  xOut.create( n, 1, CV_32F );
-
-  Mat v( n, 1, CV_32F, 0.0f );
-  Mat u = b;
-  Mat x = xOut.getMat();
-  x = Mat::zeros( x.size(), x.type() );
-  double alfa = 0;
-  double beta = cv::norm( u, NORM_L2 );
-  Mat w( n, 1, CV_32F, 0.0f );
-  const Mat AT = A.t();
-
-  if ( beta > 0 )
+  const int n = A.cols();
+  Mat u[2], v[2], w[2], Av[2], ATu[2];
+  double alfa[2], beta[2], rhobar[2], phibar[2];
+  bool active[2];
+
+  for ( int k = 0; k < 2; ++k )
   {
-    u *= 1 / beta;
-    v = AT * u;
-    alfa = cv::norm( v, NORM_L2 );
+    CV_Assert( A.rows() == b[k].size().height );
+    CV_Assert( b[k].type() == CV_32F );
+    x[k] = Mat::zeros( n, 1, CV_32F );
+    v[k] = Mat::zeros( n, 1, CV_32F );
+    w[k] = Mat::zeros( n, 1, CV_32F );
+    u[k] = b[k].clone();
+    alfa[k] = 0;
+    beta[k] = cv::norm( u[k], NORM_L2 );
+    if ( beta[k] > 0 )
+      u[k] *= 1 / beta[k];
   }
 
-  if ( alfa > 0 )
+  A.multiplyTransposed( u, ATu );
+  for ( int k = 0; k < 2; ++k )
   {
-    v *= 1 / alfa;
-    w = v.clone();
-  }
+    if ( beta[k] > 0 )
+    {
+      ATu[k].copyTo( v[k] );
+      alfa[k] = cv::norm( v[k], NORM_L2 );
+    }
+
+    if ( alfa[k] > 0 )
+    {
+      v[k] *= 1 / alfa[k];
+      v[k].copyTo( w[k] );
+    }
 
-  double rhobar = alfa;
-  double phibar = beta;
-  if ( alfa * beta == 0 )
+    rhobar[k] = alfa[k];
+    phibar[k] = beta[k];
+    active[k] = alfa[k] * beta[k] != 0;
+  }
+  if ( !active[0] && !active[1] )
     return;
 
   for ( unsigned itn = 0; itn < iter_lim; ++itn )
   {
-    u *= -alfa;
-    u += A * v;
-    beta = cv::norm( u, NORM_L2 );
-
-    if ( beta > 0 )
+    A.multiply( v, Av );
+    for ( int k = 0; k < 2; ++k )
     {
-      u *= 1 / beta;
-      v *= -beta;
-      v += AT * u;
-      alfa = cv::norm( v, NORM_L2 );
-      if ( alfa > 0 )
-        v *= 1 / alfa;
+      if ( !active[k] )
+        continue;
+      u[k] *= -alfa[k];
+      u[k] += Av[k];
+      beta[k] = cv::norm( u[k], NORM_L2 );
+      if ( beta[k] > 0 )
+        u[k] *= 1 / beta[k];
     }
 
-    double rhobar1 = sqrt( rhobar * rhobar + damp * damp );
-    double cs1 = rhobar / rhobar1;
-    phibar = cs1 * phibar;
+    A.multiplyTransposed( u, ATu );
+    for ( int k = 0; k < 2; ++k )
+    {
+      if ( !active[k] )
+        continue;
+      if ( beta[k] > 0 )
+      {
+        v[k] *= -beta[k];
+        v[k] += ATu[k];
+        alfa[k] = cv::norm( v[k], NORM_L2 );
+        if ( alfa[k] > 0 )
+          v[k] *= 1 / alfa[k];
+      }
+
+      double rhobar1 = sqrt( rhobar[k] * rhobar[k] + damp * damp );
+      double cs1 = rhobar[k] / rhobar1;
+      phibar[k] = cs1 * phibar[k];
 
-    double cs, sn, rho;
-    symOrtho( rhobar1, beta, cs, sn, rho );
+      double cs, sn, rho;
+      symOrtho( rhobar1, beta[k], cs, sn, rho );
 
-    double theta = sn * alfa;
-    rhobar = -cs * alfa;
-    double phi = cs * phibar;
-    phibar = sn * phibar;
+      double theta = sn * alfa[k];
+      rhobar[k] = -cs * alfa[k];
+      double phi = cs * phibar[k];
+      phibar[k] = sn * phibar[k];
 
-    double t1 = phi / rho;
-    double t2 = -theta / rho;
+      double t1 = phi / rho;
+      double t2 = -theta / rho;
 
-    x += t1 * w;
-    w *= t2;
-    w += v;
+      x[k] += t1 * w[k];
+      w[k] *= t2;
+      w[k] += v[k];
+    }
   }
 }
 
-inline void _cpu_fillDCTSampledPoints( float *row, const Point2f &p, const Size &basisSize, const Size &size )
+inline float sampleDCT( const Mat &table, int n, float p, int length )
 {
+  const int i = cvRound( p );
+  if ( i == p && i >= 0 && i < length )
+    return table.at<float>( n, i );
+  return cosf( ( n * CV_PI / length ) * ( p + 0.5 ) );
+}
+
+/* Fills a row of the system with the DCT basis sampled at p. The basis is separable, so it is enough
+ * to look up (or compute for subpixel points) one value per basis function along each axis.
+ */
+inline void _cpu_fillDCTSampledPoints( float *row, const Point2f &p, const Size &basisSize, const Size &size,
+                                       const Mat &cosX, const Mat &cosY, float *cx, float *cy )
+{
+  for ( int n1 = 0; n1 < basisSize.width; ++n1 )
+    cx[n1] = sampleDCT( cosX, n1, p.x, size.width );
+  for ( int n2 = 0; n2 < basisSize.height; ++n2 )
+    cy[n2] = sampleDCT( cosY, n2, p.y, size.height );
   for ( int n1 = 0; n1 < basisSize.width; ++n1 )
     for ( int n2 = 0; n2 < basisSize.height; ++n2 )
-      row[n1 * basisSize.height + n2] =
-        cosf( ( n1 * CV_PI / size.width ) * ( p.x + 0.5 ) ) * cosf( ( n2 * CV_PI / size.height ) * ( p.y + 0.5 ) );
+      row[n1 * basisSize.height + n2] = cx[n1] * cy[n2];
 }
 
 ocl::ProgramSource _ocl_fillDCTSampledPointsSource(
@@ -253,7 +398,34 @@ void reduceToFlow( const Mat &w1, const Mat &w2, Mat &flow, const Size &basisSiz
 }
 }
 
-void OpticalFlowPCAFlow::findSparseFeatures( UMat &from, UMat &to, std::vector<Point2f> &features,
+void OpticalFlowPCAFlow::updateCache( const Size size )
+{
+  if ( basisCacheSize != size )
+  {
+    basisCosX.create( basisSize.width, size.width, CV_32F );
+    basisCosY.create( basisSize.height, size.height, CV_32F );
+    for ( int n1 = 0; n1 < basisSize.width; ++n1 )
+      for ( int x = 0; x < size.width; ++x )
+        basisCosX.at<float>( n1, x ) = cosf( ( n1 * CV_PI / size.width ) * ( (float)x + 0.5 ) );
+    for ( int n2 = 0; n2 < basisSize.height; ++n2 )
+      for ( int y = 0; y < size.height; ++y )
+        basisCosY.at<float>( n2, y ) = cosf( ( n2 * CV_PI / size.height ) * ( (float)y + 0.5 ) );
+    basisCacheSize = size;
+  }
+
+  if ( prior.get() && priorA1.empty() )
+  {
+    CV_Assert( prior->getBasisSize() == basisSize.area() );
+    priorA1.create( prior->getPadding(), basisSize.area(), CV_32F );
+    priorA2.create( prior->getPadding(), basisSize.area(), CV_32F );
+    priorB1.create( prior->getPadding(), 1, CV_32F );
+    priorB2.create( prior->getPadding(), 1, CV_32F );
+    prior->fillConstraints( priorA1.ptr<float>(), priorA2.ptr<float>(), priorB1.ptr<float>(), priorB2.ptr<float>() );
+  }
+}
+
+void OpticalFlowPCAFlow::findSparseFeatures( UMat &from, InputArray fromLK, InputArray toLK,
+                                             std::vector<Point2f> &features,
                                              std::vector<Point2f> &predictedFeatures ) const
 {
   Size size = from.size();
@@ -271,7 +443,8 @@ void OpticalFlowPCAFlow::findSparseFeatures( UMat &from, UMat &to, std::vector<P
   }
   std::vector<uchar> predictedStatus;
   std::vector<float> predictedError;
-  calcOpticalFlowPyrLK( from, to, features, predictedFeatures, predictedStatus, predictedError );
+  calcOpticalFlowPyrLK( fromLK, toLK, features, predictedFeatures, predictedStatus, predictedError, lkWinSize,
+                        lkMaxLevel );
 
   size_t j = 0;
   for ( size_t i = 0; i < features.size(); ++i )
@@ -287,16 +460,18 @@ void OpticalFlowPCAFlow::findSparseFeatures( UMat &from, UMat &to, std::vector<P
   predictedFeatures.resize( j );
 }
 
-void OpticalFlowPCAFlow::removeOcclusions( UMat &from, UMat &to, std::vector<Point2f> &features,
+void OpticalFlowPCAFlow::removeOcclusions( InputArray fromLK, InputArray toLK, const Size size,
+                                           std::vector<Point2f> &features,
                                            std::vector<Point2f> &predictedFeatures ) const
 {
   std::vector<uchar> predictedStatus;
   std::vector<float> predictedError;
   std::vector<Point2f> backwardFeatures;
-  calcOpticalFlowPyrLK( to, from, predictedFeatures, backwardFeatures, predictedStatus, predictedError );
+  calcOpticalFlowPyrLK( toLK, fromLK, predictedFeatures, backwardFeatures, predictedStatus, predictedError,
+                        lkWinSize, lkMaxLevel );
 
   size_t j = 0;
-  const float threshold = occlusionsThreshold * sqrt( static_cast<float>(from.size().area()) );
+  const float threshold = occlusionsThreshold * sqrt( static_cast<float>(size.area()) );
   for ( size_t i = 0; i < predictedFeatures.size(); ++i )
   {
     if ( predictedStatus[i] )
@@ -314,78 +489,34 @@ void OpticalFlowPCAFlow::removeOcclusions( UMat &from, UMat &to, std::vector<Poi
   predictedFeatures.resize( j );
 }
 
-void OpticalFlowPCAFlow::getSystem( OutputArray AOut, OutputArray b1Out, OutputArray b2Out,
-                                    const std::vector<Point2f> &features, const std::vector<Point2f> &predictedFeatures,
-                                    const Size size )
-{
-  AOut.create( features.size(), basisSize.area(), CV_32F );
-  b1Out.create( features.size(), 1, CV_32F );
-  b2Out.create( features.size(), 1, CV_32F );
-  if ( useOpenCL )
-  {
-    UMat A = AOut.getUMat();
-    Mat b1 = b1Out.getMat();
-    Mat b2 = b2Out.getMat();
-
-    ocl::Kernel kernel( "fillDCTSampledPoints", _ocl_fillDCTSampledPointsSource );
-    CV_Assert(basisSize.width > 0 && basisSize.height > 0);
-    size_t globSize[] = {features.size(), (size_t)basisSize.width, (size_t)basisSize.height};
-    kernel
-      .args( cv::ocl::KernelArg::ReadOnlyNoSize( Mat( features ).getUMat( ACCESS_READ ) ),
-             cv::ocl::KernelArg::WriteOnlyNoSize( A ), (int)features.size(), (int)basisSize.width,
-             (int)basisSize.height, (int)size.width, (int)size.height )
-      .run( 3, globSize, 0, true );
-
-    for ( size_t i = 0; i < features.size(); ++i )
-    {
-      const Point2f flow = predictedFeatures[i] - features[i];
-      b1.at<float>( i ) = flow.x;
-      b2.at<float>( i ) = flow.y;
-    }
-  }
-  else
-  {
-    Mat A = AOut.getMat();
-    Mat b1 = b1Out.getMat();
-    Mat b2 = b2Out.getMat();
-
-    for ( size_t i = 0; i < features.size(); ++i )
-    {
-      _cpu_fillDCTSampledPoints( A.ptr<float>( i ), features[i], basisSize, size );
-      const Point2f flow = predictedFeatures[i] - features[i];
-      b1.at<float>( i ) = flow.x;
-      b2.at<float>( i ) = flow.y;
-    }
-  }
-}
-
-void OpticalFlowPCAFlow::getSystem( OutputArray A1Out, OutputArray A2Out, OutputArray b1Out, OutputArray b2Out,
-                                    const std::vector<Point2f> &features, const std::vector<Point2f> &predictedFeatures,
-                                    const Size size )
+void OpticalFlowPCAFlow::getSystem( Mat &A, Mat &b1, Mat &b2, const std::vector<Point2f> &features,
+                                    const std::vector<Point2f> &predictedFeatures, const Size size )
 {
-  CV_Assert( prior->getBasisSize() == basisSize.area() );
+  const int nFeatures = features.size();
+  const int padding = priorB1.rows;
 
-  A1Out.create( features.size() + prior->getPadding(), basisSize.area(), CV_32F );
-  A2Out.create( features.size() + prior->getPadding(), basisSize.area(), CV_32F );
-  b1Out.create( features.size() + prior->getPadding(), 1, CV_32F );
-  b2Out.create( features.size() + prior->getPadding(), 1, CV_32F );
+  // The number of matches varies from frame to frame, keep the largest buffer around
+  if ( systemBuffer.rows < nFeatures || systemBuffer.cols != basisSize.area() )
+    systemBuffer.create( std::max( nFeatures, systemBuffer.rows ), basisSize.area(), CV_32F );
+  A = systemBuffer.rowRange( 0, nFeatures );
+  b1.create( nFeatures + padding, 1, CV_32F );
+  b2.create( nFeatures + padding, 1, CV_32F );
 
   if ( useOpenCL )
   {
-    UMat A = A1Out.getUMat();
-    Mat b1 = b1Out.getMat();
-    Mat b2 = b2Out.getMat();
+    UMat uA( nFeatures, basisSize.area(), CV_32F );
 
     ocl::Kernel kernel( "fillDCTSampledPoints", _ocl_fillDCTSampledPointsSource );
     CV_Assert(basisSize.width > 0 && basisSize.height > 0);
     size_t globSize[] = {features.size(), (size_t)basisSize.width, (size_t)basisSize.height};
     kernel
       .args( cv::ocl::KernelArg::ReadOnlyNoSize( Mat( features ).getUMat( ACCESS_READ ) ),
-             cv::ocl::KernelArg::WriteOnlyNoSize( A ), (int)features.size(), (int)basisSize.width,
+             cv::ocl::KernelArg::WriteOnlyNoSize( uA ), (int)features.size(), (int)basisSize.width,
              (int)basisSize.height, (int)size.width, (int)size.height )
       .run( 3, globSize, 0, true );
+    uA.copyTo( A );
 
-    for ( size_t i = 0; i < features.size(); ++i )
+    for ( int i = 0; i < nFeatures; ++i )
     {
       const Point2f flow = predictedFeatures[i] - features[i];
       b1.at<float>( i ) = flow.x;
@@ -394,27 +525,24 @@ void OpticalFlowPCAFlow::getSystem( OutputArray A1Out, OutputArray A2Out, Output
   }
   else
   {
-    Mat A1 = A1Out.getMat();
-    Mat b1 = b1Out.getMat();
-    Mat b2 = b2Out.getMat();
-
-    for ( size_t i = 0; i < features.size(); ++i )
-    {
-      _cpu_fillDCTSampledPoints( A1.ptr<float>( i ), features[i], basisSize, size );
-      const Point2f flow = predictedFeatures[i] - features[i];
-      b1.at<float>( i ) = flow.x;
-      b2.at<float>( i ) = flow.y;
-    }
+    parallel_for_( Range( 0, nFeatures ), [&]( const Range &range ) {
+      AutoBuffer<float> buf( basisSize.width + basisSize.height );
+      for ( int i = range.start; i < range.end; ++i )
+      {
+        _cpu_fillDCTSampledPoints( A.ptr<float>( i ), features[i], basisSize, size, basisCosX, basisCosY, buf.data(),
+                                   buf.data() + basisSize.width );
+        const Point2f flow = predictedFeatures[i] - features[i];
+        b1.at<float>( i ) = flow.x;
+        b2.at<float>( i ) = flow.y;
+      }
+    } );
   }
 
-  Mat A1 = A1Out.getMat();
-  Mat A2 = A2Out.getMat();
-  Mat b1 = b1Out.getMat();
-  Mat b2 = b2Out.getMat();
-
-  memcpy( A2.ptr<float>(), A1.ptr<float>(), features.size() * basisSize.area() * sizeof( float ) );
-  prior->fillConstraints( A1.ptr<float>( features.size(), 0 ), A2.ptr<float>( features.size(), 0 ),
-                          b1.ptr<float>( features.size(), 0 ), b2.ptr<float>( features.size(), 0 ) );
+  if ( padding > 0 )
+  {
+    priorB1.copyTo( b1.rowRange( nFeatures, nFeatures + padding ) );
+    priorB2.copyTo( b2.rowRange( nFeatures, nFeatures + padding ) );
+  }
 }
 
 void OpticalFlowPCAFlow::calc( InputArray I0, InputArray I1, InputOutputArray flowOut )
@@ -447,34 +575,36 @@ void OpticalFlowPCAFlow::calc( InputArray I0, InputArray I1, InputOutputArray fl
 
   const Mat fromOrig = from.getMat( ACCESS_READ ).clone();
   useOpenCL = flowOut.isUMat() && ocl::useOpenCL();
+  updateCache( size );
 
   applyCLAHE( from, claheClip );
   applyCLAHE( to, claheClip );
 
   std::vector<Point2f> features, predictedFeatures;
-  findSparseFeatures( from, to, features, predictedFeatures );
-  removeOcclusions( from, to, features, predictedFeatures );
-
-  flowOut.create( size, CV_32FC2 );
-  Mat flow = flowOut.getMat();
-
-  Mat w1, w2;
-  if ( prior.get() )
+  if ( useOpenCL )
   {
-    Mat A1, A2, b1, b2;
-    getSystem( A1, A2, b1, b2, features, predictedFeatures, size );
-    solveLSQR( A1, b1, w1, dampingFactor * size.area() );
-    solveLSQR( A2, b2, w2, dampingFactor * size.area() );
+    findSparseFeatures( from, from, to, features, predictedFeatures );
+    removeOcclusions( from, to, size, features, predictedFeatures );
   }
   else
   {
-    Mat A, b1, b2;
-    getSystem( A, b1, b2, features, predictedFeatures, size );
-    solveLSQR( A, b1, w1, dampingFactor * size.area() );
-    solveLSQR( A, b2, w2, dampingFactor * size.area() );
+    // The pyramids are shared by the forward matching and the backward occlusion check
+    std::vector<Mat> fromPyr, toPyr;
+    buildOpticalFlowPyramid( from, fromPyr, lkWinSize, lkMaxLevel, true, BORDER_REFLECT_101, BORDER_CONSTANT, false );
+    buildOpticalFlowPyramid( to, toPyr, lkWinSize, lkMaxLevel, true, BORDER_REFLECT_101, BORDER_CONSTANT, false );
+    findSparseFeatures( from, fromPyr, toPyr, features, predictedFeatures );
+    removeOcclusions( fromPyr, toPyr, size, features, predictedFeatures );
   }
+
+  flowOut.create( size, CV_32FC2 );
+  Mat flow = flowOut.getMat();
+
+  Mat A, b[2], w[2];
+  getSystem( A, b[0], b[1], features, predictedFeatures, size );
+  solveLSQR( PairedSystem( A, priorA1, priorA2 ), b, w, dampingFactor * size.area() );
+
   Mat flowSmall( ( size / 8 ) * 2, CV_32FC2 );
-  reduceToFlow( w1, w2, flowSmall, basisSize );
+  reduceToFlow( w[0], w[1], flowSmall, basisSize );
   resize( flowSmall, flow, size, 0, 0, INTER_LINEAR );
   ximgproc::fastGlobalSmootherFilter( fromOrig, flow, flow, 500, 2 );
 }
@@ -491,7 +621,17 @@ OpticalFlowPCAFlow::OpticalFlowPCAFlow( Ptr<const PCAPrior> _prior, const Size _
   CV_Assert( occlusionsThreshold > 0 );
 }
 
-void OpticalFlowPCAFlow::collectGarbage() {}
+void OpticalFlowPCAFlow::collectGarbage()
+{
+  basisCacheSize = Size();
+  basisCosX.release();
+  basisCosY.release();
+  priorA1.release();
+  priorA2.release();
+  priorB1.release();
+  priorB2.release();
+  systemBuffer.release();
+}
 
 Ptr<DenseOpticalFlow> createOptFlow_PCAFlow() { return makePtr<OpticalFlowPCAFlow>(); }
 
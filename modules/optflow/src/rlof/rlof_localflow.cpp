@@ -358,13 +358,41 @@ int CImageBuffer::buildPyramid(cv::Size winSize, int maxLevel, float levelScale[
 {
     if (! m_Overwrite)
         return m_maxLevel;
+    // the levels do not depend on the border size, so a pyramid with a larger border can be reused
+    if (m_PyramidWinSize.width >= winSize.width && m_PyramidWinSize.height >= winSize.height
+        && (maxLevel <= m_maxLevel || (m_PyramidWinSize == winSize && m_maxLevel < m_PyramidMaxLevel)))
+        return std::min(maxLevel, m_maxLevel);
     if (withBlurredImage)
         m_maxLevel = buildOpticalFlowPyramidScale(m_BlurredImage, m_ImagePyramid, winSize, maxLevel, false, 4, 0, true, levelScale);
     else
         m_maxLevel = buildOpticalFlowPyramidScale(m_Image, m_ImagePyramid, winSize, maxLevel, false, 4, 0, true, levelScale);
+    m_PyramidWinSize = winSize;
+    m_PyramidMaxLevel = maxLevel;
+    m_DerivValid.assign(m_maxLevel + 1, 0);
     return m_maxLevel;
 }
 
+cv::Mat CImageBuffer::getDerivImage(int level)
+{
+    CV_DbgAssert(level < static_cast<int>(m_DerivValid.size()));
+    if (static_cast<int>(m_DerivPyramid.size()) <= level)
+        m_DerivPyramid.resize(level + 1);
+    const cv::Mat & img = m_ImagePyramid[level];
+    const cv::Size border = m_PyramidWinSize;
+    cv::Rect roi(border.width, border.height, img.cols, img.rows);
+    cv::Mat & deriv = m_DerivPyramid[level];
+    if (!m_DerivValid[level])
+    {
+        deriv.create(img.rows + border.height * 2, img.cols + border.width * 2,
+            CV_MAKETYPE(DataType<detail::deriv_type>::depth, img.channels() * 2));
+        cv::Mat derivI = deriv(roi);
+        calcSharrDeriv(img, derivI);
+        copyMakeBorder(derivI, deriv, border.height, border.height, border.width, border.width, BORDER_CONSTANT | BORDER_ISOLATED);
+        m_DerivValid[level] = 1;
+    }
+    return deriv(roi);
+}
+
 static
 void calcLocalOpticalFlowCore(
     Ptr<CImageBuffer>  prevPyramids[2],
@@ -388,7 +416,6 @@ void calcLocalOpticalFlowCore(
 
     bool usePreComputedCross = winSizes[0] != winSizes[1];
     Mat prevPtsMat = _prevPts.getMat();
-    const int derivDepth = DataType<detail::deriv_type>::depth;
 
     CV_Assert(param.maxLevel >= 0 && iWinSize > 2);
 
@@ -428,18 +455,10 @@ void calcLocalOpticalFlowCore(
         criteria.epsilon = std::min(std::max(criteria.epsilon, 0.), 10.);
     criteria.epsilon *= criteria.epsilon;
 
-    // dI/dx ~ Ix, dI/dy ~ Iy
-    Mat derivIBuf;
-    derivIBuf.create(prevPyramids[0]->m_ImagePyramid[0].rows + iWinSize * 2, prevPyramids[0]->m_ImagePyramid[0].cols + iWinSize * 2, CV_MAKETYPE(derivDepth, prevPyramids[0]->m_ImagePyramid[0].channels() * 2));
-
     for (level = maxLevel; level >= 0; level--)
     {
-        Mat derivI;
-        Size imgSize = prevPyramids[0]->getImage(level).size();
-        Mat _derivI(imgSize.height + iWinSize * 2, imgSize.width + iWinSize * 2, derivIBuf.type(), derivIBuf.data);
-        derivI = _derivI(Rect(iWinSize, iWinSize, imgSize.width, imgSize.height));
-        calcSharrDeriv(prevPyramids[0]->getImage(level), derivI);
-        copyMakeBorder(derivI, _derivI, iWinSize, iWinSize, iWinSize, iWinSize, BORDER_CONSTANT | BORDER_ISOLATED);
+        // dI/dx ~ Ix, dI/dy ~ Iy, kept with the pyramid of the previous image
+        Mat derivI = prevPyramids[0]->getDerivImage(level);
 
         cv::Mat tRGBPrevPyr;
         cv::Mat tRGBNextPyr;
@@ -708,4 +727,31 @@ void calcLocalOpticalFlow(
     calcLocalOpticalFlowCore(prevPyramids, currPyramids, prevPoints, currPoints, internParam);
 }
 
+void prepareImageBuffers(
+    const Mat image,
+    Ptr<CImageBuffer>  pyramids[2],
+    const RLOFOpticalFlowParameter & param)
+{
+    pyramids[0]->m_Overwrite = true;
+    pyramids[1]->m_Overwrite = true;
+    if (image.type() == CV_8UC3)
+    {
+        pyramids[0]->setGrayFromRGB(image);
+        pyramids[1]->setImage(image);
+        if (param.supportRegionType == SR_CROSS)
+            pyramids[1]->setBlurFromRGB(image);
+    }
+    else
+    {
+        pyramids[0]->setImage(image);
+    }
+
+    // built with the border of the main tracker, the global motion estimation uses a smaller window
+    float levelScale[2] = { 2.f,2.f };
+    cv::Size winSize(param.largeWinSize, param.largeWinSize);
+    int maxLevel = pyramids[0]->buildPyramid(winSize, param.maxLevel, levelScale);
+    if (param.supportRegionType == SR_CROSS)
+        pyramids[1]->buildPyramid(winSize, maxLevel, levelScale, true);
+}
+
 }} // namespace
@@ -75,32 +75,50 @@ class CImageBuffer
 {
 public:
     CImageBuffer()
-        : m_Overwrite(true)
+        : m_maxLevel(0)
+        , m_PyramidMaxLevel(-1)
+        , m_Overwrite(true)
     {}
     void setGrayFromRGB(const cv::Mat & inp)
     {
         if(m_Overwrite)
+        {
             cv::cvtColor(inp, m_Image, cv::COLOR_BGR2GRAY);
+            m_PyramidWinSize = cv::Size();
+        }
     }
     void setImage(const cv::Mat & inp)
     {
         if(m_Overwrite)
+        {
             inp.copyTo(m_Image);
+            m_PyramidWinSize = cv::Size();
+        }
     }
     void setBlurFromRGB(const cv::Mat & inp)
     {
         if(m_Overwrite)
+        {
             cv::GaussianBlur(inp, m_BlurredImage, cv::Size(7,7), -1);
+            m_PyramidWinSize = cv::Size();
+        }
     }
 
+    //! The pyramid is only rebuilt if the image has been set since the last call or a larger border or more levels are requested.
     int buildPyramid(cv::Size winSize, int maxLevel, float levelScale[2], bool withBlurredImage = false);
     cv::Mat & getImage(int level) {return m_ImagePyramid[level];}
+    //! Sharr derivatives of a pyramid level with a constant border of the pyramid border size, computed on first use.
+    cv::Mat getDerivImage(int level);
 
     std::vector<cv::Mat>     m_ImagePyramid;
+    std::vector<cv::Mat>     m_DerivPyramid;
+    std::vector<uchar>       m_DerivValid;
     cv::Mat                  m_BlurredImage;
     cv::Mat                  m_Image;
     std::vector<cv::Mat>     m_CrossPyramid;
     int                      m_maxLevel;
+    cv::Size                 m_PyramidWinSize;
+    int                      m_PyramidMaxLevel;
     bool                     m_Overwrite;
 };
 
@@ -113,5 +131,14 @@ void calcLocalOpticalFlow(
     std::vector<Point2f> & currPoints,
     const RLOFOpticalFlowParameter & param);
 
+/*! Sets the image of a buffer pair and builds the pyramids needed by calcLocalOpticalFlow for param.
+ * calcLocalOpticalFlow called with empty images afterwards reuses these pyramids and the derivatives
+ * computed from them, so a frame used as current image and then as previous image is processed once.
+ */
+void prepareImageBuffers(
+    const Mat image,
+    Ptr<CImageBuffer>  pyramids[2],
+    const RLOFOpticalFlowParameter & param);
+
 }} // namespace
 #endif
@@ -438,6 +438,177 @@ Ptr<SparseRLOFOpticalFlow> SparseRLOFOpticalFlow::create(
     return algo;
 }
 
+class SparseRLOFTrackerImpl : public SparseRLOFTracker
+{
+public:
+    SparseRLOFTrackerImpl()
+        : param(Ptr<RLOFOpticalFlowParameter>(new RLOFOpticalFlowParameter))
+        , forwardBackwardThreshold(1.f)
+        , frameType(-1)
+        , frameRegionType(SR_FIXED)
+    {
+        prevPyramid[0] = cv::Ptr< CImageBuffer>(new CImageBuffer);
+        prevPyramid[1] = cv::Ptr< CImageBuffer>(new CImageBuffer);
+        currPyramid[0] = cv::Ptr< CImageBuffer>(new CImageBuffer);
+        currPyramid[1] = cv::Ptr< CImageBuffer>(new CImageBuffer);
+    }
+    virtual void setRLOFOpticalFlowParameter(Ptr<RLOFOpticalFlowParameter>  val) CV_OVERRIDE { param = val; }
+    virtual Ptr<RLOFOpticalFlowParameter>  getRLOFOpticalFlowParameter() const CV_OVERRIDE { return param; }
+
+    virtual float getForwardBackward()  const CV_OVERRIDE { return forwardBackwardThreshold; }
+    virtual void setForwardBackward(float val) CV_OVERRIDE { forwardBackwardThreshold = val; }
+
+    virtual void reset() CV_OVERRIDE
+    {
+        frameSize = Size();
+        frameType = -1;
+        for (int k = 0; k < 2; k++)
+        {
+            prevPyramid[k] = cv::Ptr< CImageBuffer>(new CImageBuffer);
+            currPyramid[k] = cv::Ptr< CImageBuffer>(new CImageBuffer);
+        }
+    }
+
+    virtual void track(InputArray nextImg,
+        InputArrayOfArrays prevPts, InputOutputArrayOfArrays nextPts,
+        OutputArrayOfArrays status,
+        OutputArrayOfArrays err) CV_OVERRIDE
+    {
+        CV_Assert(!nextImg.empty() && nextImg.depth() == CV_8U && (nextImg.channels() == 3 || nextImg.channels() == 1));
+
+        if (param.empty())
+        {
+            param = makePtr<RLOFOpticalFlowParameter>();
+        }
+        CV_DbgAssert(!param.empty());
+
+        if (param->supportRegionType == SR_CROSS)
+        {
+            CV_CheckChannelsEQ(nextImg.channels(), 3, "SR_CROSS mode requires images with 3 channels");
+        }
+
+        Mat nextImage = nextImg.getMat();
+
+        // all sets are tracked as one point list, so a single parallel loop per level covers them
+        int nsets = static_cast<int>(prevPts.total());
+        std::vector<int> offsets(nsets + 1, 0);
+        std::vector<cv::Point2f> prevPoints, nextPoints, refPoints;
+        for (int i = 0; i < nsets; i++)
+        {
+            Mat prevPtsMat = prevPts.getMat(i);
+            int npoints = 0;
+            CV_Assert((npoints = prevPtsMat.checkVector(2, CV_32F, true)) >= 0);
+            offsets[i + 1] = offsets[i] + npoints;
+            if (npoints > 0)
+                prevPoints.insert(prevPoints.end(), prevPtsMat.ptr<Point2f>(), prevPtsMat.ptr<Point2f>() + npoints);
+        }
+        const int npoints = offsets[nsets];
+
+        // the blurred pyramid of the previous frame is only available if it has been prepared for SR_CROSS
+        bool hasPrevFrame = nextImage.size() == frameSize && nextImage.type() == frameType
+            && (param->supportRegionType != SR_CROSS || frameRegionType == SR_CROSS);
+        if (param->useInitialFlow && hasPrevFrame)
+        {
+            CV_Assert(static_cast<int>(nextPts.total()) == nsets);
+            nextPoints.resize(npoints);
+            for (int i = 0; i < nsets; i++)
+            {
+                Mat nextPtsMat = nextPts.getMat(i);
+                CV_Assert(nextPtsMat.checkVector(2, CV_32F, true) == offsets[i + 1] - offsets[i]);
+                std::copy(nextPtsMat.ptr<Point2f>(), nextPtsMat.ptr<Point2f>() + offsets[i + 1] - offsets[i], nextPoints.begin() + offsets[i]);
+            }
+        }
+
+        std::vector<uchar> statusVec(npoints, 1);
+        std::vector<float> errorVec(npoints, 0.f);
+
+        if (!hasPrevFrame)
+        {
+            prepareImageBuffers(nextImage, prevPyramid, *(param.get()));
+            frameSize = nextImage.size();
+            frameType = nextImage.type();
+            frameRegionType = param->supportRegionType;
+            nextPoints = prevPoints;
+        }
+        else
+        {
+            // only the new frame is decomposed, the previous one has been prepared by the last call
+            prepareImageBuffers(nextImage, currPyramid, *(param.get()));
+            frameRegionType = param->supportRegionType;
+            if (npoints > 0)
+            {
+                calcLocalOpticalFlow(Mat(), Mat(), prevPyramid, currPyramid, prevPoints, nextPoints, *(param.get()));
+                if (forwardBackwardThreshold > 0)
+                {
+                    RLOFOpticalFlowParameter backwardParam = *(param.get());
+                    backwardParam.useInitialFlow = false;
+                    enableBufferUpdate();
+                    calcLocalOpticalFlow(Mat(), Mat(), currPyramid, prevPyramid, nextPoints, refPoints, backwardParam);
+                    for (int r = 0; r < npoints; r++)
+                    {
+                        Point2f diff = refPoints[r] - prevPoints[r];
+                        errorVec[r] = sqrt(diff.x * diff.x + diff.y * diff.y);
+                        if (errorVec[r] > forwardBackwardThreshold)
+                            statusVec[r] = 0;
+                    }
+                }
+            }
+            std::swap(prevPyramid[0], currPyramid[0]);
+            std::swap(prevPyramid[1], currPyramid[1]);
+        }
+        enableBufferUpdate();
+
+        copyToArrays(nextPoints, offsets, CV_32FC2, nextPts);
+        if (status.needed())
+            copyToArrays(statusVec, offsets, CV_8UC1, status);
+        if (err.needed())
+            copyToArrays(errorVec, offsets, CV_32FC1, err);
+    }
+
+protected:
+    // calcLocalOpticalFlow locks the buffers it has used, the cached pyramids are reused anyway
+    void enableBufferUpdate()
+    {
+        for (int k = 0; k < 2; k++)
+        {
+            prevPyramid[k]->m_Overwrite = true;
+            currPyramid[k]->m_Overwrite = true;
+        }
+    }
+
+    template<typename T>
+    static void copyToArrays(const std::vector<T> & values, const std::vector<int> & offsets, int type, OutputArrayOfArrays dst)
+    {
+        int nsets = static_cast<int>(offsets.size()) - 1;
+        dst.create(nsets, 1, type);
+        for (int i = 0; i < nsets; i++)
+        {
+            int n = offsets[i + 1] - offsets[i];
+            dst.create(n, 1, type, i, true);
+            if (n > 0)
+                Mat(n, 1, type, (void*)&values[offsets[i]]).copyTo(dst.getMat(i));
+        }
+    }
+
+    Ptr<RLOFOpticalFlowParameter> param;
+    float                forwardBackwardThreshold;
+    Size                 frameSize;
+    int                  frameType;
+    SupportRegionType    frameRegionType;
+    Ptr<CImageBuffer>    prevPyramid[2];
+    Ptr<CImageBuffer>    currPyramid[2];
+};
+
+Ptr<SparseRLOFTracker> SparseRLOFTracker::create(
+    Ptr<RLOFOpticalFlowParameter>  rlofParam,
+    float forwardBackwardThreshold)
+{
+    Ptr<SparseRLOFTracker> algo = makePtr<SparseRLOFTrackerImpl>();
+    algo->setRLOFOpticalFlowParameter(rlofParam);
+    algo->setForwardBackward(forwardBackwardThreshold);
+    return algo;
+}
+
 void calcOpticalFlowDenseRLOF(InputArray I0, InputArray I1, InputOutputArray flow,
     Ptr<RLOFOpticalFlowParameter>  rlofParam ,
     float forewardBackwardThreshold, Size gridStep,
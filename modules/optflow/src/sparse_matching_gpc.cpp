@@ -50,6 +50,8 @@
 #ifdef CV_CXX11
 #include <random>  // std::mt19937
 #endif
+#include <fstream>
+#include <queue>
 
 /* Disable "from double to float" and "from size_t to int" warnings.
  * Fixing these would make the code look ugly by introducing explicit cast all around.
@@ -84,8 +86,10 @@ const unsigned scoreGainNeg = 1;
 const unsigned negSearchKNN = 5;
 const double simulatedAnnealingTemperatureCoef = 200.0;
 const double sigmaGrowthRate = 0.2;
-
-RNG rng;
+const int parallelSamplesThreshold = 4096; // nodes with more samples are scored in parallel
+const int minStripeSamples = 1024; // smallest number of samples scored by one parallel stripe
+const char binaryModelMagic[4] = { 'G', 'P', 'C', 'F' };
+const unsigned binaryModelVersion = 1;
 
 struct Magnitude
 {
@@ -453,7 +457,7 @@ void getTrainingSamples( const Mat &from, const Mat &to, const Mat &gt, GPCSampl
 }
 
 /* Sample random number from Cauchy distribution. */
-double getRandomCauchyScalar()
+double getRandomCauchyScalar( RNG &rng )
 {
   return tan( rng.uniform( -1.54, 1.54 ) ); // I intentionally used the value slightly less than PI/2 to enforce strictly
                                             // zero probability for large numbers. Resulting PDF for Cauchy has
@@ -462,13 +466,167 @@ double getRandomCauchyScalar()
 
 /* Sample random vector from Cauchy distribution (pointwise, i.e. vector whose components are independent random
  * variables from Cauchy distribution) */
-void getRandomCauchyVector( Vec< double, GPCPatchDescriptor::nFeatures > &v )
+void getRandomCauchyVector( Vec< double, GPCPatchDescriptor::nFeatures > &v, RNG &rng )
 {
   for ( unsigned i = 0; i < GPCPatchDescriptor::nFeatures; ++i )
-    v[i] = getRandomCauchyScalar();
+    v[i] = getRandomCauchyScalar( rng );
 }
 
 double getRobustMedian( double m ) { return m < 0 ? m * ( 1.0 + epsTolerance ) : m * ( 1.0 - epsTolerance ); }
+
+/* Run body( i ) for i in [0, n), across threads if requested. */
+template < typename Body > void forEachIndex( int n, bool parallel, const Body &body )
+{
+  if ( !parallel )
+  {
+    for ( int i = 0; i < n; ++i )
+      body( i );
+    return;
+  }
+
+  parallel_for_( Range( 0, n ), [&]( const Range &range ) {
+    for ( int i = range.start; i < range.end; ++i )
+      body( i );
+  } );
+}
+
+struct SplitCandidate
+{
+  Vec< double, GPCPatchDescriptor::nFeatures > coef;
+  double rhs;
+  unsigned score;
+};
+
+/* One global step of the hyperplane search: a random start refined by simulated annealing. Only reads the samples,
+ * so that several steps may run concurrently. The samples are scored in nStripes parallel stripes if nStripes > 1. */
+SplitCandidate searchSplit( GPCSamplesVector::const_iterator begin, int nSamples, int nStripes, RNG &rng )
+{
+  SplitCandidate best;
+  best.score = 0;
+
+  std::vector< double > values( nSamples ), sorted( nSamples );
+  std::vector< unsigned > partialScores( nStripes );
+
+  Vec< double, GPCPatchDescriptor::nFeatures > coef;
+  unsigned localBestScore = 0;
+  getRandomCauchyVector( coef, rng );
+
+  for ( int i = 0; i < localIters; ++i )
+  { // Local search step
+    double randomModification = getRandomCauchyScalar( rng ) * ( 1.0 + sigmaGrowthRate * int( i / GPCPatchDescriptor::nFeatures ) );
+    const int pos = i % GPCPatchDescriptor::nFeatures;
+    std::swap( coef[pos], randomModification );
+
+    forEachIndex( nSamples, nStripes > 1, [&]( int k ) { values[k] = begin[k].ref.dot( coef ); } );
+
+    std::copy( values.begin(), values.end(), sorted.begin() );
+    std::nth_element( sorted.begin(), sorted.begin() + nSamples / 2, sorted.end() );
+    double median = sorted[nSamples / 2];
+
+    // Skip obviously malformed division. This may happen in case there are a large number of equal samples.
+    // Most likely this won't happen with samples collected from a good dataset.
+    // Happens in case dataset contains plain (or close to plain) images.
+    if ( std::count_if( values.begin(), values.end(), CompareWithTolerance( median ) ) > std::max( 1, nSamples / 4 ) )
+      continue;
+
+    median = getRobustMedian( median );
+
+    // The projections of the reference descriptors are already known, only pos/neg ones are computed here.
+    forEachIndex( nStripes, nStripes > 1, [&]( int stripe ) {
+      unsigned score = 0;
+      for ( int k = nSamples * stripe / nStripes, kEnd = nSamples * ( stripe + 1 ) / nStripes; k < kEnd; ++k )
+      {
+        const GPCPatchSample &sample = begin[k];
+        const bool refdir = values[k] < median;
+        const bool posdir = sample.pos.isSeparated() ? ( !refdir ) : ( sample.pos.dot( coef ) < median );
+        const bool negdir = sample.neg.isSeparated() ? ( !refdir ) : ( sample.neg.dot( coef ) < median );
+        if ( refdir == posdir )
+          score += scoreGainPos;
+        if ( refdir != negdir )
+          score += scoreGainNeg;
+      }
+      partialScores[stripe] = score;
+    } );
+    unsigned score = 0;
+    for ( int stripe = 0; stripe < nStripes; ++stripe )
+      score += partialScores[stripe];
+
+    if ( score > localBestScore )
+      localBestScore = score;
+    else
+    {
+      const double beta = simulatedAnnealingTemperatureCoef * std::sqrt( static_cast<float>(i) ) / ( nSamples * ( scoreGainPos + scoreGainNeg ) );
+      if ( rng.uniform( 0.0, 1.0 ) > std::exp( -beta * ( localBestScore - score) ) )
+        coef[pos] = randomModification;
+    }
+
+    if ( score > best.score )
+    {
+      best.score = score;
+      best.coef = coef;
+      best.rhs = median;
+    }
+  }
+
+  return best;
+}
+
+/* Reorder the nodes breadth-first, so that the top levels visited by every patch share a few cache lines.
+ * Unreachable nodes are dropped. */
+void sortNodesBreadthFirst( std::vector< GPCTree::Node > &nodes )
+{
+  if ( nodes.empty() )
+    return;
+
+  const unsigned invalid = std::numeric_limits< unsigned >::max();
+  std::vector< unsigned > newId( nodes.size(), invalid );
+  std::vector< unsigned > order;
+  order.reserve( nodes.size() );
+
+  std::queue< unsigned > queue;
+  queue.push( 0 );
+  newId[0] = 0;
+  while ( !queue.empty() )
+  {
+    const unsigned id = queue.front();
+    queue.pop();
+    order.push_back( id );
+
+    const unsigned children[2] = { nodes[id].left, nodes[id].right };
+    for ( int c = 0; c < 2; ++c )
+    {
+      if ( children[c] == 0 )
+        continue;
+      if ( children[c] >= nodes.size() || newId[children[c]] != invalid )
+        CV_Error( Error::StsParseError, "Invalid tree structure" );
+      newId[children[c]] = (unsigned)( order.size() + queue.size() );
+      queue.push( children[c] );
+    }
+  }
+
+  std::vector< GPCTree::Node > sorted( order.size() );
+  for ( size_t i = 0; i < order.size(); ++i )
+  {
+    sorted[i] = nodes[order[i]];
+    sorted[i].left = sorted[i].left ? newId[sorted[i].left] : 0;
+    sorted[i].right = sorted[i].right ? newId[sorted[i].right] : 0;
+  }
+  nodes.swap( sorted );
+}
+
+template < typename T > void appendRaw( std::vector< uchar > &buf, const T *data, size_t count )
+{
+  const uchar *bytes = reinterpret_cast< const uchar * >( data );
+  buf.insert( buf.end(), bytes, bytes + sizeof( T ) * count );
+}
+
+template < typename T > void readRaw( const uchar *&ptr, const uchar *end, T *data, size_t count )
+{
+  if ( size_t( end - ptr ) < sizeof( T ) * count )
+    CV_Error( Error::StsParseError, "Unexpected end of the binary GPC model" );
+  memcpy( data, ptr, sizeof( T ) * count );
+  ptr += sizeof( T ) * count;
+}
 }
 
 double GPCPatchDescriptor::dot( const Vec< double, nFeatures > &coef ) const
@@ -521,81 +679,53 @@ void GPCDetails::getCoordinatesFromIndex( size_t index, Size sz, int &x, int &y
   y += patchRadius;
 }
 
-bool GPCTree::trainNode( size_t nodeId, SIter begin, SIter end, unsigned depth )
+unsigned GPCTree::trainNode( SIter begin, SIter end, unsigned depth, RNG &rng )
 {
   const int nSamples = (int)std::distance( begin, end );
 
   if ( nSamples < params.minNumberOfSamples || depth >= params.maxTreeDepth )
-    return false;
-
-  if ( nodeId >= nodes.size() )
-    nodes.resize( nodeId + 1 );
-
-  Node &node = nodes[nodeId];
-
-  // Select the best hyperplane
-  unsigned globalBestScore = 0;
-  std::vector< double > values;
-  values.reserve( nSamples * 2 );
+    return 0;
 
+  // Select the best hyperplane. The global search steps are independent, each one has its own random stream and
+  // the first best one wins, so the result doesn't depend on the number of threads. Large nodes are scored in parallel
+  // instead, there are only a few global steps.
+  SplitCandidate candidates[globalIters];
+  RNG stepRng[globalIters];
   for ( int j = 0; j < globalIters; ++j )
-  { // Global search step
-    Vec< double, GPCPatchDescriptor::nFeatures > coef;
-    unsigned localBestScore = 0;
-    getRandomCauchyVector( coef );
-
-    for ( int i = 0; i < localIters; ++i )
-    { // Local search step
-      double randomModification = getRandomCauchyScalar() * ( 1.0 + sigmaGrowthRate * int( i / GPCPatchDescriptor::nFeatures ) );
-      const int pos = i % GPCPatchDescriptor::nFeatures;
-      std::swap( coef[pos], randomModification );
-      values.clear();
-
-      for ( SIter iter = begin; iter != end; ++iter )
-        values.push_back( iter->ref.dot( coef ) );
-
-      std::nth_element( values.begin(), values.begin() + nSamples / 2, values.end() );
-      double median = values[nSamples / 2];
-
-      // Skip obviously malformed division. This may happen in case there are a large number of equal samples.
-      // Most likely this won't happen with samples collected from a good dataset.
-      // Happens in case dataset contains plain (or close to plain) images.
-      if ( std::count_if( values.begin(), values.end(), CompareWithTolerance( median ) ) > std::max( 1, nSamples / 4 ) )
-        continue;
-
-      median = getRobustMedian( median );
+    stepRng[j] = RNG( rng.next() );
 
-      unsigned score = 0;
-      for ( SIter iter = begin; iter != end; ++iter )
-      {
-        bool refdir, posdir, negdir;
-        iter->getDirections( refdir, posdir, negdir, coef, median );
-        if ( refdir == posdir )
-          score += scoreGainPos;
-        if ( refdir != negdir )
-          score += scoreGainNeg;
-      }
-
-      if ( score > localBestScore )
-        localBestScore = score;
-      else
-      {
-        const double beta = simulatedAnnealingTemperatureCoef * std::sqrt( static_cast<float>(i) ) / ( nSamples * ( scoreGainPos + scoreGainNeg ) );
-        if ( rng.uniform( 0.0, 1.0 ) > std::exp( -beta * ( localBestScore - score) ) )
-          coef[pos] = randomModification;
-      }
-
-      if ( score > globalBestScore )
-      {
-        globalBestScore = score;
-        node.coef = coef;
-        node.rhs = median;
-      }
-    }
+  // the scores are integer sums, so the number of stripes doesn't change them either
+  GPCSamplesVector::const_iterator cbegin = begin;
+  const int nStripes = nSamples >= parallelSamplesThreshold
+                       ? std::min( getNumThreads() * 4, std::max( 1, nSamples / minStripeSamples ) ) : 1;
+  if ( nStripes > 1 )
+  {
+    for ( int j = 0; j < globalIters; ++j )
+      candidates[j] = searchSplit( cbegin, nSamples, nStripes, stepRng[j] );
   }
+  else
+  {
+    parallel_for_( Range( 0, globalIters ), [&]( const Range &range ) {
+      for ( int j = range.start; j < range.end; ++j )
+        candidates[j] = searchSplit( cbegin, nSamples, 1, stepRng[j] );
+    } );
+  }
+
+  int bestIter = 0;
+  for ( int j = 1; j < globalIters; ++j )
+    if ( candidates[j].score > candidates[bestIter].score )
+      bestIter = j;
 
+  const unsigned globalBestScore = candidates[bestIter].score;
   if ( globalBestScore == 0 )
-    return false;
+    return 0;
+
+  const unsigned nodeId = (unsigned)nodes.size();
+  nodes.push_back( Node() );
+  Node &node = nodes.back();
+  node.coef = candidates[bestIter].coef;
+  node.rhs = candidates[bestIter].rhs;
+  node.left = node.right = 0;
 
   if ( params.printProgress )
   {
@@ -628,21 +758,32 @@ bool GPCTree::trainNode( size_t nodeId, SIter begin, SIter end, unsigned depth )
   SIter rightBegin =
     std::partition( leftEnd, end, PartitionPredicate2( node.coef, node.rhs ) ); // Separate undefined samples from right subtree samples.
 
-  node.left = ( trainNode( nodeId * 2 + 1, begin, leftEnd, depth + 1 ) ) ? unsigned( nodeId * 2 + 1 ) : 0;
-  node.right = ( trainNode( nodeId * 2 + 2, rightBegin, end, depth + 1 ) ) ? unsigned( nodeId * 2 + 2 ) : 0;
+  // The recursion appends to the node list, so the node is addressed by index from now on.
+  const unsigned left = trainNode( begin, leftEnd, depth + 1, rng );
+  nodes[nodeId].left = left;
+  const unsigned right = trainNode( rightBegin, end, depth + 1, rng );
+  nodes[nodeId].right = right;
 
-  return true;
+  return nodeId;
 }
 
 void GPCTree::train( GPCTrainingSamples &samples, const GPCTrainingParams _params )
+{
+  train( samples, _params, theRNG().next() );
+}
+
+void GPCTree::train( GPCTrainingSamples &samples, const GPCTrainingParams _params, uint64 seed )
 {
   if ( _params.descriptorType != samples.type() )
     CV_Error( Error::StsBadArg, "Descriptor type mismatch! Check that samples are collected with the same descriptor type." );
   nodes.clear();
-  nodes.reserve( samples.size() * 2 - 1 ); // set upper bound for the possible number of nodes so all subsequent resize() will be no-op
   params = _params;
   GPCSamplesVector &sv = samples;
-  trainNode( 0, sv.begin(), sv.end(), 0 );
+  RNG rng( seed );
+  trainNode( sv.begin(), sv.end(), 0, rng );
+  if ( nodes.empty() )
+    nodes.push_back( Node() ); // No split was found for the whole training set: a single leaf, every patch falls into it.
+  sortNodesBreadthFirst( nodes );
 }
 
 void GPCTree::write( FileStorage &fs ) const
@@ -657,20 +798,48 @@ void GPCTree::read( const FileNode &fn )
 {
   fn["nodes"] >> nodes;
   fn["dtype"] >> (int &)params.descriptorType;
+  sortNodesBreadthFirst( nodes );
+}
+
+void GPCTree::writeBinary( std::vector< uchar > &buf ) const
+{
+  if ( nodes.empty() )
+    CV_Error( Error::StsBadArg, "Tree have not been trained" );
+  const int dtype = params.descriptorType;
+  const unsigned nNodes = (unsigned)nodes.size();
+  appendRaw( buf, &dtype, 1 );
+  appendRaw( buf, &nNodes, 1 );
+  appendRaw( buf, &nodes[0], nodes.size() );
+}
+
+void GPCTree::readBinary( const uchar *&ptr, const uchar *end )
+{
+  CV_StaticAssert( sizeof( Node ) == ( GPCPatchDescriptor::nFeatures + 1 ) * sizeof( double ) + 2 * sizeof( unsigned ),
+                   "GPCTree::Node must not have padding, it is stored as is" );
+  int dtype = 0;
+  unsigned nNodes = 0;
+  readRaw( ptr, end, &dtype, 1 );
+  readRaw( ptr, end, &nNodes, 1 );
+  if ( nNodes == 0 || size_t( end - ptr ) / sizeof( Node ) < nNodes )
+    CV_Error( Error::StsParseError, "Unexpected end of the binary GPC model" );
+  params.descriptorType = dtype;
+  nodes.resize( nNodes );
+  readRaw( ptr, end, &nodes[0], nNodes );
+  sortNodesBreadthFirst( nodes ); // validates the child indices, the order is already breadth-first
 }
 
 unsigned GPCTree::findLeafForPatch( const GPCPatchDescriptor &descr ) const
 {
-  unsigned id = 0, prevId;
-  do
+  const Node *flat = &nodes[0];
+  unsigned id = 0;
+  for ( ;; )
   {
-    prevId = id;
-    if ( descr.dot( nodes[id].coef ) < nodes[id].rhs )
-      id = nodes[id].right;
-    else
-      id = nodes[id].left;
-  } while ( id );
-  return prevId;
+    const Node &node = flat[id];
+    const unsigned next = descr.dot( node.coef ) < node.rhs ? node.right : node.left;
+    if ( next == 0 )
+      return id;
+    id = next;
+  }
 }
 
 Ptr< GPCTrainingSamples > GPCTrainingSamples::create( const std::vector< String > &imagesFrom, const std::vector< String > &imagesTo,
@@ -737,6 +906,45 @@ Ptr< GPCTrainingSamples > GPCTrainingSamples::create( InputArrayOfArrays imagesF
   return ts;
 }
 
+void GPCDetails::writeBinaryModel( const String &filename, const std::vector< uchar > &trees, int nTrees )
+{
+  std::ofstream file( filename.c_str(), std::ios::binary );
+  if ( !file )
+    CV_Error( Error::StsError, "Can't open " + filename + " for writing" );
+  const unsigned header[2] = { binaryModelVersion, (unsigned)nTrees };
+  file.write( binaryModelMagic, sizeof( binaryModelMagic ) );
+  file.write( reinterpret_cast< const char * >( header ), sizeof( header ) );
+  if ( !trees.empty() )
+    file.write( reinterpret_cast< const char * >( &trees[0] ), trees.size() );
+  if ( !file )
+    CV_Error( Error::StsError, "Can't write " + filename );
+}
+
+int GPCDetails::readBinaryModel( const String &filename, std::vector< uchar > &trees )
+{
+  std::ifstream file( filename.c_str(), std::ios::binary );
+  if ( !file )
+    CV_Error( Error::StsError, "Can't open " + filename );
+  char magic[sizeof( binaryModelMagic )];
+  unsigned header[2];
+  file.read( magic, sizeof( magic ) );
+  file.read( reinterpret_cast< char * >( header ), sizeof( header ) );
+  if ( !file || memcmp( magic, binaryModelMagic, sizeof( magic ) ) != 0 )
+    CV_Error( Error::StsParseError, filename + " is not a binary GPC model" );
+  if ( header[0] != binaryModelVersion )
+    CV_Error( Error::StsParseError, "Unsupported version of the binary GPC model" );
+
+  file.seekg( 0, std::ios::end );
+  const std::streamoff size = file.tellg() - std::streamoff( sizeof( magic ) + sizeof( header ) );
+  file.seekg( sizeof( magic ) + sizeof( header ), std::ios::beg );
+  trees.resize( size_t( size ) );
+  if ( size > 0 )
+    file.read( reinterpret_cast< char * >( &trees[0] ), size );
+  if ( !file )
+    CV_Error( Error::StsParseError, "Can't read " + filename );
+  return (int)header[1];
+}
+
 void GPCDetails::dropOutliers( std::vector< std::pair< Point2i, Point2i > > &corr )
 {
   if ( corr.size() == 0 )
@@ -47,10 +47,86 @@ using namespace std;
 namespace cv {
 namespace optflow {
 
-CV_EXPORTS_W void calcOpticalFlowSparseToDense(InputArray from, InputArray to, OutputArray flow,
-                                               int grid_step, int k,
-                                               float sigma, bool use_post_proc,
-                                               float fgs_lambda, float fgs_sigma)
+// The instance keeps its buffers between calls: for a sequence of frames of the same size nothing is
+// reallocated, and the pyramid of the previous "to" frame is reused when it is passed as the next "from" frame.
+class OpticalFlowSparseToDense : public DenseOpticalFlow
+{
+public:
+    OpticalFlowSparseToDense(int _grid_step, int _k, float _sigma, bool _use_post_proc, float _fgs_lambda, float _fgs_sigma);
+    void calc(InputArray I0, InputArray I1, InputOutputArray flow) CV_OVERRIDE;
+    void collectGarbage() CV_OVERRIDE;
+
+    // keepFrames is false for one-shot calls, nothing is kept for a next call then
+    void calcFlow(InputArray from, InputArray to, OutputArray flow, bool keepFrames);
+protected:
+    void buildPyramid(const Mat& frame, vector<Mat>& pyramid, bool withDerivatives);
+
+    int grid_step;
+    int k;
+    float sigma;
+    bool use_post_proc;
+    float fgs_lambda;
+    float fgs_sigma;
+
+    //internal buffers:
+    Mat grayscale;
+    Mat last_frame;           // copy of the last "to" frame, nextPyramid was built from it
+    vector<Mat> prevPyramid;
+    vector<Mat> nextPyramid;
+    Size grid_size;
+    int grid_step_used;
+    vector<Point2f> points;
+    vector<Point2f> dst_points;
+    vector<unsigned char> status;
+    vector<float> err;
+    vector<Point2f> points_filtered, dst_points_filtered;
+    Ptr<ximgproc::EdgeAwareInterpolator> interpolator;
+};
+
+static const Size lkWinSize(21, 21);
+static const int lkMaxLevel = 3;
+
+static bool sameFrame(const Mat& a, const Mat& b)
+{
+    if (a.size() != b.size() || a.type() != b.type())
+        return false;
+    const size_t row_size = a.cols * a.elemSize();
+    for (int i = 0; i < a.rows; i++)
+        if (memcmp(a.ptr(i), b.ptr(i), row_size) != 0)
+            return false;
+    return true;
+}
+
+OpticalFlowSparseToDense::OpticalFlowSparseToDense(int _grid_step, int _k, float _sigma, bool _use_post_proc, float _fgs_lambda, float _fgs_sigma)
+{
+    grid_step     = _grid_step;
+    k             = _k;
+    sigma         = _sigma;
+    use_post_proc = _use_post_proc;
+    fgs_lambda    = _fgs_lambda;
+    fgs_sigma     = _fgs_sigma;
+    grid_step_used = 0;
+}
+
+void OpticalFlowSparseToDense::buildPyramid(const Mat& frame, vector<Mat>& pyramid, bool withDerivatives)
+{
+    // the derivatives are only used on the previous frame;
+    // the input is never referenced by the pyramid since the caller may overwrite it
+    if(frame.channels()==3)
+    {
+        cvtColor(frame,grayscale,COLOR_BGR2GRAY);
+        buildOpticalFlowPyramid(grayscale,pyramid,lkWinSize,lkMaxLevel,withDerivatives,BORDER_REFLECT_101,BORDER_CONSTANT,false);
+    }
+    else
+        buildOpticalFlowPyramid(frame,pyramid,lkWinSize,lkMaxLevel,withDerivatives,BORDER_REFLECT_101,BORDER_CONSTANT,false);
+}
+
+void OpticalFlowSparseToDense::calc(InputArray I0, InputArray I1, InputOutputArray flow)
+{
+    calcFlow(I0,I1,flow,true);
+}
+
+void OpticalFlowSparseToDense::calcFlow(InputArray from, InputArray to, OutputArray flow, bool keepFrames)
 {
     CV_Assert( grid_step>1 && k>3 && sigma>0.0001f && fgs_lambda>1.0f && fgs_sigma>0.01f );
     CV_Assert( !from.empty() && from.depth() == CV_8U && (from.channels() == 3 || from.channels() == 1) );
@@ -59,34 +135,41 @@ CV_EXPORTS_W void calcOpticalFlowSparseToDense(InputArray from, InputArray to, O
 
     Mat prev = from.getMat();
     Mat cur  = to.getMat();
-    Mat prev_grayscale, cur_grayscale;
 
-    while( (prev.cols/grid_step)*(prev.rows/grid_step) > SHRT_MAX ) //ensure that the number matches is not too big
-        grid_step*=2;
+    int step = grid_step;
+    while( (prev.cols/step)*(prev.rows/step) > SHRT_MAX ) //ensure that the number matches is not too big
+        step*=2;
 
-    if(prev.channels()==3)
+    if( prev.size() != grid_size || step != grid_step_used )
     {
-        cvtColor(prev,prev_grayscale,COLOR_BGR2GRAY);
-        cvtColor(cur, cur_grayscale, COLOR_BGR2GRAY);
+        points.clear();
+        for(int i=0;i<prev.rows;i+=step)
+            for(int j=0;j<prev.cols;j+=step)
+                points.push_back(Point2f((float)j,(float)i));
+        grid_size = prev.size();
+        grid_step_used = step;
+    }
+
+    if( !keepFrames )
+    {
+        buildPyramid(prev,prevPyramid,true);
+        buildPyramid(cur,nextPyramid,false);
     }
     else
     {
-        prev.copyTo(prev_grayscale);
-        cur .copyTo(cur_grayscale);
+        // the compared frame is copied anyway, checking its content is cheaper than a new pyramid
+        if( sameFrame(prev,last_frame) )
+            std::swap(prevPyramid,nextPyramid);
+        else
+            buildPyramid(prev,prevPyramid,true);
+        buildPyramid(cur,nextPyramid,true);
+        cur.copyTo(last_frame);
     }
 
-    vector<Point2f> points;
-    vector<Point2f> dst_points;
-    vector<unsigned char> status;
-    vector<float> err;
-    vector<Point2f> points_filtered, dst_points_filtered;
-
-    for(int i=0;i<prev.rows;i+=grid_step)
-        for(int j=0;j<prev.cols;j+=grid_step)
-            points.push_back(Point2f((float)j,(float)i));
-
-    calcOpticalFlowPyrLK(prev_grayscale,cur_grayscale,points,dst_points,status,err,Size(21,21));
+    calcOpticalFlowPyrLK(prevPyramid,nextPyramid,points,dst_points,status,err,lkWinSize,lkMaxLevel);
 
+    points_filtered.clear();
+    dst_points_filtered.clear();
     for(unsigned int i=0;i<points.size();i++)
     {
         if(status[i]!=0)
@@ -99,14 +182,46 @@ CV_EXPORTS_W void calcOpticalFlowSparseToDense(InputArray from, InputArray to, O
     flow.create(from.size(),CV_32FC2);
     Mat dense_flow = flow.getMat();
 
-    Ptr<ximgproc::EdgeAwareInterpolator> gd = ximgproc::createEdgeAwareInterpolator();
-    gd->setK(k);
-    gd->setSigma(sigma);
-    gd->setUsePostProcessing(use_post_proc);
-    gd->setFGSLambda(fgs_lambda);
-    gd->setFGSSigma (fgs_sigma);
-    gd->interpolate(prev,points_filtered,cur,dst_points_filtered,dense_flow);
+    if( interpolator.empty() )
+        interpolator = ximgproc::createEdgeAwareInterpolator();
+    interpolator->setK(k);
+    interpolator->setSigma(sigma);
+    interpolator->setUsePostProcessing(use_post_proc);
+    interpolator->setFGSLambda(fgs_lambda);
+    interpolator->setFGSSigma (fgs_sigma);
+    interpolator->interpolate(prev,points_filtered,cur,dst_points_filtered,dense_flow);
 }
 
+void OpticalFlowSparseToDense::collectGarbage()
+{
+    grayscale.release();
+    last_frame.release();
+    prevPyramid.clear();
+    nextPyramid.clear();
+    grid_size = Size();
+    grid_step_used = 0;
+    vector<Point2f>().swap(points);
+    vector<Point2f>().swap(dst_points);
+    vector<unsigned char>().swap(status);
+    vector<float>().swap(err);
+    vector<Point2f>().swap(points_filtered);
+    vector<Point2f>().swap(dst_points_filtered);
+    interpolator.release();
+}
+
+CV_EXPORTS_W void calcOpticalFlowSparseToDense(InputArray from, InputArray to, OutputArray flow,
+                                               int grid_step, int k,
+                                               float sigma, bool use_post_proc,
+                                               float fgs_lambda, float fgs_sigma)
+{
+    OpticalFlowSparseToDense algo(grid_step,k,sigma,use_post_proc,fgs_lambda,fgs_sigma);
+    algo.calcFlow(from,to,flow,false);
+}
+
+Ptr<DenseOpticalFlow> createOptFlow_SparseToDense()
+{
+    return makePtr<OpticalFlowSparseToDense>(8,128,0.05f,true,500.0f,1.5f);
+}
+
+}
 }
-}
\ No newline at end of file
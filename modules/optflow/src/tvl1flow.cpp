@@ -74,6 +74,7 @@
 
 #include "precomp.hpp"
 #include "opencl_kernels_optflow.hpp"
+#include "tvl1flow_blocked.hpp"
 
 #include <limits>
 #include <iomanip>
@@ -145,6 +146,7 @@ protected:
 
 private:
     void procOneScale(const Mat_<float>& I0, const Mat_<float>& I1, Mat_<float>& u1, Mat_<float>& u2, Mat_<float>& u3);
+    void procOneScale_blocked(const Mat_<float>& I0, const Mat_<float>& I1, Mat_<float>& u1, Mat_<float>& u2, Mat_<float>& u3);
 
 #ifdef HAVE_OPENCL
     bool procOneScale_ocl(const UMat& I0, const UMat& I1, UMat& u1, UMat& u2);
@@ -183,6 +185,17 @@ private:
         Mat_<float> p31_buf;
         Mat_<float> p32_buf;
 
+        // second copy of the flow and the dual variables for the blocked iterations
+        Mat_<float> u1b_buf;
+        Mat_<float> u2b_buf;
+        Mat_<float> u3b_buf;
+        Mat_<float> p11b_buf;
+        Mat_<float> p12b_buf;
+        Mat_<float> p21b_buf;
+        Mat_<float> p22b_buf;
+        Mat_<float> p31b_buf;
+        Mat_<float> p32b_buf;
+
         Mat_<float> div_p1_buf;
         Mat_<float> div_p2_buf;
         Mat_<float> div_p3_buf;
@@ -438,23 +451,16 @@ void OpticalFlowDual_TVL1::calc(InputArray _I0, InputArray _I1, InputOutputArray
         split(_flow.getMat(), mv);
     }
 
+    // the buffers are kept between the calls and only reallocated when the frame size changes
     dm.I1x_buf.create(I0.size());
     dm.I1y_buf.create(I0.size());
 
-    dm.flowMap1_buf.create(I0.size());
-    dm.flowMap2_buf.create(I0.size());
-
-    dm.I1w_buf.create(I0.size());
     dm.I1wx_buf.create(I0.size());
     dm.I1wy_buf.create(I0.size());
 
     dm.grad_buf.create(I0.size());
     dm.rho_c_buf.create(I0.size());
 
-    dm.v1_buf.create(I0.size());
-    dm.v2_buf.create(I0.size());
-    dm.v3_buf.create(I0.size());
-
     dm.p11_buf.create(I0.size());
     dm.p12_buf.create(I0.size());
     dm.p21_buf.create(I0.size());
@@ -462,17 +468,6 @@ void OpticalFlowDual_TVL1::calc(InputArray _I0, InputArray _I1, InputOutputArray
     dm.p31_buf.create(I0.size());
     dm.p32_buf.create(I0.size());
 
-    dm.div_p1_buf.create(I0.size());
-    dm.div_p2_buf.create(I0.size());
-    dm.div_p3_buf.create(I0.size());
-
-    dm.u1x_buf.create(I0.size());
-    dm.u1y_buf.create(I0.size());
-    dm.u2x_buf.create(I0.size());
-    dm.u2y_buf.create(I0.size());
-    dm.u3x_buf.create(I0.size());
-    dm.u3y_buf.create(I0.size());
-
     // create the scales
     for (int s = 1; s < nscales; ++s)
     {
@@ -506,11 +501,66 @@ void OpticalFlowDual_TVL1::calc(InputArray _I0, InputArray _I1, InputOutputArray
         dm.u2s[nscales - 1].setTo(Scalar::all(0));
     }
     if (use_gamma) dm.u3s[nscales - 1].setTo(Scalar::all(0));
+
+    // the scales with a large area run the iterations in blocks, they warp the target image per tile
+    // and need neither the intermediate images of the whole-image iterations nor their buffers
+    Size wholeSize, blockedSize;
+    for (int s = 0; s < nscales; ++s)
+    {
+        if (dm.I0s[s].size().area() < TVL1_BLOCKED_MIN_AREA)
+        {
+            wholeSize = dm.I0s[s].size();
+            break;
+        }
+        if (blockedSize.area() == 0)
+            blockedSize = dm.I0s[s].size();
+    }
+
+    if (wholeSize.area() > 0)
+    {
+        dm.flowMap1_buf.create(wholeSize);
+        dm.flowMap2_buf.create(wholeSize);
+
+        dm.I1w_buf.create(wholeSize);
+
+        dm.v1_buf.create(wholeSize);
+        dm.v2_buf.create(wholeSize);
+        dm.v3_buf.create(wholeSize);
+
+        dm.div_p1_buf.create(wholeSize);
+        dm.div_p2_buf.create(wholeSize);
+        dm.div_p3_buf.create(wholeSize);
+
+        dm.u1x_buf.create(wholeSize);
+        dm.u1y_buf.create(wholeSize);
+        dm.u2x_buf.create(wholeSize);
+        dm.u2y_buf.create(wholeSize);
+        dm.u3x_buf.create(wholeSize);
+        dm.u3y_buf.create(wholeSize);
+    }
+
+    if (blockedSize.area() > 0)
+    {
+        dm.u1b_buf.create(blockedSize);
+        dm.u2b_buf.create(blockedSize);
+        if (use_gamma) dm.u3b_buf.create(blockedSize);
+
+        dm.p11b_buf.create(blockedSize);
+        dm.p12b_buf.create(blockedSize);
+        dm.p21b_buf.create(blockedSize);
+        dm.p22b_buf.create(blockedSize);
+        if (use_gamma) dm.p31b_buf.create(blockedSize);
+        if (use_gamma) dm.p32b_buf.create(blockedSize);
+    }
+
     // pyramidal structure for computing the optical flow
     for (int s = nscales - 1; s >= 0; --s)
     {
         // compute the optical flow at the current scale
-        procOneScale(dm.I0s[s], dm.I1s[s], dm.u1s[s], dm.u2s[s], dm.u3s[s]);
+        if (dm.I0s[s].size().area() >= TVL1_BLOCKED_MIN_AREA)
+            procOneScale_blocked(dm.I0s[s], dm.I1s[s], dm.u1s[s], dm.u2s[s], dm.u3s[s]);
+        else
+            procOneScale(dm.I0s[s], dm.I1s[s], dm.u1s[s], dm.u2s[s], dm.u3s[s]);
 
         // if this was the last scale, finish now
         if (s == 0)
@@ -1220,6 +1270,73 @@ static void estimateDualVariables(const Mat_<float>& u1x, const Mat_<float>& u1y
     parallel_for_(Range(0, u1x.rows), body);
 }
 
+////////////////////////////////////////////////////////////
+// blocked processing (see tvl1flow_blocked.hpp)
+
+struct WarpTilesBody : ParallelLoopBody
+{
+    void operator() (const Range& range) const CV_OVERRIDE;
+
+    Mat_<float> I0;
+    Mat_<float> I1;
+    Mat_<float> I1x;
+    Mat_<float> I1y;
+    Mat_<float> u1;
+    Mat_<float> u2;
+    mutable Mat_<float> I1wx;
+    mutable Mat_<float> I1wy;
+    mutable Mat_<float> grad;
+    mutable Mat_<float> rho_c;
+    int tileSize;
+};
+
+void WarpTilesBody::operator() (const Range& range) const
+{
+    Mat_<float> flowMap1, flowMap2, I1w;
+
+    for (int t = range.start; t < range.end; ++t)
+    {
+        const Rect r = tileRect(t, I0.size(), tileSize);
+
+        flowMap1.create(r.size());
+        flowMap2.create(r.size());
+        for (int y = 0; y < r.height; ++y)
+        {
+            const float* u1Row = u1[r.y + y] + r.x;
+            const float* u2Row = u2[r.y + y] + r.x;
+
+            float* map1Row = flowMap1[y];
+            float* map2Row = flowMap2[y];
+
+            for (int x = 0; x < r.width; ++x)
+            {
+                map1Row[x] = (r.x + x) + u1Row[x];
+                map2Row[x] = (r.y + y) + u2Row[x];
+            }
+        }
+
+        // the maps hold absolute coordinates, so the whole source images are sampled
+        Mat_<float> I1wxTile = I1wx(r);
+        Mat_<float> I1wyTile = I1wy(r);
+        remap(I1, I1w, flowMap1, flowMap2, INTER_CUBIC);
+        remap(I1x, I1wxTile, flowMap1, flowMap2, INTER_CUBIC);
+        remap(I1y, I1wyTile, flowMap1, flowMap2, INTER_CUBIC);
+
+        CalcGradRhoBody body;
+
+        body.I0 = I0(r);
+        body.I1w = I1w;
+        body.I1wx = I1wxTile;
+        body.I1wy = I1wyTile;
+        body.u1 = u1(r);
+        body.u2 = u2(r);
+        body.grad = grad(r);
+        body.rho_c = rho_c(r);
+
+        body(Range(0, r.height));
+    }
+}
+
 #ifdef HAVE_OPENCL
 bool OpticalFlowDual_TVL1::procOneScale_ocl(const UMat& I0, const UMat& I1, UMat& u1, UMat& u2)
 {
@@ -1407,6 +1524,124 @@ void OpticalFlowDual_TVL1::procOneScale(const Mat_<float>& I0, const Mat_<float>
     }
 }
 
+void OpticalFlowDual_TVL1::procOneScale_blocked(const Mat_<float>& I0, const Mat_<float>& I1, Mat_<float>& u1, Mat_<float>& u2, Mat_<float>& u3)
+{
+    const float scaledEpsilon = static_cast<float>(epsilon * epsilon * I0.size().area());
+
+    CV_DbgAssert( I1.size() == I0.size() );
+    CV_DbgAssert( I1.type() == I0.type() );
+    CV_DbgAssert( u1.size() == I0.size() );
+    CV_DbgAssert( u2.size() == u1.size() );
+
+    Mat_<float> I1x = dm.I1x_buf(Rect(0, 0, I0.cols, I0.rows));
+    Mat_<float> I1y = dm.I1y_buf(Rect(0, 0, I0.cols, I0.rows));
+    centeredGradient(I1, I1x, I1y);
+
+    Mat_<float> I1wx = dm.I1wx_buf(Rect(0, 0, I0.cols, I0.rows));
+    Mat_<float> I1wy = dm.I1wy_buf(Rect(0, 0, I0.cols, I0.rows));
+
+    Mat_<float> grad = dm.grad_buf(Rect(0, 0, I0.cols, I0.rows));
+    Mat_<float> rho_c = dm.rho_c_buf(Rect(0, 0, I0.cols, I0.rows));
+
+    bool use_gamma = gamma != 0.;
+
+    // the blocks read one set of variables and write the other one, then the two are swapped
+    TVL1Variables vars[2];
+    vars[0].u1 = u1;
+    vars[0].u2 = u2;
+    vars[0].p11 = dm.p11_buf(Rect(0, 0, I0.cols, I0.rows));
+    vars[0].p12 = dm.p12_buf(Rect(0, 0, I0.cols, I0.rows));
+    vars[0].p21 = dm.p21_buf(Rect(0, 0, I0.cols, I0.rows));
+    vars[0].p22 = dm.p22_buf(Rect(0, 0, I0.cols, I0.rows));
+    vars[0].p11.setTo(Scalar::all(0));
+    vars[0].p12.setTo(Scalar::all(0));
+    vars[0].p21.setTo(Scalar::all(0));
+    vars[0].p22.setTo(Scalar::all(0));
+
+    vars[1].u1 = dm.u1b_buf(Rect(0, 0, I0.cols, I0.rows));
+    vars[1].u2 = dm.u2b_buf(Rect(0, 0, I0.cols, I0.rows));
+    vars[1].p11 = dm.p11b_buf(Rect(0, 0, I0.cols, I0.rows));
+    vars[1].p12 = dm.p12b_buf(Rect(0, 0, I0.cols, I0.rows));
+    vars[1].p21 = dm.p21b_buf(Rect(0, 0, I0.cols, I0.rows));
+    vars[1].p22 = dm.p22b_buf(Rect(0, 0, I0.cols, I0.rows));
+
+    if (use_gamma)
+    {
+        vars[0].u3 = u3;
+        vars[0].p31 = dm.p31_buf(Rect(0, 0, I0.cols, I0.rows));
+        vars[0].p32 = dm.p32_buf(Rect(0, 0, I0.cols, I0.rows));
+        vars[0].p31.setTo(Scalar::all(0));
+        vars[0].p32.setTo(Scalar::all(0));
+
+        vars[1].u3 = dm.u3b_buf(Rect(0, 0, I0.cols, I0.rows));
+        vars[1].p31 = dm.p31b_buf(Rect(0, 0, I0.cols, I0.rows));
+        vars[1].p32 = dm.p32b_buf(Rect(0, 0, I0.cols, I0.rows));
+    }
+    int cur = 0;
+
+    const float l_t = static_cast<float>(lambda * theta);
+    const float taut = static_cast<float>(tau / theta);
+
+    const int ntiles = tilesCount(I0.size(), TVL1_BLOCKED_TILE_SIZE);
+    std::vector<float> errors;
+
+    for (int warpings = 0; warpings < warps; ++warpings)
+    {
+        // compute the warping of the target image and its derivatives
+        WarpTilesBody warpBody;
+        warpBody.I0 = I0;
+        warpBody.I1 = I1;
+        warpBody.I1x = I1x;
+        warpBody.I1y = I1y;
+        warpBody.u1 = vars[cur].u1;
+        warpBody.u2 = vars[cur].u2;
+        warpBody.I1wx = I1wx;
+        warpBody.I1wy = I1wy;
+        warpBody.grad = grad;
+        warpBody.rho_c = rho_c;
+        warpBody.tileSize = TVL1_BLOCKED_TILE_SIZE;
+        parallel_for_(Range(0, ntiles), warpBody);
+
+        float error = std::numeric_limits<float>::max();
+        for (int n_outer = 0; error > scaledEpsilon && n_outer < outerIterations; ++n_outer)
+        {
+            if (medianFiltering > 1) {
+                cv::medianBlur(vars[cur].u1, vars[cur].u1, medianFiltering);
+                cv::medianBlur(vars[cur].u2, vars[cur].u2, medianFiltering);
+            }
+            for (int n_inner = 0; error > scaledEpsilon && n_inner < innerIterations; )
+            {
+                int iterations = std::min(TVL1_BLOCKED_DEPTH, innerIterations - n_inner);
+                blockedIterations(I1wx, I1wy, grad, rho_c, vars[cur], vars[cur ^ 1], iterations, TVL1_BLOCKED_TILE_SIZE,
+                                  l_t, static_cast<float>(theta), taut, static_cast<float>(gamma), errors);
+
+                // the whole-image iterations would have stopped at the first converged one, the
+                // block is run again from its unchanged input up to that iteration
+                int converged = 0;
+                while (converged < iterations - 1 && errors[converged] > scaledEpsilon)
+                    ++converged;
+                if (converged < iterations - 1)
+                {
+                    iterations = converged + 1;
+                    blockedIterations(I1wx, I1wy, grad, rho_c, vars[cur], vars[cur ^ 1], iterations, TVL1_BLOCKED_TILE_SIZE,
+                                      l_t, static_cast<float>(theta), taut, static_cast<float>(gamma), errors);
+                }
+
+                error = errors[iterations - 1];
+                n_inner += iterations;
+                cur ^= 1;
+            }
+        }
+    }
+
+    if (cur != 0)
+    {
+        vars[cur].u1.copyTo(u1);
+        vars[cur].u2.copyTo(u2);
+        if (use_gamma) vars[cur].u3.copyTo(u3);
+    }
+}
+
 void OpticalFlowDual_TVL1::collectGarbage()
 {
     //dataMat structure dm
@@ -1414,6 +1649,7 @@ void OpticalFlowDual_TVL1::collectGarbage()
     dm.I1s.clear();
     dm.u1s.clear();
     dm.u2s.clear();
+    dm.u3s.clear();
 
     dm.I1x_buf.release();
     dm.I1y_buf.release();
@@ -1430,19 +1666,35 @@ void OpticalFlowDual_TVL1::collectGarbage()
 
     dm.v1_buf.release();
     dm.v2_buf.release();
+    dm.v3_buf.release();
 
     dm.p11_buf.release();
     dm.p12_buf.release();
     dm.p21_buf.release();
     dm.p22_buf.release();
+    dm.p31_buf.release();
+    dm.p32_buf.release();
+
+    dm.u1b_buf.release();
+    dm.u2b_buf.release();
+    dm.u3b_buf.release();
+    dm.p11b_buf.release();
+    dm.p12b_buf.release();
+    dm.p21b_buf.release();
+    dm.p22b_buf.release();
+    dm.p31b_buf.release();
+    dm.p32b_buf.release();
 
     dm.div_p1_buf.release();
     dm.div_p2_buf.release();
+    dm.div_p3_buf.release();
 
     dm.u1x_buf.release();
     dm.u1y_buf.release();
     dm.u2x_buf.release();
     dm.u2y_buf.release();
+    dm.u3x_buf.release();
+    dm.u3y_buf.release();
 
 #ifdef HAVE_OPENCL
     //dataUMat structure dum
@@ -0,0 +1,325 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+
+#ifndef __OPENCV_OPTFLOW_TVL1FLOW_BLOCKED_HPP__
+#define __OPENCV_OPTFLOW_TVL1FLOW_BLOCKED_HPP__
+
+#include "opencv2/core.hpp"
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace cv
+{
+namespace optflow
+{
+
+// Temporal blocking of the TV-L1 primal-dual iterations
+//
+// One iteration only looks at the direct neighbours of a pixel: the divergence of the dual variables
+// reads the previous row and column, the forward gradient of the flow the next ones. A tile extended
+// by a halo of n pixels on every side can therefore run n iterations on its own, the values that
+// depend on pixels outside of the extended tile never get further than the halo. Each tile copies its
+// extended tile into local buffers, runs the iterations there while they stay in cache, and writes
+// its own pixels to a second set of variables, so that the neighbouring tiles still read the state
+// of the start of the block. The per-pixel arithmetic is the one of procOneScale.
+
+// scales with at least this many pixels do not fit in the caches and are processed in blocks
+static const int TVL1_BLOCKED_MIN_AREA = 1 << 19;
+// a 128x128 tile with a halo of 8 keeps the local variables and the warped gradients under 1 MB
+static const int TVL1_BLOCKED_TILE_SIZE = 128;
+static const int TVL1_BLOCKED_DEPTH = 8;
+
+struct TVL1Variables
+{
+    Mat_<float> u1;
+    Mat_<float> u2;
+    Mat_<float> u3;
+    Mat_<float> p11;
+    Mat_<float> p12;
+    Mat_<float> p21;
+    Mat_<float> p22;
+    Mat_<float> p31;
+    Mat_<float> p32;
+};
+
+static inline int tilesCount(const Size& size, int tileSize)
+{
+    return ((size.width + tileSize - 1) / tileSize) * ((size.height + tileSize - 1) / tileSize);
+}
+
+static inline Rect tileRect(int idx, const Size& size, int tileSize)
+{
+    const int tilesX = (size.width + tileSize - 1) / tileSize;
+    const int x = (idx % tilesX) * tileSize;
+    const int y = (idx / tilesX) * tileSize;
+    return Rect(x, y, std::min(tileSize, size.width - x), std::min(tileSize, size.height - y));
+}
+
+// same as DivergenceBody and the border handling of divergence()
+static inline float divergenceAt(const float* v1Row, const float* v2Row, const float* v2PrevRow, int x)
+{
+    if (v2PrevRow)
+    {
+        if (x > 0)
+        {
+            const float v1x = v1Row[x] - v1Row[x - 1];
+            const float v2y = v2Row[x] - v2PrevRow[x];
+            return v1x + v2y;
+        }
+        return v1Row[0] + v2Row[0] - v2PrevRow[0];
+    }
+    return x > 0 ? v1Row[x] - v1Row[x - 1] + v2Row[x] : v1Row[0] + v2Row[0];
+}
+
+struct BlockedIterationsBody : ParallelLoopBody
+{
+    void operator() (const Range& range) const CV_OVERRIDE;
+
+    Mat_<float> I1wx;
+    Mat_<float> I1wy;
+    Mat_<float> grad;
+    Mat_<float> rho_c;
+    TVL1Variables src;
+    mutable TVL1Variables dst;
+    float l_t;
+    float theta;
+    float taut;
+    float gamma;
+    int tileSize;
+    int iterations;
+    // squared flow updates of the tile pixels, iterations values per tile
+    float* errors;
+};
+
+inline void BlockedIterationsBody::operator() (const Range& range) const
+{
+    const bool use_gamma = gamma != 0;
+    const Size size = I1wx.size();
+    const int halo = iterations;
+    const int nvars = use_gamma ? 9 : 6;
+
+    const Mat_<float>* srcVars[] = { &src.u1, &src.u2, &src.p11, &src.p12, &src.p21, &src.p22, &src.u3, &src.p31, &src.p32 };
+    const Mat_<float>* dstVars[] = { &dst.u1, &dst.u2, &dst.p11, &dst.p12, &dst.p21, &dst.p22, &dst.u3, &dst.p31, &dst.p32 };
+
+    Mat_<float> bufs[9];
+    for (int i = 0; i < nvars; ++i)
+        bufs[i].create(tileSize + 2 * halo, tileSize + 2 * halo);
+
+    for (int t = range.start; t < range.end; ++t)
+    {
+        const Rect r = tileRect(t, size, tileSize);
+        const Rect ext = Rect(r.x - halo, r.y - halo, r.width + 2 * halo, r.height + 2 * halo) & Rect(Point(), size);
+        const Rect own = r - ext.tl();
+
+        Mat_<float> vars[9];
+        for (int i = 0; i < nvars; ++i)
+        {
+            vars[i] = bufs[i](Rect(0, 0, ext.width, ext.height));
+            (*srcVars[i])(ext).copyTo(vars[i]);
+        }
+        Mat_<float>& u1 = vars[0];
+        Mat_<float>& u2 = vars[1];
+        Mat_<float>& p11 = vars[2];
+        Mat_<float>& p12 = vars[3];
+        Mat_<float>& p21 = vars[4];
+        Mat_<float>& p22 = vars[5];
+        Mat_<float>& u3 = vars[6];
+        Mat_<float>& p31 = vars[7];
+        Mat_<float>& p32 = vars[8];
+
+        const Mat_<float> I1wxTile = I1wx(ext);
+        const Mat_<float> I1wyTile = I1wy(ext);
+        const Mat_<float> gradTile = grad(ext);
+        const Mat_<float> rhoTile = rho_c(ext);
+
+        // inside of the image the first row and column of the extended tile miss their previous
+        // neighbours and the last ones their next neighbours, they are left as they are
+        const int y0 = ext.y > 0 ? 1 : 0;
+        const int x0 = ext.x > 0 ? 1 : 0;
+        const int y1 = ext.y + ext.height < size.height ? ext.height - 1 : ext.height;
+        const int x1 = ext.x + ext.width < size.width ? ext.width - 1 : ext.width;
+        const int last_row = ext.height - 1;
+        const int last_col = ext.width - 1;
+
+        for (int k = 0; k < iterations; ++k)
+        {
+            float error = 0.0f;
+
+            // estimate (v1, v2, v3) and the optical flow (u1, u2, u3)
+            for (int y = y0; y < ext.height; ++y)
+            {
+                const float* I1wxRow = I1wxTile[y];
+                const float* I1wyRow = I1wyTile[y];
+                const float* gradRow = gradTile[y];
+                const float* rhoRow = rhoTile[y];
+
+                const float* p11Row = p11[y];
+                const float* p12Row = p12[y];
+                const float* p12PrevRow = y > 0 ? p12[y - 1] : NULL;
+                const float* p21Row = p21[y];
+                const float* p22Row = p22[y];
+                const float* p22PrevRow = y > 0 ? p22[y - 1] : NULL;
+                const float* p31Row = use_gamma ? p31[y] : NULL;
+                const float* p32Row = use_gamma ? p32[y] : NULL;
+                const float* p32PrevRow = use_gamma && y > 0 ? p32[y - 1] : NULL;
+
+                float* u1Row = u1[y];
+                float* u2Row = u2[y];
+                float* u3Row = use_gamma ? u3[y] : NULL;
+
+                // only the pixels of the tile itself count for the convergence
+                const bool ownRow = y >= own.y && y < own.y + own.height;
+
+                for (int x = x0; x < ext.width; ++x)
+                {
+                    const float u1k = u1Row[x];
+                    const float u2k = u2Row[x];
+                    const float u3k = use_gamma ? u3Row[x] : 0;
+
+                    // estimateV
+                    const float rho = use_gamma ? rhoRow[x] + (I1wxRow[x] * u1k + I1wyRow[x] * u2k) + gamma * u3k :
+                                                  rhoRow[x] + (I1wxRow[x] * u1k + I1wyRow[x] * u2k);
+                    float d1 = 0.0f;
+                    float d2 = 0.0f;
+                    float d3 = 0.0f;
+                    if (rho < -l_t * gradRow[x])
+                    {
+                        d1 = l_t * I1wxRow[x];
+                        d2 = l_t * I1wyRow[x];
+                        if (use_gamma) d3 = l_t * gamma;
+                    }
+                    else if (rho > l_t * gradRow[x])
+                    {
+                        d1 = -l_t * I1wxRow[x];
+                        d2 = -l_t * I1wyRow[x];
+                        if (use_gamma) d3 = -l_t * gamma;
+                    }
+                    else if (gradRow[x] > std::numeric_limits<float>::epsilon())
+                    {
+                        float fi = -rho / gradRow[x];
+                        d1 = fi * I1wxRow[x];
+                        d2 = fi * I1wyRow[x];
+                        if (use_gamma) d3 = fi * gamma;
+                    }
+
+                    const float v1 = u1k + d1;
+                    const float v2 = u2k + d2;
+                    const float v3 = u3k + d3;
+
+                    // estimateU
+                    u1Row[x] = v1 + theta * divergenceAt(p11Row, p12Row, p12PrevRow, x);
+                    u2Row[x] = v2 + theta * divergenceAt(p21Row, p22Row, p22PrevRow, x);
+                    if (use_gamma) u3Row[x] = v3 + theta * divergenceAt(p31Row, p32Row, p32PrevRow, x);
+
+                    if (ownRow && x >= own.x && x < own.x + own.width)
+                        error += use_gamma ? (u1Row[x] - u1k) * (u1Row[x] - u1k) + (u2Row[x] - u2k) * (u2Row[x] - u2k) + (u3Row[x] - u3k) * (u3Row[x] - u3k) :
+                                             (u1Row[x] - u1k) * (u1Row[x] - u1k) + (u2Row[x] - u2k) * (u2Row[x] - u2k);
+                }
+            }
+
+            errors[t * iterations + k] = error;
+
+            // estimate the values of the dual variable (p1, p2, p3)
+            for (int y = 0; y < y1; ++y)
+            {
+                const float* u1Row = u1[y];
+                const float* u2Row = u2[y];
+                const float* u3Row = use_gamma ? u3[y] : NULL;
+                const float* u1NextRow = y < last_row ? u1[y + 1] : NULL;
+                const float* u2NextRow = y < last_row ? u2[y + 1] : NULL;
+                const float* u3NextRow = use_gamma && y < last_row ? u3[y + 1] : NULL;
+
+                float* p11Row = p11[y];
+                float* p12Row = p12[y];
+                float* p21Row = p21[y];
+                float* p22Row = p22[y];
+                float* p31Row = use_gamma ? p31[y] : NULL;
+                float* p32Row = use_gamma ? p32[y] : NULL;
+
+                for (int x = 0; x < x1; ++x)
+                {
+                    // forwardGradient
+                    const float u1x = x < last_col ? u1Row[x + 1] - u1Row[x] : 0.0f;
+                    const float u1y = u1NextRow ? u1NextRow[x] - u1Row[x] : 0.0f;
+                    const float u2x = x < last_col ? u2Row[x + 1] - u2Row[x] : 0.0f;
+                    const float u2y = u2NextRow ? u2NextRow[x] - u2Row[x] : 0.0f;
+
+                    // estimateDualVariables
+                    const float g1 = static_cast<float>(hypot(u1x, u1y));
+                    const float g2 = static_cast<float>(hypot(u2x, u2y));
+
+                    const float ng1  = 1.0f + taut * g1;
+                    const float ng2 =  1.0f + taut * g2;
+
+                    p11Row[x] = (p11Row[x] + taut * u1x) / ng1;
+                    p12Row[x] = (p12Row[x] + taut * u1y) / ng1;
+                    p21Row[x] = (p21Row[x] + taut * u2x) / ng2;
+                    p22Row[x] = (p22Row[x] + taut * u2y) / ng2;
+
+                    if (use_gamma)
+                    {
+                        const float u3x = x < last_col ? u3Row[x + 1] - u3Row[x] : 0.0f;
+                        const float u3y = u3NextRow ? u3NextRow[x] - u3Row[x] : 0.0f;
+                        const float g3 = static_cast<float>(hypot(u3x, u3y));
+                        const float ng3 = 1.0f + taut * g3;
+                        p31Row[x] = (p31Row[x] + taut * u3x) / ng3;
+                        p32Row[x] = (p32Row[x] + taut * u3y) / ng3;
+                    }
+                }
+            }
+        }
+
+        for (int i = 0; i < nvars; ++i)
+        {
+            Mat_<float> dstTile = (*dstVars[i])(r);
+            vars[i](own).copyTo(dstTile);
+        }
+    }
+}
+
+// Runs iterations primal-dual iterations from the variables src and stores the result in dst, which
+// must not share data with src. errors receives the squared flow update of every iteration, summed
+// per tile and then over the tiles in a fixed order.
+static inline void blockedIterations(const Mat_<float>& I1wx, const Mat_<float>& I1wy, const Mat_<float>& grad, const Mat_<float>& rho_c,
+                                     const TVL1Variables& src, TVL1Variables& dst, int iterations, int tileSize,
+                                     float l_t, float theta, float taut, float gamma, std::vector<float>& errors)
+{
+    CV_DbgAssert( I1wy.size() == I1wx.size() );
+    CV_DbgAssert( grad.size() == I1wx.size() );
+    CV_DbgAssert( rho_c.size() == I1wx.size() );
+    CV_DbgAssert( src.u1.size() == I1wx.size() && dst.u1.size() == I1wx.size() );
+    CV_DbgAssert( src.u1.data != dst.u1.data );
+    CV_Assert( iterations > 0 && tileSize > 0 );
+
+    const int ntiles = tilesCount(I1wx.size(), tileSize);
+    std::vector<float> tileErrors(ntiles * iterations);
+
+    BlockedIterationsBody body;
+    body.I1wx = I1wx;
+    body.I1wy = I1wy;
+    body.grad = grad;
+    body.rho_c = rho_c;
+    body.src = src;
+    body.dst = dst;
+    body.l_t = l_t;
+    body.theta = theta;
+    body.taut = taut;
+    body.gamma = gamma;
+    body.tileSize = tileSize;
+    body.iterations = iterations;
+    body.errors = &tileErrors[0];
+
+    parallel_for_(Range(0, ntiles), body);
+
+    errors.assign(iterations, 0.0f);
+    for (int t = 0; t < ntiles; ++t)
+        for (int k = 0; k < iterations; ++k)
+            errors[k] += tileErrors[t * iterations + k];
+}
+
+}
+}
+
+#endif
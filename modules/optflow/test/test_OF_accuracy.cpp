@@ -243,6 +243,48 @@ TEST(SparseOpticalFlow, ReferenceAccuracy)
     EXPECT_LE(calcRMSE(prevPts, currPts, GT), 0.28f);
 }
 
+TEST(SparseOpticalFlow_RLOFTracker, SameAsSparseRLOF)
+{
+    Mat frame1, frame2, GT;
+    ASSERT_TRUE(readRubberWhale(frame1, frame2, GT));
+    // two interleaved point sets
+    vector<vector<Point2f> > prevPts(2);
+    for (int r = 0; r < frame1.rows; r+=10)
+    {
+        for (int c = 0; c < frame1.cols; c+=10)
+        {
+            prevPts[(r / 10) % 2].push_back(Point2f(static_cast<float>(c), static_cast<float>(r)));
+        }
+    }
+    vector<vector<Point2f> > nextPts;
+    vector<vector<uchar> > status;
+    vector<vector<float> > err;
+    Ptr<SparseRLOFTracker> tracker = SparseRLOFTracker::create();
+    tracker->track(frame1, prevPts, nextPts, status, err);
+    ASSERT_EQ(prevPts.size(), nextPts.size());
+    EXPECT_EQ(0, cvtest::norm(prevPts[0], nextPts[0], NORM_INF));
+    tracker->track(frame2, prevPts, nextPts, status, err);
+    ASSERT_EQ(prevPts.size(), nextPts.size());
+    ASSERT_EQ(prevPts.size(), status.size());
+    ASSERT_EQ(prevPts.size(), err.size());
+
+    Ptr<SparseRLOFOpticalFlow> algo = SparseRLOFOpticalFlow::create();
+    for (size_t i = 0; i < prevPts.size(); i++)
+    {
+        vector<Point2f> currPts;
+        vector<uchar> currStatus;
+        vector<float> currErr;
+        algo->calc(frame1, frame2, prevPts[i], currPts, currStatus, currErr);
+        ASSERT_EQ(currPts.size(), nextPts[i].size());
+        // lost points may be NaN in both results
+        Mat expected = Mat(currPts).clone(), actual = Mat(nextPts[i]).clone();
+        patchNaNs(expected, 0);
+        patchNaNs(actual, 0);
+        EXPECT_LE(cvtest::norm(expected, actual, NORM_INF), 1e-3);
+        EXPECT_EQ(0, cvtest::norm(currStatus, status[i], NORM_INF));
+    }
+}
+
 TEST(DenseOpticalFlow_RLOF, ReferenceAccuracy)
 {
     Mat frame1, frame2, GT;
@@ -287,6 +329,21 @@ TEST(DenseOpticalFlow_SparseToDenseFlow, ReferenceAccuracy)
     EXPECT_LE(calcRMSE(GT, flow), target_RMSE);
 }
 
+TEST(DenseOpticalFlow_SparseToDenseFlow, ReusedInstance)
+{
+    Mat frame1, frame2, GT;
+    ASSERT_TRUE(readRubberWhale(frame1, frame2, GT));
+
+    // the second call starts from the frame passed last, its pyramid is reused
+    Mat flow, ref_flow;
+    Ptr<DenseOpticalFlow> algo = createOptFlow_SparseToDense();
+    algo->calc(frame1, frame2, flow);
+    algo->calc(frame2, frame1, flow);
+    calcOpticalFlowSparseToDense(frame2, frame1, ref_flow);
+    ASSERT_EQ(ref_flow.size(), flow.size());
+    EXPECT_EQ(0, cvtest::norm(ref_flow, flow, NORM_INF));
+}
+
 TEST(DenseOpticalFlow_PCAFlow, ReferenceAccuracy)
 {
     Mat frame1, frame2, GT;
@@ -349,5 +406,37 @@ TEST(DenseOpticalFlow_GlobalPatchColliderWHT, ReferenceAccuracy)
     ASSERT_LE(calcAvgEPE(corr, GT), 0.5f);
 }
 
+TEST(DenseOpticalFlow_GlobalPatchCollider, BinaryModel)
+{
+    Mat frame1, frame2, GT;
+    ASSERT_TRUE(readRubberWhale(frame1, frame2, GT));
+
+    const Size sz = frame1.size() / 2;
+    frame1 = frame1(Rect(0, 0, sz.width, sz.height));
+    frame2 = frame2(Rect(0, 0, sz.width, sz.height));
+    GT = GT(Rect(0, 0, sz.width, sz.height));
+
+    vector<Mat> img1, img2, gt;
+    img1.push_back(frame1);
+    img2.push_back(frame2);
+    gt.push_back(GT);
+
+    Ptr< GPCForest<3> > forest = GPCForest<3>::create();
+    forest->train(img1, img2, gt, GPCTrainingParams(6, 3, GPC_DESCRIPTOR_WHT, false));
+
+    const string filename = cv::tempfile(".gpc");
+    forest->saveBinary(filename);
+    Ptr< GPCForest<3> > loaded = GPCForest<3>::create();
+    loaded->loadBinary(filename);
+    remove(filename.c_str());
+
+    vector< pair<Point2i, Point2i> > corr, corrLoaded;
+    forest->findCorrespondences(frame1, frame2, corr);
+    loaded->findCorrespondences(frame1, frame2, corrLoaded);
+
+    ASSERT_FALSE(corr.empty());
+    EXPECT_EQ(corr, corrLoaded);
+}
+
 
 }} // namespace
@@ -498,4 +498,71 @@ TEST(Video_MHIUpdate, accuracy) { CV_UpdateMHITest test; test.safe_run(); }
 TEST(Video_MHIGradient, accuracy) { CV_MHIGradientTest test; test.safe_run(); }
 TEST(Video_MHIGlobalOrient, accuracy) { CV_MHIGlobalOrientTest test; test.safe_run(); }
 
+// motion history of a few rectangles moving in different directions
+static void makeMotionHistory( Size size, int frames, double duration, Mat& mhi, Mat& silh )
+{
+    RNG& rng = theRNG();
+    mhi = Mat::zeros(size, CV_32F);
+    silh.create(size, CV_8U);
+    for( int t = 1; t <= frames; t++ )
+    {
+        silh = Scalar::all(0);
+        for( int k = 0; k < 4; k++ )
+        {
+            Point org(size.width*(k + 1)/5 + (k % 2 ? t : -t)*3, size.height*(k + 1)/6 + (k < 2 ? t : -t)*2);
+            rectangle(silh, Rect(org, Size(size.width/8, size.height/8)), Scalar::all(255), FILLED);
+        }
+        // some noise to break the symmetry
+        for( int k = 0; k < 50; k++ )
+            silh.at<uchar>(rng.uniform(0, size.height), rng.uniform(0, size.width)) = 255;
+        if( t < frames )
+            cv::motempl::updateMotionHistory(silh, mhi, t, duration);
+    }
+}
+
+TEST(Video_MHIUpdateAndGradient, consistency)
+{
+    const Size size(317, 203);
+    const double duration = 5;
+    for( int aperture_size = 3; aperture_size <= 7; aperture_size += 2 )
+    {
+        Mat mhi, silh;
+        makeMotionHistory(size, 12, duration, mhi, silh);
+        Mat mhiRef = mhi.clone(), maskRef, orientRef;
+        cv::motempl::updateMotionHistory(silh, mhiRef, 12, duration);
+        cv::motempl::calcMotionGradient(mhiRef, maskRef, orientRef, 0.5, 1.5, aperture_size);
+
+        Mat mask, orient;
+        cv::motempl::updateMotionHistoryAndGradient(silh, mhi, mask, orient, 12, duration, 0.5, 1.5, aperture_size);
+
+        EXPECT_EQ(0, cvtest::norm(mhi, mhiRef, NORM_INF)) << "aperture_size=" << aperture_size;
+        EXPECT_EQ(0, cvtest::norm(mask, maskRef, NORM_INF)) << "aperture_size=" << aperture_size;
+        EXPECT_LE(cvtest::norm(orient, orientRef, NORM_INF), 1e-3) << "aperture_size=" << aperture_size;
+    }
+}
+
+TEST(Video_MHIGlobalOrient, zones)
+{
+    const Size size(640, 480);
+    const double duration = 5;
+    Mat mhi, silh, mask, orient;
+    makeMotionHistory(size, 12, duration, mhi, silh);
+    cv::motempl::calcMotionGradient(mhi, mask, orient, 0.5, 1.5);
+
+    vector<Rect> rois;
+    for( int y = 0; y + 120 <= size.height; y += 60 )
+        for( int x = 0; x + 160 <= size.width; x += 80 )
+            rois.push_back(Rect(x, y, 160, 120));
+    rois.push_back(Rect(Point(0, 0), size));
+
+    vector<double> orientations;
+    cv::motempl::calcGlobalOrientation(orient, mask, mhi, rois, 11, duration, orientations);
+    ASSERT_EQ(rois.size(), orientations.size());
+    for( size_t i = 0; i < rois.size(); i++ )
+    {
+        double expected = cv::motempl::calcGlobalOrientation(orient(rois[i]), mask(rois[i]), mhi(rois[i]), 11, duration);
+        EXPECT_EQ(expected, orientations[i]) << "roi " << rois[i];
+    }
+}
+
 }} // namespace
@@ -40,6 +40,7 @@
 //M*/
 
 #include "test_precomp.hpp"
+#include "../src/tvl1flow_blocked.hpp"
 
 namespace opencv_test { namespace {
 
@@ -170,4 +171,91 @@ TEST(Contrib_calcOpticalFlowDual_TVL1, Regression)
 #endif
 }
 
+TEST(Contrib_calcOpticalFlowDual_TVL1, BlockedIterations)
+{
+    // the iterations on a single tile covering the image are the whole-image iterations
+    const Size sz(203, 157);
+    RNG rng(12345);
+
+    Mat_<float> I1wx(sz), I1wy(sz), grad(sz), rho_c(sz);
+    rng.fill(I1wx, RNG::UNIFORM, -20, 20);
+    rng.fill(I1wy, RNG::UNIFORM, -20, 20);
+    rng.fill(rho_c, RNG::UNIFORM, -50, 50);
+    grad = I1wx.mul(I1wx) + I1wy.mul(I1wy);
+
+    for (int gamma = 0; gamma <= 1; gamma++)
+    {
+        optflow::TVL1Variables src;
+        Mat_<float>* srcVars[] = { &src.u1, &src.u2, &src.u3, &src.p11, &src.p12, &src.p21, &src.p22, &src.p31, &src.p32 };
+        for (int i = 0; i < 9; i++)
+        {
+            srcVars[i]->create(sz);
+            rng.fill(*srcVars[i], RNG::UNIFORM, -1, 1);
+        }
+
+        for (int iterations = 1; iterations <= optflow::TVL1_BLOCKED_DEPTH; iterations += 3)
+        {
+            optflow::TVL1Variables whole, blocked;
+            Mat_<float>* wholeVars[] = { &whole.u1, &whole.u2, &whole.u3, &whole.p11, &whole.p12, &whole.p21, &whole.p22, &whole.p31, &whole.p32 };
+            Mat_<float>* blockedVars[] = { &blocked.u1, &blocked.u2, &blocked.u3, &blocked.p11, &blocked.p12, &blocked.p21, &blocked.p22, &blocked.p31, &blocked.p32 };
+            for (int i = 0; i < 9; i++)
+            {
+                wholeVars[i]->create(sz);
+                blockedVars[i]->create(sz);
+            }
+
+            std::vector<float> wholeErrors, blockedErrors;
+            optflow::blockedIterations(I1wx, I1wy, grad, rho_c, src, whole, iterations, std::max(sz.width, sz.height),
+                                       0.045f, 0.3f, 0.25f / 0.3f, gamma * 0.1f, wholeErrors);
+            optflow::blockedIterations(I1wx, I1wy, grad, rho_c, src, blocked, iterations, 37,
+                                       0.045f, 0.3f, 0.25f / 0.3f, gamma * 0.1f, blockedErrors);
+
+            const int nvars = gamma ? 9 : 6;
+            const int order[] = { 0, 1, 3, 4, 5, 6, 2, 7, 8 };
+            for (int i = 0; i < nvars; i++)
+                EXPECT_LE(cvtest::norm(*wholeVars[order[i]], *blockedVars[order[i]], NORM_INF), 1e-5)
+                    << "gamma=" << gamma << ", iterations=" << iterations << ", variable " << order[i];
+
+            ASSERT_EQ(wholeErrors.size(), blockedErrors.size());
+            for (int k = 0; k < iterations; k++)
+                EXPECT_NEAR(wholeErrors[k], blockedErrors[k], 1e-4 * wholeErrors[k]) << "iteration " << k;
+        }
+    }
+}
+
+TEST(Contrib_calcOpticalFlowDual_TVL1, LargeFrame)
+{
+    const string frame1_path = TS::ptr()->get_data_path() + "optflow/RubberWhale1.png";
+    const string frame2_path = TS::ptr()->get_data_path() + "optflow/RubberWhale2.png";
+
+    Mat frame1 = imread(frame1_path, IMREAD_GRAYSCALE);
+    Mat frame2 = imread(frame2_path, IMREAD_GRAYSCALE);
+    ASSERT_FALSE(frame1.empty());
+    ASSERT_FALSE(frame2.empty());
+
+    // the finest scale runs the blocked iterations
+    resize(frame1, frame1, Size(), 2, 2, INTER_LINEAR);
+    resize(frame2, frame2, Size(), 2, 2, INTER_LINEAR);
+    ASSERT_GE(frame1.size().area(), optflow::TVL1_BLOCKED_MIN_AREA);
+
+    Ptr<DualTVL1OpticalFlow> tvl1 = cv::optflow::DualTVL1OpticalFlow::create();
+    tvl1->setWarpingsNumber(2);
+    tvl1->setOuterIterations(2);
+
+    // the convergence error is summed in a fixed order, the result does not depend on the threads
+    const int originalThreads = getNumThreads();
+    Mat_<Point2f> flow[2];
+    for (int run = 0; run < 2; run++)
+    {
+        setNumThreads(run == 0 ? 1 : originalThreads);
+        tvl1->calc(frame1, frame2, flow[run]);
+    }
+    setNumThreads(originalThreads);
+
+    EXPECT_EQ(0, cvtest::norm(flow[0], flow[1], NORM_INF));
+    for (int i = 0; i < flow[0].rows; i++)
+        for (int j = 0; j < flow[0].cols; j++)
+            ASSERT_TRUE(isFlowCorrect(flow[0](i, j))) << Point(j, i);
+}
+
 }} // namespace
@@ -32,10 +32,19 @@ public:
     */
     CV_WRAP cv::Scalar compute( InputArray img ) CV_OVERRIDE;
 
+    /**
+    @brief Computes BRISQUE quality scores for a batch of images
+    @param imgs images (BGR(A) or grayscale) for which to compute quality
+    @returns cv::Scalar with the score in the first element for each image.  The features of the images are computed in parallel and scored with a single model prediction
+    */
+    std::vector<cv::Scalar> computeBatch( InputArrayOfArrays imgs );
+
     /**
     @brief Create an object which calculates quality
     @param model_file_path cv::String which contains a path to the BRISQUE model data, eg. /path/to/brisque_model_live.yml
     @param range_file_path cv::String which contains a path to the BRISQUE range data, eg. /path/to/brisque_range_live.yml
+
+    The model and range data are loaded once per pair of paths and shared between all objects created from them.
     */
     CV_WRAP static Ptr<QualityBRISQUE> create( const cv::String& model_file_path, const cv::String& range_file_path );
 
@@ -27,11 +27,18 @@ public:
     */
     CV_WRAP cv::Scalar compute( InputArray cmp ) CV_OVERRIDE;
 
+    /**
+    @brief Computes GMSD of a sequence of comparison images, e.g. the frames of a video, against the reference image
+    @param cmp comparison images
+    @returns cv::Scalar with per-channel quality value for each comparison image.  Only the quality map of the last image is kept
+    */
+    std::vector<cv::Scalar> computeBatch( InputArrayOfArrays cmp );
+
     /** @brief Implements Algorithm::empty()  */
     CV_WRAP bool empty() const CV_OVERRIDE { return _refImgData.empty() && QualityBase::empty(); }
 
     /** @brief Implements Algorithm::clear()  */
-    CV_WRAP void clear() CV_OVERRIDE { _refImgData = _mat_data(); QualityBase::clear(); }
+    CV_WRAP void clear() CV_OVERRIDE { _refImgData = _mat_data(); _buffers = _cpu_buffers(); QualityBase::clear(); }
 
     /**
     @brief Create an object which calculates image quality
@@ -81,6 +88,25 @@ protected:
     /** @brief Reference image data */
     _mat_data _refImgData;
 
+    // buffers of the CPU implementation, reused from a frame to the next
+    struct _cpu_buffers
+    {
+        Mat
+            cmp             // comparison image, converted to CV_32F
+            , downsampled   // 2x2 downsampled comparison image
+            ;
+        std::vector<double> stripeSums; // per-stripe sums and sums of squares of the quality map
+    };
+
+    _cpu_buffers _buffers;
+
+    /**
+    @brief Computes GMSD of a CV_32F comparison image with the fused CPU implementation
+    @param cmp comparison image, converted to the internal type
+    @param qualityMapNeeded flag to write the quality map
+    */
+    cv::Scalar compute_fused( const Mat& cmp, bool qualityMapNeeded );
+
     // internal constructor
     QualityGMSD(_mat_data refImgData)
         : _refImgData(std::move(refImgData))
@@ -32,8 +32,10 @@ AND THE UNIVERSITY OF TEXAS AT AUSTIN HAS NO OBLIGATION TO PROVIDE MAINTENANCE,
 /* Original Paper: @cite Mittal2 and Original Implementation: @cite Mittal2_software */
 #include "precomp.hpp"
 #include "opencv2/imgproc.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 #include "opencv2/quality/qualitybrisque.hpp"
 #include "opencv2/quality/quality_utils.hpp"
+#include <map>
 
 namespace
 {
@@ -53,192 +55,332 @@ namespace
     // brisque intermediate matrix element type.  float if BRISQUE_CALC_MAT_TYPE == CV_32F, double if BRISQUE_CALC_MAT_TYPE == CV_64F
     using brisque_calc_element_type = float;
 
+    // number of features computed per image: 2 scales x (2 MSCN + 4 orientations x 4 pairwise product) features
+    static constexpr const int BRISQUE_FEATURE_COUNT = 36;
+
     // convert mat to grayscale, range [0-1]
     brisque_mat_type mat_convert( const brisque_mat_type& mat )
     {
-        brisque_mat_type result = mat;
+        brisque_mat_type gray = mat;
         switch (mat.channels())
         {
         case 1:
             break;
         case 3:
-            cv::cvtColor(result, result, cv::COLOR_BGR2GRAY, 1);
+            cv::cvtColor(gray, gray, cv::COLOR_BGR2GRAY, 1);
             break;
         case 4:
-            cv::cvtColor(result, result, cv::COLOR_BGRA2GRAY, 1);
+            cv::cvtColor(gray, gray, cv::COLOR_BGRA2GRAY, 1);
             break;
         default:
             CV_Error(cv::Error::StsNotImplemented, "Unknown/unsupported channel count");
         };//switch
 
-        // scale to 0-1 range
-        result.convertTo(result, BRISQUE_CALC_MAT_TYPE, 1. / 255.);
+        // scale to 0-1 range.  separate destination so that a single channel input is never scaled in place
+        brisque_mat_type result;
+        gray.convertTo(result, BRISQUE_CALC_MAT_TYPE, 1. / 255.);
         return result;
     }
 
-    // function to compute best fit parameters from AGGDfit
-    void AGGDfit(const brisque_mat_type& structdis, double& lsigma_best, double& rsigma_best, double& gamma_best)
+    // loads the model and range files, sharing them between all instances created from the same files
+    std::pair<cv::Ptr<cv::ml::SVM>, cv::Mat> load_model(const cv::String& model_file_path, const cv::String& range_file_path)
+    {
+        using model_key = std::pair<cv::String, cv::String>;
+        using model_data = std::pair<cv::Ptr<cv::ml::SVM>, cv::Mat>;
+
+        static cv::Mutex cacheMutex;
+        static std::map<model_key, model_data> cache;
+
+        cv::AutoLock lock(cacheMutex);
+        const model_key key(model_file_path, range_file_path);
+        auto it = cache.find(key);
+        if (it != cache.end())
+            return it->second;
+
+        model_data data(
+            cv::ml::SVM::load(model_file_path)
+            , cv::FileStorage(range_file_path, cv::FileStorage::READ)["range"].mat()
+        );
+
+        // failed loads are not cached so that a missing file can be provided later
+        if (!data.first.empty() && !data.second.empty())
+            cache[key] = data;
+        return data;
+    }
+
+    // sample statistics the AGGD fit is computed from
+    struct aggd_moments
     {
-        long int poscount = 0, negcount = 0;
+        long int poscount = 0, negcount = 0, totalcount = 0;
         double possqsum = 0, negsqsum = 0, abssum = 0;
-        for (int i = 0; i < structdis.rows; i++)
+    };
+
+    // accumulates the AGGD moments of a[j] (PRODUCT == false) or a[j]*b[j] (PRODUCT == true) for j < n
+    template <bool PRODUCT>
+    void aggd_accumulate(const brisque_calc_element_type* a, const brisque_calc_element_type* b, int n, aggd_moments& m)
+    {
+        int j = 0;
+#if CV_SIMD128_64F
+        const v_float32x4 vzero = v_setzero_f32();
+        const v_float64x2 vzero64 = v_setzero_f64();
+        v_int32x4 vposcount = v_setzero_s32(), vnegcount = v_setzero_s32();
+        v_float64x2 vpossqsum = v_setzero_f64(), vnegsqsum = v_setzero_f64(), vabssum = v_setzero_f64();
+
+        for (; j <= n - v_float32x4::nlanes; j += v_float32x4::nlanes)
         {
-            for (int j = 0; j < structdis.cols; j++)
+            v_float32x4 v = v_load(a + j);
+            if (PRODUCT)
+                v = v * v_load(b + j);
+
+            // NaN samples (flat regions at the image border) fail both comparisons and are skipped like in the scalar loop
+            vposcount -= v_reinterpret_as_s32(v > vzero);
+            vnegcount -= v_reinterpret_as_s32(v < vzero);
+
+            const v_float64x2 halves[2] = { v_cvt_f64(v), v_cvt_f64_high(v) };
+            for (const v_float64x2& pt : halves)
             {
-                double pt = structdis.at<brisque_calc_element_type>(i, j);
-                if (pt > 0)
-                {
-                    poscount++;
-                    possqsum += pt * pt;
-                    abssum += pt;
-                }
-                else if (pt < 0)
-                {
-                    negcount++;
-                    negsqsum += pt * pt;
-                    abssum -= pt;
-                }
+                const v_float64x2 pos = pt > vzero64, neg = pt < vzero64, sq = pt * pt;
+                vpossqsum += sq & pos;
+                vnegsqsum += sq & neg;
+                vabssum += v_abs(pt) & (pos | neg);
             }
         }
 
-        lsigma_best = cv::pow(negsqsum / negcount, 0.5);
-        rsigma_best = cv::pow(possqsum / poscount, 0.5);
+        double possqsum[v_float64x2::nlanes], negsqsum[v_float64x2::nlanes], abssum[v_float64x2::nlanes];
+        v_store(possqsum, vpossqsum);
+        v_store(negsqsum, vnegsqsum);
+        v_store(abssum, vabssum);
+        for (int k = 0; k < v_float64x2::nlanes; ++k)
+        {
+            m.possqsum += possqsum[k];
+            m.negsqsum += negsqsum[k];
+            m.abssum += abssum[k];
+        }
+        m.poscount += v_reduce_sum(vposcount);
+        m.negcount += v_reduce_sum(vnegcount);
+#endif
+        for (; j < n; ++j)
+        {
+            double pt = PRODUCT ? a[j] * b[j] : a[j];
+            if (pt > 0)
+            {
+                m.poscount++;
+                m.possqsum += pt * pt;
+                m.abssum += pt;
+            }
+            else if (pt < 0)
+            {
+                m.negcount++;
+                m.negsqsum += pt * pt;
+                m.abssum -= pt;
+            }
+        }
+    }
+
+    // AGGD moments of the MSCN image
+    aggd_moments aggd_moments_mscn(const brisque_mat_type& structdis)
+    {
+        aggd_moments m;
+        for (int i = 0; i < structdis.rows; i++)
+            aggd_accumulate<false>(structdis.ptr<brisque_calc_element_type>(i), nullptr, structdis.cols, m);
+        m.totalcount = (long int)structdis.cols * structdis.rows;
+        return m;
+    }
+
+    // AGGD moments of the pairwise product of the MSCN image with itself shifted by (dy, dx), dx >= 0
+    //  pairs falling outside the image have a zero product: they only count towards the total
+    aggd_moments aggd_moments_product(const brisque_mat_type& structdis, int dy, int dx)
+    {
+        CV_DbgAssert(dx >= 0);
+
+        aggd_moments m;
+        const int
+            row_begin = std::max(0, -dy)
+            , row_end = std::min(structdis.rows, structdis.rows - dy)
+            , n = structdis.cols - dx
+            ;
+        for (int i = row_begin; i < row_end; i++)
+            aggd_accumulate<true>(structdis.ptr<brisque_calc_element_type>(i), structdis.ptr<brisque_calc_element_type>(i + dy) + dx, n, m);
+        m.totalcount = (long int)structdis.cols * structdis.rows;
+        return m;
+    }
+
+    // r(gamma) = tgamma(2/gamma)^2 / (tgamma(1/gamma) * tgamma(3/gamma)), sampled on the AGGD fit search grid
+    //  the values only depend on the grid, so they are computed once instead of for every fit
+    const std::vector<std::pair<double, double>>& aggd_gamma_table()
+    {
+        static const std::vector<std::pair<double, double>> table = []()
+        {
+            std::vector<std::pair<double, double>> result;
+            double sampling = 0.001;
+            for (double gam = 0.2; gam < 10; gam += sampling) //possible to coarsen sampling to quicken the code, with some loss of accuracy
+                result.emplace_back(gam, tgamma(2 / gam)*tgamma(2 / gam) / (tgamma(1 / gam)*tgamma(3 / gam)));
+            return result;
+        }();
+        return table;
+    }
+
+    // function to compute best fit parameters from AGGDfit
+    void AGGDfit(const aggd_moments& m, double& lsigma_best, double& rsigma_best, double& gamma_best)
+    {
+        lsigma_best = cv::pow(m.negsqsum / m.negcount, 0.5);
+        rsigma_best = cv::pow(m.possqsum / m.poscount, 0.5);
 
         double gammahat = lsigma_best / rsigma_best;
-        long int totalcount = (structdis.cols)*(structdis.rows);
-        double rhat = cv::pow(abssum / totalcount, static_cast<double>(2)) / ((negsqsum + possqsum) / totalcount);
+        long int totalcount = m.totalcount;
+        double rhat = cv::pow(m.abssum / totalcount, static_cast<double>(2)) / ((m.negsqsum + m.possqsum) / totalcount);
         double rhatnorm = rhat * (cv::pow(gammahat, 3) + 1)*(gammahat + 1) / pow(pow(gammahat, 2) + 1, 2);
 
         double prevgamma = 0;
         double prevdiff = 1e10;
-        double sampling = 0.001;
-        for (double gam = 0.2; gam < 10; gam += sampling) //possible to coarsen sampling to quicken the code, with some loss of accuracy
+        for (const auto& sample : aggd_gamma_table())
         {
-            double r_gam = tgamma(2 / gam)*tgamma(2 / gam) / (tgamma(1 / gam)*tgamma(3 / gam));
-            double diff = abs(r_gam - rhatnorm);
+            double diff = std::abs(sample.second - rhatnorm);
             if (diff > prevdiff) break;
             prevdiff = diff;
-            prevgamma = gam;
+            prevgamma = sample.first;
         }
         gamma_best = prevgamma;
+    }
 
-        // return structdis.clone();
+    // computes the MSCN coefficients of a scaled image
+    brisque_mat_type compute_mscn(const brisque_mat_type& imdist_scaled)
+    {
+        // compute mu (local mean)
+        brisque_mat_type mu;
+        cv::GaussianBlur(imdist_scaled, mu, cv::Size(7, 7), 7. / 6., 0., cv::BORDER_REPLICATE );
+
+        // local second moment
+        brisque_mat_type sigma;
+        cv::multiply(imdist_scaled, imdist_scaled, sigma);
+        cv::GaussianBlur(sigma, sigma, cv::Size(7, 7), 7./6., 0., cv::BORDER_REPLICATE );
+
+        // structdis = (img - mu) / (sqrt(sigma - mu^2) + 1/255), in one pass
+        brisque_mat_type structdis(imdist_scaled.size(), BRISQUE_CALC_MAT_TYPE);
+        const brisque_calc_element_type eps = (brisque_calc_element_type)(1.0 / 255); // to avoid DivideByZero Error
+        for (int i = 0; i < structdis.rows; i++)
+        {
+            const brisque_calc_element_type
+                *img_row = imdist_scaled.ptr<brisque_calc_element_type>(i)
+                , *mu_row = mu.ptr<brisque_calc_element_type>(i)
+                , *sigma_row = sigma.ptr<brisque_calc_element_type>(i)
+                ;
+            brisque_calc_element_type* dst_row = structdis.ptr<brisque_calc_element_type>(i);
+
+            int j = 0;
+#if CV_SIMD128
+            const v_float32x4 veps = v_setall_f32(eps);
+            for (; j <= structdis.cols - v_float32x4::nlanes; j += v_float32x4::nlanes)
+            {
+                const v_float32x4 m = v_load(mu_row + j);
+                const v_float32x4 s = v_sqrt(v_load(sigma_row + j) - m * m) + veps;
+                v_store(dst_row + j, (v_load(img_row + j) - m) / s);
+            }
+#endif
+            for (; j < structdis.cols; j++)
+            {
+                const brisque_calc_element_type m = mu_row[j];
+                dst_row[j] = (img_row[j] - m) / (std::sqrt(sigma_row[j] - m * m) + eps);
+            }
+        }
+        return structdis;
     }
 
-    std::vector<brisque_calc_element_type> ComputeBrisqueFeature( const brisque_mat_type& orig )
+    // computes the BRISQUE features of a grayscale image normalized to the range 0,1 into features[BRISQUE_FEATURE_COUNT]
+    void ComputeBrisqueFeature( const brisque_mat_type& orig, brisque_calc_element_type* features )
     {
         CV_DbgAssert(orig.channels() == 1);
 
-        std::vector<brisque_calc_element_type> featurevector;
+        static constexpr const int scalenum = 2; // number of times to scale the image
 
-        auto orig_bw = orig;
+        // indices for orientations (H, V, D1, D2)
+        static constexpr const int shifts[4][2] = { {0,1},{1,0},{1,1},{-1,1} };
 
-        // orig_bw now contains the grayscale image normalized to the range 0,1
-        int scalenum = 2; // number of times to scale the image
-        for (int itr_scale = 1; itr_scale <= scalenum; itr_scale++)
+        // MSCN coefficients of each scale, the scales are independent
+        brisque_mat_type structdis[scalenum];
+        cv::parallel_for_(cv::Range(0, scalenum), [&](const cv::Range& range)
         {
-            // resize image
-            cv::Size dst_size( int( orig_bw.cols / cv::pow((double)2, itr_scale - 1) ), int( orig_bw.rows / pow((double)2, itr_scale - 1)));
-            brisque_mat_type imdist_scaled;
-            cv::resize(orig_bw, imdist_scaled, dst_size, 0, 0, cv::INTER_CUBIC); // INTER_CUBIC
-
-            // calculating MSCN coefficients
-            // compute mu (local mean)
-            brisque_mat_type mu;//  (imdist_scaled.size(), CV_64FC1, 1);
-            cv::GaussianBlur(imdist_scaled, mu, cv::Size(7, 7), 7. / 6., 0., cv::BORDER_REPLICATE );
-
-            brisque_mat_type mu_sq;
-            cv::pow(mu, double(2.0), mu_sq);
-
-            //compute sigma (local sigma)
-            brisque_mat_type sigma;// (imdist_scaled.size(), CV_64FC1, 1);
-            cv::multiply(imdist_scaled, imdist_scaled, sigma);
-
-            cv::GaussianBlur(sigma, sigma, cv::Size(7, 7), 7./6., 0., cv::BORDER_REPLICATE );
-
-            cv::subtract(sigma, mu_sq, sigma);
-            cv::pow(sigma, double(0.5), sigma);
-            cv::add(sigma, Scalar(1.0 / 255), sigma); // to avoid DivideByZero Error
-
-            brisque_mat_type structdis;// (imdist_scaled.size(), CV_64FC1, 1);
-            cv::subtract(imdist_scaled, mu, structdis);
-            cv::divide(structdis, sigma, structdis);  // structdis is MSCN image
-
-            // Compute AGGD fit to MSCN image
-            double lsigma_best, rsigma_best, gamma_best;
-
-            //structdis = AGGDfit(structdis, lsigma_best, rsigma_best, gamma_best);
-            AGGDfit(structdis, lsigma_best, rsigma_best, gamma_best);
-            featurevector.push_back( (brisque_calc_element_type) gamma_best);
-            featurevector.push_back(( (brisque_calc_element_type)(  lsigma_best*lsigma_best + rsigma_best * rsigma_best) / 2 ));
-
-            // Compute paired product images
-            // indices for orientations (H, V, D1, D2)
-            int shifts[4][2] = { {0,1},{1,0},{1,1},{-1,1} };
-
-            for (int itr_shift = 1; itr_shift <= 4; itr_shift++)
+            for (int s = range.start; s < range.end; s++)
             {
-                // select the shifting index from the 2D array
-                int* reqshift = shifts[itr_shift - 1];
+                if (s == 0)
+                {
+                    structdis[s] = compute_mscn(orig);
+                    continue;
+                }
 
-                // declare, create shifted_structdis as pairwise image
-                brisque_mat_type shifted_structdis(imdist_scaled.size(), BRISQUE_CALC_MAT_TYPE); //(imdist_scaled.size(), CV_64FC1, 1);
+                // resize image
+                cv::Size dst_size( int( orig.cols / cv::pow((double)2, s) ), int( orig.rows / pow((double)2, s)));
+                brisque_mat_type imdist_scaled;
+                cv::resize(orig, imdist_scaled, dst_size, 0, 0, cv::INTER_CUBIC); // INTER_CUBIC
+                structdis[s] = compute_mscn(imdist_scaled);
+            }
+        });
 
-                // create pair-wise product for the given orientation (reqshift)
-                for (int i = 0; i < structdis.rows; i++)
+        // AGGD fits: per scale, one for the MSCN image and one per orientation of the pairwise products
+        static constexpr const int fits_per_scale = 5;
+        cv::parallel_for_(cv::Range(0, scalenum * fits_per_scale), [&](const cv::Range& range)
+        {
+            for (int fit = range.start; fit < range.end; fit++)
+            {
+                const int
+                    s = fit / fits_per_scale
+                    , orientation = fit % fits_per_scale - 1
+                    ;
+                brisque_calc_element_type* dst = features + s * (BRISQUE_FEATURE_COUNT / scalenum);
+                double lsigma_best, rsigma_best, gamma_best;
+
+                if (orientation < 0)
                 {
-                    for (int j = 0; j < structdis.cols; j++)
-                    {
-                        if (i + reqshift[0] >= 0 && i + reqshift[0] < structdis.rows && j + reqshift[1] >= 0 && j + reqshift[1] < structdis.cols)
-                        {
-                            shifted_structdis.at<brisque_calc_element_type>(i,j) = structdis.at<brisque_calc_element_type>(i + reqshift[0], j + reqshift[1]);
-                        }
-                        else
-                        {
-                            shifted_structdis.at<brisque_calc_element_type>(i, j) = (brisque_calc_element_type) 0;
-                        }
-                    }
+                    // Compute AGGD fit to MSCN image
+                    AGGDfit(aggd_moments_mscn(structdis[s]), lsigma_best, rsigma_best, gamma_best);
+                    dst[0] = (brisque_calc_element_type) gamma_best;
+                    dst[1] = ( (brisque_calc_element_type)(  lsigma_best*lsigma_best + rsigma_best * rsigma_best) / 2 );
+                    continue;
                 }
 
-                // calculate the products of the pairs
-                cv::multiply(structdis, shifted_structdis, shifted_structdis);
-
-                // fit the pairwise product to AGGD
-                // shifted_structdis = AGGDfit(shifted_structdis, lsigma_best, rsigma_best, gamma_best);
-                AGGDfit(shifted_structdis, lsigma_best, rsigma_best, gamma_best);
+                // fit the pairwise product for the given orientation to AGGD
+                AGGDfit(aggd_moments_product(structdis[s], shifts[orientation][0], shifts[orientation][1]), lsigma_best, rsigma_best, gamma_best);
 
                 double constant = sqrt(tgamma(1 / gamma_best)) / sqrt(tgamma(3 / gamma_best));
                 double meanparam = (rsigma_best - lsigma_best)*(tgamma(2 / gamma_best) / tgamma(1 / gamma_best))*constant;
 
-                // push the calculated parameters from AGGD fit to pair-wise products
-                featurevector.push_back((brisque_calc_element_type)gamma_best);
-                featurevector.push_back((brisque_calc_element_type)meanparam);
-                featurevector.push_back( (brisque_calc_element_type) cv::pow(lsigma_best, 2));
-                featurevector.push_back( (brisque_calc_element_type) cv::pow(rsigma_best, 2));
+                // the calculated parameters from AGGD fit to pair-wise products
+                dst += 2 + 4 * orientation;
+                dst[0] = (brisque_calc_element_type)gamma_best;
+                dst[1] = (brisque_calc_element_type)meanparam;
+                dst[2] = (brisque_calc_element_type) cv::pow(lsigma_best, 2);
+                dst[3] = (brisque_calc_element_type) cv::pow(rsigma_best, 2);
             }
-        }
+        });
+    }
 
+    std::vector<brisque_calc_element_type> ComputeBrisqueFeature( const brisque_mat_type& orig )
+    {
+        std::vector<brisque_calc_element_type> featurevector(BRISQUE_FEATURE_COUNT);
+        ComputeBrisqueFeature(orig, featurevector.data());
         return featurevector;
     }
 
-    brisque_calc_element_type computescore(const cv::Ptr<cv::ml::SVM>& model, const cv::Mat& range, const brisque_mat_type& img ) {
-
-        const auto brisqueFeatures = ComputeBrisqueFeature( img ); // compute brisque features
-
-        cv::Mat feat_mat( 1,(int)brisqueFeatures.size(), CV_32FC1, (void*)brisqueFeatures.data() ); // load to mat
-        quality_utils::scale(feat_mat, range, -1.f, 1.f);// scale to range [-1,1]
+    // computes scores for a matrix of BRISQUE features, one image per row
+    std::vector<cv::Scalar> computescores(const cv::Ptr<cv::ml::SVM>& model, const cv::Mat& range, cv::Mat& features)
+    {
+        quality_utils::scale(features, range, -1.f, 1.f);// scale to range [-1,1]
 
         cv::Mat result;
-        model->predict(feat_mat, result);
-        return std::min( std::max( result.at<float>(0), 0.f ), 100.f ); // clamp to [0-100]
+        model->predict(features, result);
+
+        std::vector<cv::Scalar> scores(features.rows, cv::Scalar{ 0. });
+        for (int i = 0; i < features.rows; ++i)
+            scores[i][0] = std::min( std::max( result.at<float>(i), 0.f ), 100.f ); // clamp to [0-100]
+        return scores;
     }
 
     // computes score for a single frame
     cv::Scalar compute(const cv::Ptr<cv::ml::SVM>& model, const cv::Mat& range, const brisque_mat_type& img)
     {
-        auto result = cv::Scalar{ 0. };
-        result[0] = computescore(model, range, img);
-        return result;
+        cv::Mat features(1, BRISQUE_FEATURE_COUNT, CV_32FC1);
+        ComputeBrisqueFeature(img, features.ptr<brisque_calc_element_type>()); // compute brisque features
+        return computescores(model, range, features)[0];
     }
 }
 
@@ -262,11 +404,11 @@ cv::Scalar QualityBRISQUE::compute( InputArray img, const cv::String& model_file
 
 // QualityBRISQUE() constructor
 QualityBRISQUE::QualityBRISQUE(const cv::String& model_file_path, const cv::String& range_file_path)
-    : QualityBRISQUE(
-        cv::ml::SVM::load(model_file_path)
-        , cv::FileStorage(range_file_path, cv::FileStorage::READ)["range"].mat()
-    )
-{}
+{
+    const auto model = ::load_model(model_file_path, range_file_path);
+    this->_model = model.first;
+    this->_range = model.second;
+}
 
 cv::Scalar QualityBRISQUE::compute( InputArray img )
 {
@@ -277,6 +419,28 @@ cv::Scalar QualityBRISQUE::compute( InputArray img )
     return ::compute(this->_model, this->_range, mat );
 }
 
+std::vector<cv::Scalar> QualityBRISQUE::computeBatch( InputArrayOfArrays imgs )
+{
+    std::vector<brisque_mat_type> mats = {};
+    imgs.getMatVector(mats);
+    if (mats.empty())
+        return {};
+
+    // images are processed in parallel, the features of each are computed serially within its task
+    cv::Mat features((int)mats.size(), BRISQUE_FEATURE_COUNT, CV_32FC1);
+    cv::parallel_for_(cv::Range(0, (int)mats.size()), [&](const cv::Range& range)
+    {
+        for (int i = range.start; i < range.end; ++i)
+        {
+            CV_Assert(!mats[i].empty());
+            ComputeBrisqueFeature(mat_convert(mats[i]), features.ptr<brisque_calc_element_type>(i));
+        }
+    });
+
+    // single prediction for the whole batch
+    return ::computescores(this->_model, this->_range, features);
+}
+
 //static
 void QualityBRISQUE::computeFeatures(InputArray img, OutputArray features)
 {
@@ -6,6 +6,7 @@
 
 #include "opencv2/quality/qualitygmsd.hpp"
 #include "opencv2/core/ocl.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 
 #include "opencv2/imgproc.hpp"  // blur, resize
 #include "opencv2/quality/quality_utils.hpp"
@@ -78,6 +79,180 @@ namespace
                 .rowRange((kernel.rows - 1) / 2, dest.rows - kernel.rows / 2);
         }
     }
+
+    // Fused implementation for the CV_32F internal type on the CPU.  The comparison image is downsampled in a
+    //  single pass, then its prewitt gradient magnitude and the quality map are computed together, row by row.
+    //  The gradient map of the reference comes from its cached data
+    const int GMSD_STRIPE_ROWS = 32;
+    const float GMSD_T = 170.f;
+
+    // size of the gradient map of an image, as resize by .5
+    cv::Size gmsd_size( const cv::Size& size )
+    {
+        return cv::Size( saturate_cast<int>(size.width * .5), saturate_cast<int>(size.height * .5) );
+    }
+
+    // true if the comparison image can be scored with the fused implementation against the reference gradient map
+    bool gmsd_fused_supported( const _mat_type& refGradientMap, InputArray cmp )
+    {
+        const int depth = cmp.depth();
+        return !cv::ocl::useOpenCL()
+            && ( cmp.isMat() || cmp.isUMat() )
+            && refGradientMap.depth() == CV_32F
+            && gmsd_size(cmp.size()) == refGradientMap.size() && cmp.channels() == refGradientMap.channels()
+            && depth != CV_32F && depth != CV_32S && depth != CV_64F   // expanded to CV_32F, see expand_mat
+            ;
+    }
+
+    // 2x2 average with a zero border sampled every other pixel, same as blur() with anchor (0, 0) and resize()
+    void gmsd_downsample( const Mat& src, Mat& dst )
+    {
+        const int cn = src.channels();
+        dst.create(gmsd_size(src.size()), src.type());
+
+        cv::parallel_for_(Range(0, dst.rows), [&](const Range& range)
+        {
+            for (int y = range.start; y < range.end; ++y)
+            {
+                const int sy = std::min(2 * y, src.rows - 1);
+                const float* r0 = src.ptr<float>(sy);
+                const float* r1 = sy + 1 < src.rows ? src.ptr<float>(sy + 1) : nullptr;
+                float* d = dst.ptr<float>(y);
+                for (int x = 0; x < dst.cols; ++x)
+                {
+                    const int sx = std::min(2 * x, src.cols - 1);
+                    const bool right = sx + 1 < src.cols;
+                    for (int c = 0; c < cn; ++c)
+                    {
+                        const int e = sx * cn + c;
+                        const float
+                            top = r0[e] + (right ? r0[e + cn] : 0.f)
+                            , bottom = r1 ? r1[e] + (right ? r1[e + cn] : 0.f) : 0.f
+                            ;
+                        d[x * cn + c] = (top + bottom) * .25f;
+                    }
+                }
+            }
+        });
+    }
+
+    // quality value of one element from the reference gradient magnitude and the prewitt sums of the comparison
+    inline float gmsd_quality( float gm1, float sx, float sy )
+    {
+        const float gm2 = std::sqrt(sx * sx + sy * sy) * (1.f / 3.f);
+        return (2.f * gm1 * gm2 + GMSD_T) / (gm1 * gm1 + gm2 * gm2 + GMSD_T);
+    }
+
+    // quality map of rows [y0, y1) of the downsampled comparison image and its per-channel sums and sums of squares
+    void gmsd_stripe( const Mat& gm1, const Mat& D, int y0, int y1, Mat* qualityMap, float* q, double* sums, double* sqsums )
+    {
+        const int cn = D.channels(), W = D.cols, n = W * cn;
+        for (int y = y0; y < y1; ++y)
+        {
+            // rows outside of the image are zero
+            const float* ru = y > 0 ? D.ptr<float>(y - 1) : nullptr;
+            const float* rm = D.ptr<float>(y);
+            const float* rd = y + 1 < D.rows ? D.ptr<float>(y + 1) : nullptr;
+            const float* g1 = gm1.ptr<float>(y);
+            float* pq = qualityMap ? qualityMap->ptr<float>(y) : q;
+
+            const auto at = [&](const float* r, int e) { return r && e >= 0 && e < n ? r[e] : 0.f; };
+            const auto scalar_quality = [&](int e)
+            {
+                const float
+                    sy = at(rd, e - cn) + at(rd, e) + at(rd, e + cn) - at(ru, e - cn) - at(ru, e) - at(ru, e + cn)
+                    , sx = at(ru, e + cn) + at(rm, e + cn) + at(rd, e + cn) - at(ru, e - cn) - at(rm, e - cn) - at(rd, e - cn)
+                    ;
+                pq[e] = gmsd_quality(g1[e], sx, sy);
+            };
+
+            int e = 0;
+            if (!ru || !rd)
+            {
+                for (; e < n; ++e)
+                    scalar_quality(e);
+            }
+            else
+            {
+                // first and last columns have a zero neighbor
+                for (; e < std::min(cn, n); ++e)
+                    scalar_quality(e);
+#if CV_SIMD128
+                const v_float32x4
+                    third = v_setall_f32(1.f / 3.f)
+                    , two = v_setall_f32(2.f)
+                    , t = v_setall_f32(GMSD_T)
+                    ;
+                for (; e <= n - cn - v_float32x4::nlanes; e += v_float32x4::nlanes)
+                {
+                    const v_float32x4
+                        ul = v_load(ru + e - cn), um = v_load(ru + e), ur = v_load(ru + e + cn)
+                        , ml = v_load(rm + e - cn), mr = v_load(rm + e + cn)
+                        , dl = v_load(rd + e - cn), dm = v_load(rd + e), dr = v_load(rd + e + cn)
+                        , sy = (dl + dm + dr) - (ul + um + ur)
+                        , sx = (ur + mr + dr) - (ul + ml + dl)
+                        , gm2 = v_sqrt(sx * sx + sy * sy) * third
+                        , gm1_ = v_load(g1 + e)
+                        ;
+                    v_store(pq + e, (two * gm1_ * gm2 + t) / (gm1_ * gm1_ + gm2 * gm2 + t));
+                }
+#endif
+                for (; e < n; ++e)
+                    scalar_quality(e);
+            }
+
+            for (int c = 0; c < cn; ++c)
+            {
+                double sum = 0., sqsum = 0.;
+                for (int i = c; i < n; i += cn)
+                {
+                    sum += pq[i];
+                    sqsum += (double)pq[i] * pq[i];
+                }
+                sums[c] += sum;
+                sqsums[c] += sqsum;
+            }
+        }
+    }
+
+    // fused gmsd of the downsampled comparison image D against the reference gradient map, stripes of rows are
+    //  processed in parallel
+    cv::Scalar gmsd_fused( const Mat& gm1, const Mat& D, Mat* qualityMap, std::vector<double>& stripeSums )
+    {
+        const int
+            cn = D.channels()
+            , nStripes = (D.rows + GMSD_STRIPE_ROWS - 1) / GMSD_STRIPE_ROWS
+            ;
+
+        stripeSums.assign((size_t)nStripes * cn * 2, 0.);
+        cv::parallel_for_(Range(0, nStripes), [&](const Range& range)
+        {
+            AutoBuffer<float> q(qualityMap ? 1 : D.cols * cn);
+            for (int i = range.start; i < range.end; ++i)
+            {
+                double* sums = &stripeSums[(size_t)i * cn * 2];
+                gmsd_stripe(gm1, D, i * GMSD_STRIPE_ROWS, std::min((i + 1) * GMSD_STRIPE_ROWS, D.rows), qualityMap, q.data(), sums, sums + cn);
+            }
+        });
+
+        // reduce in stripe order, the result does not depend on the scheduling
+        cv::Scalar sum = {}, sqsum = {}, result = {};
+        for (int i = 0; i < nStripes; ++i)
+            for (int c = 0; c < cn; ++c)
+            {
+                sum[c] += stripeSums[(size_t)i * cn * 2 + c];
+                sqsum[c] += stripeSums[(size_t)i * cn * 2 + cn + c];
+            }
+
+        // standard deviation of the quality map, as meanStdDev
+        const double total = (double)D.total();
+        for (int c = 0; c < cn; ++c)
+        {
+            const double mean = sum[c] / total;
+            result[c] = std::sqrt(std::max(sqsum[c] / total - mean * mean, 0.));
+        }
+        return result;
+    }
 }   // ns
 
 // construct mat_data from _mat_type
@@ -136,7 +311,18 @@ Ptr<QualityGMSD> QualityGMSD::create( InputArray ref )
 // static
 cv::Scalar QualityGMSD::compute( InputArray ref, InputArray cmp, OutputArray qualityMap )
 {
-    auto result = _mat_data::compute( _mat_data(ref), _mat_data(cmp) );
+    _mat_data refData( ref );
+    if (::gmsd_fused_supported(refData.gradient_map, cmp))
+    {
+        QualityGMSD gmsd( std::move(refData) );
+        auto result = gmsd.compute(cmp);
+
+        if (qualityMap.needed())
+            qualityMap.assign(gmsd._qualityMap);
+        return result;
+    }
+
+    auto result = _mat_data::compute( refData, _mat_data(cmp) );
 
     if (qualityMap.needed())
         qualityMap.assign(result.second);
@@ -145,11 +331,51 @@ cv::Scalar QualityGMSD::compute( InputArray ref, InputArray cmp, OutputArray qua
 
 cv::Scalar QualityGMSD::compute( InputArray cmp )
 {
+    if (::gmsd_fused_supported(this->_refImgData.gradient_map, cmp))
+    {
+        cmp.getMat().convertTo(this->_buffers.cmp, CV_32F);
+        return this->compute_fused(this->_buffers.cmp, true);
+    }
+
     auto result = _mat_data::compute(this->_refImgData, _mat_data(cmp));
     OutputArray(this->_qualityMap).assign(result.second);
     return result.first;
 }
 
+std::vector<cv::Scalar> QualityGMSD::computeBatch( InputArrayOfArrays cmp )
+{
+    std::vector<Mat> frames = {};
+    cmp.getMatVector(frames);
+
+    std::vector<cv::Scalar> result( frames.size() );
+    for (size_t i = 0; i < frames.size(); ++i)
+    {
+        if (::gmsd_fused_supported(this->_refImgData.gradient_map, frames[i]))
+        {
+            // only the quality map of the last frame is kept
+            frames[i].convertTo(this->_buffers.cmp, CV_32F);
+            result[i] = this->compute_fused(this->_buffers.cmp, i + 1 == frames.size());
+        }
+        else
+            result[i] = this->compute(frames[i]);
+    }
+    return result;
+}
+
+cv::Scalar QualityGMSD::compute_fused( const Mat& cmp, bool qualityMapNeeded )
+{
+    const Mat gm1 = this->_refImgData.gradient_map.getMat(ACCESS_READ);
+    ::gmsd_downsample(cmp, this->_buffers.downsampled);
+
+    if (!qualityMapNeeded)
+        return ::gmsd_fused(gm1, this->_buffers.downsampled, nullptr, this->_buffers.stripeSums);
+
+    // the quality map is written in place, its buffer is reused from a frame to the next
+    this->_qualityMap.create(gm1.size(), gm1.type());
+    Mat qualityMap = this->_qualityMap.getMat(ACCESS_WRITE);
+    return ::gmsd_fused(gm1, this->_buffers.downsampled, &qualityMap, this->_buffers.stripeSums);
+}
+
 // computes gmsd and quality map for single frame
 std::pair<cv::Scalar, _quality_map_type> QualityGMSD::_mat_data::compute(const QualityGMSD::_mat_data& lhs, const QualityGMSD::_mat_data& rhs)
 {
@@ -4,6 +4,8 @@
 
 #include "precomp.hpp"
 #include "opencv2/quality/qualityssim.hpp"
+#include "opencv2/core/ocl.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 #include "opencv2/imgproc.hpp"  // GaussianBlur
 #include "opencv2/quality/quality_utils.hpp"
 
@@ -22,6 +24,207 @@ namespace
         cv::GaussianBlur( mat, result, cv::Size(11, 11), 1.5 );
         return result;
     }
+
+    // Fused implementation for the CV_32F internal type on the CPU.  The gaussian windowed moments of the
+    //  comparison image are computed together, along with the quality map, in tiles small enough for the input
+    //  rows of a tile to stay in cache.  The moments of the reference come from its cached data
+    const int
+        SSIM_RADIUS = 5 // 11x11 window, as blur()
+        , SSIM_TILE_WIDTH = 256
+        , SSIM_TILE_HEIGHT = 32
+        , SSIM_MAX_CHANNELS = 4
+        , SSIM_BUF_SIZE = (SSIM_TILE_WIDTH + 2 * SSIM_RADIUS) * SSIM_MAX_CHANNELS
+        ;
+
+    const float SSIM_C1 = 6.5025f, SSIM_C2 = 58.5225f;
+
+    const float* ssim_kernel()
+    {
+        static const Mat kernel = cv::getGaussianKernel(2 * SSIM_RADIUS + 1, 1.5, CV_32F);
+        return kernel.ptr<float>();
+    }
+
+    // true if the comparison image can be scored with the fused implementation against the reference image data
+    bool ssim_fused_supported( const _mat_type& ref, InputArray cmp )
+    {
+        const int depth = cmp.depth();
+        return !cv::ocl::useOpenCL()
+            && ( cmp.isMat() || cmp.isUMat() )
+            && ref.depth() == CV_32F && ref.channels() <= SSIM_MAX_CHANNELS
+            && cmp.size() == ref.size() && cmp.channels() == ref.channels()
+            && depth != CV_32F && depth != CV_32S && depth != CV_64F   // expanded to CV_32F, see expand_mat
+            ;
+    }
+
+    // gaussian weighted vertical sums of I2, I2^2 and I1*I2 around row y, for the elements [e0, e1) of the rows
+    void ssim_vertical( const Mat& I1, const Mat& I2, int y, int e0, int e1, float* m2, float* e22, float* e12 )
+    {
+        const float* kernel = ssim_kernel();
+        const float* p1[2 * SSIM_RADIUS + 1];
+        const float* p2[2 * SSIM_RADIUS + 1];
+        for (int k = 0; k <= 2 * SSIM_RADIUS; ++k)
+        {
+            const int ry = cv::borderInterpolate(y - SSIM_RADIUS + k, I1.rows, BORDER_REFLECT_101);
+            p1[k] = I1.ptr<float>(ry);
+            p2[k] = I2.ptr<float>(ry);
+        }
+
+        int e = e0;
+#if CV_SIMD128
+        for (; e <= e1 - v_float32x4::nlanes; e += v_float32x4::nlanes)
+        {
+            v_float32x4 a = v_setzero_f32(), b = v_setzero_f32(), c = v_setzero_f32();
+            for (int k = 0; k <= 2 * SSIM_RADIUS; ++k)
+            {
+                const v_float32x4 i2 = v_load(p2[k] + e);
+                const v_float32x4 wi2 = v_setall_f32(kernel[k]) * i2;
+                a += wi2;
+                b = v_fma(wi2, i2, b);
+                c = v_fma(wi2, v_load(p1[k] + e), c);
+            }
+            v_store(m2 + e - e0, a);
+            v_store(e22 + e - e0, b);
+            v_store(e12 + e - e0, c);
+        }
+#endif
+        for (; e < e1; ++e)
+        {
+            float a = 0.f, b = 0.f, c = 0.f;
+            for (int k = 0; k <= 2 * SSIM_RADIUS; ++k)
+            {
+                const float i2 = p2[k][e], wi2 = kernel[k] * i2;
+                a += wi2;
+                b += wi2 * i2;
+                c += wi2 * p1[k][e];
+            }
+            m2[e - e0] = a;
+            e22[e - e0] = b;
+            e12[e - e0] = c;
+        }
+    }
+
+    // quality map of a tile and its per-channel sums.  qualityMap may be null if the map is not needed
+    void ssim_tile( const Mat& I1, const Mat& mu1, const Mat& sigma1_2, const Mat& I2, const Rect& tile, Mat* qualityMap, double* sums )
+    {
+        const int cn = I1.channels(), W = I1.cols, n = tile.width * cn;
+        const float* kernel = ssim_kernel();
+
+        float buf[4 * SSIM_BUF_SIZE];
+        float
+            *m2 = buf
+            , *e22 = m2 + SSIM_BUF_SIZE
+            , *e12 = e22 + SSIM_BUF_SIZE
+            , *q = e12 + SSIM_BUF_SIZE
+            ;
+
+        // columns of the tile extended by the window radius, the ones inside the image are contiguous
+        const int
+            x0 = tile.x - SSIM_RADIUS
+            , x1 = tile.x + tile.width + SSIM_RADIUS
+            , xin0 = std::max(x0, 0)
+            , xin1 = std::min(x1, W)
+            ;
+
+        for (int y = tile.y; y < tile.y + tile.height; ++y)
+        {
+            // vertical pass
+            int o = (xin0 - x0) * cn;
+            ssim_vertical(I1, I2, y, xin0 * cn, xin1 * cn, m2 + o, e22 + o, e12 + o);
+            for (int x = x0; x < x1; ++x)
+            {
+                if (x >= xin0 && x < xin1)
+                    continue;
+                const int sx = cv::borderInterpolate(x, W, BORDER_REFLECT_101);
+                o = (x - x0) * cn;
+                ssim_vertical(I1, I2, y, sx * cn, (sx + 1) * cn, m2 + o, e22 + o, e12 + o);
+            }
+
+            // horizontal pass and quality map
+            const float* pmu1 = mu1.ptr<float>(y) + tile.x * cn;
+            const float* psigma1_2 = sigma1_2.ptr<float>(y) + tile.x * cn;
+            float* pq = qualityMap ? qualityMap->ptr<float>(y) + tile.x * cn : q;
+
+            int e = 0;
+#if CV_SIMD128
+            const v_float32x4 c1 = v_setall_f32(SSIM_C1), c2 = v_setall_f32(SSIM_C2), two = v_setall_f32(2.f);
+            for (; e <= n - v_float32x4::nlanes; e += v_float32x4::nlanes)
+            {
+                v_float32x4 mu2 = v_setzero_f32(), s2 = v_setzero_f32(), s12 = v_setzero_f32();
+                for (int k = 0; k <= 2 * SSIM_RADIUS; ++k)
+                {
+                    const v_float32x4 w = v_setall_f32(kernel[k]);
+                    mu2 = v_fma(w, v_load(m2 + e + k * cn), mu2);
+                    s2 = v_fma(w, v_load(e22 + e + k * cn), s2);
+                    s12 = v_fma(w, v_load(e12 + e + k * cn), s12);
+                }
+                const v_float32x4
+                    mu1_ = v_load(pmu1 + e)
+                    , mu1_mu2 = mu1_ * mu2
+                    , mu2_2 = mu2 * mu2
+                    , t3 = (two * mu1_mu2 + c1) * (two * (s12 - mu1_mu2) + c2)
+                    , t1 = (mu1_ * mu1_ + mu2_2 + c1) * (v_load(psigma1_2 + e) + (s2 - mu2_2) + c2)
+                    ;
+                v_store(pq + e, t3 / t1);
+            }
+#endif
+            for (; e < n; ++e)
+            {
+                float mu2 = 0.f, s2 = 0.f, s12 = 0.f;
+                for (int k = 0; k <= 2 * SSIM_RADIUS; ++k)
+                {
+                    mu2 += kernel[k] * m2[e + k * cn];
+                    s2 += kernel[k] * e22[e + k * cn];
+                    s12 += kernel[k] * e12[e + k * cn];
+                }
+                const float
+                    mu1_mu2 = pmu1[e] * mu2
+                    , mu2_2 = mu2 * mu2
+                    , t3 = (2.f * mu1_mu2 + SSIM_C1) * (2.f * (s12 - mu1_mu2) + SSIM_C2)
+                    , t1 = (pmu1[e] * pmu1[e] + mu2_2 + SSIM_C1) * (psigma1_2[e] + (s2 - mu2_2) + SSIM_C2)
+                    ;
+                pq[e] = t3 / t1;
+            }
+
+            for (int c = 0; c < cn; ++c)
+            {
+                double sum = 0.;
+                for (int i = c; i < n; i += cn)
+                    sum += pq[i];
+                sums[c] += sum;
+            }
+        }
+    }
+
+    // fused ssim of I2 against the reference data, the tiles are processed in parallel
+    cv::Scalar ssim_fused( const Mat& I1, const Mat& mu1, const Mat& sigma1_2, const Mat& I2, Mat* qualityMap, std::vector<double>& tileSums )
+    {
+        const int
+            cn = I1.channels()
+            , tilesX = (I1.cols + SSIM_TILE_WIDTH - 1) / SSIM_TILE_WIDTH
+            , tilesY = (I1.rows + SSIM_TILE_HEIGHT - 1) / SSIM_TILE_HEIGHT
+            , nTiles = tilesX * tilesY
+            ;
+
+        tileSums.assign((size_t)nTiles * cn, 0.);
+        cv::parallel_for_(Range(0, nTiles), [&](const Range& range)
+        {
+            for (int t = range.start; t < range.end; ++t)
+            {
+                const Rect tile = Rect((t % tilesX) * SSIM_TILE_WIDTH, (t / tilesX) * SSIM_TILE_HEIGHT, SSIM_TILE_WIDTH, SSIM_TILE_HEIGHT)
+                    & Rect(0, 0, I1.cols, I1.rows);
+                ssim_tile(I1, mu1, sigma1_2, I2, tile, qualityMap, &tileSums[(size_t)t * cn]);
+            }
+        });
+
+        // reduce in tile order, the result does not depend on the scheduling
+        cv::Scalar result = {};
+        for (int t = 0; t < nTiles; ++t)
+            for (int c = 0; c < cn; ++c)
+                result[c] += tileSums[(size_t)t * cn + c];
+        for (int c = 0; c < cn; ++c)
+            result[c] /= (double)I1.total();
+        return result;
+    }
 }   // ns
 
 QualitySSIM::_mat_data::_mat_data( const _mat_type& mat )
@@ -47,7 +250,19 @@ Ptr<QualitySSIM> QualitySSIM::create( InputArray ref )
 // static
 cv::Scalar QualitySSIM::compute( InputArray ref, InputArray cmp, OutputArray qualityMap )
 {
-    auto result = _mat_data::compute( _mat_data(ref), _mat_data(cmp) );
+    _mat_data refData( ref );
+    if (::ssim_fused_supported(refData.I, cmp))
+    {
+        QualitySSIM ssim( std::move(refData) );
+        auto result = ssim.compute(cmp);
+
+        if (qualityMap.needed())
+            qualityMap.assign(ssim._qualityMap);
+
+        return result;
+    }
+
+    auto result = _mat_data::compute( refData, _mat_data(cmp) );
 
     if (qualityMap.needed())
         qualityMap.assign(result.second);
@@ -57,6 +272,12 @@ cv::Scalar QualitySSIM::compute( InputArray ref, InputArray cmp, OutputArray qua
 
 cv::Scalar QualitySSIM::compute( InputArray cmp )
 {
+    if (::ssim_fused_supported(this->_refImgData.I, cmp))
+    {
+        cmp.getMat().convertTo(this->_buffers.cmp, CV_32F);
+        return this->compute_fused(this->_buffers.cmp, true);
+    }
+
     auto result = _mat_data::compute(
         this->_refImgData
         , _mat_data(cmp)
@@ -66,6 +287,43 @@ cv::Scalar QualitySSIM::compute( InputArray cmp )
     return result.first;
 }
 
+std::vector<cv::Scalar> QualitySSIM::computeBatch( InputArrayOfArrays cmp )
+{
+    std::vector<Mat> frames = {};
+    cmp.getMatVector(frames);
+
+    std::vector<cv::Scalar> result( frames.size() );
+    for (size_t i = 0; i < frames.size(); ++i)
+    {
+        if (::ssim_fused_supported(this->_refImgData.I, frames[i]))
+        {
+            // only the quality map of the last frame is kept
+            frames[i].convertTo(this->_buffers.cmp, CV_32F);
+            result[i] = this->compute_fused(this->_buffers.cmp, i + 1 == frames.size());
+        }
+        else
+            result[i] = this->compute(frames[i]);
+    }
+    return result;
+}
+
+cv::Scalar QualitySSIM::compute_fused( const Mat& cmp, bool qualityMapNeeded )
+{
+    const Mat
+        I1 = this->_refImgData.I.getMat(ACCESS_READ)
+        , mu1 = this->_refImgData.mu.getMat(ACCESS_READ)
+        , sigma1_2 = this->_refImgData.sigma_2.getMat(ACCESS_READ)
+        ;
+
+    if (!qualityMapNeeded)
+        return ::ssim_fused(I1, mu1, sigma1_2, cmp, nullptr, this->_buffers.tileSums);
+
+    // the quality map is written in place, its buffer is reused from a frame to the next
+    this->_qualityMap.create(I1.size(), I1.type());
+    Mat qualityMap = this->_qualityMap.getMat(ACCESS_WRITE);
+    return ::ssim_fused(I1, mu1, sigma1_2, cmp, &qualityMap, this->_buffers.tileSums);
+}
+
 // static.  computes ssim and quality map for single frame
 // based on https://docs.opencv.org/2.4/doc/tutorials/highgui/video-input-psnr-ssim/video-input-psnr-ssim.html
 std::pair<cv::Scalar, _mat_type> QualitySSIM::_mat_data::compute(const _mat_data& lhs, const _mat_data& rhs)
@@ -77,6 +77,16 @@ TEST(TEST_CASE_NAME, compute_features)
     EXPECT_EQ(features.cols, 36);
 }
 
+TEST(TEST_CASE_NAME, batch)
+{
+    const std::vector<cv::Mat> imgs = { get_testfile_1a(), get_testfile_2a(), get_testfile_1a() };
+    const auto result = create_brisque()->computeBatch(imgs);
+    ASSERT_EQ(imgs.size(), result.size());
+    quality_expect_near(BRISQUE_EXPECTED_1, result[0]);
+    quality_expect_near(BRISQUE_EXPECTED_2, result[1]);
+    quality_expect_near(BRISQUE_EXPECTED_1, result[2]);
+}
+
 /*
 // internal a/b test
 TEST(TEST_CASE_NAME, performance)
@@ -39,6 +39,27 @@ TEST(TEST_CASE_NAME, multi_channel)
     quality_test(quality::QualitySSIM::create(get_testfile_2a()), get_testfile_2b(), SSIM_EXPECTED_2);
 }
 
+// batch of comparison images
+TEST(TEST_CASE_NAME, batch)
+{
+    auto fn = []()
+    {
+        const std::vector<cv::Mat> frames = { get_testfile_2b(), get_testfile_2a(), get_testfile_2b() };
+        auto ptr = quality::QualitySSIM::create(get_testfile_2a());
+        const auto result = ptr->computeBatch(frames);
+        ASSERT_EQ(frames.size(), result.size());
+        quality_expect_near(SSIM_EXPECTED_2, result[0]);
+        quality_expect_near(cv::Scalar(1., 1., 1.), result[1]); // ref vs ref
+        quality_expect_near(SSIM_EXPECTED_2, result[2]);
+
+        cv::Mat qMat = {};
+        ptr->getQualityMap(qMat);
+        check_quality_map(qMat);
+    };
+    OCL_OFF(fn());
+    OCL_ON(fn());
+}
+
 // internal a/b test
 /*
 TEST(TEST_CASE_NAME, performance)
@@ -185,6 +185,18 @@ public:
     return computeSaliencyImpl( image, saliencyMap );
   }
 
+  /** @brief Processes the current frame of several independent camera streams in one call.
+
+    Each model keeps the background of its own stream and must have been initialized with init() for the size of
+    the corresponding image. The streams are processed in parallel.
+    @param models one motion saliency model per stream.
+    @param images current frame of each stream, single channel 8-bit images.
+    @param saliencyMaps binarized saliency map of each stream.
+    @return true if the saliency map of every stream has been computed.
+  */
+  static bool computeSaliencyBatch( const std::vector<Ptr<MotionSaliencyBinWangApr2014> >& models,
+                                    InputArrayOfArrays images, OutputArrayOfArrays saliencyMaps );
+
   /** @brief This is a utility function that allows to set the correct size (taken from the input image) in the
     corresponding variables that will be used to size the data structures of the algorithm.
     @param W width of input image
@@ -239,12 +251,14 @@ private:
   bool decisionThresholdAdaptation();
 
   // changing structure
-  std::vector<Ptr<Mat> > backgroundModel;// The vector represents the background template T0---TK of reference paper.
-  // Matrices are two-channel matrix. In the first layer there are the B (background value)
-  // for each pixel. In the second layer, there are the C (efficacy) value for each pixel
+  // The background templates T0---TK of reference paper, stored as separate planes: backgroundModelB[k] holds the
+  // B (background value) of template k for each pixel and backgroundModelC[k] the C (efficacy) value
+  std::vector<Mat> backgroundModelB;
+  std::vector<Mat> backgroundModelC;
   Mat potentialBackground;// Two channel Matrix. For each pixel, in the first level there are the Ba value (potential background value)
                           // and in the secon level there are the Ca value, the counter for each potential value.
   Mat epslonPixelsValue;// epslon threshold
+  Mat replacementMask;// Pixels whose potential background value replaces the last template in templateReplacement
 
   Mat activityPixelsValue;// Activity level of each pixel
 
@@ -308,6 +322,20 @@ public:
     return computeSaliencyImpl( image, saliencyMap );
   }
 
+  /** @brief Computes the objectness bounding boxes of a collection of images.
+
+    The trained model of each color space is loaded once for the whole collection and the buffers of the
+    window sizes, which are processed in parallel, are shared by all the images. Unlike computeSaliency, the
+    results are not written in the results directory.
+    @param images input images.
+    @param boundingBoxes for each image, the objectness bounding boxes in descending order of objectness, each one
+    represented by a *Vec4i* for (minX, minY, maxX, maxY).
+    @param values for each image, the objectness values of the rectangles, as returned by getobjectnessValues.
+    @return false if one of the images is empty.
+     */
+  bool computeSaliencyBatch( InputArrayOfArrays images, std::vector<std::vector<Vec4i> > &boundingBoxes,
+                             std::vector<std::vector<float> > &values );
+
   CV_WRAP void read();
   CV_WRAP void write() const;
 
@@ -379,9 +407,9 @@ private:
     void update( Mat &w );
 
     // For a W by H gradient magnitude map, find a W-7 by H-7 CV_32F matching score map
-    Mat matchTemplate( const Mat &mag1u );
+    void matchTemplate( const Mat &mag1u, Mat &matchCost1f ) const;
 
-    float dot( int64_t tig1, int64_t tig2, int64_t tig4, int64_t tig8 );
+    float dot( int64_t tig1, int64_t tig2, int64_t tig4, int64_t tig8 ) const;
     void reconstruct( Mat &w );// For illustration purpose
 
   private:
@@ -422,6 +450,13 @@ private:
     std::vector<ST> sortedStructVals;
   };
 
+  // Buffers used to score one window size, kept from an image to the next
+  struct ScaleBuffers
+  {
+    Mat im3u, clr3u, mag1u, matchCost1f;
+    ValStructVec<float, Point> matchCost;
+  };
+
   enum
   {
     MAXBGR,
@@ -444,6 +479,7 @@ private:
   Mat _svmFilter;// Filters learned at stage I, each is a _H by _W CV_32F matrix
   FilterTIG _tigF;// TIG filter
   Mat _svmReW1f;// Re-weight parameters learned at stage II.
+  std::vector<ScaleBuffers> _scaleBuffers;// One per active size
 
 // List of the rectangles' objectness value, in the same order as
 // the  vector<Vec4i> objectnessBoundingBox returned by the algorithm (in computeSaliencyImpl function)
@@ -471,33 +507,25 @@ private:
 // Use numDet to control the final number of proposed bounding boxes, and number of per size (scale and aspect ratio)
   void getObjBndBoxes( Mat &img3u, ValStructVec<float, Vec4i> &valBoxes, int numDetPerSize = 120 );
   void getObjBndBoxesForSingleImage( Mat img, ValStructVec<float, Vec4i> &boxes, int numDetPerSize );
+  void getObjBndBoxesForImages( std::vector<Mat> &imgs, std::vector<ValStructVec<float, Vec4i> > &finalBoxes, int numDetPerSize );
+  static void sortBoxes( ValStructVec<float, Vec4i> &finalBoxes, std::vector<Vec4i> &sortedBB, std::vector<float> &values );
 
   bool filtersLoaded()
   {
     int n = (int) _svmSzIdxs.size();
     return n > 0 && _svmReW1f.size() == Size( 2, n ) && _svmFilter.size() == Size( _W, _W );
   }
+  // Window size of the ir-th active size for an imgW by imgH image, false if it is too large for the image
+  bool windowSize( int ir, int imgW, int imgH, int &width, int &height ) const;
   void predictBBoxSI( Mat &mag3u, ValStructVec<float, Vec4i> &valBoxes, std::vector<int> &sz, int NUM_WIN_PSZ = 100, bool fast = true );
   void predictBBoxSII( ValStructVec<float, Vec4i> &valBoxes, const std::vector<int> &sz );
 
 // Calculate the image gradient: center option as in VLFeat
-  void gradientMag( Mat &imgBGR3u, Mat &mag1u );
+  void gradientMag( const Mat &imgBGR3u, Mat &mag1u, Mat &clr ) const;
 
-  static void gradientRGB( Mat &bgr3u, Mat &mag1u );
-  static void gradientGray( Mat &bgr3u, Mat &mag1u );
-  static void gradientHSV( Mat &bgr3u, Mat &mag1u );
-  static void gradientXY( Mat &x1i, Mat &y1i, Mat &mag1u );
-
-  static inline int bgrMaxDist( const Vec3b &u, const Vec3b &v )
-  {
-    int b = abs( u[0] - v[0] ), g = abs( u[1] - v[1] ), r = abs( u[2] - v[2] );
-    b = max( b, g );
-    return max( b, r );
-  }
-  static inline int vecDist3b( const Vec3b &u, const Vec3b &v )
-  {
-    return abs( u[0] - v[0] ) + abs( u[1] - v[1] ) + abs( u[2] - v[2] );
-  }
+  static void gradientRGB( const Mat &bgr3u, Mat &mag1u );
+  static void gradientGray( const Mat &bgr3u, Mat &mag1u, Mat &g1u );
+  static void gradientHSV( const Mat &bgr3u, Mat &mag1u, Mat &hsv3u );
 
 //Non-maximal suppress
   static void nonMaxSup( Mat &matchCost1f, ValStructVec<float, Point> &matchCost, int NSS = 1, int maxPoint = 50, bool fast = true );
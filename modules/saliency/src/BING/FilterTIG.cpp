@@ -48,21 +48,21 @@ namespace saliency
 {
 
 typedef int64_t TIG_TYPE;
-typedef double MAT_TIG_TYPE; // cv::Mat has no native support for int64/uint64
 
 struct TIGbits
 {
   TIGbits() : bc0(0), bc1(0) {}
   inline void accumulate(TIG_TYPE tig, TIG_TYPE tigMask0, TIG_TYPE tigMask1, uchar shift)
   {
-    bc0 += ((POPCNT64(tigMask0 & tig) << 1) - POPCNT64(tig)) << shift;
-    bc1 += ((POPCNT64(tigMask1 & tig) << 1) - POPCNT64(tig)) << shift;
+    const TIG_TYPE bc = POPCNT64(tig);
+    bc0 += ((POPCNT64(tigMask0 & tig) << 1) - bc) << shift;
+    bc1 += ((POPCNT64(tigMask1 & tig) << 1) - bc) << shift;
   }
   TIG_TYPE bc0;
   TIG_TYPE bc1;
 };
 
-float ObjectnessBING::FilterTIG::dot( TIG_TYPE tig1, TIG_TYPE tig2, TIG_TYPE tig4, TIG_TYPE tig8 )
+float ObjectnessBING::FilterTIG::dot( TIG_TYPE tig1, TIG_TYPE tig2, TIG_TYPE tig4, TIG_TYPE tig8 ) const
 {
   TIGbits x;
   x.accumulate(tig1, _bTIGs[0], _bTIGs[1], 0);
@@ -110,48 +110,43 @@ void ObjectnessBING::FilterTIG::reconstruct( Mat &w1f )
 
 // For a W by H gradient magnitude map, find a W-7 by H-7 CV_32F matching score map
 // Please refer to my paper for definition of the variables used in this function
-Mat ObjectnessBING::FilterTIG::matchTemplate( const Mat &mag1u )
+// A binary TIG only depends on the last 8 rows, so a single row of them is kept and updated in place
+void ObjectnessBING::FilterTIG::matchTemplate( const Mat &mag1u, Mat &matchCost1f ) const
 {
   const int H = mag1u.rows, W = mag1u.cols;
-  const Size sz( W + 1, H + 1 );  // Expand original size to avoid dealing with boundary conditions
-  Mat_<MAT_TIG_TYPE> Tig1 = Mat_<MAT_TIG_TYPE>::zeros( sz ), Tig2 = Mat_<MAT_TIG_TYPE>::zeros( sz );
-  Mat_<MAT_TIG_TYPE> Tig4 = Mat_<MAT_TIG_TYPE>::zeros( sz ), Tig8 = Mat_<MAT_TIG_TYPE>::zeros( sz );
-  Mat_<BYTE> Row1 = Mat_<BYTE>::zeros( sz ), Row2 = Mat_<BYTE>::zeros( sz );
-  Mat_<BYTE> Row4 = Mat_<BYTE>::zeros( sz ), Row8 = Mat_<BYTE>::zeros( sz );
-  Mat_<float> scores( sz );
-  for ( int y = 1; y <= H; y++ )
+  CV_Assert( mag1u.type() == CV_8U && H >= 8 && W >= 8 );
+  matchCost1f.create( H - 7, W - 7, CV_32F );
+
+  AutoBuffer<TIG_TYPE> tigBuf( 4 * W );
+  TIG_TYPE* T1 = tigBuf.data();  // Binary TIG of current row
+  TIG_TYPE* T2 = T1 + W;
+  TIG_TYPE* T4 = T2 + W;
+  TIG_TYPE* T8 = T4 + W;
+  std::fill( T1, T1 + 4 * W, (TIG_TYPE) 0 );
+
+  for ( int y = 0; y < H; y++ )
   {
-    const BYTE* G = mag1u.ptr<BYTE>( y - 1 );
-    TIG_TYPE* T1 = Tig1.ptr<TIG_TYPE>( y );  // Binary TIG of current row
-    TIG_TYPE* T2 = Tig2.ptr<TIG_TYPE>( y );
-    TIG_TYPE* T4 = Tig4.ptr<TIG_TYPE>( y );
-    TIG_TYPE* T8 = Tig8.ptr<TIG_TYPE>( y );
-    TIG_TYPE* Tu1 = Tig1.ptr<TIG_TYPE>( y - 1 );  // Binary TIG of upper row
-    TIG_TYPE* Tu2 = Tig2.ptr<TIG_TYPE>( y - 1 );
-    TIG_TYPE* Tu4 = Tig4.ptr<TIG_TYPE>( y - 1 );
-    TIG_TYPE* Tu8 = Tig8.ptr<TIG_TYPE>( y - 1 );
-    BYTE* R1 = Row1.ptr<BYTE>( y );
-    BYTE* R2 = Row2.ptr<BYTE>( y );
-    BYTE* R4 = Row4.ptr<BYTE>( y );
-    BYTE* R8 = Row8.ptr<BYTE>( y );
-    float *s = scores.ptr<float>( y );
-    for ( int x = 1; x <= W; x++ )
+    const BYTE* G = mag1u.ptr<BYTE>( y );
+    BYTE R1 = 0, R2 = 0, R4 = 0, R8 = 0;  // Binary TIG of the last 8 pixels of current row
+    for ( int x = 0; x < W; x++ )
     {
-      BYTE g = G[x - 1];
-      R1[x] = ( R1[x - 1] << 1 ) | ( ( g >> 4 ) & 1 );
-      R2[x] = ( R2[x - 1] << 1 ) | ( ( g >> 5 ) & 1 );
-      R4[x] = ( R4[x - 1] << 1 ) | ( ( g >> 6 ) & 1 );
-      R8[x] = ( R8[x - 1] << 1 ) | ( ( g >> 7 ) & 1 );
-      T1[x] = ( Tu1[x] << 8 ) | R1[x];
-      T2[x] = ( Tu2[x] << 8 ) | R2[x];
-      T4[x] = ( Tu4[x] << 8 ) | R4[x];
-      T8[x] = ( Tu8[x] << 8 ) | R8[x];
-      s[x] = dot( T1[x], T2[x], T4[x], T8[x] );
+      BYTE g = G[x];
+      R1 = (BYTE) ( ( R1 << 1 ) | ( ( g >> 4 ) & 1 ) );
+      R2 = (BYTE) ( ( R2 << 1 ) | ( ( g >> 5 ) & 1 ) );
+      R4 = (BYTE) ( ( R4 << 1 ) | ( ( g >> 6 ) & 1 ) );
+      R8 = (BYTE) ( ( R8 << 1 ) | ( ( g >> 7 ) & 1 ) );
+      T1[x] = ( T1[x] << 8 ) | R1;
+      T2[x] = ( T2[x] << 8 ) | R2;
+      T4[x] = ( T4[x] << 8 ) | R4;
+      T8[x] = ( T8[x] << 8 ) | R8;
     }
+
+    if( y < 7 )
+      continue;
+    float *s = matchCost1f.ptr<float>( y - 7 );
+    for ( int x = 7; x < W; x++ )
+      s[x - 7] = dot( T1[x], T2[x], T4[x], T8[x] );
   }
-  Mat matchCost1f;
-  scores( Rect( 8, 8, W - 7, H - 7 ) ).copyTo( matchCost1f );
-  return matchCost1f;
 }
 
 }  // namespace saliency
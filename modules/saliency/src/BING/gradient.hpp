@@ -0,0 +1,141 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+
+#ifndef __OPENCV_SALIENCY_BING_GRADIENT_HPP__
+#define __OPENCV_SALIENCY_BING_GRADIENT_HPP__
+
+#include "opencv2/core.hpp"
+#include "opencv2/core/hal/intrin.hpp"
+#include <algorithm>
+#include <cstdlib>
+
+namespace cv
+{
+namespace saliency
+{
+
+// Distance between two pixels: the maximum (or the sum) of the absolute channel differences
+template<int cn, bool sumDist>
+static inline int pixelDist( const uchar* u, const uchar* v )
+{
+  int d = std::abs( u[0] - v[0] );
+  for ( int c = 1; c < cn; c++ )
+    d = sumDist ? d + std::abs( u[c] - v[c] ) : std::max( d, std::abs( u[c] - v[c] ) );
+  return d;
+}
+
+#if CV_SIMD128
+template<int cn, bool sumDist>
+static inline void pixelDist( const uchar* u, const uchar* v, v_uint16x8& d0, v_uint16x8& d1 )
+{
+  if( cn == 1 )
+  {
+    v_expand( v_absdiff( v_load( u ), v_load( v ) ), d0, d1 );
+    return;
+  }
+
+  v_uint8x16 u0, u1, u2, v0, v1, v2;
+  v_load_deinterleave( u, u0, u1, u2 );
+  v_load_deinterleave( v, v0, v1, v2 );
+  const v_uint8x16 a0 = v_absdiff( u0, v0 ), a1 = v_absdiff( u1, v1 ), a2 = v_absdiff( u2, v2 );
+  if( !sumDist )
+  {
+    v_expand( v_max( a0, v_max( a1, a2 ) ), d0, d1 );
+    return;
+  }
+
+  v_uint16x8 e0, e1;
+  v_expand( a0, d0, d1 );
+  v_expand( a1, e0, e1 );
+  d0 += e0;
+  d1 += e1;
+  v_expand( a2, e0, e1 );
+  d0 += e0;
+  d1 += e1;
+}
+#endif
+
+// Gradient magnitude min(|Ix| + |Iy|, 255) with central differences in inner regions (divided by 2^innerShift)
+// and one-sided differences on the image borders (multiplied by edgeMul), computed row by row
+template<int cn, bool sumDist>
+static void gradientFused( const Mat &src, Mat &mag1u, int edgeMul, int innerShift )
+{
+  const int H = src.rows, W = src.cols;
+  CV_Assert( src.type() == CV_8UC( cn ) && H >= 2 && W >= 2 );
+  mag1u.create( H, W, CV_8U );
+
+  for ( int y = 0; y < H; y++ )
+  {
+    // Top/bottom most rows use the one-sided difference for Iy
+    const bool edgeRow = y == 0 || y == H - 1;
+    const uchar* dataP = src.ptr<uchar>( y );
+    const uchar* tP = src.ptr<uchar>( y == 0 ? 1 : y == H - 1 ? H - 1 : y - 1 );
+    const uchar* bP = src.ptr<uchar>( y == 0 ? 0 : y == H - 1 ? H - 2 : y + 1 );
+    uchar* m = mag1u.ptr<uchar>( y );
+
+    auto iy = [&]( int x ) -> int
+    {
+      const int d = pixelDist<cn, sumDist>( tP + x * cn, bP + x * cn );
+      return edgeRow ? d * edgeMul : d >> innerShift;
+    };
+
+    // Left/right most column Ix
+    m[0] = (uchar) std::min( pixelDist<cn, sumDist>( dataP + cn, dataP ) * edgeMul + iy( 0 ), 255 );
+    m[W - 1] = (uchar) std::min( pixelDist<cn, sumDist>( dataP + ( W - 1 ) * cn, dataP + ( W - 2 ) * cn ) * edgeMul + iy( W - 1 ), 255 );
+
+    // Find the gradient for inner regions
+    int x = 1;
+#if CV_SIMD128
+    for ( ; x <= W - 17; x += 16 )
+    {
+      v_uint16x8 ix0, ix1, iy0, iy1;
+      pixelDist<cn, sumDist>( dataP + ( x - 1 ) * cn, dataP + ( x + 1 ) * cn, ix0, ix1 );
+      pixelDist<cn, sumDist>( tP + x * cn, bP + x * cn, iy0, iy1 );
+      ix0 = ix0 >> innerShift;
+      ix1 = ix1 >> innerShift;
+      if( edgeRow )
+      {
+        const v_uint16x8 mul = v_setall_u16( (ushort) edgeMul );
+        iy0 = iy0 * mul;
+        iy1 = iy1 * mul;
+      }
+      else
+      {
+        iy0 = iy0 >> innerShift;
+        iy1 = iy1 >> innerShift;
+      }
+      // saturating pack, i.e. min( x + y, 255 )
+      v_store( m + x, v_pack( ix0 + iy0, ix1 + iy1 ) );
+    }
+#endif
+    for ( ; x < W - 1; x++ )
+    {
+      const int ix = pixelDist<cn, sumDist>( dataP + ( x - 1 ) * cn, dataP + ( x + 1 ) * cn ) >> innerShift;
+      m[x] = (uchar) std::min( ix + iy( x ), 255 );
+    }
+  }
+}
+
+// Gradient magnitude of the MAXBGR color space: maximum channel distance, the image borders are doubled
+static inline void gradientMaxBGR( const Mat &bgr3u, Mat &mag1u )
+{
+  gradientFused<3, false>( bgr3u, mag1u, 2, 0 );
+}
+
+// Gradient magnitude of a gray image, the image borders are doubled
+static inline void gradientGray1u( const Mat &g1u, Mat &mag1u )
+{
+  gradientFused<1, false>( g1u, mag1u, 2, 0 );
+}
+
+// Gradient magnitude of an HSV image: sum of the channel distances, the inner regions are halved
+static inline void gradientHSV3u( const Mat &hsv3u, Mat &mag1u )
+{
+  gradientFused<3, true>( hsv3u, mag1u, 1, 1 );
+}
+
+} /* namespace saliency */
+} /* namespace cv */
+
+#endif
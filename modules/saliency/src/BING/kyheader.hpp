@@ -241,7 +241,11 @@ inline int popcnt_byte( uint32_t u )
   return (int)c;
 }
 
-#if defined(_MSC_VER)
+#if CV_POPCNT && (defined(__x86_64__) || defined(_M_X64))
+// The build enables the POPCNT instruction, count the 64 bits of a TIG feature at once
+# define POPCNT(x) (int)_mm_popcnt_u32((unsigned)(x))
+# define POPCNT64(x) (int)_mm_popcnt_u64((uint64_t)(x))
+#elif defined(_MSC_VER)
 #if defined(_M_ARM) || defined(_M_ARM64)
 # define POPCNT(x) popcnt((x))
 # define POPCNT64(x) popcnt64((x))
@@ -250,9 +254,7 @@ inline int popcnt_byte( uint32_t u )
 # define POPCNT(x) __popcnt(x)
 # define POPCNT64(x) (__popcnt((unsigned)(x)) + __popcnt((unsigned)((uint64_t)(x) >> 32)))
 #endif
-#endif
-
-#if defined(__GNUC__)
+#elif defined(__GNUC__)
 # define POPCNT(x) __builtin_popcount(x)
 # define POPCNT64(x) __builtin_popcountll(x)
 #endif
@@ -42,6 +42,7 @@
 #include "../precomp.hpp"
 
 #include "kyheader.hpp"
+#include "gradient.hpp"
 #include "CmTimer.hpp"
 #include "CmFile.hpp"
 
@@ -122,6 +123,17 @@ int ObjectnessBING::loadTrainedModel()  // Return -1, 0, or 1 if partial, none,
   return 1;
 }
 
+bool ObjectnessBING::windowSize( int ir, int imgW, int imgH, int &width, int &height ) const
+{
+  int r = _svmSzIdxs[ir];
+  height = cvRound( pow( _base, r / _numT + _minT ) ), width = cvRound( pow( _base, r % _numT + _minT ) );
+  if( height > imgH * _base || width > imgW * _base )
+    return false;
+
+  height = min( height, imgH ), width = min( width, imgW );
+  return true;
+}
+
 void ObjectnessBING::predictBBoxSI( Mat &img3u, ValStructVec<float, Vec4i> &valBoxes, std::vector<int> &sz, int NUM_WIN_PSZ, bool fast )
 {
   const int numSz = (int) _svmSzIdxs.size();
@@ -129,24 +141,36 @@ void ObjectnessBING::predictBBoxSI( Mat &img3u, ValStructVec<float, Vec4i> &valB
   valBoxes.reserve( 10000 );
   sz.clear();
   sz.reserve( 10000 );
+  if( (int) _scaleBuffers.size() < numSz )
+    _scaleBuffers.resize( numSz );
+
+  // The window sizes are independent: the gradient map and the TIG scores of all of them are computed in parallel,
+  // each one in its own buffers which are kept for the next images
+  parallel_for_( Range( 0, numSz ), [&]( const Range& range )
+  {
+    for ( int ir = range.start; ir < range.end; ir++ )
+    {
+      ScaleBuffers& buf = _scaleBuffers[ir];
+      buf.matchCost.clear();
+      int width, height;
+      if( !windowSize( ir, imgW, imgH, width, height ) )
+        continue;
+
+      resize( img3u, buf.im3u, Size( cvRound( _W * imgW * 1.0 / width ), cvRound( _W * imgH * 1.0 / height ) ), 0, 0, INTER_LINEAR_EXACT );
+      gradientMag( buf.im3u, buf.mag1u, buf.clr3u );
+      _tigF.matchTemplate( buf.mag1u, buf.matchCost1f );
+      nonMaxSup( buf.matchCost1f, buf.matchCost, _NSS, NUM_WIN_PSZ, fast );
+    }
+  } );
+
   for ( int ir = numSz - 1; ir >= 0; ir-- )
   {
-    int r = _svmSzIdxs[ir];
-    int height = cvRound( pow( _base, r / _numT + _minT ) ), width = cvRound( pow( _base, r % _numT + _minT ) );
-    if( height > imgH * _base || width > imgW * _base )
+    int width, height;
+    if( !windowSize( ir, imgW, imgH, width, height ) )
       continue;
 
-    height = min( height, imgH ), width = min( width, imgW );
-    Mat im3u, matchCost1f, mag1u;
-    resize( img3u, im3u, Size( cvRound( _W * imgW * 1.0 / width ), cvRound( _W * imgH * 1.0 / height ) ), 0, 0, INTER_LINEAR_EXACT );
-    gradientMag( im3u, mag1u );
-
-    matchCost1f = _tigF.matchTemplate( mag1u );
-
-    ValStructVec<float, Point> matchCost;
-    nonMaxSup( matchCost1f, matchCost, _NSS, NUM_WIN_PSZ, fast );
-
     // Find true locations and match values
+    const ValStructVec<float, Point> &matchCost = _scaleBuffers[ir].matchCost;
     double ratioX = width / _W, ratioY = height / _W;
     int iMax = min( matchCost.size(), NUM_WIN_PSZ );
     for ( int i = 0; i < iMax; i++ )
@@ -241,7 +265,7 @@ void ObjectnessBING::nonMaxSup( Mat &matchCost1f, ValStructVec<float, Point> &ma
   }
 }
 
-void ObjectnessBING::gradientMag( Mat &imgBGR3u, Mat &mag1u )
+void ObjectnessBING::gradientMag( const Mat &imgBGR3u, Mat &mag1u, Mat &clr ) const
 {
   switch ( _Clr )
   {
@@ -249,127 +273,31 @@ void ObjectnessBING::gradientMag( Mat &imgBGR3u, Mat &mag1u )
       gradientRGB( imgBGR3u, mag1u );
       break;
     case G:
-      gradientGray( imgBGR3u, mag1u );
+      gradientGray( imgBGR3u, mag1u, clr );
       break;
     case HSV:
-      gradientHSV( imgBGR3u, mag1u );
+      gradientHSV( imgBGR3u, mag1u, clr );
       break;
     default:
       printf( "Error: not recognized color space\n" );
   }
 }
 
-void ObjectnessBING::gradientRGB( Mat &bgr3u, Mat &mag1u )
+void ObjectnessBING::gradientRGB( const Mat &bgr3u, Mat &mag1u )
 {
-  const int H = bgr3u.rows, W = bgr3u.cols;
-  Mat Ix( H, W, CV_32S ), Iy( H, W, CV_32S );
-
-  // Left/right most column Ix
-  for ( int y = 0; y < H; y++ )
-  {
-    Ix.at<int>( y, 0 ) = bgrMaxDist( bgr3u.at<Vec3b>( y, 1 ), bgr3u.at<Vec3b>( y, 0 ) ) * 2;
-    Ix.at<int>( y, W - 1 ) = bgrMaxDist( bgr3u.at<Vec3b>( y, W - 1 ), bgr3u.at<Vec3b>( y, W - 2 ) ) * 2;
-  }
-
-  // Top/bottom most column Iy
-  for ( int x = 0; x < W; x++ )
-  {
-    Iy.at<int>( 0, x ) = bgrMaxDist( bgr3u.at<Vec3b>( 1, x ), bgr3u.at<Vec3b>( 0, x ) ) * 2;
-    Iy.at<int>( H - 1, x ) = bgrMaxDist( bgr3u.at<Vec3b>( H - 1, x ), bgr3u.at<Vec3b>( H - 2, x ) ) * 2;
-  }
-
-  // Find the gradient for inner regions
-  for ( int y = 0; y < H; y++ )
-  {
-    const Vec3b *dataP = bgr3u.ptr<Vec3b>( y );
-    for ( int x = 2; x < W; x++ )
-      Ix.at<int>( y, x - 1 ) = bgrMaxDist( dataP[x - 2], dataP[x] );  //  bgr3u.at<Vec3b>(y, x+1), bgr3u.at<Vec3b>(y, x-1));
-  }
-  for ( int y = 1; y < H - 1; y++ )
-  {
-    const Vec3b *tP = bgr3u.ptr<Vec3b>( y - 1 );
-    const Vec3b *bP = bgr3u.ptr<Vec3b>( y + 1 );
-    for ( int x = 0; x < W; x++ )
-      Iy.at<int>( y, x ) = bgrMaxDist( tP[x], bP[x] );
-  }
-  gradientXY( Ix, Iy, mag1u );
+  gradientMaxBGR( bgr3u, mag1u );
 }
 
-void ObjectnessBING::gradientGray( Mat &bgr3u, Mat &mag1u )
+void ObjectnessBING::gradientGray( const Mat &bgr3u, Mat &mag1u, Mat &g1u )
 {
-  Mat g1u;
   cvtColor( bgr3u, g1u, COLOR_BGR2GRAY );
-  const int H = g1u.rows, W = g1u.cols;
-  Mat Ix( H, W, CV_32S ), Iy( H, W, CV_32S );
-
-  // Left/right most column Ix
-  for ( int y = 0; y < H; y++ )
-  {
-    Ix.at<int>( y, 0 ) = abs( g1u.at<BYTE>( y, 1 ) - g1u.at<BYTE>( y, 0 ) ) * 2;
-    Ix.at<int>( y, W - 1 ) = abs( g1u.at<BYTE>( y, W - 1 ) - g1u.at<BYTE>( y, W - 2 ) ) * 2;
-  }
-
-  // Top/bottom most column Iy
-  for ( int x = 0; x < W; x++ )
-  {
-    Iy.at<int>( 0, x ) = abs( g1u.at<BYTE>( 1, x ) - g1u.at<BYTE>( 0, x ) ) * 2;
-    Iy.at<int>( H - 1, x ) = abs( g1u.at<BYTE>( H - 1, x ) - g1u.at<BYTE>( H - 2, x ) ) * 2;
-  }
-
-  // Find the gradient for inner regions
-  for ( int y = 0; y < H; y++ )
-    for ( int x = 1; x < W - 1; x++ )
-      Ix.at<int>( y, x ) = abs( g1u.at<BYTE>( y, x + 1 ) - g1u.at<BYTE>( y, x - 1 ) );
-  for ( int y = 1; y < H - 1; y++ )
-    for ( int x = 0; x < W; x++ )
-      Iy.at<int>( y, x ) = abs( g1u.at<BYTE>( y + 1, x ) - g1u.at<BYTE>( y - 1, x ) );
-
-  gradientXY( Ix, Iy, mag1u );
+  gradientGray1u( g1u, mag1u );
 }
 
-void ObjectnessBING::gradientHSV( Mat &bgr3u, Mat &mag1u )
+void ObjectnessBING::gradientHSV( const Mat &bgr3u, Mat &mag1u, Mat &hsv3u )
 {
-  Mat hsv3u;
   cvtColor( bgr3u, hsv3u, COLOR_BGR2HSV );
-  const int H = hsv3u.rows, W = hsv3u.cols;
-  Mat Ix( H, W, CV_32S ), Iy( H, W, CV_32S );
-
-  // Left/right most column Ix
-  for ( int y = 0; y < H; y++ )
-  {
-    Ix.at<int>( y, 0 ) = vecDist3b( hsv3u.at<Vec3b>( y, 1 ), hsv3u.at<Vec3b>( y, 0 ) );
-    Ix.at<int>( y, W - 1 ) = vecDist3b( hsv3u.at<Vec3b>( y, W - 1 ), hsv3u.at<Vec3b>( y, W - 2 ) );
-  }
-
-  // Top/bottom most column Iy
-  for ( int x = 0; x < W; x++ )
-  {
-    Iy.at<int>( 0, x ) = vecDist3b( hsv3u.at<Vec3b>( 1, x ), hsv3u.at<Vec3b>( 0, x ) );
-    Iy.at<int>( H - 1, x ) = vecDist3b( hsv3u.at<Vec3b>( H - 1, x ), hsv3u.at<Vec3b>( H - 2, x ) );
-  }
-
-  // Find the gradient for inner regions
-  for ( int y = 0; y < H; y++ )
-    for ( int x = 1; x < W - 1; x++ )
-      Ix.at<int>( y, x ) = vecDist3b( hsv3u.at<Vec3b>( y, x + 1 ), hsv3u.at<Vec3b>( y, x - 1 ) ) / 2;
-  for ( int y = 1; y < H - 1; y++ )
-    for ( int x = 0; x < W; x++ )
-      Iy.at<int>( y, x ) = vecDist3b( hsv3u.at<Vec3b>( y + 1, x ), hsv3u.at<Vec3b>( y - 1, x ) ) / 2;
-
-  gradientXY( Ix, Iy, mag1u );
-}
-
-void ObjectnessBING::gradientXY( Mat &x1i, Mat &y1i, Mat &mag1u )
-{
-  const int H = x1i.rows, W = x1i.cols;
-  mag1u.create( H, W, CV_8U );
-  for ( int r = 0; r < H; r++ )
-  {
-    const int *x = x1i.ptr<int>( r ), *y = y1i.ptr<int>( r );
-    BYTE* m = mag1u.ptr<BYTE>( r );
-    for ( int c = 0; c < W; c++ )
-      m[c] = (BYTE) min( x[c] + y[c], 255 );   //((int)sqrt(sqr(x[c]) + sqr(y[c])), 255);
-  }
+  gradientHSV3u( hsv3u, mag1u );
 }
 
 void ObjectnessBING::getObjBndBoxesForSingleImage( Mat img, ValStructVec<float, Vec4i> &finalBoxes, int numDetPerSize )
@@ -414,6 +342,31 @@ void ObjectnessBING::getObjBndBoxesForSingleImage( Mat img, ValStructVec<float,
   ofs.close();
 }
 
+void ObjectnessBING::getObjBndBoxesForImages( std::vector<Mat> &imgs, std::vector<ValStructVec<float, Vec4i> > &finalBoxes, int numDetPerSize )
+{
+  ValStructVec<float, Vec4i> boxes;
+  finalBoxes.resize( imgs.size() );
+  for ( size_t i = 0; i < imgs.size(); i++ )
+    finalBoxes[i].reserve( 10000 );
+
+  int scales[3] =
+  { 1, 3, 5 };
+  // The model of each color space is loaded once for the whole collection, the per-size buffers are shared by
+  // all the images
+  for ( int clr = MAXBGR; clr <= G; clr++ )
+  {
+    setColorSpace( clr );
+    if (!loadTrainedModel())
+      continue;
+
+    for ( size_t i = 0; i < imgs.size(); i++ )
+    {
+      getObjBndBoxes( imgs[i], boxes, numDetPerSize );
+      finalBoxes[i].append( boxes, scales[clr] );
+    }
+  }
+}
+
 struct MatchPathSeparator
 {
   bool operator()( char ch ) const
@@ -463,22 +416,50 @@ void ObjectnessBING::write() const
 
 }
 
+void ObjectnessBING::sortBoxes( ValStructVec<float, Vec4i> &finalBoxes, std::vector<Vec4i> &sortedBB, std::vector<float> &values )
+{
+  // List of rectangles returned by objectess function in descending order.
+  // At the top there are the rectangles with higher values, ie more
+  // likely to have objects in them.
+  sortedBB = finalBoxes.getSortedStructVal();
+
+  // List of the rectangles' objectness value
+  const std::vector<std::pair<float, int> > valIdxes = finalBoxes.getvalIdxes();
+  values.resize( valIdxes.size() );
+  for ( size_t i = 0; i < valIdxes.size(); i++ )
+    values[valIdxes[i].second] = valIdxes[i].first;
+}
+
 bool ObjectnessBING::computeSaliencyImpl( InputArray image, OutputArray objectnessBoundingBox )
 {
   ValStructVec<float, Vec4i> finalBoxes;
   getObjBndBoxesForSingleImage( image.getMat(), finalBoxes, 250 );
 
-  // List of rectangles returned by objectess function in descending order.
-  // At the top there are the rectangles with higher values, ie more
-  // likely to have objects in them.
-  std::vector<Vec4i> sortedBB = finalBoxes.getSortedStructVal();
+  std::vector<Vec4i> sortedBB;
+  sortBoxes( finalBoxes, sortedBB, objectnessValues );
   Mat( sortedBB ).copyTo( objectnessBoundingBox );
 
-  // List of the rectangles' objectness value
-  unsigned long int valIdxesSize = (unsigned long int) finalBoxes.getvalIdxes().size();
-  objectnessValues.resize( valIdxesSize );
-  for ( uint i = 0; i < valIdxesSize; i++ )
-    objectnessValues[finalBoxes.getvalIdxes()[i].second] = finalBoxes.getvalIdxes()[i].first;
+  return true;
+}
+
+bool ObjectnessBING::computeSaliencyBatch( InputArrayOfArrays _images, std::vector<std::vector<Vec4i> > &boundingBoxes,
+                                           std::vector<std::vector<float> > &values )
+{
+  std::vector<Mat> images;
+  _images.getMatVector( images );
+  for ( size_t i = 0; i < images.size(); i++ )
+  {
+    if( images[i].empty() )
+      return false;
+  }
+
+  std::vector<ValStructVec<float, Vec4i> > finalBoxes;
+  getObjBndBoxesForImages( images, finalBoxes, 250 );
+
+  boundingBoxes.resize( images.size() );
+  values.resize( images.size() );
+  for ( size_t i = 0; i < images.size(); i++ )
+    sortBoxes( finalBoxes[i], boundingBoxes[i], values[i] );
 
   return true;
 }
@@ -41,6 +41,7 @@
 
 #include <limits>
 #include "precomp.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 
 #define thetaA_VAL 200
 #define thetaL_VAL 250
@@ -89,15 +90,15 @@ bool MotionSaliencyBinWangApr2014::init()
   Size imgSize( imageWidth, imageHeight );
   epslonPixelsValue = Mat( imgSize.height, imgSize.width, CV_32F, Scalar( epslonGeneric ) );
   potentialBackground = Mat( imgSize.height, imgSize.width, CV_8UC2, Scalar( 0, 0 ) );
-  backgroundModel.resize( K + 1 );
+  backgroundModelB.resize( K + 1 );
+  backgroundModelC.resize( K + 1 );
 
   for ( int i = 0; i < K + 1; i++ )
   {
-    Mat* tmpm = new Mat;
-    tmpm->create( imgSize.height, imgSize.width, CV_32FC2 );
-    tmpm->setTo( Scalar( std::numeric_limits<float>::quiet_NaN(), 0 ) );
-    Ptr<Mat> tmp = Ptr<Mat>( tmpm );
-    backgroundModel[i] = tmp;
+    backgroundModelB[i].create( imgSize.height, imgSize.width, CV_32F );
+    backgroundModelB[i].setTo( Scalar( std::numeric_limits<float>::quiet_NaN() ) );
+    backgroundModelC[i].create( imgSize.height, imgSize.width, CV_32F );
+    backgroundModelC[i].setTo( Scalar( 0 ) );
   }
 
   noisePixelMask.create( imgSize.height, imgSize.width, CV_8U );
@@ -115,284 +116,296 @@ MotionSaliencyBinWangApr2014::~MotionSaliencyBinWangApr2014()
 }
 
 // classification (and adaptation) functions
-bool MotionSaliencyBinWangApr2014::fullResolutionDetection( const Mat& image2, Mat& highResBFMask )
+bool MotionSaliencyBinWangApr2014::fullResolutionDetection( const Mat& image, Mat& highResBFMask )
 {
-  Mat image = image2.clone();
-
-  uchar currentPixelValue;
-  float currentEpslonValue;
-  bool backgFlag = false;
-
-  // Initially, all pixels are considered as foreground and then we evaluate with the background model
+  const int nTemplates = (int) backgroundModelB.size();
   highResBFMask.create( image.rows, image.cols, CV_8U );
-  highResBFMask.setTo( 1 );
-
-  uchar* pImage;
-  float* pEpslon;
-  uchar* pMask;
 
-  // Scan all pixels of image
-  for ( int i = 0; i < image.rows; i++ )
+  // Every pixel only touches its own template values, so the rows are processed independently
+  parallel_for_( Range( 0, image.rows ), [&]( const Range& range )
   {
+    AutoBuffer<float*> rowB( nTemplates ), rowC( nTemplates );
+    AutoBuffer<float> upperC( nTemplates );
+    for ( int z = 0; z < nTemplates; z++ )
+      upperC[z] = z == 0 ? (float) L0 : z == 1 ? (float) L1 : std::numeric_limits<float>::max();
 
-    pImage = image.ptr<uchar>( i );
-    pEpslon = epslonPixelsValue.ptr<float>( i );
-    pMask = highResBFMask.ptr<uchar>( i );
-    for ( int j = 0; j < image.cols; j++ )
+    for ( int i = range.start; i < range.end; i++ )
     {
-      /*    Pixels with activity greater than Bth are eliminated from the detection result. In this way,
-       continuously blinking noise-pixels will be eliminated from the detection results,
-       preventing the generation of false positives.*/
-      if( activityPixelsValue.at<uchar>( i, j ) < Bth )
+      const uchar* pImage = image.ptr<uchar>( i );
+      const uchar* pActivity = activityPixelsValue.ptr<uchar>( i );
+      const float* pEpslon = epslonPixelsValue.ptr<float>( i );
+      uchar* pMask = highResBFMask.ptr<uchar>( i );
+      for ( int z = 0; z < nTemplates; z++ )
       {
-        backgFlag = false;
-        currentPixelValue = pImage[j];
-        currentEpslonValue = pEpslon[j];
+        rowB[z] = backgroundModelB[z].ptr<float>( i );
+        rowC[z] = backgroundModelC[z].ptr<float>( i );
+      }
 
-        int counter = 0;
-        for ( size_t z = 0; z < backgroundModel.size(); z++ )
-        {
+      int j = 0;
+#if CV_SIMD128
+      const v_float32x4 v_zero = v_setzero_f32(), v_one = v_setall_f32( 1.f );
+      const v_float32x4 v_alpha = v_setall_f32( alpha ), v_beta = v_setall_f32( 1 - alpha );
+      const v_int32x4 v_bth = v_setall_s32( Bth ), v_maskOne = v_setall_s32( 1 );
+      for ( ; j <= image.cols - 8; j += 8 )
+      {
+        v_uint32x4 pix[2], act[2];
+        v_expand( v_load_expand( pImage + j ), pix[0], pix[1] );
+        v_expand( v_load_expand( pActivity + j ), act[0], act[1] );
 
-          counter += (int) backgroundModel[z]->ptr<Vec2f>( i )[j][1];
-          if( counter != 0 )
-            break;
+        v_int32x4 mask[2];
+        for ( int h = 0; h < 2; h++ )
+        {
+          const int jj = j + h * 4;
+          const v_float32x4 x = v_cvt_f32( v_reinterpret_as_s32( pix[h] ) );
+          const v_float32x4 epslon = v_load( pEpslon + jj );
+          // Pixels with activity greater than Bth are eliminated from the detection result
+          const v_float32x4 valid = v_reinterpret_as_f32( v_reinterpret_as_s32( act[h] ) < v_bth );
+          v_float32x4 matched = v_zero;
+
+          for ( int z = 0; z < nTemplates; z++ )
+          {
+            v_float32x4 B = v_load( rowB[z] + jj ), C = v_load( rowC[z] + jj );
+            const v_float32x4 active = valid & ( C > v_zero );
+            // only the first matching template is updated, the other active ones lose efficacy
+            const v_float32x4 match = v_select( matched, v_zero, active & ( v_abs( x - B ) < epslon ) );
+            const v_float32x4 inc = match & ( C < v_setall_f32( upperC[z] ) );
+            const v_float32x4 dec = v_select( match, v_zero, active );
+            C = C + ( inc & v_one ) - ( dec & v_one );
+            B = v_select( match, v_beta * B + v_alpha * x, B );
+            v_store( rowB[z] + jj, B );
+            v_store( rowC[z] + jj, C );
+            matched = matched | match;
+          }
+          mask[h] = v_reinterpret_as_s32( v_select( matched, v_zero, valid ) ) & v_maskOne;
         }
-
-        if( counter != 0 )  //if at least the first template is activated / initialized
+        v_pack_u_store( pMask + j, v_pack( mask[0], mask[1] ) );
+      }
+#endif
+      for ( ; j < image.cols; j++ )
+      {
+        /*    Pixels with activity greater than Bth are eliminated from the detection result. In this way,
+         continuously blinking noise-pixels will be eliminated from the detection results,
+         preventing the generation of false positives.*/
+        if( pActivity[j] >= Bth )
         {
+          pMask[j] = 0;
+          continue;
+        }
 
-          // scan background model vector
-          for ( size_t z = 0; z < backgroundModel.size(); z++ )
+        // Pixels whose model is not yet initialized have no active template and stay foreground
+        const float currentPixelValue = pImage[j];
+        const float currentEpslonValue = pEpslon[j];
+        bool backgFlag = false;
+        for ( int z = 0; z < nTemplates; z++ )
+        {
+          float& currentB = rowB[z][j];
+          float& currentC = rowC[z][j];
+          if( currentC > 0 )  //The current template is active
           {
-            float* currentB;
-            float* currentC;
-            currentB = & ( backgroundModel[z]->ptr<Vec2f>( i )[j][0] );
-            currentC = & ( backgroundModel[z]->ptr<Vec2f>( i )[j][1] );
-
-            //continue;
-            if( ( *currentC ) > 0 )  //The current template is active
+            // If there is a match with a current background template
+            if( !backgFlag && std::abs( currentPixelValue - currentB ) < currentEpslonValue )
             {
-              // If there is a match with a current background template
-              if( abs( currentPixelValue - ( *currentB ) ) < currentEpslonValue && !backgFlag )
-              {
-                // The correspondence pixel in the  BF mask is set as background ( 0 value)
-                pMask[j] = 0;
-                if( ( *currentC < L0 && z == 0 ) || ( *currentC < L1 && z == 1 ) || ( z > 1 ) )
-                {
-                  *currentC += 1;  // increment the efficacy of this template
-                }
-
-                *currentB = ( ( 1 - alpha ) * ( *currentB ) ) + ( alpha * currentPixelValue );  // Update the template value
-                backgFlag = true;
-              }
-              else
+              if( currentC < upperC[z] )
               {
-                *currentC -= 1;  // decrement the efficacy of this template
+                currentC += 1;  // increment the efficacy of this template
               }
 
+              currentB = ( ( 1 - alpha ) * currentB ) + ( alpha * currentPixelValue );  // Update the template value
+              backgFlag = true;
             }
-
-          }  // end "for" cicle of template vector
-
-        }
-        else
-        {
-          pMask[j] = 1;  //if the model of the current pixel is not yet initialized, we mark the pixels as foreground
+            else
+            {
+              currentC -= 1;  // decrement the efficacy of this template
+            }
+          }
         }
-      }
-      else
-      {
-        pMask[j] = 0;
-      }
 
+        // The correspondence pixel in the  BF mask is set as background ( 0 value) if a template matched
+        pMask[j] = backgFlag ? 0 : 1;
+      }
     }
-  }  // end "for" cicle of all image's pixels
+  } );
 
   return true;
 }
 
-bool MotionSaliencyBinWangApr2014::lowResolutionDetection( const Mat& image, Mat& lowResBFMask )
+template<typename T>
+static inline double blockMean( const Mat& m, const Rect& roi )
 {
-  std::vector<Mat> mv;
-  split( *backgroundModel[0], mv );
-
-  //if at least the first template is activated / initialized for all pixels
-  if( countNonZero( mv[1] ) > ( mv[1].cols * mv[1].rows ) / 2 )
+  double sum = 0;
+  for ( int y = roi.y; y < roi.y + roi.height; y++ )
   {
-    float currentPixelValue;
-    float currentEpslonValue;
-    float currentB;
-    float currentC;
+    const T* p = m.ptr<T>( y ) + roi.x;
+    for ( int x = 0; x < roi.width; x++ )
+      sum += p[x];
+  }
+  return sum / roi.area();
+}
 
-    // Create a mask to select ROI in the original Image and Backgound model and at the same time compute the mean
+bool MotionSaliencyBinWangApr2014::lowResolutionDetection( const Mat& image, Mat& lowResBFMask )
+{
+  // Initially, all pixels are considered as foreground and then we evaluate with the background model
+  lowResBFMask.create( image.rows, image.cols, CV_8U );
+  lowResBFMask.setTo( 1 );
 
-    Rect roi( Point( 0, 0 ), Size( N, N ) );
-    Scalar imageROImean;
-    Scalar backGModelROImean;
-    Mat currentModel;
+  //if at least the first template is activated / initialized for all pixels
+  if( countNonZero( backgroundModelC[0] ) <= ( image.cols * image.rows ) / 2 )
+    return false;
 
-    // Initially, all pixels are considered as foreground and then we evaluate with the background model
-    lowResBFMask.create( image.rows, image.cols, CV_8U );
-    lowResBFMask.setTo( 1 );
+  const int blockRows = ( image.rows + N - 1 ) / N, blockCols = ( image.cols + N - 1 ) / N;
+  const int nTemplates = std::min( N_DS, (int) backgroundModelB.size() );
 
-    // Scan all the ROI of original matrices
-    for ( int i = 0; i < (int)ceil( (float) image.rows / N ); i++ )
+  // Scan all the NxN blocks of original matrices, the last row and column of blocks are clipped to the image
+  parallel_for_( Range( 0, blockRows ), [&]( const Range& range )
+  {
+    for ( int bi = range.start; bi < range.end; bi++ )
     {
-      if( ( roi.y + ( N - 1 ) ) <= ( image.rows - 1 ) )
+      for ( int bj = 0; bj < blockCols; bj++ )
       {
-        // Reset original ROI dimension
-        roi = Rect( Point( roi.x, roi.y ), Size( N, N ) );
-      }
+        const Rect roi( bj * N, bi * N, std::min( N, image.cols - bj * N ), std::min( N, image.rows - bi * N ) );
 
-      for ( int j = 0; j < (int)ceil( (float) image.cols / N ); j++ )
-      {
         /* Pixels with activity greater than Bth are eliminated from the detection result. In this way,
          continuously blinking noise-pixels will be eliminated from the detection results,
          preventing the generation of false positives.*/
-        if( activityPixelsValue.at<uchar>( i, j ) < Bth )
+        if( activityPixelsValue.at<uchar>( roi.y, roi.x ) >= Bth )
         {
+          // The correspondence pixel in the  BF mask is set as background ( 0 value)
+          lowResBFMask( roi ).setTo( 0 );
+          continue;
+        }
 
-          // Compute the mean of image's block and epslonMatrix's block based on ROI
-          Mat roiImage = image( roi );
-          Mat roiEpslon = epslonPixelsValue( roi );
-          currentPixelValue = (float) mean( roiImage ).val[0];
-          currentEpslonValue = (float) mean( roiEpslon ).val[0];
+        // Compute the mean of image's block and epslonMatrix's block
+        const float currentPixelValue = (float) blockMean<uchar>( image, roi );
+        const float currentEpslonValue = (float) blockMean<float>( epslonPixelsValue, roi );
 
-          // scan background model vector
-          for ( int z = 0; z < N_DS; z++ )
+        // scan background model vector
+        for ( int z = 0; z < nTemplates; z++ )
+        {
+          const float currentC = (float) blockMean<float>( backgroundModelC[z], roi );
+          if( currentC > 0 )  //The current template is active
           {
-            // Select the current template 2 channel matrix, select ROI and compute the mean for each channel separately
-            Mat roiTemplate = ( * ( backgroundModel[z] ) )( roi );
-            Scalar templateMean = mean( roiTemplate );
-            currentB = (float) templateMean[0];
-            currentC = (float) templateMean[1];
-
-            if( ( currentC ) > 0 )  //The current template is active
+            const float currentB = (float) blockMean<float>( backgroundModelB[z], roi );
+            // If there is a match with a current background template
+            if( std::abs( currentPixelValue - currentB ) < currentEpslonValue )
             {
-              // If there is a match with a current background template
-              if( abs( currentPixelValue - ( currentB ) ) < currentEpslonValue )
-              {
-                // The correspondence pixel in the  BF mask is set as background ( 0 value)
-                rectangle( lowResBFMask, roi, Scalar( 0 ), FILLED );
-                break;
-              }
+              // The correspondence pixel in the  BF mask is set as background ( 0 value)
+              lowResBFMask( roi ).setTo( 0 );
+              break;
             }
           }
-          // Shift the ROI from left to right follow the block dimension
-          roi = roi + Point( N, 0 );
-          if( ( roi.x + ( roi.width - 1 ) ) > ( image.cols - 1 ) && ( roi.y + ( N - 1 ) ) <= ( image.rows - 1 ) )
-          {
-            roi = Rect( Point( roi.x, roi.y ), Size( abs( ( image.cols - 1 ) - roi.x ) + 1, N ) );
-          }
-          else if( ( roi.x + ( roi.width - 1 ) ) > ( image.cols - 1 ) && ( roi.y + ( N - 1 ) ) > ( image.rows - 1 ) )
-          {
-            roi = Rect( Point( roi.x, roi.y ), Size( abs( ( image.cols - 1 ) - roi.x ) + 1, abs( ( image.rows - 1 ) - roi.y ) + 1 ) );
-          }
-        }
-        else
-        {
-          // The correspondence pixel in the  BF mask is set as background ( 0 value)
-          rectangle( lowResBFMask, roi, Scalar( 0 ), FILLED );
         }
       }
-      //Shift the ROI from up to down follow the block dimension, also bringing it back to beginning of row
-      roi.x = 0;
-      roi.y += N;
-      if( ( roi.y + ( roi.height - 1 ) ) > ( image.rows - 1 ) )
-      {
-        roi = Rect( Point( roi.x, roi.y ), Size( N, abs( ( image.rows - 1 ) - roi.y ) + 1 ) );
-      }
-
     }
-    return true;
-  }
-  else
-  {
-    lowResBFMask.create( image.rows, image.cols, CV_8U );
-    lowResBFMask.setTo( 1 );
-    return false;
-  }
-
-}
-
-bool inline pairCompare( std::pair<float, float> t, std::pair<float, float> t_plusOne )
-{
-
-  return ( t.second > t_plusOne.second );
+  } );
 
+  return true;
 }
 
 bool MotionSaliencyBinWangApr2014::templateOrdering()
 {
+  const int nTemplates = (int) backgroundModelB.size();
+  const float thetaLf = (float) thetaL;
 
-  Mat dstMask, tempMat, dstMask2, dstMask3;
-  Mat convertMat1, convertMat2;
-  int backGroundModelSize = (int)backgroundModel.size();
-
-  std::vector<std::vector<Mat> > channelSplit( backGroundModelSize );
-  for ( int i = 0; i < backGroundModelSize; i++ )
+  parallel_for_( Range( 0, backgroundModelB[0].rows ), [&]( const Range& range )
   {
-    split( *backgroundModel[i], channelSplit[i] );
+    AutoBuffer<float*> rowB( nTemplates ), rowC( nTemplates );
+    const int cols = backgroundModelB[0].cols;
 
-  }
-
-  //Bubble sort : Template T1 - Tk
-  for ( int i = 1; i < backGroundModelSize - 1; i++ )
-  {
-    // compare and order the i-th template with the others
-    for ( int j = i + 1; j < backGroundModelSize; j++ )
+    for ( int i = range.start; i < range.end; i++ )
     {
+      for ( int z = 0; z < nTemplates; z++ )
+      {
+        rowB[z] = backgroundModelB[z].ptr<float>( i );
+        rowC[z] = backgroundModelC[z].ptr<float>( i );
+      }
 
-      compare( channelSplit[j][1], channelSplit[i][1], dstMask, CMP_GT );
+      int j = 0;
+#if CV_SIMD128
+      const v_float32x4 v_thetaL = v_setall_f32( thetaLf );
+      for ( ; j <= cols - 4; j += 4 )
+      {
+        //Bubble sort : Template T1 - Tk
+        for ( int a = 1; a < nTemplates - 1; a++ )
+        {
+          for ( int b = a + 1; b < nTemplates; b++ )
+          {
+            const v_float32x4 Ba = v_load( rowB[a] + j ), Bb = v_load( rowB[b] + j );
+            const v_float32x4 Ca = v_load( rowC[a] + j ), Cb = v_load( rowC[b] + j );
+            const v_float32x4 swap = Cb > Ca;
+            v_store( rowB[a] + j, v_select( swap, Bb, Ba ) );
+            v_store( rowB[b] + j, v_select( swap, Ba, Bb ) );
+            v_store( rowC[a] + j, v_select( swap, Cb, Ca ) );
+            v_store( rowC[b] + j, v_select( swap, Ca, Cb ) );
+          }
+        }
 
-      channelSplit[i][0].copyTo( tempMat );
-      channelSplit[j][0].copyTo( channelSplit[i][0], dstMask );
-      tempMat.copyTo( channelSplit[j][0], dstMask );
+        // SORT Template T0 and T1
+        const v_float32x4 B0 = v_load( rowB[0] + j ), B1 = v_load( rowB[1] + j );
+        const v_float32x4 C0 = v_load( rowC[0] + j ), C1 = v_load( rowC[1] + j );
+        const v_float32x4 swap = ( C1 > v_thetaL ) & ( v_thetaL > C0 );
+        v_store( rowB[0] + j, v_select( swap, B1, B0 ) );
+        v_store( rowB[1] + j, v_select( swap, B0, B1 ) );
+        v_store( rowC[1] + j, v_select( swap, C0, C1 ) );
+        v_store( rowC[0] + j, v_select( swap, v_thetaL, C0 ) );
+      }
+#endif
+      for ( ; j < cols; j++ )
+      {
+        //Bubble sort : Template T1 - Tk
+        for ( int a = 1; a < nTemplates - 1; a++ )
+        {
+          for ( int b = a + 1; b < nTemplates; b++ )
+          {
+            if( rowC[b][j] > rowC[a][j] )
+            {
+              std::swap( rowB[a][j], rowB[b][j] );
+              std::swap( rowC[a][j], rowC[b][j] );
+            }
+          }
+        }
 
-      channelSplit[i][1].copyTo( tempMat );
-      channelSplit[j][1].copyTo( channelSplit[i][1], dstMask );
-      tempMat.copyTo( channelSplit[j][1], dstMask );
+        // SORT Template T0 and T1: copy correct B element of T1 inside T0 and swap, the C element of T0 goes
+        // to T1 and the new C0 value is thetaL
+        if( rowC[1][j] > thetaLf && thetaLf > rowC[0][j] )
+        {
+          std::swap( rowB[0][j], rowB[1][j] );
+          rowC[1][j] = rowC[0][j];
+          rowC[0][j] = thetaLf;
+        }
+      }
     }
-  }
-
-  // SORT Template T0 and T1
-  Mat M_deltaL( backgroundModel[0]->rows, backgroundModel[0]->cols, CV_32F, Scalar( thetaL ) );
-
-  compare( channelSplit[1][1], M_deltaL, dstMask2, CMP_GT );
-  compare( M_deltaL, channelSplit[0][1], dstMask3, CMP_GT );
+  } );
 
-  threshold( dstMask2, dstMask2, 0, 1, THRESH_BINARY );
-  threshold( dstMask3, dstMask3, 0, 1, THRESH_BINARY );
-
-  bitwise_and( dstMask2, dstMask3, dstMask );
-
-  //copy correct B element of T1 inside T0 and swap
-  channelSplit[0][0].copyTo( tempMat );
-  channelSplit[1][0].copyTo( channelSplit[0][0], dstMask );
-  tempMat.copyTo( channelSplit[1][0], dstMask );
-
-  //copy correct C element of T0 inside T1
-  channelSplit[0][1].copyTo( channelSplit[1][1], dstMask );
-
-  //set new C0 values as gamma * thetaL
-  M_deltaL.mul( gamma );
-  M_deltaL.copyTo( channelSplit[0][1], dstMask );
+  return true;
+}
 
-  for ( int i = 0; i < backGroundModelSize; i++ )
+/* Check if the value of current pixel BA in potentialBackground model is already contained in at least one of its
+ * neighbors' background model. The neighborhood is the 3x3 window centered in the pixel, clipped to the image,
+ * and the template values are compared as 8-bit values.
+ */
+static bool neighborhoodMatch( const std::vector<Mat>& backgroundModelB, int i, int j, uchar currentBA, float epslon )
+{
+  const int rows = backgroundModelB[0].rows, cols = backgroundModelB[0].cols;
+  const int ithresh = cvFloor( epslon );
+  for ( size_t z = 0; z < backgroundModelB.size(); z++ )
   {
-    merge( channelSplit[i], *backgroundModel[i] );
+    for ( int y = std::max( i - 1, 0 ); y <= std::min( i + 1, rows - 1 ); y++ )
+    {
+      const float* pB = backgroundModelB[z].ptr<float>( y );
+      for ( int x = std::max( j - 1, 0 ); x <= std::min( j + 1, cols - 1 ); x++ )
+      {
+        if( std::abs( (int) saturate_cast<uchar>( pB[x] ) - (int) currentBA ) <= ithresh )
+          return true;
+      }
+    }
   }
-
-  return true;
+  return false;
 }
 
 bool MotionSaliencyBinWangApr2014::templateReplacement( const Mat& finalBFMask, const Mat& image )
 {
-  std::vector<Mat> temp;
-  split( *backgroundModel[0], temp );
-
 //if at least the first template is activated / initialized for all pixels
-  if( countNonZero( temp[1] ) <= ( temp[1].cols * temp[1].rows ) / 2 )
+  if( countNonZero( backgroundModelC[0] ) <= ( finalBFMask.cols * finalBFMask.rows ) / 2 )
   {
     thetaA = 50;
     thetaL = 150;
@@ -408,29 +421,27 @@ bool MotionSaliencyBinWangApr2014::templateReplacement( const Mat& finalBFMask,
     neighborhoodCheck = true;
   }
 
-  int roiSize = 3;  // FIXED ROI SIZE, not change until you first appropriately adjust the following controls in the EVALUATION section!
-  int countNonZeroElements = 0;
-  std::vector<Mat> mv;
-  Mat replicateCurrentBAMat( roiSize, roiSize, CV_8U );
-  Mat backgroundModelROI( roiSize, roiSize, CV_32F );
-  Mat diffResult( roiSize, roiSize, CV_8U );
+  // Pixels whose potential background value replaces the last template. The replacement is applied after all
+  // pixels have been evaluated, so the neighborhood check of every row sees the same background model.
+  replacementMask.create( finalBFMask.rows, finalBFMask.cols, CV_8U );
 
 // Scan all pixels of finalBFMask and all pixels of others models (the dimension are the same)
-  const uchar* finalBFMaskP;
-  Vec2b* pbgP;
-  const uchar* imageP;
-  float* epslonP;
-  for ( int i = 0; i < finalBFMask.rows; i++ )
+  parallel_for_( Range( 0, finalBFMask.rows ), [&]( const Range& range )
   {
-    finalBFMaskP = finalBFMask.ptr<uchar>( i );
-    pbgP = potentialBackground.ptr<Vec2b>( i );
-    imageP = image.ptr<uchar>( i );
-    epslonP = epslonPixelsValue.ptr<float>( i );
-    for ( int j = 0; j < finalBFMask.cols; j++ )
+    for ( int i = range.start; i < range.end; i++ )
     {
-      /////////////////// MAINTENANCE of potentialBackground model ///////////////////
-      if( finalBFMaskP[j] == 1 )  // i.e. the corresponding frame pixel has been market as foreground
+      const uchar* finalBFMaskP = finalBFMask.ptr<uchar>( i );
+      const uchar* imageP = image.ptr<uchar>( i );
+      const float* epslonP = epslonPixelsValue.ptr<float>( i );
+      Vec2b* pbgP = potentialBackground.ptr<Vec2b>( i );
+      uchar* replaceP = replacementMask.ptr<uchar>( i );
+      for ( int j = 0; j < finalBFMask.cols; j++ )
       {
+        replaceP[j] = 0;
+        if( finalBFMaskP[j] != 1 )  // i.e. the corresponding frame pixel has not been market as foreground
+          continue;
+
+        /////////////////// MAINTENANCE of potentialBackground model ///////////////////
         /* For the pixels with CA= 0, if the current frame pixel has been classified as foreground, its value
          * will be loaded into BA and CA will be set to 1*/
         if( pbgP[j][1] == 0 )
@@ -441,7 +452,7 @@ bool MotionSaliencyBinWangApr2014::templateReplacement( const Mat& finalBFMask,
 
         /*the distance between this pixel value and BA is calculated, and if this distance is smaller than
          the decision threshold epslon, then CA is increased by 1, otherwise is decreased by 1*/
-        else if( abs( (float) imageP[j] - pbgP[j][0] ) < epslonP[j] )
+        else if( std::abs( (float) imageP[j] - pbgP[j][0] ) < epslonP[j] )
         {
           pbgP[j][1] += 1;
         }
@@ -449,189 +460,114 @@ bool MotionSaliencyBinWangApr2014::templateReplacement( const Mat& finalBFMask,
         {
           pbgP[j][1] -= 1;
         }
-        /*}*/  /////////////////// END of potentialBackground model MAINTENANCE///////////////////
+        /////////////////// END of potentialBackground model MAINTENANCE///////////////////
+
         /////////////////// EVALUATION of potentialBackground values ///////////////////
         if( pbgP[j][1] > thetaA )
         {
-          if( neighborhoodCheck )
-          {
-            // replicate currentBA value
-            replicateCurrentBAMat.setTo( pbgP[j][0] );
-
-            for ( size_t z = 0; z < backgroundModel.size(); z++ )
-            {
-              // Neighborhood of current pixel in the current background model template.
-              // The ROI is centered in the pixel coordinates
-
-              if( i > 0 && j > 0 && i < ( backgroundModel[z]->rows - 1 ) && j < ( backgroundModel[z]->cols - 1 ) )
-              {
-                split( *backgroundModel[z], mv );
-                backgroundModelROI = mv[0]( Rect( j - (int) floor((float) roiSize / 2 ), i - (int) floor((float) roiSize / 2 ), roiSize, roiSize ) );
-              }
-              else if( i == 0 && j == 0 )  // upper leftt
-              {
-                split( *backgroundModel[z], mv );
-                backgroundModelROI = mv[0]( Rect( j, i, (int) ceil((float) roiSize / 2 ), (int) ceil((float) roiSize / 2 ) ) );
-              }
-              else if( j == 0 && i > 0 && i < ( backgroundModel[z]->rows - 1 ) )  // middle left
-              {
-                split( *backgroundModel[z], mv );
-                backgroundModelROI = mv[0]( Rect( j, i - (int) floor((float) roiSize / 2 ), (int) ceil((float) roiSize / 2 ), roiSize ) );
-              }
-              else if( i == ( backgroundModel[z]->rows - 1 ) && j == 0 )  //down left
-              {
-                split( *backgroundModel[z], mv );
-                backgroundModelROI = mv[0]( Rect( j, i - (int) floor((float) roiSize / 2 ), (int) ceil((float) roiSize / 2 ), (int) ceil((float) roiSize / 2 ) ) );
-              }
-              else if( i == 0 && j > 0 && j < ( backgroundModel[z]->cols - 1 ) )  // upper - middle
-              {
-                split( *backgroundModel[z], mv );
-                backgroundModelROI = mv[0]( Rect( ( j - (int) floor((float) roiSize / 2 ) ), i, roiSize, (int) ceil((float) roiSize / 2 ) ) );
-              }
-              else if( i == ( backgroundModel[z]->rows - 1 ) && j > 0 && j < ( backgroundModel[z]->cols - 1 ) )  //down middle
-              {
-                split( *backgroundModel[z], mv );
-                backgroundModelROI = mv[0](
-                    Rect( j - (int) floor((float) roiSize / 2 ), i - (int) floor((float) roiSize / 2 ), roiSize, (int) ceil((float) roiSize / 2 ) ) );
-              }
-              else if( i == 0 && j == ( backgroundModel[z]->cols - 1 ) )  // upper right
-              {
-                split( *backgroundModel[z], mv );
-                backgroundModelROI = mv[0]( Rect( j - (int) floor((float) roiSize / 2 ), i, (int) ceil((float) roiSize / 2 ), (int) ceil((float) roiSize / 2 ) ) );
-              }
-              else if( j == ( backgroundModel[z]->cols - 1 ) && i > 0 && i < ( backgroundModel[z]->rows - 1 ) )  // middle - right
-              {
-                split( *backgroundModel[z], mv );
-                backgroundModelROI = mv[0](
-                    Rect( j - (int) floor((float) roiSize / 2 ), i - (int) floor((float) roiSize / 2 ), (int) ceil((float) roiSize / 2 ), roiSize ) );
-              }
-              else if( i == ( backgroundModel[z]->rows - 1 ) && j == ( backgroundModel[z]->cols - 1 ) )  // down right
-              {
-                split( *backgroundModel[z], mv );
-                backgroundModelROI = mv[0](
-                    Rect( j - (int) floor((float) roiSize / 2 ), i - (int) floor((float) roiSize / 2 ), (int) ceil((float) roiSize / 2 ), (int) ceil((float) roiSize / 2 ) ) );
-              }
-
-              /* Check if the value of current pixel BA in potentialBackground model is already contained in at least one of its neighbors'
-               * background model
-               */
-              resize( replicateCurrentBAMat, replicateCurrentBAMat, Size( backgroundModelROI.cols, backgroundModelROI.rows ), 0, 0, INTER_LINEAR_EXACT );
-              resize( diffResult, diffResult, Size( backgroundModelROI.cols, backgroundModelROI.rows ), 0, 0, INTER_LINEAR_EXACT );
-
-              backgroundModelROI.convertTo( backgroundModelROI, CV_8U );
-
-              absdiff( replicateCurrentBAMat, backgroundModelROI, diffResult );
-              threshold( diffResult, diffResult, epslonP[j], 255, THRESH_BINARY_INV );
-              countNonZeroElements = countNonZero( diffResult );
-
-              if( countNonZeroElements > 0 )
-              {
-                /////////////////// REPLACEMENT of backgroundModel template ///////////////////
-                //replace TA with current TK
-                backgroundModel[backgroundModel.size() - 1]->at<Vec2f>( i, j ) = potentialBackground.at<Vec2b>( i, j );
-                potentialBackground.at<Vec2b>( i, j )[0] = 0;
-                potentialBackground.at<Vec2b>( i, j )[1] = 0;
-
-                break;
-              }
-            }  // end for backgroundModel size
-          }
-          else
-          {
-            backgroundModel[backgroundModel.size() - 1]->at<Vec2f>( i, j ) = potentialBackground.at<Vec2b>( i, j );
-            potentialBackground.at<Vec2b>( i, j )[0] = 0;
-            potentialBackground.at<Vec2b>( i, j )[1] = 0;
-          }
-        }  // close if of EVALUATION
-      }  // end of  if( finalBFMask.at<uchar>( i, j ) == 1 )  // i.e. the corresponding frame pixel has been market as foreground
+          replaceP[j] = !neighborhoodCheck || neighborhoodMatch( backgroundModelB, i, j, pbgP[j][0], epslonP[j] );
+        }
+      }
+    }
+  } );
 
-    }  // end of second for
-  }  // end of first for
+  /////////////////// REPLACEMENT of backgroundModel template ///////////////////
+  //replace TA with current TK
+  Mat& lastB = backgroundModelB.back();
+  Mat& lastC = backgroundModelC.back();
+  parallel_for_( Range( 0, finalBFMask.rows ), [&]( const Range& range )
+  {
+    for ( int i = range.start; i < range.end; i++ )
+    {
+      const uchar* replaceP = replacementMask.ptr<uchar>( i );
+      Vec2b* pbgP = potentialBackground.ptr<Vec2b>( i );
+      float* pB = lastB.ptr<float>( i );
+      float* pC = lastC.ptr<float>( i );
+      for ( int j = 0; j < finalBFMask.cols; j++ )
+      {
+        if( replaceP[j] )
+        {
+          pB[j] = pbgP[j][0];
+          pC[j] = pbgP[j][1];
+          pbgP[j] = Vec2b( 0, 0 );
+        }
+      }
+    }
+  } );
 
   return true;
 }
 
 bool MotionSaliencyBinWangApr2014::activityControl( const Mat& current_noisePixelsMask )
 {
-  Mat discordanceFramesNoise, not_current_noisePixelsMask;
-  Mat nonZeroIndexes, not_discordanceFramesNoise;  //u_current_noisePixelsMask;
-
-//current_noisePixelsMask.convertTo( u_current_noisePixelsMask, CV_8UC1 );
-
-// Derive the discrepancy between noise in the frame n-1 and frame n
-//threshold( u_current_noisePixelsMask, not_current_noisePixelsMask, 0.5, 1.0, THRESH_BINARY_INV );
-  threshold( current_noisePixelsMask, not_current_noisePixelsMask, 0.5, 1.0, THRESH_BINARY_INV );
-  bitwise_and( noisePixelMask, not_current_noisePixelsMask, discordanceFramesNoise );
-
-// indices in which the pixel at frame n-1 was the noise (or not) and now no (or yes) (blinking pixels)
-  findNonZero( discordanceFramesNoise, nonZeroIndexes );
-
-  Vec2i temp;
-
-// we increase the activity value of these pixels
-  for ( int i = 0; i < nonZeroIndexes.rows; i++ )
+  parallel_for_( Range( 0, activityPixelsValue.rows ), [&]( const Range& range )
   {
-    //TODO check rows, cols inside at
-    temp = nonZeroIndexes.at<Vec2i>( i );
-    if( activityPixelsValue.at<uchar>( temp.val[1], temp.val[0] ) < Bmax )
+    for ( int i = range.start; i < range.end; i++ )
     {
-      activityPixelsValue.at<uchar>( temp.val[1], temp.val[0] ) += Ainc;
-    }
-  }
-
-// decrement other pixels that have not changed (not blinking)
-  threshold( discordanceFramesNoise, not_discordanceFramesNoise, 0.5, 1.0, THRESH_BINARY_INV );
-  findNonZero( not_discordanceFramesNoise, nonZeroIndexes );
-
-  Vec2i temp2;
+      const uchar* pCurrent = current_noisePixelsMask.ptr<uchar>( i );
+      uchar* pNoise = noisePixelMask.ptr<uchar>( i );
+      uchar* pActivity = activityPixelsValue.ptr<uchar>( i );
+      for ( int j = 0; j < activityPixelsValue.cols; j++ )
+      {
+        // pixels which were noise at frame n-1 and are not anymore at frame n (blinking pixels):
+        // we increase the activity value of these pixels
+        if( pNoise[j] && !pCurrent[j] )
+        {
+          if( pActivity[j] < Bmax )
+            pActivity[j] += Ainc;
+        }
+        // decrement other pixels that have not changed (not blinking)
+        else if( pActivity[j] > 0 )
+        {
+          pActivity[j] -= 1;
+        }
 
-  for ( int j = 0; j < nonZeroIndexes.rows; j++ )
-  {
-    temp2 = nonZeroIndexes.at<Vec2i>( j );
-    if( activityPixelsValue.at<uchar>( temp2.val[1], temp2.val[0] ) > 0 )
-    {
-      activityPixelsValue.at<uchar>( temp2.val[1], temp2.val[0] ) -= 1;
+        // update the noisePixelsMask
+        pNoise[j] = pCurrent[j];
+      }
     }
-  }
-// update the noisePixelsMask
-  current_noisePixelsMask.copyTo( noisePixelMask );
+  } );
 
   return true;
 }
 
 bool MotionSaliencyBinWangApr2014::decisionThresholdAdaptation()
 {
-
-  for ( int i = 0; i < activityPixelsValue.rows; i++ )
+  parallel_for_( Range( 0, activityPixelsValue.rows ), [&]( const Range& range )
   {
-    for ( int j = 0; j < activityPixelsValue.cols; j++ )
+    for ( int i = range.start; i < range.end; i++ )
     {
-      if( activityPixelsValue.at<uchar>( i, j ) > Binc && ( epslonPixelsValue.at<float>( i, j ) + deltaINC ) < epslonMAX )
-      {
-
-        epslonPixelsValue.at<float>( i, j ) += deltaINC;
-      }
-      else if( activityPixelsValue.at<uchar>( i, j ) < Bdec && ( epslonPixelsValue.at<float>( i, j ) - deltaDEC ) > epslonMIN )
+      const uchar* pActivity = activityPixelsValue.ptr<uchar>( i );
+      float* pEpslon = epslonPixelsValue.ptr<float>( i );
+      for ( int j = 0; j < activityPixelsValue.cols; j++ )
       {
-        epslonPixelsValue.at<float>( i, j ) -= deltaDEC;
+        if( pActivity[j] > Binc && ( pEpslon[j] + deltaINC ) < epslonMAX )
+        {
+          pEpslon[j] += deltaINC;
+        }
+        else if( pActivity[j] < Bdec && ( pEpslon[j] - deltaDEC ) > epslonMIN )
+        {
+          pEpslon[j] -= deltaDEC;
+        }
       }
     }
-  }
+  } );
 
   return true;
 }
 
-bool MotionSaliencyBinWangApr2014::computeSaliencyImpl( InputArray image, OutputArray saliencyMap )
+bool MotionSaliencyBinWangApr2014::computeSaliencyImpl( InputArray _image, OutputArray saliencyMap )
 {
-  CV_Assert(image.channels() == 1);
+  CV_Assert(_image.channels() == 1);
 
-  Mat highResBFMask, u_highResBFMask;
-  Mat lowResBFMask, u_lowResBFMask;
+  Mat image = _image.getMat();
+  Mat highResBFMask;
+  Mat lowResBFMask;
   Mat not_lowResBFMask;
   Mat current_noisePixelsMask;
 
-  fullResolutionDetection( image.getMat(), highResBFMask );
-  lowResolutionDetection( image.getMat(), lowResBFMask );
+  fullResolutionDetection( image, highResBFMask );
+  lowResolutionDetection( image, lowResBFMask );
 
 // Compute the final background-foreground mask. One pixel is marked as foreground if and only if it is
 // foreground in both masks (full and low)
@@ -649,12 +585,48 @@ bool MotionSaliencyBinWangApr2014::computeSaliencyImpl( InputArray image, Output
   }
 
   templateOrdering();
-  templateReplacement( saliencyMap.getMat(), image.getMat() );
+  templateReplacement( saliencyMap.getMat(), image );
   templateOrdering();
 
   activityControlFlag = true;
   return true;
 }
 
+bool MotionSaliencyBinWangApr2014::computeSaliencyBatch( const std::vector<Ptr<MotionSaliencyBinWangApr2014> >& models,
+                                                         InputArrayOfArrays _images, OutputArrayOfArrays _saliencyMaps )
+{
+  std::vector<Mat> images;
+  _images.getMatVector( images );
+  CV_Assert( images.size() == models.size() );
+
+  const int nStreams = (int) images.size();
+  std::vector<Mat> saliencyMaps( nStreams );
+  std::vector<uchar> results( nStreams, 0 );
+
+  // The streams are independent. With at least one stream per thread each thread processes whole frames,
+  // otherwise the streams are processed in turn and the row loops of each one run in parallel.
+  auto processStreams = [&]( const Range& range )
+  {
+    for ( int s = range.start; s < range.end; s++ )
+    {
+      CV_Assert( !models[s].empty() );
+      results[s] = !images[s].empty() && models[s]->computeSaliencyImpl( images[s], saliencyMaps[s] );
+    }
+  };
+  if( nStreams >= getNumThreads() )
+    parallel_for_( Range( 0, nStreams ), processStreams );
+  else
+    processStreams( Range( 0, nStreams ) );
+
+  _saliencyMaps.create( nStreams, 1, CV_8U, -1, true );
+  bool result = true;
+  for ( int s = 0; s < nStreams; s++ )
+  {
+    _saliencyMaps.getMatRef( s ) = saliencyMaps[s];
+    result = result && results[s] != 0;
+  }
+  return result;
+}
+
 }  // namespace saliency
 }  // namespace cv
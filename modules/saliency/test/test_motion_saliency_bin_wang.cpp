@@ -0,0 +1,309 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+
+#include "test_precomp.hpp"
+
+namespace opencv_test { namespace {
+
+static Ptr<MotionSaliencyBinWangApr2014> createMotionSaliency(const Size& size)
+{
+    Ptr<MotionSaliencyBinWangApr2014> saliencyAlgorithm = MotionSaliencyBinWangApr2014::create();
+    saliencyAlgorithm->setImagesize(size.width, size.height);
+    saliencyAlgorithm->init();
+    return saliencyAlgorithm;
+}
+
+// noisy static background with a bright square moving over it
+static Mat makeFrame(const Size& size, int frame, uint64 seed)
+{
+    Mat img(size, CV_8U, Scalar(60));
+    RNG rng(seed + frame);
+    Mat noise(size, CV_8U);
+    rng.fill(noise, RNG::UNIFORM, 0, 8);
+    img += noise;
+    img(Rect((5 + 2 * frame) % (size.width - 20), size.height / 3, 20, 20)).setTo(Scalar(220));
+    return img;
+}
+
+// Motion saliency as computed before the planar, row-parallel implementation: two-channel (B, C) templates updated
+// pixel by pixel, block means and the neighborhood check done with the core functions. It includes the two behavior
+// changes of that implementation: the template replacement is evaluated on the model as it was before the call, and
+// the low resolution pass reads the activity of the first pixel of each block and always advances to the next block.
+class RefMotionSaliency
+{
+public:
+    explicit RefMotionSaliency(const Size& size) : thetaA(200), thetaL(250), neighborhoodCheck(true), activityControlFlag(false)
+    {
+        epslon = Mat(size, CV_32F, Scalar(20));
+        potentialBackground = Mat(size, CV_8UC2, Scalar(0, 0));
+        for (int z = 0; z < K + 1; z++)
+            model.push_back(Mat(size, CV_32FC2, Scalar(std::numeric_limits<float>::quiet_NaN(), 0)));
+        noise = Mat::zeros(size, CV_8U);
+        activity = Mat::zeros(size, CV_8U);
+    }
+
+    void compute(const Mat& image, Mat& saliencyMap)
+    {
+        Mat highRes, lowRes;
+        fullResolutionDetection(image, highRes);
+        lowResolutionDetection(image, lowRes);
+        bitwise_and(highRes, lowRes, saliencyMap);
+
+        if (activityControlFlag)
+        {
+            Mat notLowRes, currentNoise;
+            threshold(lowRes, notLowRes, 0.5, 1.0, THRESH_BINARY_INV);
+            bitwise_and(highRes, notLowRes, currentNoise);
+            activityControl(currentNoise);
+            decisionThresholdAdaptation();
+        }
+
+        templateOrdering();
+        templateReplacement(saliencyMap, image);
+        templateOrdering();
+        activityControlFlag = true;
+    }
+
+private:
+    static const int N_DS = 2, K = 3, N = 4, L0 = 1000, L1 = 800, Ainc = 6, Bmax = 80, Bth = 20, Binc = 15, Bdec = 5;
+
+    void fullResolutionDetection(const Mat& image, Mat& mask)
+    {
+        const float alpha = 0.01f;
+        mask.create(image.size(), CV_8U);
+        for (int i = 0; i < image.rows; i++)
+            for (int j = 0; j < image.cols; j++)
+            {
+                uchar& m = mask.at<uchar>(i, j);
+                if (activity.at<uchar>(i, j) >= Bth)
+                {
+                    m = 0;
+                    continue;
+                }
+                m = 1;
+                const uchar x = image.at<uchar>(i, j);
+                bool matched = false;
+                for (int z = 0; z < K + 1; z++)
+                {
+                    Vec2f& t = model[z].at<Vec2f>(i, j);
+                    if (t[1] <= 0)
+                        continue;
+                    if (!matched && std::abs(x - t[0]) < epslon.at<float>(i, j))
+                    {
+                        m = 0;
+                        if ((t[1] < L0 && z == 0) || (t[1] < L1 && z == 1) || z > 1)
+                            t[1] += 1;
+                        t[0] = ((1 - alpha) * t[0]) + (alpha * x);
+                        matched = true;
+                    }
+                    else
+                        t[1] -= 1;
+                }
+            }
+    }
+
+    bool firstTemplateActive() const
+    {
+        Mat C0;
+        extractChannel(model[0], C0, 1);
+        return countNonZero(C0) > (int)C0.total() / 2;
+    }
+
+    void lowResolutionDetection(const Mat& image, Mat& mask)
+    {
+        mask.create(image.size(), CV_8U);
+        mask.setTo(1);
+        if (!firstTemplateActive())
+            return;
+        for (int y = 0; y < image.rows; y += N)
+            for (int x = 0; x < image.cols; x += N)
+            {
+                const Rect roi = Rect(x, y, N, N) & Rect(Point(), image.size());
+                if (activity.at<uchar>(y, x) >= Bth)
+                {
+                    mask(roi).setTo(0);
+                    continue;
+                }
+                const float value = (float)mean(image(roi))[0];
+                const float eps = (float)mean(epslon(roi))[0];
+                for (int z = 0; z < N_DS; z++)
+                {
+                    const Scalar t = mean(model[z](roi));
+                    if ((float)t[1] > 0 && std::abs(value - (float)t[0]) < eps)
+                    {
+                        mask(roi).setTo(0);
+                        break;
+                    }
+                }
+            }
+    }
+
+    void templateOrdering()
+    {
+        for (int i = 0; i < epslon.rows; i++)
+            for (int j = 0; j < epslon.cols; j++)
+            {
+                for (int a = 1; a < K; a++)
+                    for (int b = a + 1; b < K + 1; b++)
+                        if (model[b].at<Vec2f>(i, j)[1] > model[a].at<Vec2f>(i, j)[1])
+                            std::swap(model[a].at<Vec2f>(i, j), model[b].at<Vec2f>(i, j));
+
+                Vec2f& t0 = model[0].at<Vec2f>(i, j);
+                Vec2f& t1 = model[1].at<Vec2f>(i, j);
+                if (t1[1] > thetaL && thetaL > t0[1])
+                {
+                    std::swap(t0[0], t1[0]);
+                    t1[1] = t0[1];
+                    t0[1] = (float)thetaL;
+                }
+            }
+    }
+
+    void templateReplacement(const Mat& mask, const Mat& image)
+    {
+        neighborhoodCheck = firstTemplateActive();
+        thetaA = neighborhoodCheck ? 200 : 50;
+        thetaL = neighborhoodCheck ? 250 : 150;
+
+        std::vector<Mat> B(K + 1);
+        for (int z = 0; z < K + 1; z++)
+            extractChannel(model[z], B[z], 0);
+
+        Mat replace = Mat::zeros(mask.size(), CV_8U);
+        for (int i = 0; i < mask.rows; i++)
+            for (int j = 0; j < mask.cols; j++)
+            {
+                if (mask.at<uchar>(i, j) != 1)
+                    continue;
+                Vec2b& pb = potentialBackground.at<Vec2b>(i, j);
+                const float eps = epslon.at<float>(i, j);
+                if (pb[1] == 0)
+                {
+                    pb[0] = image.at<uchar>(i, j);
+                    pb[1] = 1;
+                }
+                else if (std::abs((float)image.at<uchar>(i, j) - pb[0]) < eps)
+                    pb[1] += 1;
+                else
+                    pb[1] -= 1;
+
+                if (pb[1] <= thetaA)
+                    continue;
+                if (!neighborhoodCheck)
+                {
+                    replace.at<uchar>(i, j) = 1;
+                    continue;
+                }
+                const Rect roi = Rect(j - 1, i - 1, 3, 3) & Rect(Point(), mask.size());
+                for (int z = 0; z < K + 1 && !replace.at<uchar>(i, j); z++)
+                {
+                    Mat roi8u, diff;
+                    B[z](roi).convertTo(roi8u, CV_8U);
+                    absdiff(roi8u, Scalar(pb[0]), diff);
+                    threshold(diff, diff, eps, 255, THRESH_BINARY_INV);
+                    replace.at<uchar>(i, j) = countNonZero(diff) > 0;
+                }
+            }
+
+        for (int i = 0; i < mask.rows; i++)
+            for (int j = 0; j < mask.cols; j++)
+                if (replace.at<uchar>(i, j))
+                {
+                    Vec2b& pb = potentialBackground.at<Vec2b>(i, j);
+                    model[K].at<Vec2f>(i, j) = Vec2f(pb[0], pb[1]);
+                    pb = Vec2b(0, 0);
+                }
+    }
+
+    void activityControl(const Mat& currentNoise)
+    {
+        for (int i = 0; i < activity.rows; i++)
+            for (int j = 0; j < activity.cols; j++)
+            {
+                uchar& a = activity.at<uchar>(i, j);
+                if (noise.at<uchar>(i, j) && !currentNoise.at<uchar>(i, j))
+                {
+                    if (a < Bmax)
+                        a += Ainc;
+                }
+                else if (a > 0)
+                    a -= 1;
+            }
+        currentNoise.copyTo(noise);
+    }
+
+    void decisionThresholdAdaptation()
+    {
+        for (int i = 0; i < activity.rows; i++)
+            for (int j = 0; j < activity.cols; j++)
+            {
+                const uchar a = activity.at<uchar>(i, j);
+                float& e = epslon.at<float>(i, j);
+                if (a > Binc && e + 20 < 80)
+                    e += 20;
+                else if (a < Bdec && e - 0.125f > 18)
+                    e -= 0.125f;
+            }
+    }
+
+    int thetaA, thetaL;
+    bool neighborhoodCheck, activityControlFlag;
+    std::vector<Mat> model;
+    Mat potentialBackground, epslon, noise, activity;
+};
+
+TEST(CV_MotionSaliencyBinWangApr2014, matches_reference)
+{
+    // the widths cover the vector loops with a scalar tail, the heights a clipped last row of blocks;
+    // after about 200 frames the background model is initialized and the neighborhood check is used
+    const Size sizes[] = { Size(37, 29), Size(64, 48), Size(50, 21) };
+    const int nFrames = 260;
+    for (size_t s = 0; s < sizeof(sizes)/sizeof(sizes[0]); s++)
+    {
+        Ptr<MotionSaliencyBinWangApr2014> saliencyAlgorithm = createMotionSaliency(sizes[s]);
+        RefMotionSaliency ref(sizes[s]);
+        Mat saliencyMap, refMap;
+        for (int f = 0; f < nFrames; f++)
+        {
+            const Mat frame = makeFrame(sizes[s], f, 77 * s);
+            ASSERT_TRUE(saliencyAlgorithm->computeSaliency(frame, saliencyMap));
+            ref.compute(frame, refMap);
+            ASSERT_EQ(0, cvtest::norm(saliencyMap, refMap, NORM_INF)) << sizes[s] << " frame " << f;
+        }
+        // only the moving square is salient once the background is learned
+        EXPECT_LT(countNonZero(saliencyMap), (int)saliencyMap.total() / 2) << sizes[s];
+    }
+}
+
+TEST(CV_MotionSaliencyBinWangApr2014, batch_matches_single_stream)
+{
+    const Size sizes[] = { Size(97, 61), Size(64, 48), Size(128, 35) };
+    const int nStreams = 3, nFrames = 60;
+
+    std::vector<Ptr<MotionSaliencyBinWangApr2014> > single, batch;
+    for (int s = 0; s < nStreams; s++)
+    {
+        single.push_back(createMotionSaliency(sizes[s]));
+        batch.push_back(createMotionSaliency(sizes[s]));
+    }
+
+    for (int f = 0; f < nFrames; f++)
+    {
+        std::vector<Mat> frames, batchMaps;
+        for (int s = 0; s < nStreams; s++)
+            frames.push_back(makeFrame(sizes[s], f, 1000 * s));
+
+        ASSERT_TRUE(MotionSaliencyBinWangApr2014::computeSaliencyBatch(batch, frames, batchMaps));
+        ASSERT_EQ(nStreams, (int)batchMaps.size());
+        for (int s = 0; s < nStreams; s++)
+        {
+            Mat saliencyMap;
+            ASSERT_TRUE(single[s]->computeSaliency(frames[s], saliencyMap));
+            ASSERT_EQ(CV_8U, batchMaps[s].type());
+            EXPECT_EQ(0, cvtest::norm(saliencyMap, batchMaps[s], NORM_INF)) << "stream " << s << " frame " << f;
+        }
+    }
+}
+
+}} // namespace
@@ -0,0 +1,193 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+
+#include "test_precomp.hpp"
+#include "opencv2/core/utils/filesystem.hpp"
+#include "../src/BING/gradient.hpp"
+
+namespace opencv_test { namespace {
+
+// Gradient magnitude as computed before the fused implementation: full Ix and Iy maps with one-sided
+// differences on the borders (multiplied by edgeMul) and central differences inside (divided by innerDiv),
+// then min(|Ix| + |Iy|, 255)
+static int refDist( const uchar* u, const uchar* v, int cn, bool sumDist )
+{
+    int d = 0;
+    for (int c = 0; c < cn; c++)
+        d = sumDist ? d + std::abs(u[c] - v[c]) : std::max(d, std::abs(u[c] - v[c]));
+    return d;
+}
+
+static void refGradient( const Mat& src, Mat& mag1u, bool sumDist, int edgeMul, int innerDiv )
+{
+    const int H = src.rows, W = src.cols, cn = src.channels();
+    Mat Ix(H, W, CV_32S), Iy(H, W, CV_32S);
+
+    // Left/right most column Ix
+    for (int y = 0; y < H; y++)
+    {
+        const uchar* p = src.ptr<uchar>(y);
+        Ix.at<int>(y, 0) = refDist(p + cn, p, cn, sumDist) * edgeMul;
+        Ix.at<int>(y, W - 1) = refDist(p + (W - 1)*cn, p + (W - 2)*cn, cn, sumDist) * edgeMul;
+    }
+
+    // Top/bottom most row Iy
+    for (int x = 0; x < W; x++)
+    {
+        Iy.at<int>(0, x) = refDist(src.ptr<uchar>(1) + x*cn, src.ptr<uchar>(0) + x*cn, cn, sumDist) * edgeMul;
+        Iy.at<int>(H - 1, x) = refDist(src.ptr<uchar>(H - 1) + x*cn, src.ptr<uchar>(H - 2) + x*cn, cn, sumDist) * edgeMul;
+    }
+
+    // Find the gradient for inner regions
+    for (int y = 0; y < H; y++)
+        for (int x = 1; x < W - 1; x++)
+            Ix.at<int>(y, x) = refDist(src.ptr<uchar>(y) + (x + 1)*cn, src.ptr<uchar>(y) + (x - 1)*cn, cn, sumDist) / innerDiv;
+    for (int y = 1; y < H - 1; y++)
+        for (int x = 0; x < W; x++)
+            Iy.at<int>(y, x) = refDist(src.ptr<uchar>(y + 1) + x*cn, src.ptr<uchar>(y - 1) + x*cn, cn, sumDist) / innerDiv;
+
+    mag1u.create(H, W, CV_8U);
+    for (int y = 0; y < H; y++)
+        for (int x = 0; x < W; x++)
+            mag1u.at<uchar>(y, x) = (uchar)std::min(Ix.at<int>(y, x) + Iy.at<int>(y, x), 255);
+}
+
+static Mat makeTestImage( RNG& rng, Size size )
+{
+    Mat img(size, CV_8UC3);
+    rng.fill(img, RNG::UNIFORM, 0, 64);
+    for (int i = 0; i < 6; i++)
+    {
+        Point center(rng.uniform(0, size.width), rng.uniform(0, size.height));
+        Size axes(rng.uniform(8, size.width / 3), rng.uniform(8, size.height / 3));
+        rectangle(img, center - Point(axes), center + Point(axes),
+                  Scalar(rng.uniform(64, 256), rng.uniform(64, 256), rng.uniform(64, 256)), FILLED);
+    }
+    return img;
+}
+
+TEST(CV_SaliencyBING, gradient_matches_reference)
+{
+    RNG rng(12345);
+    // the widths cover the scalar tail only, and the vector loop with and without a tail
+    const Size sizes[] = { Size(2, 2), Size(5, 4), Size(18, 7), Size(37, 23), Size(64, 48) };
+    for (size_t i = 0; i < sizeof(sizes)/sizeof(sizes[0]); i++)
+    {
+        Mat bgr(sizes[i], CV_8UC3), gray, hsv;
+        rng.fill(bgr, RNG::UNIFORM, 0, 256);
+        cvtColor(bgr, gray, COLOR_BGR2GRAY);
+        cvtColor(bgr, hsv, COLOR_BGR2HSV);
+
+        Mat mag, ref;
+        saliency::gradientMaxBGR(bgr, mag);
+        refGradient(bgr, ref, false, 2, 1);
+        EXPECT_EQ(0, cvtest::norm(mag, ref, NORM_INF)) << "MAXBGR " << sizes[i];
+
+        saliency::gradientGray1u(gray, mag);
+        refGradient(gray, ref, false, 2, 1);
+        EXPECT_EQ(0, cvtest::norm(mag, ref, NORM_INF)) << "gray " << sizes[i];
+
+        saliency::gradientHSV3u(hsv, mag);
+        refGradient(hsv, ref, true, 1, 2);
+        EXPECT_EQ(0, cvtest::norm(mag, ref, NORM_INF)) << "HSV " << sizes[i];
+    }
+}
+
+class CV_SaliencyBINGModel : public testing::Test
+{
+protected:
+    // writes a random model for the 3 color spaces, with all the window sizes active
+    void SetUp() CV_OVERRIDE
+    {
+        modelDir = cv::tempfile("bing");
+        ASSERT_TRUE(cv::utils::fs::createDirectories(modelDir));
+        RNG rng(0);
+        const char* clrNames[] = { "MAXBGR", "HSV", "I" };
+        const int numSizes = 36;
+        for (int clr = 0; clr < 3; clr++)
+        {
+            const std::string name = std::string("ObjNessB2W8") + clrNames[clr];
+            Mat filter(8, 8, CV_32F), idx(numSizes, 1, CV_32S), reW(numSizes, 2, CV_32F);
+            rng.fill(filter, RNG::UNIFORM, -1., 1.);
+            for (int i = 0; i < numSizes; i++)
+            {
+                idx.at<int>(i) = i;
+                reW.at<float>(i, 0) = (float)rng.uniform(0.5, 1.5);
+                reW.at<float>(i, 1) = (float)rng.uniform(-1., 1.);
+            }
+            FileStorage(modelDir + "/" + name + ".wS1.yml.gz", FileStorage::WRITE) << name << filter;
+            FileStorage(modelDir + "/" + name + ".idx.yml.gz", FileStorage::WRITE) << name << idx;
+            FileStorage(modelDir + "/" + name + ".wS2.yml.gz", FileStorage::WRITE) << name << reW;
+        }
+
+        RNG imgRng(42);
+        images.push_back(makeTestImage(imgRng, Size(160, 120)));
+        images.push_back(makeTestImage(imgRng, Size(97, 131)));
+        images.push_back(makeTestImage(imgRng, Size(200, 64)));
+    }
+
+    void TearDown() CV_OVERRIDE
+    {
+        cv::utils::fs::remove_all(modelDir);
+    }
+
+    Ptr<ObjectnessBING> createBING() const
+    {
+        Ptr<ObjectnessBING> bing = makePtr<ObjectnessBING>();
+        bing->setTrainingPath(modelDir);
+        bing->setBBResDir(modelDir + "/results");
+        return bing;
+    }
+
+    std::string modelDir;
+    std::vector<Mat> images;
+};
+
+TEST_F(CV_SaliencyBINGModel, batch_equals_single_image)
+{
+    Ptr<ObjectnessBING> batchBING = createBING();
+    std::vector<std::vector<Vec4i> > batchBoxes;
+    std::vector<std::vector<float> > batchValues;
+    ASSERT_TRUE(batchBING->computeSaliencyBatch(images, batchBoxes, batchValues));
+    ASSERT_EQ(images.size(), batchBoxes.size());
+    ASSERT_EQ(images.size(), batchValues.size());
+
+    for (size_t i = 0; i < images.size(); i++)
+    {
+        Ptr<ObjectnessBING> bing = createBING();
+        std::vector<Vec4i> boxes;
+        ASSERT_TRUE(bing->computeSaliency(images[i], boxes));
+        std::vector<float> values = bing->getobjectnessValues();
+
+        ASSERT_FALSE(boxes.empty()) << "image " << i;
+        ASSERT_EQ(boxes.size(), batchBoxes[i].size()) << "image " << i;
+        ASSERT_EQ(values.size(), batchValues[i].size()) << "image " << i;
+        for (size_t k = 0; k < boxes.size(); k++)
+        {
+            EXPECT_EQ(boxes[k], batchBoxes[i][k]) << "image " << i << ", box " << k;
+            EXPECT_EQ(values[k], batchValues[i][k]) << "image " << i << ", box " << k;
+        }
+    }
+}
+
+TEST_F(CV_SaliencyBINGModel, number_of_threads_does_not_change_results)
+{
+    const int originalThreads = getNumThreads();
+    std::vector<std::vector<Vec4i> > boxes[2];
+    std::vector<std::vector<float> > values[2];
+    for (int run = 0; run < 2; run++)
+    {
+        setNumThreads(run == 0 ? 1 : originalThreads);
+        ASSERT_TRUE(createBING()->computeSaliencyBatch(images, boxes[run], values[run]));
+    }
+    setNumThreads(originalThreads);
+
+    for (size_t i = 0; i < images.size(); i++)
+    {
+        EXPECT_EQ(boxes[0][i], boxes[1][i]) << "image " << i;
+        EXPECT_EQ(values[0][i], values[1][i]) << "image " << i;
+    }
+}
+
+}} // namespace
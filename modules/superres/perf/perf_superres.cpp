@@ -69,6 +69,30 @@ namespace
         Mat frame_;
     };
 
+    // crops of a larger image along a small cyclic camera path, to get non zero motions
+    class MovingFrameSource_CPU : public FrameSource
+    {
+    public:
+        MovingFrameSource_CPU(const Mat& image, const Size& size) : image_(image), size_(size), pos_(0) {}
+
+        void nextFrame(OutputArray frame)
+        {
+            const int dx = pos_ % 8, dy = (pos_ / 2) % 8;
+            ++pos_;
+            image_(Rect(Point(dx, dy), size_)).copyTo(frame);
+        }
+
+        void reset()
+        {
+            pos_ = 0;
+        }
+
+    private:
+        Mat image_;
+        Size size_;
+        int pos_;
+    };
+
     class OneFrameSource_CUDA : public FrameSource
     {
     public:
@@ -170,6 +194,41 @@ PERF_TEST_P(Size_MatType, SuperResolution_BTVL1,
     }
 }
 
+typedef tuple<Size, MatType, int> Size_MatType_Radius_t;
+typedef perf::TestBaseWithParam<Size_MatType_Radius_t> Size_MatType_Radius;
+
+PERF_TEST_P(Size_MatType_Radius, SuperResolution_BTVL1_Farneback,
+            Combine(Values(szVGA, sz720p),
+                    Values(MatType(CV_8UC1), MatType(CV_8UC3)),
+                    Values(1, 4)))
+{
+    declare.time(10 * 60);
+
+    const Size size = get<0>(GetParam());
+    const int type = get<1>(GetParam());
+    const int temporalAreaRadius = get<2>(GetParam());
+
+    Mat image(size + Size(8, 8), type);
+    declare.in(image, WARMUP_RNG);
+    GaussianBlur(image, image, Size(5, 5), 0.0);
+
+    Ptr<SuperResolution> superRes = createSuperResolution_BTVL1();
+
+    superRes->setScale(2);
+    superRes->setIterations(10);
+    superRes->setTemporalAreaRadius(temporalAreaRadius);
+    superRes->setOpticalFlow(createOptFlow_Farneback());
+
+    superRes->setInput(makePtr<MovingFrameSource_CPU>(image, size));
+
+    Mat dst;
+    superRes->nextFrame(dst);
+
+    TEST_CYCLE_N(10) superRes->nextFrame(dst);
+
+    SANITY_CHECK_NOTHING();
+}
+
 #ifdef HAVE_OPENCL
 
 namespace ocl {
@@ -52,6 +52,54 @@ using namespace cv::superres::detail;
 
 namespace
 {
+    // independent work (motion estimation of the next frame) executed inside another parallel loop
+    typedef std::function<void()> SideTask;
+
+    // Runs body over range and the side tasks in one parallel region: the tasks take the first stripes
+    // and the rows are split among the others. Nested parallel loops are serialized, so running the
+    // tasks alongside the rows keeps all the threads busy instead of nesting one loop into the other.
+    void parallelForWithSideTasks(const Range& range, const ParallelLoopBody& body, const std::vector<SideTask>& sideTasks)
+    {
+        if (sideTasks.empty())
+        {
+            parallel_for_(range, body);
+            return;
+        }
+
+        const int ntasks = static_cast<int>(sideTasks.size());
+        const int len = std::max(range.size(), 0);
+        const int nrowStripes = std::min(len, std::max(getNumThreads(), 1) * 4);
+
+        parallel_for_(Range(0, ntasks + nrowStripes), [&](const Range& stripes)
+        {
+            for (int s = stripes.start; s < stripes.end; ++s)
+            {
+                if (s < ntasks)
+                {
+                    sideTasks[s]();
+                    continue;
+                }
+
+                const int i = s - ntasks;
+                const Range rows(range.start + static_cast<int>(static_cast<int64>(len) * i / nrowStripes),
+                                 range.start + static_cast<int>(static_cast<int64>(len) * (i + 1) / nrowStripes));
+                if (rows.start < rows.end)
+                    body(rows);
+            }
+        }, ntasks + nrowStripes);
+    }
+
+    void runSideTasks(const std::vector<SideTask>& sideTasks)
+    {
+        const int ntasks = static_cast<int>(sideTasks.size());
+
+        parallel_for_(Range(0, ntasks), [&](const Range& range)
+        {
+            for (int i = range.start; i < range.end; ++i)
+                sideTasks[i]();
+        }, ntasks);
+    }
+
 #ifdef HAVE_OPENCL
 
     bool ocl_calcRelativeMotions(InputArrayOfArrays _forwardMotions, InputArrayOfArrays _backwardMotions,
@@ -146,6 +194,12 @@ namespace
 
 #endif
 
+    void upscaleMotion(const Mat& lowResMotion, Mat& highResMotion, int scale)
+    {
+        resize(lowResMotion, highResMotion, Size(), scale, scale, INTER_CUBIC);
+        multiply(highResMotion, Scalar::all(scale), highResMotion);
+    }
+
     void upscaleMotions(InputArrayOfArrays _lowResMotions, OutputArrayOfArrays _highResMotions, int scale)
     {
         CV_OCL_RUN(_lowResMotions.isUMatVector() && _highResMotions.isUMatVector(),
@@ -157,10 +211,63 @@ namespace
         highResMotions.resize(lowResMotions.size());
 
         for (size_t i = 0; i < lowResMotions.size(); ++i)
+            upscaleMotion(lowResMotions[i], highResMotions[i], scale);
+    }
+
+    // Builds the motion maps of a temporal window from the upscaled motions between neighbouring frames
+    // (forwardMotions[k]: k -> k + 1, backwardMotions[k]: k -> k - 1). The motions relative to the base
+    // frame are accumulated row by row, which replaces calcRelativeMotions + upscaleMotions + buildMotionMaps
+    // and lets the caller upscale every motion once instead of once per window it belongs to.
+    void accumulateMotionMaps(const std::vector<Mat>& forwardMotions, const std::vector<Mat>& backwardMotions,
+                              int baseIdx, const Size& size, std::vector<Mat>& forwardMaps, std::vector<Mat>& backwardMaps)
+    {
+        const int count = static_cast<int>(forwardMotions.size());
+
+        forwardMaps.resize(count);
+        backwardMaps.resize(count);
+        for (int k = 0; k < count; ++k)
         {
-            resize(lowResMotions[i], highResMotions[i], Size(), scale, scale, INTER_CUBIC);
-            multiply(highResMotions[i], Scalar::all(scale), highResMotions[i]);
+            forwardMaps[k].create(size, CV_32FC2);
+            backwardMaps[k].create(size, CV_32FC2);
         }
+
+        parallel_for_(Range(0, size.height), [&](const Range& range)
+        {
+            std::vector<Point2f> relForward(size.width), relBackward(size.width);
+
+            for (int y = range.start; y < range.end; ++y)
+            {
+                Point2f* forwardBaseRow = forwardMaps[baseIdx].ptr<Point2f>(y);
+                Point2f* backwardBaseRow = backwardMaps[baseIdx].ptr<Point2f>(y);
+                for (int x = 0; x < size.width; ++x)
+                    forwardBaseRow[x] = backwardBaseRow[x] = Point2f(static_cast<float>(x), static_cast<float>(y));
+
+                for (int side = -1; side <= 1; side += 2)
+                {
+                    std::fill(relForward.begin(), relForward.end(), Point2f());
+                    std::fill(relBackward.begin(), relBackward.end(), Point2f());
+
+                    for (int k = baseIdx + side; k >= 0 && k < count; k += side)
+                    {
+                        // moving away from the base frame, the motion of the new link is added to the chain
+                        const Point2f* forwardRow = side < 0 ? forwardMotions[k].ptr<Point2f>(y) : backwardMotions[k].ptr<Point2f>(y);
+                        const Point2f* backwardRow = side < 0 ? backwardMotions[k + 1].ptr<Point2f>(y) : forwardMotions[k - 1].ptr<Point2f>(y);
+                        Point2f* forwardMapRow = forwardMaps[k].ptr<Point2f>(y);
+                        Point2f* backwardMapRow = backwardMaps[k].ptr<Point2f>(y);
+
+                        for (int x = 0; x < size.width; ++x)
+                        {
+                            relForward[x] += forwardRow[x];
+                            relBackward[x] += backwardRow[x];
+
+                            Point2f base(static_cast<float>(x), static_cast<float>(y));
+                            forwardMapRow[x] = base + relBackward[x];
+                            backwardMapRow[x] = base + relForward[x];
+                        }
+                    }
+                }
+            }
+        });
     }
 
 #ifdef HAVE_OPENCL
@@ -240,6 +347,7 @@ namespace
         }
     }
 
+    // upscale() and diffSign() on arrays serve the OpenCL path, the CPU one uses diffSignUpscale()
 #ifdef HAVE_OPENCL
 
     static bool ocl_upscale(InputArray _src, OutputArray _dst, int scale)
@@ -262,7 +370,6 @@ namespace
         return k.run(2, globalsize, NULL, false);
     }
 
-#endif
 
     typedef struct _Point4f { float ar[4]; } Point4f;
 
@@ -285,6 +392,8 @@ namespace
         func(_src, _dst, scale);
     }
 
+#endif
+
     inline float diffSign(float a, float b)
     {
         return a > b ? 1.0f : a < b ? -1.0f : 0.0f;
@@ -320,7 +429,6 @@ namespace
         return k.run(2, globalsize, NULL, false);
     }
 
-#endif
 
     void diffSign(InputArray _src1, OutputArray _src2, OutputArray _dst)
     {
@@ -344,6 +452,36 @@ namespace
         }
     }
 
+#endif
+
+    // diffSign followed by upscale: only the samples of the sparse high resolution image are written,
+    // the rest of dst is zero and is kept from one call to the next
+    void diffSignUpscale(const Mat& src1, const Mat& src2, Mat& dst, int scale)
+    {
+        const Size highResSize(src1.cols * scale, src1.rows * scale);
+        if (dst.size() != highResSize || dst.type() != src1.type())
+        {
+            dst.create(highResSize, src1.type());
+            dst.setTo(Scalar::all(0));
+        }
+
+        const int cn = src1.channels();
+
+        parallel_for_(Range(0, src1.rows), [&](const Range& range)
+        {
+            for (int y = range.start; y < range.end; ++y)
+            {
+                const float * const src1Ptr = src1.ptr<float>(y);
+                const float * const src2Ptr = src2.ptr<float>(y);
+                float* dstPtr = dst.ptr<float>(y * scale);
+
+                for (int x = 0, X = 0; x < src1.cols; ++x, X += scale)
+                    for (int c = 0; c < cn; ++c)
+                        dstPtr[X * cn + c] = diffSign(src1Ptr[x * cn + c], src2Ptr[x * cn + c]);
+            }
+        });
+    }
+
     void calcBtvWeights(int btvKernelSize, double alpha, std::vector<float>& btvWeights)
     {
         const size_t size = btvKernelSize * btvKernelSize;
@@ -397,7 +535,8 @@ namespace
     }
 
     template <typename T>
-    void calcBtvRegularizationImpl(InputArray _src, OutputArray _dst, int btvKernelSize, const std::vector<float>& btvWeights)
+    void calcBtvRegularizationImpl(InputArray _src, OutputArray _dst, int btvKernelSize, const std::vector<float>& btvWeights,
+                                   const std::vector<SideTask>& sideTasks)
     {
         Mat src = _src.getMat();
         _dst.create(src.size(), src.type());
@@ -413,7 +552,7 @@ namespace
         body.ksize = ksize;
         body.btvWeights = &btvWeights[0];
 
-        parallel_for_(Range(ksize, src.rows - ksize), body);
+        parallelForWithSideTasks(Range(ksize, src.rows - ksize), body, sideTasks);
     }
 
 #ifdef HAVE_OPENCL
@@ -443,18 +582,19 @@ namespace
 #endif
 
     void calcBtvRegularization(InputArray _src, OutputArray _dst, int btvKernelSize,
-                               const std::vector<float>& btvWeights, const UMat & ubtvWeights)
+                               const std::vector<float>& btvWeights, const UMat & ubtvWeights,
+                               const std::vector<SideTask>& sideTasks = std::vector<SideTask>())
     {
         CV_OCL_RUN(_dst.isUMat(),
                    ocl_calcBtvRegularization(_src, _dst, btvKernelSize, ubtvWeights))
         CV_UNUSED(ubtvWeights);
         if (_src.channels() == 1)
         {
-            calcBtvRegularizationImpl<float>(_src, _dst, btvKernelSize, btvWeights);
+            calcBtvRegularizationImpl<float>(_src, _dst, btvKernelSize, btvWeights, sideTasks);
         }
         else if (_src.channels() == 3)
         {
-            calcBtvRegularizationImpl<Point3f>(_src, _dst, btvKernelSize, btvWeights);
+            calcBtvRegularizationImpl<Point3f>(_src, _dst, btvKernelSize, btvWeights, sideTasks);
         }
         else
         {
@@ -470,6 +610,11 @@ namespace
         void process(InputArrayOfArrays src, OutputArray dst, InputArrayOfArrays forwardMotions,
                      InputArrayOfArrays backwardMotions, int baseIdx);
 
+        // the iterations of process() on precomputed motion maps, sideTasks run during the first one
+        void processWithMaps(const std::vector<Mat>& src, OutputArray dst, const std::vector<Mat>& forwardMaps,
+                             const std::vector<Mat>& backwardMaps, int baseIdx,
+                             const std::vector<SideTask>& sideTasks = std::vector<SideTask>());
+
         void collectGarbage() CV_OVERRIDE;
 
         inline int getScale() const CV_OVERRIDE { return scale_; }
@@ -494,6 +639,8 @@ namespace
         inline void setOpticalFlow(const Ptr<cv::superres::DenseOpticalFlowExt>& val) CV_OVERRIDE { opticalFlow_ = val; }
 
     protected:
+        void checkParameters() const;
+
         int scale_;
         int iterations_;
         double tau_;
@@ -533,7 +680,7 @@ namespace
         Mat highRes_;
 
         Mat diffTerm_, regTerm_;
-        Mat a_, b_, c_;
+        Mat a_, b_, c_, d_;
 
 #ifdef HAVE_OPENCL
         // UMat
@@ -667,11 +814,8 @@ namespace
 
 #endif
 
-    void BTVL1_Base::process(InputArrayOfArrays _src, OutputArray _dst, InputArrayOfArrays _forwardMotions,
-                             InputArrayOfArrays _backwardMotions, int baseIdx)
+    void BTVL1_Base::checkParameters() const
     {
-        CV_INSTRUMENT_REGION();
-
         CV_Assert( scale_ > 1 );
         CV_Assert( iterations_ > 0 );
         CV_Assert( tau_ > 0.0 );
@@ -679,6 +823,14 @@ namespace
         CV_Assert( btvKernelSize_ > 0 );
         CV_Assert( blurKernelSize_ > 0 );
         CV_Assert( blurSigma_ >= 0.0 );
+    }
+
+    void BTVL1_Base::process(InputArrayOfArrays _src, OutputArray _dst, InputArrayOfArrays _forwardMotions,
+                             InputArrayOfArrays _backwardMotions, int baseIdx)
+    {
+        CV_INSTRUMENT_REGION();
+
+        checkParameters();
 
         CV_OCL_RUN(_src.isUMatVector() && _dst.isUMat() && _forwardMotions.isUMatVector() &&
                    _backwardMotions.isUMatVector(),
@@ -688,6 +840,25 @@ namespace
                 & forwardMotions = *(std::vector<Mat> *)_forwardMotions.getObj(),
                 & backwardMotions = *(std::vector<Mat> *)_backwardMotions.getObj();
 
+        // calc high res motions
+        calcRelativeMotions(forwardMotions, backwardMotions, lowResForwardMotions_, lowResBackwardMotions_, baseIdx, src[0].size());
+
+        upscaleMotions(lowResForwardMotions_, highResForwardMotions_, scale_);
+        upscaleMotions(lowResBackwardMotions_, highResBackwardMotions_, scale_);
+
+        forwardMaps_.resize(highResForwardMotions_.size());
+        backwardMaps_.resize(highResForwardMotions_.size());
+        for (size_t i = 0; i < highResForwardMotions_.size(); ++i)
+            buildMotionMaps(highResForwardMotions_[i], highResBackwardMotions_[i], forwardMaps_[i], backwardMaps_[i]);
+
+        processWithMaps(src, _dst, forwardMaps_, backwardMaps_, baseIdx);
+    }
+
+    void BTVL1_Base::processWithMaps(const std::vector<Mat>& src, OutputArray _dst, const std::vector<Mat>& forwardMaps,
+                                     const std::vector<Mat>& backwardMaps, int baseIdx, const std::vector<SideTask>& sideTasks)
+    {
+        CV_INSTRUMENT_REGION();
+
         // update blur filter and btv weights
         if (blurKernelSize_ != curBlurKernelSize_ || blurSigma_ != curBlurSigma_ || src[0].type() != curSrcType_)
         {
@@ -704,57 +875,51 @@ namespace
             curAlpha_ = alpha_;
         }
 
-        // calc high res motions
-        calcRelativeMotions(forwardMotions, backwardMotions, lowResForwardMotions_, lowResBackwardMotions_, baseIdx, src[0].size());
-
-        upscaleMotions(lowResForwardMotions_, highResForwardMotions_, scale_);
-        upscaleMotions(lowResBackwardMotions_, highResBackwardMotions_, scale_);
-
-        forwardMaps_.resize(highResForwardMotions_.size());
-        backwardMaps_.resize(highResForwardMotions_.size());
-        for (size_t i = 0; i < highResForwardMotions_.size(); ++i)
-            buildMotionMaps(highResForwardMotions_[i], highResBackwardMotions_[i], forwardMaps_[i], backwardMaps_[i]);
-
         // initial estimation
         const Size lowResSize = src[0].size();
         const Size highResSize(lowResSize.width * scale_, lowResSize.height * scale_);
 
         resize(src[baseIdx], highRes_, highResSize, 0, 0, INTER_CUBIC);
 
-        // iterations
+        // iterations, the buffers are only reallocated when the frame size changes
         diffTerm_.create(highResSize, highRes_.type());
         a_.create(highResSize, highRes_.type());
         b_.create(highResSize, highRes_.type());
         c_.create(lowResSize, highRes_.type());
 
+        if (lambda_ <= 0)
+            runSideTasks(sideTasks);
+
         for (int i = 0; i < iterations_; ++i)
         {
-            diffTerm_.setTo(Scalar::all(0));
-
             for (size_t k = 0; k < src.size(); ++k)
             {
                 // a = M * Ih
-                remap(highRes_, a_, backwardMaps_[k], noArray(), INTER_NEAREST);
+                remap(highRes_, a_, backwardMaps[k], noArray(), INTER_NEAREST);
                 // b = HM * Ih
                 GaussianBlur(a_, b_, Size(blurKernelSize_, blurKernelSize_), blurSigma_);
                 // c = DHM * Ih
                 resize(b_, c_, lowResSize, 0, 0, INTER_NEAREST);
 
-                diffSign(src[k], c_, c_);
-
-                // a = Dt * diff
-                upscale(c_, a_, scale_);
+                // d = Dt * diff
+                diffSignUpscale(src[k], c_, d_, scale_);
                 // b = HtDt * diff
-                GaussianBlur(a_, b_, Size(blurKernelSize_, blurKernelSize_), blurSigma_);
-                // a = MtHtDt * diff
-                remap(b_, a_, forwardMaps_[k], noArray(), INTER_NEAREST);
+                GaussianBlur(d_, b_, Size(blurKernelSize_, blurKernelSize_), blurSigma_);
 
-                add(diffTerm_, a_, diffTerm_);
+                // a = MtHtDt * diff, the first term initializes the sum
+                if (k == 0)
+                    remap(b_, diffTerm_, forwardMaps[k], noArray(), INTER_NEAREST);
+                else
+                {
+                    remap(b_, a_, forwardMaps[k], noArray(), INTER_NEAREST);
+                    add(diffTerm_, a_, diffTerm_);
+                }
             }
 
             if (lambda_ > 0)
             {
-                calcBtvRegularization(highRes_, regTerm_, btvKernelSize_, btvWeights_, ubtvWeights_);
+                calcBtvRegularization(highRes_, regTerm_, btvKernelSize_, btvWeights_, ubtvWeights_,
+                                      i == 0 ? sideTasks : std::vector<SideTask>());
                 addWeighted(diffTerm_, 1.0, regTerm_, -lambda_, 0.0, diffTerm_);
             }
 
@@ -784,6 +949,7 @@ namespace
         a_.release();
         b_.release();
         c_.release();
+        d_.release();
 
 #ifdef HAVE_OPENCL
         // UMat
@@ -825,8 +991,9 @@ namespace
     private:
         void readNextFrame(Ptr<FrameSource>& frameSource);
         bool ocl_readNextFrame(Ptr<FrameSource>& frameSource);
+        void queueFrame(int pos, std::vector<SideTask>& tasks);
 
-        void processFrame(int idx);
+        void processFrame(int idx, const std::vector<SideTask>& sideTasks = std::vector<SideTask>());
         bool ocl_processFrame(int idx);
 
         int storePos_;
@@ -847,6 +1014,15 @@ namespace
         std::vector<Mat> srcBackwardMotions_;
         Mat finalOutput_;
 
+        // second instance estimating the backward motions concurrently with the forward ones
+        Ptr<DenseOpticalFlowExt> backwardOpticalFlow_;
+
+        // motions between neighbouring frames upscaled once, when they are estimated
+        std::vector<Mat> upscaledForwardMotions_;
+        std::vector<Mat> upscaledBackwardMotions_;
+        std::vector<Mat> windowForwardMaps_;
+        std::vector<Mat> windowBackwardMaps_;
+
 #ifdef HAVE_OPENCL
         // UMat
         UMat ucurFrame_;
@@ -887,6 +1063,12 @@ namespace
         srcBackwardMotions_.clear();
         finalOutput_.release();
 
+        backwardOpticalFlow_.release();
+        upscaledForwardMotions_.clear();
+        upscaledBackwardMotions_.clear();
+        windowForwardMaps_.clear();
+        windowBackwardMaps_.clear();
+
 #ifdef HAVE_OPENCL
         // UMat
         ucurFrame_.release();
@@ -935,12 +1117,15 @@ namespace
 
     void BTVL1::initImpl(Ptr<FrameSource>& frameSource)
     {
-        const int cacheSize = 2 * temporalAreaRadius_ + 1;
+        // one more slot than the window for the frame read ahead
+        const int cacheSize = 2 * temporalAreaRadius_ + 2;
 
         frames_.resize(cacheSize);
         forwardMotions_.resize(cacheSize);
         backwardMotions_.resize(cacheSize);
         outputs_.resize(cacheSize);
+        upscaledForwardMotions_.resize(cacheSize);
+        upscaledBackwardMotions_.resize(cacheSize);
 
         CV_OCL_RUN(isUmat_,
                    ocl_initImpl(frameSource))
@@ -955,6 +1140,9 @@ namespace
 
         procPos_ = temporalAreaRadius_;
         outPos_ = -1;
+
+        // the frame processImpl() would read first, from now on each call reads the one of the next call
+        readNextFrame(frameSource);
     }
 
 #ifdef HAVE_OPENCL
@@ -979,12 +1167,40 @@ namespace
             return;
         }
 
-        readNextFrame(frameSource);
+        if (isUmat_)
+        {
+            readNextFrame(frameSource);
 
-        if (procPos_ < storePos_)
+            if (procPos_ < storePos_)
+            {
+                ++procPos_;
+                processFrame(procPos_);
+            }
+        }
+        else
         {
-            ++procPos_;
-            processFrame(procPos_);
+            // the window is already complete, the motions of the frame needed by the next call
+            // are estimated while the iterations of the current one run
+            std::vector<SideTask> tasks;
+
+            frameSource->nextFrame(curFrame_);
+            const bool hasNext = !curFrame_.empty();
+            if (hasNext)
+                queueFrame(storePos_ + 1, tasks);
+
+            if (procPos_ < storePos_)
+            {
+                ++procPos_;
+                processFrame(procPos_, tasks);
+            }
+            else
+                runSideTasks(tasks);
+
+            if (hasNext)
+            {
+                curFrame_.copyTo(prevFrame_);
+                ++storePos_;
+            }
         }
         ++outPos_;
 
@@ -1037,15 +1253,50 @@ namespace
         CV_OCL_RUN(isUmat_,
                    ocl_readNextFrame(frameSource))
 
-        curFrame_.convertTo(at(storePos_, frames_), CV_32F);
+        std::vector<SideTask> tasks;
+        queueFrame(storePos_, tasks);
+        runSideTasks(tasks);
 
-        if (storePos_ > 0)
+        curFrame_.copyTo(prevFrame_);
+    }
+
+    void BTVL1::queueFrame(int pos, std::vector<SideTask>& tasks)
+    {
+        curFrame_.convertTo(at(pos, frames_), CV_32F);
+
+        if (pos == 0)
+            return;
+
+        Mat& forwardMotion = at(pos - 1, forwardMotions_);
+        Mat& backwardMotion = at(pos, backwardMotions_);
+        Mat& upscaledForwardMotion = at(pos - 1, upscaledForwardMotions_);
+        Mat& upscaledBackwardMotion = at(pos, upscaledBackwardMotions_);
+        const int scale = scale_;
+
+        syncOpticalFlowCopy(opticalFlow_, backwardOpticalFlow_);
+
+        SideTask forward = [this, &forwardMotion, &upscaledForwardMotion, scale]()
         {
-            opticalFlow_->calc(prevFrame_, curFrame_, at(storePos_ - 1, forwardMotions_));
-            opticalFlow_->calc(curFrame_, prevFrame_, at(storePos_, backwardMotions_));
-        }
+            opticalFlow_->calc(prevFrame_, curFrame_, forwardMotion);
+            upscaleMotion(forwardMotion, upscaledForwardMotion, scale);
+        };
+        Ptr<DenseOpticalFlowExt> backwardFlow = backwardOpticalFlow_ ? backwardOpticalFlow_ : opticalFlow_;
+        SideTask backward = [this, backwardFlow, &backwardMotion, &upscaledBackwardMotion, scale]()
+        {
+            backwardFlow->calc(curFrame_, prevFrame_, backwardMotion);
+            upscaleMotion(backwardMotion, upscaledBackwardMotion, scale);
+        };
 
-        curFrame_.copyTo(prevFrame_);
+        if (backwardOpticalFlow_)
+        {
+            tasks.push_back(forward);
+            tasks.push_back(backward);
+        }
+        else
+        {
+            // the instance can't be shared between threads
+            tasks.push_back([forward, backward]() { forward(); backward(); });
+        }
     }
 
 #ifdef HAVE_OPENCL
@@ -1116,7 +1367,31 @@ namespace
                 srcBackwardMotions_[k] = at(i, backwardMotions_);
         }
 
-        process(srcFrames_, at(idx, outputs_), srcForwardMotions_, srcBackwardMotions_, baseIdx);
+        checkParameters();
+
+        // the motions are upscaled with the scale current when they were estimated
+        const Size highResSize(srcFrames_[0].cols * scale_, srcFrames_[0].rows * scale_);
+        for (int i = startIdx, k = 0; i <= endIdx; ++i, ++k)
+        {
+            if (i < endIdx)
+            {
+                Mat& upscaledForwardMotion = at(i, upscaledForwardMotions_);
+                if (upscaledForwardMotion.size() != highResSize)
+                    upscaleMotion(srcForwardMotions_[k], upscaledForwardMotion, scale_);
+                srcForwardMotions_[k] = upscaledForwardMotion;
+            }
+            if (i > startIdx)
+            {
+                Mat& upscaledBackwardMotion = at(i, upscaledBackwardMotions_);
+                if (upscaledBackwardMotion.size() != highResSize)
+                    upscaleMotion(srcBackwardMotions_[k], upscaledBackwardMotion, scale_);
+                srcBackwardMotions_[k] = upscaledBackwardMotion;
+            }
+        }
+
+        accumulateMotionMaps(srcForwardMotions_, srcBackwardMotions_, baseIdx, highResSize, windowForwardMaps_, windowBackwardMaps_);
+
+        processWithMaps(srcFrames_, at(idx, outputs_), windowForwardMaps_, windowBackwardMaps_, baseIdx, sideTasks);
     }
 }
 
@@ -403,6 +403,45 @@ Ptr<cv::superres::DualTVL1OpticalFlow> cv::superres::createOptFlow_DualTVL1()
     return makePtr<DualTVL1>();
 }
 
+void cv::superres::detail::syncOpticalFlowCopy(const Ptr<DenseOpticalFlowExt>& src, Ptr<DenseOpticalFlowExt>& dst)
+{
+    if (Ptr<Farneback> farneback = src.dynamicCast<Farneback>())
+    {
+        Ptr<Farneback> copy = dst.dynamicCast<Farneback>();
+        if (!copy || copy == farneback)
+            copy = makePtr<Farneback>();
+
+        copy->setPyrScale(farneback->getPyrScale());
+        copy->setLevelsNumber(farneback->getLevelsNumber());
+        copy->setWindowSize(farneback->getWindowSize());
+        copy->setIterations(farneback->getIterations());
+        copy->setPolyN(farneback->getPolyN());
+        copy->setPolySigma(farneback->getPolySigma());
+        copy->setFlags(farneback->getFlags());
+
+        dst = copy;
+    }
+    else if (Ptr<DualTVL1> tvl1 = src.dynamicCast<DualTVL1>())
+    {
+        Ptr<DualTVL1> copy = dst.dynamicCast<DualTVL1>();
+        if (!copy || copy == tvl1)
+            copy = makePtr<DualTVL1>();
+
+        copy->setTau(tvl1->getTau());
+        copy->setLambda(tvl1->getLambda());
+        copy->setTheta(tvl1->getTheta());
+        copy->setScalesNumber(tvl1->getScalesNumber());
+        copy->setWarpingsNumber(tvl1->getWarpingsNumber());
+        copy->setEpsilon(tvl1->getEpsilon());
+        copy->setIterations(tvl1->getIterations());
+        copy->setUseInitialFlow(tvl1->getUseInitialFlow());
+
+        dst = copy;
+    }
+    else
+        dst.release();
+}
+
 ///////////////////////////////////////////////////////////////////
 // GpuOpticalFlow
 
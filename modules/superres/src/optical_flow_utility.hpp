@@ -0,0 +1,24 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+
+#ifndef __OPENCV_SUPERRES_OPTICAL_FLOW_UTILITY_HPP__
+#define __OPENCV_SUPERRES_OPTICAL_FLOW_UTILITY_HPP__
+
+#include "opencv2/superres/optical_flow.hpp"
+
+namespace cv
+{
+    namespace superres
+    {
+        namespace detail
+        {
+            // Makes dst an independent instance of the CPU optical flow src with the same parameters,
+            // so both can run concurrently. dst is reused when it already has the right type and is
+            // released when src can't be duplicated (GPU and user implementations).
+            void syncOpticalFlowCopy(const Ptr<DenseOpticalFlowExt>& src, Ptr<DenseOpticalFlowExt>& dst);
+        }
+    }
+}
+
+#endif // __OPENCV_SUPERRES_OPTICAL_FLOW_UTILITY_HPP__
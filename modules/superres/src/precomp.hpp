@@ -115,6 +115,7 @@
 #include "opencv2/superres.hpp"
 #include "opencv2/superres/optical_flow.hpp"
 #include "input_array_utility.hpp"
+#include "optical_flow_utility.hpp"
 
 #include "ring_buffer.hpp"
 
@@ -76,8 +76,12 @@ struct CV_EXPORTS RansacParams
     float thresh; //!< max error to classify as inlier
     float eps; //!< max outliers ratio
     float prob; //!< probability of success
+    /** if positive, the hypotheses are scored on consecutive blocks of this many points (in random
+    order) and the worse half of them is dropped after each block (preemptive RANSAC), otherwise
+    every hypothesis is scored on all points */
+    int preemptiveBlockSize;
 
-    RansacParams() : size(0), thresh(0), eps(0), prob(0) {}
+    RansacParams() : size(0), thresh(0), eps(0), prob(0), preemptiveBlockSize(0) {}
     /** @brief Constructor
     @param size Subset size.
     @param thresh Maximum re-projection error value to classify as inlier.
@@ -119,7 +123,7 @@ struct CV_EXPORTS RansacParams
 };
 
 inline RansacParams::RansacParams(int _size, float _thresh, float _eps, float _prob)
-    : size(_size), thresh(_thresh), eps(_eps), prob(_prob) {}
+    : size(_size), thresh(_thresh), eps(_eps), prob(_prob), preemptiveBlockSize(0) {}
 
 //! @}
 
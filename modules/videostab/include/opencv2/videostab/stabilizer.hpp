@@ -148,16 +148,31 @@ public:
     void setMotionFilter(Ptr<MotionFilterBase> val) { motionFilter_ = val; }
     Ptr<MotionFilterBase> motionFilter() const { return motionFilter_; }
 
+    /** @brief Enables the pipelined mode, must be set before the first frame is requested.
+
+    The next frame is read (and its blurriness rated) while the motion to the current frame is
+    estimated and the frame radius() positions behind is stabilized (deblurred, warped,
+    inpainted). The output frames are the same as in the sequential mode.
+     */
+    void setPipelined(bool val) { pipelined_ = val; }
+    bool pipelined() const { return pipelined_; }
+
     virtual void reset() CV_OVERRIDE;
-    virtual Mat nextFrame() CV_OVERRIDE { return nextStabilizedFrame(); }
+    virtual Mat nextFrame() CV_OVERRIDE { return pipelined_ ? nextPipelinedFrame() : nextStabilizedFrame(); }
 
 protected:
+    Mat nextPipelinedFrame();
+
     virtual void setUp(const Mat &firstFrame) CV_OVERRIDE;
     virtual Mat estimateMotion() CV_OVERRIDE;
     virtual Mat estimateStabilizationMotion() CV_OVERRIDE;
     virtual Mat postProcessFrame(const Mat &frame) CV_OVERRIDE;
 
     Ptr<MotionFilterBase> motionFilter_;
+
+    bool pipelined_;
+    Mat aheadFrame_; // frame read but not yet put into the frame ring
+    float aheadBlurriness_;
 };
 
 class CV_EXPORTS TwoPassStabilizer : public StabilizerBase, public IFrameSource
@@ -174,11 +189,27 @@ public:
     void setEstimateTrimRatio(bool val) { mustEstTrimRatio_ = val; }
     bool mustEstimateTrimaRatio() const { return mustEstTrimRatio_; }
 
+    /** @brief Sets motion estimators the first pass uses in addition to motionEstimator().
+
+    With N additional estimators the first pass decodes the video in batches of
+    (N + 1)*prePassChunkSize() frames, splits the frame pairs of each batch into N + 1 chunks and
+    estimates the chunks concurrently, each one with its own estimator. The estimators must be
+    configured like motionEstimator() and must not depend on the order of the frame pairs they get.
+     */
+    void setPrePassMotionEstimators(const std::vector<Ptr<ImageMotionEstimatorBase> > &val) { prePassMotionEstimators_ = val; }
+    std::vector<Ptr<ImageMotionEstimatorBase> > prePassMotionEstimators() const { return prePassMotionEstimators_; }
+
+    void setPrePassChunkSize(int val) { prePassChunkSize_ = val; }
+    int prePassChunkSize() const { return prePassChunkSize_; }
+
     virtual void reset() CV_OVERRIDE;
     virtual Mat nextFrame() CV_OVERRIDE;
 
 protected:
     void runPrePassIfNecessary();
+    void estimateMotionsSequentially();
+    void estimateMotionsChunked();
+    void addPrePassMotion(const Mat &prevFrame, const Mat &frame, const Mat &motion, bool ok);
 
     virtual void setUp(const Mat &firstFrame) CV_OVERRIDE;
     virtual Mat estimateMotion() CV_OVERRIDE;
@@ -188,6 +219,8 @@ protected:
     Ptr<IMotionStabilizer> motionStabilizer_;
     Ptr<WobbleSuppressorBase> wobbleSuppressor_;
     bool mustEstTrimRatio_;
+    std::vector<Ptr<ImageMotionEstimatorBase> > prePassMotionEstimators_;
+    int prePassChunkSize_;
 
     int frameCount_;
     bool isPrePassDone_;
@@ -0,0 +1,57 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+#include "perf_precomp.hpp"
+
+namespace opencv_test { namespace {
+
+typedef tuple<int, int, bool> Ransac_Params_t;
+typedef perf::TestBaseWithParam<Ransac_Params_t> videostab_ransac;
+
+// matches between two 1920x1080 frames related by a small similarity, 30% of them outliers
+static void makeMatches(int count, Mat& points0, Mat& points1)
+{
+    RNG& rng = theRNG();
+    const float angle = 0.01f, scale = 1.01f;
+    const float c = scale*std::cos(angle), s = scale*std::sin(angle);
+
+    points0.create(1, count, CV_32FC2);
+    points1.create(1, count, CV_32FC2);
+    for (int i = 0; i < count; i++)
+    {
+        Point2f p0(rng.uniform(0.f, 1920.f), rng.uniform(0.f, 1080.f));
+        Point2f p1(c*p0.x - s*p0.y + 5.f, s*p0.x + c*p0.y - 3.f);
+        if (rng.uniform(0.f, 1.f) < 0.3f)
+            p1 = Point2f(rng.uniform(0.f, 1920.f), rng.uniform(0.f, 1080.f));
+        else
+            p1 += Point2f((float)rng.gaussian(0.2), (float)rng.gaussian(0.2));
+        points0.at<Point2f>(i) = p0;
+        points1.at<Point2f>(i) = p1;
+    }
+}
+
+PERF_TEST_P(videostab_ransac, estimate,
+            testing::Combine(testing::Values((int)MM_TRANSLATION, (int)MM_SIMILARITY, (int)MM_AFFINE),
+                             testing::Values(1000, 10000), testing::Bool()))
+{
+    const MotionModel model = (MotionModel)get<0>(GetParam());
+    const int count = get<1>(GetParam());
+    const bool preemptive = get<2>(GetParam());
+
+    Mat points0, points1;
+    makeMatches(count, points0, points1);
+
+    RansacParams params = RansacParams::default2dMotion(model);
+    if (preemptive)
+        params.preemptiveBlockSize = 100;
+
+    MotionEstimatorRansacL2 estimator(model);
+    estimator.setRansacParams(params);
+
+    Mat M;
+    TEST_CYCLE() M = estimator.estimate(points0, points1);
+
+    SANITY_CHECK_NOTHING();
+}
+
+}} // namespace
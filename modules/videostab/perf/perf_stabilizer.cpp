@@ -0,0 +1,70 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+#include "perf_precomp.hpp"
+
+namespace opencv_test { namespace {
+
+typedef tuple<Size, bool> Stabilizer_Params_t;
+typedef perf::TestBaseWithParam<Stabilizer_Params_t> videostab_stabilizer;
+
+#define STABILIZER_SIZES testing::Values(szHD, sz1080p, sz2160p)
+
+// every cycle stabilizes this many frames: frames/second = FRAME_COUNT / cycle time
+static const int FRAME_COUNT = 10;
+
+class VectorFrameSource : public IFrameSource
+{
+public:
+    VectorFrameSource(const std::vector<Mat> &frames) : frames_(frames), pos_(0) {}
+
+    virtual void reset() CV_OVERRIDE { pos_ = 0; }
+    virtual Mat nextFrame() CV_OVERRIDE { return pos_ < frames_.size() ? frames_[pos_++] : Mat(); }
+
+private:
+    const std::vector<Mat> &frames_;
+    size_t pos_;
+};
+
+// shaky camera panning over a textured scene
+static std::vector<Mat> makeShakyFrames(int count, Size size)
+{
+    RNG& rng = theRNG();
+    Mat scene(size.height + 64, size.width + 64 + 4*count, CV_8UC3);
+    rng.fill(scene, RNG::UNIFORM, Scalar::all(0), Scalar::all(255));
+    GaussianBlur(scene, scene, Size(7, 7), 2.0);
+
+    std::vector<Mat> frames;
+    for (int i = 0; i < count; ++i)
+    {
+        const int x = 32 + 4*i + rng.uniform(-8, 9), y = 32 + rng.uniform(-8, 9);
+        frames.push_back(scene(Rect(x, y, size.width, size.height)).clone());
+    }
+    return frames;
+}
+
+PERF_TEST_P(videostab_stabilizer, one_pass, testing::Combine(STABILIZER_SIZES, testing::Bool()))
+{
+    const Size size = get<0>(GetParam());
+    const bool pipelined = get<1>(GetParam());
+    const std::vector<Mat> frames = makeShakyFrames(FRAME_COUNT, size);
+
+    declare.time(300);
+
+    TEST_CYCLE()
+    {
+        OnePassStabilizer stabilizer;
+        stabilizer.setLog(makePtr<NullLog>());
+        stabilizer.setRadius(4);
+        stabilizer.setMotionFilter(makePtr<GaussianMotionFilter>(4));
+        stabilizer.setTrimRatio(0.05f);
+        stabilizer.setFrameSource(makePtr<VectorFrameSource>(frames));
+        stabilizer.setPipelined(pipelined);
+        while (!stabilizer.nextFrame().empty())
+            ;
+    }
+
+    SANITY_CHECK_NOTHING();
+}
+
+}} // namespace
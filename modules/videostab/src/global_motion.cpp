@@ -45,6 +45,7 @@
 #include "opencv2/videostab/ring_buffer.hpp"
 #include "opencv2/videostab/outlier_rejection.hpp"
 #include "opencv2/opencv_modules.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 #include "clp.hpp"
 
 #include "opencv2/core/private.cuda.hpp"
@@ -145,6 +146,88 @@ static Mat normalizePoints(int npoints, Point2f *points)
 }
 
 
+// number of the points in [begin, end) whose squared error under the affine part of M is below thresh2,
+// if mask is given it receives 255 for the inliers and 0 for the outliers
+static int countInliers(
+        const Mat_<float> &M, const Point2f *points0, const Point2f *points1, int begin, int end,
+        float thresh2, uchar *mask = 0)
+{
+    const float m00 = M(0,0), m01 = M(0,1), m02 = M(0,2);
+    const float m10 = M(1,0), m11 = M(1,1), m12 = M(1,2);
+    int count = 0, i = begin;
+
+#if CV_SIMD128
+    const v_float32x4 vm00 = v_setall_f32(m00), vm01 = v_setall_f32(m01), vm02 = v_setall_f32(m02);
+    const v_float32x4 vm10 = v_setall_f32(m10), vm11 = v_setall_f32(m11), vm12 = v_setall_f32(m12);
+    const v_float32x4 vthresh2 = v_setall_f32(thresh2);
+    v_int32x4 vcount = v_setzero_s32();
+
+    for (; i <= end - v_float32x4::nlanes; i += v_float32x4::nlanes)
+    {
+        v_float32x4 x0, y0, x1, y1;
+        v_load_deinterleave(&points0[i].x, x0, y0);
+        v_load_deinterleave(&points1[i].x, x1, y1);
+        const v_float32x4 dx = vm00*x0 + vm01*y0 + vm02 - x1;
+        const v_float32x4 dy = vm10*x0 + vm11*y0 + vm12 - y1;
+        const v_int32x4 inliers = v_reinterpret_as_s32(dx*dx + dy*dy < vthresh2);
+        vcount -= inliers;
+
+        if (mask)
+        {
+            int flags[v_int32x4::nlanes];
+            v_store(flags, inliers);
+            for (int k = 0; k < v_int32x4::nlanes; ++k)
+                mask[i + k] = flags[k] ? 255 : 0;
+        }
+    }
+    count = v_reduce_sum(vcount);
+#endif
+
+    for (; i < end; ++i)
+    {
+        const float dx = m00*points0[i].x + m01*points0[i].y + m02 - points1[i].x;
+        const float dy = m10*points0[i].x + m11*points0[i].y + m12 - points1[i].y;
+        const bool inlier = dx*dx + dy*dy < thresh2;
+        count += inlier;
+        if (mask)
+            mask[i] = inlier ? 255 : 0;
+    }
+    return count;
+}
+
+
+// root-mean-square error of the points under the affine part of M
+static float affineRmse(const Mat_<float> &M, int npoints, const Point2f *points0, const Point2f *points1)
+{
+    const float m00 = M(0,0), m01 = M(0,1), m02 = M(0,2);
+    const float m10 = M(1,0), m11 = M(1,1), m12 = M(1,2);
+    float sum = 0.f;
+    int i = 0;
+
+#if CV_SIMD128
+    const v_float32x4 vm00 = v_setall_f32(m00), vm01 = v_setall_f32(m01), vm02 = v_setall_f32(m02);
+    const v_float32x4 vm10 = v_setall_f32(m10), vm11 = v_setall_f32(m11), vm12 = v_setall_f32(m12);
+    v_float32x4 vsum = v_setzero_f32();
+
+    for (; i <= npoints - v_float32x4::nlanes; i += v_float32x4::nlanes)
+    {
+        v_float32x4 x0, y0, x1, y1;
+        v_load_deinterleave(&points0[i].x, x0, y0);
+        v_load_deinterleave(&points1[i].x, x1, y1);
+        const v_float32x4 dx = x1 - vm00*x0 - vm01*y0 - vm02;
+        const v_float32x4 dy = y1 - vm10*x0 - vm11*y0 - vm12;
+        vsum += dx*dx + dy*dy;
+    }
+    sum = v_reduce_sum(vsum);
+#endif
+
+    for (; i < npoints; ++i)
+        sum += sqr(points1[i].x - m00*points0[i].x - m01*points0[i].y - m02) +
+               sqr(points1[i].y - m10*points0[i].x - m11*points0[i].y - m12);
+    return std::sqrt(sum / npoints);
+}
+
+
 static Mat estimateGlobMotionLeastSquaresTranslation(
         int npoints, Point2f *points0, Point2f *points1, float *rmse)
 {
@@ -158,13 +241,7 @@ static Mat estimateGlobMotionLeastSquaresTranslation(
     M(1,2) /= npoints;
 
     if (rmse)
-    {
-        *rmse = 0;
-        for (int i = 0; i < npoints; ++i)
-            *rmse += sqr(points1[i].x - points0[i].x - M(0,2)) +
-                     sqr(points1[i].y - points0[i].y - M(1,2));
-        *rmse = std::sqrt(*rmse / npoints);
-    }
+        *rmse = affineRmse(M, npoints, points0, points1);
 
     return std::move(M);
 }
@@ -235,17 +312,7 @@ static Mat estimateGlobMotionLeastSquaresRotation(
     }
 
     if (rmse)
-    {
-        *rmse = 0;
-        for (int i = 0; i < npoints; ++i)
-        {
-            p0 = points0[i];
-            p1 = points1[i];
-            *rmse += sqr(p1.x - M(0,0)*p0.x - M(0,1)*p0.y) +
-                     sqr(p1.y - M(1,0)*p0.x - M(1,1)*p0.y);
-        }
-        *rmse = std::sqrt(*rmse / npoints);
-    }
+        *rmse = affineRmse(M, npoints, points0, points1);
 
     return std::move(M);
 }
@@ -289,17 +356,7 @@ static Mat  estimateGlobMotionLeastSquaresRigid(
     M(1,2) = mean1.y - R(1,0)*mean0.x - R(1,1)*mean0.y;
 
     if (rmse)
-    {
-        *rmse = 0;
-        for (int i = 0; i < npoints; ++i)
-        {
-            pt0 = points0[i];
-            pt1 = points1[i];
-            *rmse += sqr(pt1.x - M(0,0)*pt0.x - M(0,1)*pt0.y - M(0,2)) +
-                     sqr(pt1.y - M(1,0)*pt0.x - M(1,1)*pt0.y - M(1,2));
-        }
-        *rmse = std::sqrt(*rmse / npoints);
-    }
+        *rmse = affineRmse(M, npoints, points0, points1);
 
     return std::move(M);
 }
@@ -406,6 +463,23 @@ Mat estimateGlobalMotionLeastSquares(
 }
 
 
+// scores a hypothesis on all points, gives up (returns -1) as soon as it can't reach minInliers
+static int scoreHypothesis(
+        const Mat_<float> &M, const Point2f *points0, const Point2f *points1, int npoints,
+        float thresh2, int minInliers)
+{
+    const int blockSize = 256;
+    int count = 0;
+    for (int begin = 0; begin < npoints; begin += blockSize)
+    {
+        if (count + npoints - begin < minInliers)
+            return -1;
+        count += countInliers(M, points0, points1, begin, std::min(begin + blockSize, npoints), thresh2);
+    }
+    return count;
+}
+
+
 Mat estimateGlobalMotionRansac(
         InputArray points0, InputArray points1, int model, const RansacParams &params,
         float *rmse, int *ninliers)
@@ -422,63 +496,154 @@ Mat estimateGlobalMotionRansac(
 
     const Point2f *points0_ = points0.getMat().ptr<Point2f>();
     const Point2f *points1_ = points1.getMat().ptr<Point2f>();
-    const int niters = params.niters();
-
-    // current hypothesis
-    std::vector<int> indices(params.size);
-    std::vector<Point2f> subset0(params.size);
-    std::vector<Point2f> subset1(params.size);
-
-    // best hypothesis
-    std::vector<int> bestIndices(params.size);
-
-    Mat_<float> bestM;
-    int ninliersMax = -1;
+    const int niters = std::max(params.niters(), 0);
+    const float thresh2 = params.thresh * params.thresh;
 
+    // the subsets are drawn up front, so the hypotheses don't depend on the evaluation order
+    std::vector<int> indices(niters * params.size);
     RNG rng(0);
-    Point2f p0, p1;
-    float x, y;
 
     for (int iter = 0; iter < niters; ++iter)
     {
+        int *subset = &indices[iter * params.size];
         for (int i = 0; i < params.size; ++i)
         {
             bool ok = false;
             while (!ok)
             {
                 ok = true;
-                indices[i] = static_cast<unsigned>(rng) % npoints;
+                subset[i] = static_cast<unsigned>(rng) % npoints;
                 for (int j = 0; j < i; ++j)
-                    if (indices[i] == indices[j])
+                    if (subset[i] == subset[j])
                         { ok = false; break; }
             }
         }
-        for (int i = 0; i < params.size; ++i)
+    }
+
+    std::vector<Mat_<float> > hypotheses(niters);
+    auto estimateHypotheses = [&](const Range &range)
+    {
+        std::vector<Point2f> subset0(params.size);
+        std::vector<Point2f> subset1(params.size);
+        for (int iter = range.start; iter < range.end; ++iter)
         {
-            subset0[i] = points0_[indices[i]];
-            subset1[i] = points1_[indices[i]];
+            for (int i = 0; i < params.size; ++i)
+            {
+                subset0[i] = points0_[indices[iter * params.size + i]];
+                subset1[i] = points1_[indices[iter * params.size + i]];
+            }
+            hypotheses[iter] = estimateGlobalMotionLeastSquares(subset0, subset1, model, 0);
         }
+    };
+
+    // small problems aren't worth the threading overhead
+    const bool parallel = static_cast<int64>(niters) * npoints >= (1 << 15) && getNumThreads() > 1;
+
+    int best = -1;
+    int ninliersMax = -1;
 
-        Mat_<float> M = estimateGlobalMotionLeastSquares(subset0, subset1, model, 0);
+    if (params.preemptiveBlockSize <= 0)
+    {
+        // The hypotheses are evaluated in parallel batches. A hypothesis which can't reach the
+        // best score of the previous batches couldn't be selected, so its scoring is cut short.
+        // As with the sequential loop the last hypothesis with the most inliers is selected, and
+        // once all points are inliers the refined motion can't change anymore.
+        const int batchSize = parallel ? 2 * getNumThreads() : 1;
+        std::vector<int> scores(niters, -1);
+
+        for (int batchStart = 0; batchStart < niters && ninliersMax < npoints; batchStart += batchSize)
+        {
+            const Range batch(batchStart, std::min(batchStart + batchSize, niters));
+            const int minInliers = ninliersMax;
+            auto evaluate = [&](const Range &range)
+            {
+                estimateHypotheses(range);
+                for (int iter = range.start; iter < range.end; ++iter)
+                    scores[iter] = scoreHypothesis(
+                            hypotheses[iter], points0_, points1_, npoints, thresh2, minInliers);
+            };
+            if (parallel)
+                parallel_for_(batch, evaluate);
+            else
+                evaluate(batch);
+
+            for (int iter = batch.start; iter < batch.end; ++iter)
+            {
+                if (scores[iter] >= ninliersMax)
+                {
+                    best = iter;
+                    ninliersMax = scores[iter];
+                }
+            }
+        }
+    }
+    else
+    {
+        // Preemptive scoring: the points are visited in random order and after each block only the
+        // better half of the hypotheses is kept, ties are resolved in favour of the later hypothesis.
+        std::vector<int> order(npoints);
+        for (int i = 0; i < npoints; ++i)
+            order[i] = i;
+        for (int i = npoints - 1; i > 0; --i)
+            std::swap(order[i], order[rng.uniform(0, i + 1)]);
 
-        int numinliers = 0;
+        std::vector<Point2f> shuffled0(npoints), shuffled1(npoints);
         for (int i = 0; i < npoints; ++i)
         {
-            p0 = points0_[i];
-            p1 = points1_[i];
-            x = M(0,0)*p0.x + M(0,1)*p0.y + M(0,2);
-            y = M(1,0)*p0.x + M(1,1)*p0.y + M(1,2);
-            if (sqr(x - p1.x) + sqr(y - p1.y) < params.thresh * params.thresh)
-                numinliers++;
+            shuffled0[i] = points0_[order[i]];
+            shuffled1[i] = points1_[order[i]];
+        }
+
+        if (parallel)
+            parallel_for_(Range(0, niters), estimateHypotheses);
+        else
+            estimateHypotheses(Range(0, niters));
+
+        std::vector<int> alive(niters), scores(niters, 0);
+        for (int iter = 0; iter < niters; ++iter)
+            alive[iter] = iter;
+
+        for (int blockStart = 0; blockStart < npoints && alive.size() > 1; blockStart += params.preemptiveBlockSize)
+        {
+            const int blockEnd = std::min(blockStart + params.preemptiveBlockSize, npoints);
+            auto evaluate = [&](const Range &range)
+            {
+                for (int k = range.start; k < range.end; ++k)
+                    scores[alive[k]] += countInliers(
+                            hypotheses[alive[k]], &shuffled0[0], &shuffled1[0], blockStart, blockEnd, thresh2);
+            };
+            if (parallel)
+                parallel_for_(Range(0, static_cast<int>(alive.size())), evaluate);
+            else
+                evaluate(Range(0, static_cast<int>(alive.size())));
+
+            std::sort(alive.begin(), alive.end(), [&scores](int a, int b)
+            {
+                return scores[a] != scores[b] ? scores[a] > scores[b] : a > b;
+            });
+            alive.resize(std::max<size_t>(alive.size() / 2, 1));
         }
-        if (numinliers >= ninliersMax)
+
+        if (!alive.empty())
         {
-            bestM = M;
-            ninliersMax = numinliers;
-            bestIndices.swap(indices);
+            best = alive[0];
+            ninliersMax = countInliers(hypotheses[best], points0_, points1_, 0, npoints, thresh2);
         }
     }
 
+    // best hypothesis
+    std::vector<int> bestIndices(params.size, 0);
+    Mat_<float> bestM;
+    if (best >= 0)
+    {
+        std::copy(indices.begin() + best * params.size, indices.begin() + (best + 1) * params.size,
+                  bestIndices.begin());
+        bestM = hypotheses[best];
+    }
+
+    std::vector<Point2f> subset0(params.size);
+    std::vector<Point2f> subset1(params.size);
+
     if (ninliersMax < params.size)
     {
         // compute RMSE
@@ -491,18 +656,17 @@ Mat estimateGlobalMotionRansac(
     }
     else
     {
+        std::vector<uchar> mask(npoints);
+        countInliers(bestM, points0_, points1_, 0, npoints, thresh2, &mask[0]);
+
         subset0.resize(ninliersMax);
         subset1.resize(ninliersMax);
         for (int i = 0, j = 0; i < npoints && j < ninliersMax ; ++i)
         {
-            p0 = points0_[i];
-            p1 = points1_[i];
-            x = bestM(0,0)*p0.x + bestM(0,1)*p0.y + bestM(0,2);
-            y = bestM(1,0)*p0.x + bestM(1,1)*p0.y + bestM(1,2);
-            if (sqr(x - p1.x) + sqr(y - p1.y) < params.thresh * params.thresh)
+            if (mask[i])
             {
-                subset0[j] = p0;
-                subset1[j] = p1;
+                subset0[j] = points0_[i];
+                subset1[j] = points1_[i];
                 j++;
             }
         }
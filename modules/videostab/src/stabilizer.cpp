@@ -256,6 +256,7 @@ void StabilizerBase::logProcessingTime()
 OnePassStabilizer::OnePassStabilizer()
 {
     setMotionFilter(makePtr<GaussianMotionFilter>());
+    setPipelined(false);
     reset();
 }
 
@@ -263,6 +264,92 @@ OnePassStabilizer::OnePassStabilizer()
 void OnePassStabilizer::reset()
 {
     StabilizerBase::reset();
+    aheadFrame_ = Mat();
+    aheadBlurriness_ = 0.f;
+}
+
+
+Mat OnePassStabilizer::nextPipelinedFrame()
+{
+    // Every step is the sequential iteration for the frame read ahead: it is put into the ring,
+    // the motion to it is estimated with estimateMotion() and frame curPos_-radius_ is
+    // stabilized. Meanwhile the following frame is read, which only touches aheadFrame_.
+
+    if (curPos_ == -1)
+    {
+        Mat frame = frameSource_->nextFrame();
+        if (frame.empty())
+        {
+            logProcessingTime();
+            return Mat();
+        }
+
+        curPos_ = 0;
+        setUp(frame);
+        log_->print(".");
+
+        aheadFrame_ = frameSource_->nextFrame();
+        if (doDeblurring_ && !aheadFrame_.empty())
+            aheadBlurriness_ = calcBlurriness(aheadFrame_);
+    }
+
+    // the steps before frame radius_ is read do not stabilize any frame
+    for (;;)
+    {
+        if (!aheadFrame_.empty())
+        {
+            curPos_++;
+            at(curPos_, frames_) = aheadFrame_;
+            if (doDeblurring_)
+                at(curPos_, blurrinessRates_) = aheadBlurriness_;
+
+            const bool doStabilization = curPos_ >= radius_;
+            Mat frame;
+            float blurriness = 0.f;
+            parallel_for_(Range(0, 2), [&](const Range &range)
+            {
+                for (int stage = range.start; stage < range.end; ++stage)
+                {
+                    if (stage == 0)
+                    {
+                        frame = frameSource_->nextFrame();
+                        if (doDeblurring_ && !frame.empty())
+                            blurriness = calcBlurriness(frame);
+                    }
+                    else
+                    {
+                        at(curPos_ - 1, motions_) = estimateMotion();
+                        if (doStabilization)
+                        {
+                            curStabilizedPos_ = curPos_ - radius_;
+                            stabilizeFrame();
+                        }
+                    }
+                }
+            }, 2);
+
+            aheadFrame_ = frame;
+            aheadBlurriness_ = blurriness;
+            log_->print(".");
+
+            if (doStabilization)
+                return postProcessFrame(at(curStabilizedPos_, stabilizedFrames_));
+        }
+        else if (curStabilizedPos_ < curPos_)
+        {
+            curStabilizedPos_++;
+            at(curPos_, motions_) = Mat::eye(3, 3, CV_32F);
+            stabilizeFrame();
+            log_->print(".");
+
+            return postProcessFrame(at(curStabilizedPos_, stabilizedFrames_));
+        }
+        else
+        {
+            logProcessingTime();
+            return Mat();
+        }
+    }
 }
 
 
@@ -314,6 +401,7 @@ TwoPassStabilizer::TwoPassStabilizer()
     setMotionStabilizer(makePtr<GaussianMotionFilter>());
     setWobbleSuppressor(makePtr<NullWobbleSuppressor>());
     setEstimateTrimRatio(false);
+    setPrePassChunkSize(4);
     reset();
 }
 
@@ -382,44 +470,10 @@ void TwoPassStabilizer::runPrePassIfNecessary()
         clock_t startTime = clock();
         log_->print("first pass: estimating motions");
 
-        Mat prevFrame, frame;
-        bool ok = true, ok2 = true;
-
-        while (!(frame = frameSource_->nextFrame()).empty())
-        {
-            if (frameCount_ > 0)
-            {
-                if (maskSource_)
-                    motionEstimator_->setFrameMask(maskSource_->nextFrame());
-
-                motions_.push_back(motionEstimator_->estimate(prevFrame, frame, &ok));
-
-                if (doWobbleSuppression_)
-                {
-                    Mat M = wobbleSuppressor_->motionEstimator()->estimate(prevFrame, frame, &ok2);
-                    if (ok2)
-                        motions2_.push_back(M);
-                    else
-                        motions2_.push_back(motions_.back());
-                }
-
-                if (ok)
-                {
-                    if (ok2) log_->print(".");
-                    else log_->print("?");
-                }
-                else log_->print("x");
-            }
-            else
-            {
-                frameSize_ = frame.size();
-                frameMask_.create(frameSize_, CV_8U);
-                frameMask_.setTo(255);
-            }
-
-            prevFrame = frame;
-            frameCount_++;
-        }
+        if (prePassMotionEstimators_.empty())
+            estimateMotionsSequentially();
+        else
+            estimateMotionsChunked();
 
         clock_t elapsedTime = clock() - startTime;
         log_->print("\nmotion estimation time: %.3f sec\n",
@@ -465,6 +519,134 @@ void TwoPassStabilizer::runPrePassIfNecessary()
 }
 
 
+void TwoPassStabilizer::estimateMotionsSequentially()
+{
+    Mat prevFrame, frame;
+    bool ok = true;
+
+    while (!(frame = frameSource_->nextFrame()).empty())
+    {
+        if (frameCount_ > 0)
+        {
+            if (maskSource_)
+                motionEstimator_->setFrameMask(maskSource_->nextFrame());
+
+            Mat motion = motionEstimator_->estimate(prevFrame, frame, &ok);
+            addPrePassMotion(prevFrame, frame, motion, ok);
+        }
+        else
+        {
+            frameSize_ = frame.size();
+            frameMask_.create(frameSize_, CV_8U);
+            frameMask_.setTo(255);
+        }
+
+        prevFrame = frame;
+        frameCount_++;
+    }
+}
+
+
+void TwoPassStabilizer::estimateMotionsChunked()
+{
+    std::vector<Ptr<ImageMotionEstimatorBase> > estimators(1, motionEstimator_);
+    estimators.insert(estimators.end(), prePassMotionEstimators_.begin(), prePassMotionEstimators_.end());
+    const int nchunks = static_cast<int>(estimators.size());
+    const int chunkSize = std::max(prePassChunkSize_, 1);
+
+    // decoded frames of the current batch, the first one is the last frame of the previous batch
+    std::vector<Mat> frames, masks;
+    std::vector<Mat> motions;
+    std::vector<uchar> oks;
+    bool isSourceDone = false;
+
+    while (!isSourceDone)
+    {
+        while (static_cast<int>(frames.size()) < nchunks*chunkSize + 1)
+        {
+            Mat frame = frameSource_->nextFrame();
+            if (frame.empty())
+            {
+                isSourceDone = true;
+                break;
+            }
+
+            if (frameCount_ > 0)
+            {
+                if (maskSource_)
+                    masks.push_back(maskSource_->nextFrame());
+            }
+            else
+            {
+                frameSize_ = frame.size();
+                frameMask_.create(frameSize_, CV_8U);
+                frameMask_.setTo(255);
+            }
+
+            frames.push_back(frame);
+            frameCount_++;
+        }
+
+        const int npairs = static_cast<int>(frames.size()) - 1;
+        if (npairs <= 0)
+            break;
+
+        // contiguous chunks of frame pairs, each estimated by its own estimator
+        const int pairsPerChunk = (npairs + nchunks - 1) / nchunks;
+        motions.assign(npairs, Mat());
+        oks.assign(npairs, 0);
+
+        parallel_for_(Range(0, nchunks), [&](const Range &range)
+        {
+            for (int chunk = range.start; chunk < range.end; ++chunk)
+            {
+                ImageMotionEstimatorBase &estimator = *estimators[chunk];
+                const int end = std::min((chunk + 1)*pairsPerChunk, npairs);
+                for (int i = chunk*pairsPerChunk; i < end; ++i)
+                {
+                    if (maskSource_)
+                        estimator.setFrameMask(masks[i]);
+
+                    bool ok = true;
+                    motions[i] = estimator.estimate(frames[i], frames[i + 1], &ok);
+                    oks[i] = ok;
+                }
+            }
+        }, nchunks);
+
+        // stitch the chunks in frame order
+        for (int i = 0; i < npairs; ++i)
+            addPrePassMotion(frames[i], frames[i + 1], motions[i], oks[i] != 0);
+
+        frames.erase(frames.begin(), frames.end() - 1);
+        masks.clear();
+    }
+}
+
+
+void TwoPassStabilizer::addPrePassMotion(const Mat &prevFrame, const Mat &frame, const Mat &motion, bool ok)
+{
+    bool ok2 = true;
+    motions_.push_back(motion);
+
+    if (doWobbleSuppression_)
+    {
+        Mat M = wobbleSuppressor_->motionEstimator()->estimate(prevFrame, frame, &ok2);
+        if (ok2)
+            motions2_.push_back(M);
+        else
+            motions2_.push_back(motions_.back());
+    }
+
+    if (ok)
+    {
+        if (ok2) log_->print(".");
+        else log_->print("?");
+    }
+    else log_->print("x");
+}
+
+
 void TwoPassStabilizer::setUp(const Mat &firstFrame)
 {
     int cacheSize = 2*radius_ + 1;
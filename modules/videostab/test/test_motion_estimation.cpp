@@ -21,7 +21,7 @@ void addNoise(cv::Mat points);
 
 cv::Mat generateTransform(const cv::videostab::MotionModel model);
 
-double performTest(const cv::videostab::MotionModel model, int size);
+double performTest(const cv::videostab::MotionModel model, int size, int preemptiveBlockSize = 0);
 
 }
 
@@ -102,11 +102,13 @@ cv::Mat testUtil::generateTransform(const cv::videostab::MotionModel model)
 }
 
 
-double testUtil::performTest(const cv::videostab::MotionModel model, int size)
+double testUtil::performTest(const cv::videostab::MotionModel model, int size, int preemptiveBlockSize)
 {
     cv::Ptr<cv::videostab::MotionEstimatorRansacL2> estimator = cv::makePtr<cv::videostab::MotionEstimatorRansacL2>(model);
 
-    estimator->setRansacParams(cv::videostab::RansacParams(size, 3.f*testUtil::sigma /*3 sigma rule*/, 0.5f, 0.5f));
+    cv::videostab::RansacParams params(size, 3.f*testUtil::sigma /*3 sigma rule*/, 0.5f, 0.5f);
+    params.preemptiveBlockSize = preemptiveBlockSize;
+    estimator->setRansacParams(params);
 
     double disparity = 0.;
 
@@ -172,4 +174,14 @@ TEST(Regression, MM_AFFINE)
     EXPECT_LT(testUtil::performTest(cv::videostab::MM_AFFINE, 6), 9.f);
 }
 
+TEST(Regression, MM_SIMILARITY_preemptive)
+{
+    EXPECT_LT(testUtil::performTest(cv::videostab::MM_SIMILARITY, 4, 8), 7.f);
+}
+
+TEST(Regression, MM_AFFINE_preemptive)
+{
+    EXPECT_LT(testUtil::performTest(cv::videostab::MM_AFFINE, 6, 8), 9.f);
+}
+
 }} // namespace
@@ -33,6 +33,127 @@ private:
     Mat frame_;
 };
 
+class VectorTestSource : public IFrameSource
+{
+public:
+    VectorTestSource(const std::vector<Mat> &frames)
+    {
+        frameNumber_ = 0;
+        frames_ = frames;
+    }
+
+    virtual void reset() CV_OVERRIDE
+    {
+        frameNumber_ = 0;
+    }
+
+    virtual Mat nextFrame() CV_OVERRIDE
+    {
+        return (frameNumber_ < frames_.size()) ? frames_[frameNumber_++].clone() : Mat();
+    }
+
+private:
+    size_t frameNumber_;
+    std::vector<Mat> frames_;
+};
+
+// shaky camera panning over a textured scene
+static std::vector<Mat> makeShakyFrames(int count, Size size)
+{
+    RNG rng(0);
+    Mat scene(size.height + 64, size.width + 64 + 2*count, CV_8UC3);
+    rng.fill(scene, RNG::UNIFORM, Scalar::all(0), Scalar::all(255));
+    GaussianBlur(scene, scene, Size(5, 5), 1.5);
+
+    std::vector<Mat> frames;
+    for (int i = 0; i < count; ++i)
+    {
+        const int x = 32 + 2*i + rng.uniform(-4, 5), y = 32 + rng.uniform(-4, 5);
+        frames.push_back(scene(Rect(x, y, size.width, size.height)).clone());
+    }
+    return frames;
+}
+
+TEST(OnePassStabilizer, pipelined)
+{
+    const std::vector<Mat> frames = makeShakyFrames(25, Size(160, 120));
+
+    for (int radius = 1; radius <= 8; radius += 7)
+    {
+        std::vector<Mat> results[2];
+        for (int pipelined = 0; pipelined < 2; ++pipelined)
+        {
+            OnePassStabilizer stabilizer;
+            stabilizer.setLog(makePtr<NullLog>());
+            stabilizer.setRadius(radius);
+            stabilizer.setTrimRatio(0.1f);
+            stabilizer.setFrameSource(makePtr<VectorTestSource>(frames));
+            stabilizer.setMotionFilter(makePtr<GaussianMotionFilter>(radius));
+
+            Ptr<WeightingDeblurer> deblurer = makePtr<WeightingDeblurer>();
+            deblurer->setRadius(radius);
+            stabilizer.setDeblurer(deblurer);
+
+            Ptr<ConsistentMosaicInpainter> inpainter = makePtr<ConsistentMosaicInpainter>();
+            inpainter->setRadius(radius);
+            stabilizer.setInpainter(inpainter);
+            stabilizer.setPipelined(pipelined != 0);
+
+            Mat frame;
+            while (!(frame = stabilizer.nextFrame()).empty())
+                results[pipelined].push_back(frame.clone());
+            EXPECT_TRUE(stabilizer.nextFrame().empty());
+        }
+
+        ASSERT_EQ(frames.size(), results[0].size());
+        ASSERT_EQ(results[0].size(), results[1].size());
+        for (size_t i = 0; i < results[0].size(); ++i)
+            EXPECT_MAT_NEAR(results[0][i], results[1][i], 0) << "radius " << radius << ", frame " << i;
+    }
+}
+
+// replaces the motion estimation, the pipelined mode must go through it too
+class IdentityMotionStabilizer : public OnePassStabilizer
+{
+public:
+    IdentityMotionStabilizer() : calls(0) {}
+
+    int calls;
+
+protected:
+    virtual Mat estimateMotion() CV_OVERRIDE
+    {
+        ++calls;
+        return Mat::eye(3, 3, CV_32F);
+    }
+};
+
+TEST(OnePassStabilizer, pipelined_estimateMotion_override)
+{
+    const std::vector<Mat> frames = makeShakyFrames(10, Size(160, 120));
+
+    for (int pipelined = 0; pipelined < 2; ++pipelined)
+    {
+        IdentityMotionStabilizer stabilizer;
+        stabilizer.setLog(makePtr<NullLog>());
+        stabilizer.setRadius(3);
+        stabilizer.setFrameSource(makePtr<VectorTestSource>(frames));
+        stabilizer.setPipelined(pipelined != 0);
+
+        // with identity motions the frames come out unchanged
+        size_t count = 0;
+        Mat frame;
+        while (!(frame = stabilizer.nextFrame()).empty())
+        {
+            ASSERT_LT(count, frames.size());
+            EXPECT_MAT_NEAR(frames[count], frame, 0) << "pipelined " << pipelined << ", frame " << count;
+            count++;
+        }
+        EXPECT_EQ(frames.size(), count);
+        EXPECT_EQ((int)frames.size() - 1, stabilizer.calls) << "pipelined " << pipelined;
+    }
+}
+
 TEST(OnePassStabilizer, oneFrame)
 {
     Mat frame(2, 3, CV_8UC3);
@@ -65,6 +186,38 @@ TEST(OnePassStabilizer, oneFrame_deblur)
     EXPECT_TRUE(stabilizer.nextFrame().empty());
 }
 
+TEST(TwoPassStabilizer, chunkedPrePass)
+{
+    const std::vector<Mat> frames = makeShakyFrames(25, Size(160, 120));
+
+    std::vector<Mat> results[2];
+    for (int chunked = 0; chunked < 2; ++chunked)
+    {
+        TwoPassStabilizer stabilizer;
+        stabilizer.setLog(makePtr<NullLog>());
+        stabilizer.setRadius(5);
+        stabilizer.setMotionStabilizer(makePtr<GaussianMotionFilter>(5));
+        stabilizer.setFrameSource(makePtr<VectorTestSource>(frames));
+        if (chunked)
+        {
+            std::vector<Ptr<ImageMotionEstimatorBase> > estimators;
+            for (int i = 0; i < 2; ++i)
+                estimators.push_back(makePtr<KeypointBasedMotionEstimator>(makePtr<MotionEstimatorRansacL2>()));
+            stabilizer.setPrePassMotionEstimators(estimators);
+            stabilizer.setPrePassChunkSize(3);
+        }
+
+        Mat frame;
+        while (!(frame = stabilizer.nextFrame()).empty())
+            results[chunked].push_back(frame.clone());
+    }
+
+    ASSERT_EQ(frames.size(), results[0].size());
+    ASSERT_EQ(results[0].size(), results[1].size());
+    for (size_t i = 0; i < results[0].size(); ++i)
+        EXPECT_MAT_NEAR(results[0][i], results[1][i], 0) << "frame " << i;
+}
+
 TEST(TwoPassStabilizer, oneFrame)
 {
     Mat frame(2, 3, CV_8UC3);
@@ -39,6 +39,8 @@ the use of this software, even if advised of the possibility of such damage.
 #ifndef __OPENCV_XFEATURES2D_HPP__
 #define __OPENCV_XFEATURES2D_HPP__
 
+#include <functional>
+
 #include "opencv2/features2d.hpp"
 #include "opencv2/xfeatures2d/nonfree.hpp"
 
@@ -318,6 +320,22 @@ public:
      */
     virtual void compute( InputArray image, OutputArray descriptors ) = 0;
 
+    /** @brief Receives the dense descriptors of one horizontal band of the image.
+     * @param band image region covered by the band, always spanning the full image width
+     * @param descriptors descriptors of the band pixels in row-major order, valid only during the call
+     */
+    typedef std::function<void(const Rect& band, const Mat& descriptors)> BandCallback;
+
+    /** @overload
+     * Computes the descriptors for all image pixels band by band, so the working memory stays bounded
+     * for very large images. Each band is processed with the halo the smoothing and sampling need,
+     * so the results are the same as the ones of compute( image, descriptors ).
+     * @param image image to extract descriptors
+     * @param callback function receiving the descriptors of every band, in top to bottom order
+     * @param maxBufferSize approximate upper bound in bytes of the memory used for one band
+     */
+    virtual void compute( InputArray image, const BandCallback& callback, size_t maxBufferSize = 256 << 20 ) = 0;
+
     /**
      * @param y position y on image
      * @param x position x on image
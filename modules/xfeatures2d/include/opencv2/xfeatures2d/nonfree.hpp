@@ -109,6 +109,15 @@ public:
 
     CV_WRAP virtual void setUpright(bool upright) = 0;
     CV_WRAP virtual bool getUpright() const = 0;
+
+    /** @brief Limits the detector to the maxKeypoints strongest keypoints, 0 (default) keeps all of them.
+
+    The limit is applied while the maxima are searched: once enough keypoints are found in a layer,
+    the threshold of that layer rises to the response of the weakest one kept, so a low hessianThreshold
+    does not cost a second detection pass nor a large intermediate keypoint list.
+    */
+    CV_WRAP virtual void setMaxKeypoints(int maxKeypoints) = 0;
+    CV_WRAP virtual int getMaxKeypoints() const = 0;
 };
 
 typedef SURF SurfFeatureDetector;
@@ -0,0 +1,80 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+#include "perf_precomp.hpp"
+
+namespace opencv_test { namespace {
+
+typedef perf::TestBaseWithParam<int> binary_descriptors;
+
+#define KEYPOINT_COUNTS 5000, 20000, 100000
+
+static void makeRandomKeypoints(const Size& sz, int count, vector<KeyPoint>& points)
+{
+    const int border = 64;
+    RNG& rng = theRNG();
+    points.resize(count);
+    for (int i = 0; i < count; i++)
+    {
+        points[i] = KeyPoint(rng.uniform((float)border, (float)(sz.width - border)),
+                             rng.uniform((float)border, (float)(sz.height - border)),
+                             rng.uniform(7.f, 30.f), rng.uniform(0.f, 360.f));
+    }
+}
+
+PERF_TEST_P(binary_descriptors, freak, testing::Values(KEYPOINT_COUNTS))
+{
+    Mat frame(1080, 1920, CV_8UC1);
+    declare.in(frame, WARMUP_RNG).time(90);
+
+    vector<KeyPoint> points;
+    makeRandomKeypoints(frame.size(), GetParam(), points);
+
+    Ptr<FREAK> descriptor = FREAK::create();
+    Mat descriptors;
+    vector<KeyPoint> kpts;
+    TEST_CYCLE()
+    {
+        kpts = points;
+        descriptor->compute(frame, kpts, descriptors);
+    }
+
+    SANITY_CHECK_NOTHING();
+}
+
+PERF_TEST_P(binary_descriptors, latch, testing::Values(KEYPOINT_COUNTS))
+{
+    Mat frame(1080, 1920, CV_8UC1);
+    declare.in(frame, WARMUP_RNG).time(90);
+
+    vector<KeyPoint> points;
+    makeRandomKeypoints(frame.size(), GetParam(), points);
+
+    Ptr<LATCH> descriptor = LATCH::create();
+    Mat descriptors;
+    vector<KeyPoint> kpts;
+    TEST_CYCLE()
+    {
+        kpts = points;
+        descriptor->compute(frame, kpts, descriptors);
+    }
+
+    SANITY_CHECK_NOTHING();
+}
+
+PERF_TEST_P(binary_descriptors, lucid, testing::Values(KEYPOINT_COUNTS))
+{
+    Mat frame(1080, 1920, CV_8UC3);
+    declare.in(frame, WARMUP_RNG).time(90);
+
+    vector<KeyPoint> points;
+    makeRandomKeypoints(frame.size(), GetParam(), points);
+
+    Ptr<LUCID> descriptor = LUCID::create();
+    Mat descriptors;
+    TEST_CYCLE() descriptor->compute(frame, points, descriptors);
+
+    SANITY_CHECK_NOTHING();
+}
+
+}} // namespace
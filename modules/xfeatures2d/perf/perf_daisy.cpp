@@ -30,4 +30,22 @@ PERF_TEST_P(daisy, extract, testing::Values(DAISY_IMAGES))
     SANITY_CHECK_NOTHING();
 }
 
+PERF_TEST_P(daisy, extract_bands, testing::Values(DAISY_IMAGES))
+{
+    string filename = getDataPath(GetParam());
+    Mat frame = imread(filename, IMREAD_GRAYSCALE);
+    ASSERT_FALSE(frame.empty()) << "Unable to load source image " << filename;
+
+    declare.in(frame).time(90);
+
+    Ptr<DAISY> descriptor = DAISY::create();
+
+    // bands of at most 64 MB, descriptors are consumed and dropped
+    size_t count = 0;
+    TEST_CYCLE() descriptor->compute(frame, [&](const Rect&, const Mat& descriptors) { count += descriptors.rows; },
+                                     (size_t)64 << 20);
+
+    SANITY_CHECK_NOTHING();
+}
+
 }} // namespace
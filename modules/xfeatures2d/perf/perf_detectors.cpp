@@ -0,0 +1,68 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+#include "perf_precomp.hpp"
+
+namespace opencv_test { namespace {
+
+typedef tuple<std::string, Size> Detector_Image_t;
+typedef perf::TestBaseWithParam<Detector_Image_t> xfeatures2d_detectors;
+
+#define DETECTOR_IMAGES \
+    testing::Values("cv/detectors_descriptors_evaluation/images_datasets/leuven/img1.png", "stitching/a3.png")
+// original size and a 12 MP upscale
+#define DETECTOR_SIZES \
+    testing::Values(Size(0, 0), Size(4000, 3000))
+
+static Mat loadDetectorImage(const Detector_Image_t& param)
+{
+    string filename = TestBase::getDataPath(get<0>(param));
+    Mat frame = imread(filename, IMREAD_GRAYSCALE);
+    if (!frame.empty() && get<1>(param).area() > 0)
+        resize(frame, frame, get<1>(param), 0, 0, INTER_LINEAR);
+    return frame;
+}
+
+PERF_TEST_P(xfeatures2d_detectors, harris_laplace, testing::Combine(DETECTOR_IMAGES, DETECTOR_SIZES))
+{
+    Mat frame = loadDetectorImage(GetParam());
+    ASSERT_FALSE(frame.empty()) << "Unable to load source image " << get<0>(GetParam());
+
+    declare.in(frame).time(300);
+
+    Ptr<HarrisLaplaceFeatureDetector> detector = HarrisLaplaceFeatureDetector::create();
+    vector<KeyPoint> points;
+    TEST_CYCLE() detector->detect(frame, points);
+
+    SANITY_CHECK_NOTHING();
+}
+
+PERF_TEST_P(xfeatures2d_detectors, star, testing::Combine(DETECTOR_IMAGES, DETECTOR_SIZES))
+{
+    Mat frame = loadDetectorImage(GetParam());
+    ASSERT_FALSE(frame.empty()) << "Unable to load source image " << get<0>(GetParam());
+
+    declare.in(frame).time(90);
+
+    Ptr<StarDetector> detector = StarDetector::create();
+    vector<KeyPoint> points;
+    TEST_CYCLE() detector->detect(frame, points);
+
+    SANITY_CHECK_NOTHING();
+}
+
+PERF_TEST_P(xfeatures2d_detectors, tbmr, testing::Combine(DETECTOR_IMAGES, DETECTOR_SIZES))
+{
+    Mat frame = loadDetectorImage(GetParam());
+    ASSERT_FALSE(frame.empty()) << "Unable to load source image " << get<0>(GetParam());
+
+    declare.in(frame).time(300);
+
+    Ptr<TBMR> detector = TBMR::create(60, 0.01f, 1.5f, 3);
+    vector<KeyPoint> points;
+    TEST_CYCLE() detector->detect(frame, points);
+
+    SANITY_CHECK_NOTHING();
+}
+
+}} // namespace
@@ -0,0 +1,84 @@
+// This file is part of OpenCV project.
+// It is subject to the license terms in the LICENSE file found in the top-level directory
+// of this distribution and at http://opencv.org/license.html.
+#include "perf_precomp.hpp"
+
+namespace opencv_test { namespace {
+
+typedef tuple<bool, bool> GMS_Options_t;
+typedef perf::TestBaseWithParam<GMS_Options_t> xfeatures2d_gms;
+typedef perf::TestBaseWithParam<int> xfeatures2d_logos;
+
+#define MATCH_COUNTS 10000, 100000
+
+// matches between two 1920x1080 views related by a small similarity, half of them outliers
+static void makeMatches(int count, vector<KeyPoint>& keypoints1, vector<KeyPoint>& keypoints2, vector<DMatch>& matches)
+{
+    const Size sz(1920, 1080);
+    RNG& rng = theRNG();
+    const float angle = 0.1f, scale = 1.2f;
+    const float c = scale*std::cos(angle), s = scale*std::sin(angle);
+
+    keypoints1.resize(count);
+    keypoints2.resize(count);
+    matches.resize(count);
+    for (int i = 0; i < count; i++)
+    {
+        Point2f p1(rng.uniform(0.f, (float)sz.width), rng.uniform(0.f, (float)sz.height));
+        Point2f p2(rng.uniform(0.f, (float)sz.width), rng.uniform(0.f, (float)sz.height));
+        if (i % 2 == 0)
+        {
+            Point2f d = p1 - Point2f(sz.width*0.5f, sz.height*0.5f);
+            p2 = Point2f(c*d.x - s*d.y + sz.width*0.5f + rng.uniform(-2.f, 2.f),
+                         s*d.x + c*d.y + sz.height*0.5f + rng.uniform(-2.f, 2.f));
+            p2.x = std::min(std::max(p2.x, 0.f), sz.width - 1.f);
+            p2.y = std::min(std::max(p2.y, 0.f), sz.height - 1.f);
+        }
+        float angle1 = rng.uniform(0.f, 360.f);
+        keypoints1[i] = KeyPoint(p1, 10.f, angle1);
+        keypoints2[i] = KeyPoint(p2, 10.f*scale, angle1 + angle*180.f/(float)CV_PI);
+        matches[i] = DMatch(i, i, 0.f);
+    }
+}
+
+PERF_TEST_P(xfeatures2d_gms, match, testing::Combine(testing::Bool(), testing::Bool()))
+{
+    vector<KeyPoint> keypoints1, keypoints2;
+    vector<DMatch> matches;
+    makeMatches(100000, keypoints1, keypoints2, matches);
+
+    declare.time(120);
+
+    const bool withRotation = get<0>(GetParam()), withScale = get<1>(GetParam());
+    vector<DMatch> matchesGMS;
+    TEST_CYCLE() matchGMS(Size(1920, 1080), Size(1920, 1080), keypoints1, keypoints2, matches, matchesGMS,
+                          withRotation, withScale);
+
+    SANITY_CHECK_NOTHING();
+}
+
+PERF_TEST_P(xfeatures2d_logos, match, testing::Values(MATCH_COUNTS))
+{
+    const int count = GetParam();
+    vector<KeyPoint> keypoints1, keypoints2;
+    vector<DMatch> matches;
+    makeMatches(count, keypoints1, keypoints2, matches);
+
+    // inliers share their vocabulary word, outliers get random ones
+    RNG& rng = theRNG();
+    vector<int> nn1(count), nn2(count);
+    for (int i = 0; i < count; i++)
+    {
+        nn1[i] = i % 2 == 0 ? i : rng.uniform(0, count);
+        nn2[i] = i % 2 == 0 ? i : rng.uniform(0, count);
+    }
+
+    declare.time(120);
+
+    vector<DMatch> matchesLogos;
+    TEST_CYCLE() matchLOGOS(keypoints1, keypoints2, nn1, nn2, matchesLogos);
+
+    SANITY_CHECK_NOTHING();
+}
+
+}} // namespace
@@ -64,5 +64,67 @@ PERF_TEST_P(surf, full, testing::Values(SURF_IMAGES))
     SANITY_CHECK_NOTHING();
 }
 
+typedef tuple<std::string, Size> SURF_Image_t;
+typedef perf::TestBaseWithParam<SURF_Image_t> surf_large;
+
+// original size and a 12 MP upscale, whose integral image overflows 32 bits
+#define SURF_SIZES \
+    testing::Values(Size(0, 0), Size(4000, 3000))
+
+static Mat loadSurfImage(const SURF_Image_t& param)
+{
+    string filename = TestBase::getDataPath(get<0>(param));
+    Mat frame = imread(filename, IMREAD_GRAYSCALE);
+    if (!frame.empty() && get<1>(param).area() > 0)
+        resize(frame, frame, get<1>(param), 0, 0, INTER_LINEAR);
+    return frame;
+}
+
+PERF_TEST_P(surf_large, detect, testing::Combine(testing::Values(SURF_IMAGES), SURF_SIZES))
+{
+    Mat frame = loadSurfImage(GetParam());
+    ASSERT_FALSE(frame.empty()) << "Unable to load source image " << get<0>(GetParam());
+
+    declare.in(frame).time(90);
+    Ptr<SURF> detector = SURF::create();
+    vector<KeyPoint> points;
+
+    TEST_CYCLE() detector->detect(frame, points);
+
+    SANITY_CHECK_NOTHING();
+}
+
+PERF_TEST_P(surf_large, detect_upright_budget, testing::Combine(testing::Values(SURF_IMAGES), SURF_SIZES))
+{
+    Mat frame = loadSurfImage(GetParam());
+    ASSERT_FALSE(frame.empty()) << "Unable to load source image " << get<0>(GetParam());
+
+    declare.in(frame).time(90);
+    // low threshold, the keypoint budget selects the strongest responses
+    Ptr<SURF> detector = SURF::create(10, 4, 3, false, true);
+    detector->setMaxKeypoints(2000);
+    vector<KeyPoint> points;
+
+    TEST_CYCLE() detector->detect(frame, points);
+
+    SANITY_CHECK_NOTHING();
+}
+
+PERF_TEST_P(surf_large, full_budget, testing::Combine(testing::Values(SURF_IMAGES), SURF_SIZES))
+{
+    Mat frame = loadSurfImage(GetParam());
+    ASSERT_FALSE(frame.empty()) << "Unable to load source image " << get<0>(GetParam());
+
+    declare.in(frame).time(90);
+    Ptr<SURF> detector = SURF::create(10);
+    detector->setMaxKeypoints(2000);
+    vector<KeyPoint> points;
+    Mat descriptors;
+
+    TEST_CYCLE() detector->detectAndCompute(frame, noArray(), points, descriptors, false);
+
+    SANITY_CHECK_NOTHING();
+}
+
 }} // namespace
 #endif // NONFREE
@@ -135,6 +135,13 @@ public:
      */
     virtual void compute( InputArray image, OutputArray descriptors ) CV_OVERRIDE;
 
+    /** @overload
+     * @param image image to extract descriptors
+     * @param callback receives the descriptors of every band
+     * @param maxBufferSize memory budget of one band
+     */
+    virtual void compute( InputArray image, const BandCallback& callback, size_t maxBufferSize ) CV_OVERRIDE;
+
     /**
      * @param y position y on image
      * @param x position x on image
@@ -275,6 +282,10 @@ private:
     // image set image as working
     inline void set_image( InputArray image );
 
+    // rows of context a band needs above and below the rows it computes
+    // descriptors for, to get the same result as on the whole image
+    inline int band_halo() const;
+
     // releases all the used memory; call this if you want to process
     // multiple images within a loop.
     inline void reset();
@@ -993,6 +1004,7 @@ struct ComputeDescriptorsInvoker : ParallelLoopBody
     {
       x_off = _roi->x;
       x_end = _roi->x + _roi->width;
+      y_off = _roi->y;
       image = _image;
       layers = _layers;
       th_q_no = _th_q_no;
@@ -1010,7 +1022,7 @@ struct ComputeDescriptorsInvoker : ParallelLoopBody
       {
         for( int x = x_off; x < x_end; x++ )
         {
-          index = y*image->cols + x;
+          index = (y - y_off)*(x_end - x_off) + (x - x_off);
           orientation = 0;
           if( !orientation_map->empty() )
               orientation = (int) orientation_map->at<ushort>( y, x );
@@ -1024,7 +1036,7 @@ struct ComputeDescriptorsInvoker : ParallelLoopBody
     }
 
     int th_q_no;
-    int x_off, x_end;
+    int x_off, x_end, y_off;
     std::vector<Mat>* layers;
     Mat *descriptors;
     Mat *orientation_map;
@@ -1476,6 +1488,29 @@ inline void DAISY_Impl::set_image( InputArray _image )
       m_image = image;
 }
 
+inline int DAISY_Impl::band_halo() const
+{
+    // gradient: 5x5 gaussian and 3 taps derivative
+    int halo = 2 + 1;
+    // initial smoothing of the layers
+    halo += filter_size( sqrt(g_sigma_init*g_sigma_init-0.25f), 5.0f ) / 2;
+    // incremental smoothing of the cubes
+    for( int r=0; r<m_rad_q_no; r++ )
+    {
+      double sigma;
+      if( r == 0 )
+        sigma = m_cube_sigmas.at<double>(0);
+      else
+        sigma = sqrt( m_cube_sigmas.at<double>(r  ) * m_cube_sigmas.at<double>(r  )
+                    - m_cube_sigmas.at<double>(r-1) * m_cube_sigmas.at<double>(r-1) );
+      halo += filter_size( sigma, 5.0f ) / 2;
+    }
+    // outermost petals plus the interpolation neighbourhood
+    halo += cvCeil( m_rad ) + 2;
+
+    return halo;
+}
+
 
 // -------------------------------------------------
 /* DAISY interface implementation */
@@ -1588,6 +1623,52 @@ void DAISY_Impl::compute( InputArray _image, OutputArray _descriptors )
     normalize_descriptors( &descriptors );
 }
 
+// full scope, streamed by horizontal bands
+void DAISY_Impl::compute( InputArray _image, const BandCallback& callback, size_t maxBufferSize )
+{
+    Mat image = _image.getMat();
+    // do nothing if no image
+    if( image.empty() )
+      return;
+
+    CV_Assert( m_h_matrix.empty() );
+    CV_Assert( ! m_use_orientation );
+    CV_Assert( callback );
+
+    set_parameters();
+
+    // working memory per band row: gray image, (m_rad_q_no + 1) cubes and descriptors
+    const int halo = band_halo();
+    const size_t row_size = (size_t)image.cols * sizeof(float)
+                          * ( 1 + (m_rad_q_no + 1) * m_hist_th_q_no + m_descriptor_size );
+    int band_rows = (int) std::min( maxBufferSize / row_size, (size_t)image.rows + 2*halo ) - 2*halo;
+    band_rows = std::min( std::max( band_rows, 1 ), image.rows );
+
+    Mat buffer( band_rows * image.cols, m_descriptor_size, CV_32F );
+
+    for( int y0 = 0; y0 < image.rows; y0 += band_rows )
+    {
+      int y1 = std::min( y0 + band_rows, image.rows );
+      int b0 = std::max( y0 - halo, 0 );
+      int b1 = std::min( y1 + halo, image.rows );
+
+      // band with its halo, replicated borders only at the true image borders
+      set_image( image.rowRange( b0, b1 ).clone() );
+      m_roi = Rect( 0, y0 - b0, image.cols, y1 - y0 );
+
+      initialize_single_descriptor_mode();
+
+      Mat descriptors = buffer.rowRange( 0, m_roi.width * m_roi.height );
+
+      compute_descriptors( &descriptors );
+      normalize_descriptors( &descriptors );
+
+      callback( Rect( 0, y0, image.cols, y1 - y0 ), descriptors );
+    }
+
+    reset();
+}
+
 // constructor
 DAISY_Impl::DAISY_Impl( float _radius, int _q_radius, int _q_theta, int _q_hist,
              DAISY::NormalizationType _norm, InputArray _H, bool _interpolation, bool _use_orientation )
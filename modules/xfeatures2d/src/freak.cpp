@@ -31,6 +31,7 @@
 //  the use of this software, even if advised of the possibility of such damage.
 
 #include "precomp.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 #include <fstream>
 #include <stdlib.h>
 #include <algorithm>
@@ -92,14 +93,17 @@ protected:
     void buildPattern();
 
     template <typename imgType, typename iiType>
-    imgType meanIntensity( InputArray image, InputArray integral, const float kp_x, const float kp_y,
-                          const unsigned int scale, const unsigned int rot, const unsigned int point );
+    imgType meanIntensity( const Mat& image, const Mat& integral, const float kp_x, const float kp_y,
+                          const unsigned int scale, const unsigned int rot, const unsigned int point ) const;
+
+    template <typename srcMatType, typename iiMatType>
+    int estimateOrientation( const Mat& image, const Mat& integral, KeyPoint& kpt, int scaleIdx ) const;
 
     template <typename srcMatType, typename iiMatType>
     void computeDescriptors( InputArray image, std::vector<KeyPoint>& keypoints, OutputArray descriptors );
 
     template <typename srcMatType>
-    void extractDescriptor(srcMatType *pointsValue, void ** ptr);
+    void extractDescriptor(srcMatType *pointsValue, void ** ptr) const;
 
     bool orientationNormalized; //true if the orientation is normalized, false otherwise
     bool scaleNormalized; //true if the scale is normalized, false otherwise
@@ -364,11 +368,11 @@ void FREAK_Impl::compute( InputArray _image, std::vector<KeyPoint>& keypoints, O
 }
 
 template <typename srcMatType>
-void FREAK_Impl::extractDescriptor(srcMatType *pointsValue, void ** ptr)
+void FREAK_Impl::extractDescriptor(srcMatType *pointsValue, void ** ptr) const
 {
     std::bitset<FREAK::NB_PAIRS>** ptrScalar = (std::bitset<FREAK::NB_PAIRS>**) ptr;
 
-    // extracting descriptor preserving the order of SSE version
+    // extracting descriptor preserving the order of SIMD version
     int cnt = 0;
     for( int n = 7; n < FREAK::NB_PAIRS; n += 128)
     {
@@ -384,63 +388,49 @@ void FREAK_Impl::extractDescriptor(srcMatType *pointsValue, void ** ptr)
     --(*ptrScalar);
 }
 
-#if CV_SSE2
+#if CV_SIMD128
 template <>
-void FREAK_Impl::extractDescriptor(uchar *pointsValue, void ** ptr)
+void FREAK_Impl::extractDescriptor(uchar *pointsValue, void ** ptr) const
 {
-    __m128i** ptrSSE = (__m128i**) ptr;
+    uchar** ptrSIMD = (uchar**) ptr;
 
     // note that comparisons order is modified in each block (but first 128 comparisons remain globally the same-->does not affect the 128,384 bits segmanted matching strategy)
     int cnt = 0;
     for( int n = FREAK::NB_PAIRS/128; n-- ; )
     {
-        __m128i result128 = _mm_setzero_si128();
+        v_uint8x16 result128 = v_setzero_u8();
         for( int m = 128/16; m--; cnt += 16 )
         {
-            __m128i operand1 = _mm_set_epi8(pointsValue[descriptionPairs[cnt+0].i],
-                                            pointsValue[descriptionPairs[cnt+1].i],
-                                            pointsValue[descriptionPairs[cnt+2].i],
-                                            pointsValue[descriptionPairs[cnt+3].i],
-                                            pointsValue[descriptionPairs[cnt+4].i],
-                                            pointsValue[descriptionPairs[cnt+5].i],
-                                            pointsValue[descriptionPairs[cnt+6].i],
-                                            pointsValue[descriptionPairs[cnt+7].i],
-                                            pointsValue[descriptionPairs[cnt+8].i],
-                                            pointsValue[descriptionPairs[cnt+9].i],
-                                            pointsValue[descriptionPairs[cnt+10].i],
-                                            pointsValue[descriptionPairs[cnt+11].i],
-                                            pointsValue[descriptionPairs[cnt+12].i],
-                                            pointsValue[descriptionPairs[cnt+13].i],
-                                            pointsValue[descriptionPairs[cnt+14].i],
-                                            pointsValue[descriptionPairs[cnt+15].i]);
-
-            __m128i operand2 = _mm_set_epi8(pointsValue[descriptionPairs[cnt+0].j],
-                                            pointsValue[descriptionPairs[cnt+1].j],
-                                            pointsValue[descriptionPairs[cnt+2].j],
-                                            pointsValue[descriptionPairs[cnt+3].j],
-                                            pointsValue[descriptionPairs[cnt+4].j],
-                                            pointsValue[descriptionPairs[cnt+5].j],
-                                            pointsValue[descriptionPairs[cnt+6].j],
-                                            pointsValue[descriptionPairs[cnt+7].j],
-                                            pointsValue[descriptionPairs[cnt+8].j],
-                                            pointsValue[descriptionPairs[cnt+9].j],
-                                            pointsValue[descriptionPairs[cnt+10].j],
-                                            pointsValue[descriptionPairs[cnt+11].j],
-                                            pointsValue[descriptionPairs[cnt+12].j],
-                                            pointsValue[descriptionPairs[cnt+13].j],
-                                            pointsValue[descriptionPairs[cnt+14].j],
-                                            pointsValue[descriptionPairs[cnt+15].j]);
-
-            __m128i workReg = _mm_min_epu8(operand1, operand2); // emulated "not less than" for 8-bit UNSIGNED integers
-            workReg = _mm_cmpeq_epi8(workReg, operand2);        // emulated "not less than" for 8-bit UNSIGNED integers
-
-            workReg = _mm_and_si128(_mm_set1_epi16(short(0x8080 >> m)), workReg); // merge the last 16 bits with the 128bits std::vector until full
-            result128 = _mm_or_si128(result128, workReg);
+            // lanes are filled in reverse pair order to keep the bit layout of the former SSE2 code
+            const DescriptionPair* pairs = descriptionPairs + cnt;
+            v_uint8x16 operand1(pointsValue[pairs[15].i], pointsValue[pairs[14].i],
+                                pointsValue[pairs[13].i], pointsValue[pairs[12].i],
+                                pointsValue[pairs[11].i], pointsValue[pairs[10].i],
+                                pointsValue[pairs[9].i],  pointsValue[pairs[8].i],
+                                pointsValue[pairs[7].i],  pointsValue[pairs[6].i],
+                                pointsValue[pairs[5].i],  pointsValue[pairs[4].i],
+                                pointsValue[pairs[3].i],  pointsValue[pairs[2].i],
+                                pointsValue[pairs[1].i],  pointsValue[pairs[0].i]);
+
+            v_uint8x16 operand2(pointsValue[pairs[15].j], pointsValue[pairs[14].j],
+                                pointsValue[pairs[13].j], pointsValue[pairs[12].j],
+                                pointsValue[pairs[11].j], pointsValue[pairs[10].j],
+                                pointsValue[pairs[9].j],  pointsValue[pairs[8].j],
+                                pointsValue[pairs[7].j],  pointsValue[pairs[6].j],
+                                pointsValue[pairs[5].j],  pointsValue[pairs[4].j],
+                                pointsValue[pairs[3].j],  pointsValue[pairs[2].j],
+                                pointsValue[pairs[1].j],  pointsValue[pairs[0].j]);
+
+            v_uint8x16 workReg = operand1 >= operand2;
+
+            // merge the last 16 bits with the 128bits std::vector until full
+            workReg &= v_reinterpret_as_u8(v_setall_u16((ushort)(0x8080 >> m)));
+            result128 |= workReg;
         }
-        (**ptrSSE) = result128;
-        ++(*ptrSSE);
+        v_store(*ptrSIMD, result128);
+        *ptrSIMD += 16;
     }
-    (*ptrSSE) -= 8;
+    (*ptrSIMD) -= 8*16;
 }
 #endif
 
@@ -451,56 +441,35 @@ void FREAK_Impl::computeDescriptors( InputArray _image, std::vector<KeyPoint>& k
     Mat imgIntegral;
     integral(image, imgIntegral, DataType<iiMatType>::type);
     std::vector<int> kpScaleIdx(keypoints.size()); // used to save pattern scale index corresponding to each keypoints
-    const std::vector<int>::iterator ScaleIdxBegin = kpScaleIdx.begin(); // used in std::vector erase function
-    const std::vector<cv::KeyPoint>::iterator kpBegin = keypoints.begin(); // used in std::vector erase function
     const float sizeCst = static_cast<float>(FREAK::NB_SCALES/(FREAK_LOG2* nOctaves));
-    srcMatType pointsValue[FREAK_NB_POINTS];
-    int thetaIdx = 0;
-    int direction0;
-    int direction1;
+    const int scIdx = std::max( cvRound(1.0986122886681*sizeCst) ,0);
 
-    // compute the scale index corresponding to the keypoint size and remove keypoints close to the border
-    if( scaleNormalized )
+    // compute the scale index corresponding to the keypoint size and remove keypoints close to the border,
+    // compacting the keypoint list in place to keep it linear on large keypoint sets
+    size_t nkept = 0;
+    for( size_t k = 0; k < keypoints.size(); k++ )
     {
-        for( size_t k = keypoints.size(); k--; )
-        {
-            //Is k non-zero? If so, decrement it and continue"
-            kpScaleIdx[k] = std::max( (int)(std::log(keypoints[k].size/FREAK_SMALLEST_KP_SIZE)*sizeCst+0.5) ,0);
-            if( kpScaleIdx[k] >= FREAK::NB_SCALES )
-                kpScaleIdx[k] = FREAK::NB_SCALES-1;
-
-            if( keypoints[k].pt.x <= patternSizes[kpScaleIdx[k]] || //check if the description at this specific position and scale fits inside the image
-                 keypoints[k].pt.y <= patternSizes[kpScaleIdx[k]] ||
-                 keypoints[k].pt.x >= image.cols-patternSizes[kpScaleIdx[k]] ||
-                 keypoints[k].pt.y >= image.rows-patternSizes[kpScaleIdx[k]]
-               )
-            {
-                keypoints.erase(kpBegin+k);
-                kpScaleIdx.erase(ScaleIdxBegin+k);
-            }
-        }
-    }
-    else
-    {
-        const int scIdx = std::max( cvRound(1.0986122886681*sizeCst) ,0);
-        for( size_t k = keypoints.size(); k--; )
-        {
-            kpScaleIdx[k] = scIdx; // equivalent to the formule when the scale is normalized with a constant size of keypoints[k].size=3*SMALLEST_KP_SIZE
-            if( kpScaleIdx[k] >= FREAK::NB_SCALES )
-            {
-                kpScaleIdx[k] = FREAK::NB_SCALES-1;
-            }
-            if( keypoints[k].pt.x <= patternSizes[kpScaleIdx[k]] ||
-                keypoints[k].pt.y <= patternSizes[kpScaleIdx[k]] ||
-                keypoints[k].pt.x >= image.cols-patternSizes[kpScaleIdx[k]] ||
-                keypoints[k].pt.y >= image.rows-patternSizes[kpScaleIdx[k]]
-               )
-            {
-                keypoints.erase(kpBegin+k);
-                kpScaleIdx.erase(ScaleIdxBegin+k);
-            }
-        }
+        int scaleIdx;
+        if( scaleNormalized )
+            scaleIdx = std::max( (int)(std::log(keypoints[k].size/FREAK_SMALLEST_KP_SIZE)*sizeCst+0.5) ,0);
+        else
+            scaleIdx = scIdx; // equivalent to the formule when the scale is normalized with a constant size of keypoints[k].size=3*SMALLEST_KP_SIZE
+        if( scaleIdx >= FREAK::NB_SCALES )
+            scaleIdx = FREAK::NB_SCALES-1;
+
+        if( keypoints[k].pt.x <= patternSizes[scaleIdx] || //check if the description at this specific position and scale fits inside the image
+            keypoints[k].pt.y <= patternSizes[scaleIdx] ||
+            keypoints[k].pt.x >= image.cols-patternSizes[scaleIdx] ||
+            keypoints[k].pt.y >= image.rows-patternSizes[scaleIdx]
+           )
+            continue;
+
+        if( nkept != k )
+            keypoints[nkept] = keypoints[k];
+        kpScaleIdx[nkept++] = scaleIdx;
     }
+    keypoints.resize(nkept);
+    kpScaleIdx.resize(nkept);
 
     // allocate descriptor memory, estimate orientations, extract descriptors
     if( !extAll )
@@ -510,129 +479,111 @@ void FREAK_Impl::computeDescriptors( InputArray _image, std::vector<KeyPoint>& k
         _descriptors.setTo(Scalar::all(0));
         Mat descriptors = _descriptors.getMat();
 
-        void *ptr = descriptors.data+(keypoints.size()-1)*descriptors.step[0];
-
-        for( size_t k = keypoints.size(); k--; ) {
-            // estimate orientation (gradient)
-            if( !orientationNormalized )
-            {
-                thetaIdx = 0; // assign 0° to all keypoints
-                keypoints[k].angle = 0.0;
-            }
-            else
+        parallel_for_(Range(0, (int)keypoints.size()), [&](const Range& range)
+        {
+            srcMatType pointsValue[FREAK_NB_POINTS];
+            for( int k = range.start; k < range.end; k++ )
             {
-                // get the points intensity value in the un-rotated pattern
+                const int thetaIdx = estimateOrientation<srcMatType, iiMatType>(image, imgIntegral, keypoints[k], kpScaleIdx[k]);
+
+                // extract descriptor at the computed orientation
                 for( int i = FREAK_NB_POINTS; i--; ) {
                     pointsValue[i] = meanIntensity<srcMatType, iiMatType>(image, imgIntegral,
                                                                           keypoints[k].pt.x, keypoints[k].pt.y,
-                                                                          kpScaleIdx[k], 0, i);
+                                                                          kpScaleIdx[k], thetaIdx, i);
                 }
-                direction0 = 0;
-                direction1 = 0;
-                for( int m = 45; m--; )
-                {
-                    //iterate through the orientation pairs
-                    const int delta = (pointsValue[ orientationPairs[m].i ]-pointsValue[ orientationPairs[m].j ]);
-                    direction0 += delta*(orientationPairs[m].weight_dx)/2048;
-                    direction1 += delta*(orientationPairs[m].weight_dy)/2048;
-                }
-
-                keypoints[k].angle = static_cast<float>(atan2((float)direction1,(float)direction0)*(180.0/CV_PI));//estimate orientation
-
-                thetaIdx = cvRound(FREAK_NB_ORIENTATION*keypoints[k].angle*(1/360.0));
 
-                if( thetaIdx < 0 )
-                    thetaIdx += FREAK_NB_ORIENTATION;
-
-                if( thetaIdx >= FREAK_NB_ORIENTATION )
-                    thetaIdx -= FREAK_NB_ORIENTATION;
-            }
-            // extract descriptor at the computed orientation
-            for( int i = FREAK_NB_POINTS; i--; ) {
-                pointsValue[i] = meanIntensity<srcMatType, iiMatType>(image, imgIntegral,
-                                                                      keypoints[k].pt.x, keypoints[k].pt.y,
-                                                                      kpScaleIdx[k], thetaIdx, i);
+                // Extract descriptor
+                void *ptr = descriptors.ptr(k);
+                extractDescriptor<srcMatType>(pointsValue, &ptr);
             }
-
-            // Extract descriptor
-            extractDescriptor<srcMatType>(pointsValue, &ptr);
-        }
+        });
     }
     else // extract all possible comparisons for selection
     {
         _descriptors.create((int)keypoints.size(), 128, CV_8U);
         _descriptors.setTo(Scalar::all(0));
         Mat descriptors = _descriptors.getMat();
-        std::bitset<1024>* ptr = (std::bitset<1024>*) (descriptors.data+(keypoints.size()-1)*descriptors.step[0]);
 
-        for( size_t k = keypoints.size(); k--; )
+        parallel_for_(Range(0, (int)keypoints.size()), [&](const Range& range)
         {
-            //estimate orientation (gradient)
-            if( !orientationNormalized )
-            {
-                thetaIdx = 0;//assign 0° to all keypoints
-                keypoints[k].angle = 0.0;
-            }
-            else
+            srcMatType pointsValue[FREAK_NB_POINTS];
+            for( int k = range.start; k < range.end; k++ )
             {
-                //get the points intensity value in the un-rotated pattern
-                for( int i = FREAK_NB_POINTS;i--; )
+                const int thetaIdx = estimateOrientation<srcMatType, iiMatType>(image, imgIntegral, keypoints[k], kpScaleIdx[k]);
+
+                // get the points intensity value in the rotated pattern
+                for( int i = FREAK_NB_POINTS; i--; ) {
                     pointsValue[i] = meanIntensity<srcMatType, iiMatType>(image, imgIntegral,
-                                                                          keypoints[k].pt.x,keypoints[k].pt.y,
-                                                                          kpScaleIdx[k], 0, i);
+                                                                          keypoints[k].pt.x, keypoints[k].pt.y,
+                                                                          kpScaleIdx[k], thetaIdx, i);
+                }
 
-                direction0 = 0;
-                direction1 = 0;
-                for( int m = 45; m--; )
+                std::bitset<1024>* ptr = (std::bitset<1024>*) descriptors.ptr(k);
+                int cnt(0);
+                for( int i = 1; i < FREAK_NB_POINTS; ++i )
                 {
-                    //iterate through the orientation pairs
-                    const int delta = (pointsValue[ orientationPairs[m].i ]-pointsValue[ orientationPairs[m].j ]);
-                    direction0 += delta*(orientationPairs[m].weight_dx)/2048;
-                    direction1 += delta*(orientationPairs[m].weight_dy)/2048;
+                    //(generate all the pairs)
+                    for( int j = 0; j < i; ++j )
+                    {
+                        ptr->set(cnt, pointsValue[i] >= pointsValue[j] );
+                        ++cnt;
+                    }
                 }
+            }
+        });
+    }
+}
+
+// estimate the keypoint orientation from the un-rotated pattern, returns the pattern orientation index
+template <typename srcMatType, typename iiMatType>
+int FREAK_Impl::estimateOrientation( const Mat& image, const Mat& imgIntegral, KeyPoint& kpt, int scaleIdx ) const
+{
+    if( !orientationNormalized )
+    {
+        kpt.angle = 0.0; // assign 0° to all keypoints
+        return 0;
+    }
 
-                keypoints[k].angle = static_cast<float>(atan2((float)direction1,(float)direction0)*(180.0/CV_PI)); //estimate orientation
+    // get the points intensity value in the un-rotated pattern
+    srcMatType pointsValue[FREAK_NB_POINTS];
+    for( int i = FREAK_NB_POINTS; i--; ) {
+        pointsValue[i] = meanIntensity<srcMatType, iiMatType>(image, imgIntegral,
+                                                              kpt.pt.x, kpt.pt.y,
+                                                              scaleIdx, 0, i);
+    }
+    int direction0 = 0;
+    int direction1 = 0;
+    for( int m = 45; m--; )
+    {
+        //iterate through the orientation pairs
+        const int delta = (pointsValue[ orientationPairs[m].i ]-pointsValue[ orientationPairs[m].j ]);
+        direction0 += delta*(orientationPairs[m].weight_dx)/2048;
+        direction1 += delta*(orientationPairs[m].weight_dy)/2048;
+    }
 
-                thetaIdx = cvRound(FREAK_NB_ORIENTATION*keypoints[k].angle*(1/360.0));
+    kpt.angle = static_cast<float>(atan2((float)direction1,(float)direction0)*(180.0/CV_PI));//estimate orientation
 
-                if( thetaIdx < 0 )
-                    thetaIdx += FREAK_NB_ORIENTATION;
+    int thetaIdx = cvRound(FREAK_NB_ORIENTATION*kpt.angle*(1/360.0));
 
-                if( thetaIdx >= FREAK_NB_ORIENTATION )
-                    thetaIdx -= FREAK_NB_ORIENTATION;
-            }
-            // get the points intensity value in the rotated pattern
-            for( int i = FREAK_NB_POINTS; i--; ) {
-                pointsValue[i] = meanIntensity<srcMatType, iiMatType>(image, imgIntegral,
-                                                                      keypoints[k].pt.x, keypoints[k].pt.y,
-                                                                      kpScaleIdx[k], thetaIdx, i);
-            }
+    if( thetaIdx < 0 )
+        thetaIdx += FREAK_NB_ORIENTATION;
 
-            int cnt(0);
-            for( int i = 1; i < FREAK_NB_POINTS; ++i )
-            {
-                //(generate all the pairs)
-                for( int j = 0; j < i; ++j )
-                {
-                    ptr->set(cnt, pointsValue[i] >= pointsValue[j] );
-                    ++cnt;
-                }
-            }
-            --ptr;
-        }
-    }
+    if( thetaIdx >= FREAK_NB_ORIENTATION )
+        thetaIdx -= FREAK_NB_ORIENTATION;
+
+    return thetaIdx;
 }
 
 // simply take average on a square patch, not even gaussian approx
 template <typename imgType, typename iiType>
-imgType FREAK_Impl::meanIntensity( InputArray _image, InputArray _integral,
+imgType FREAK_Impl::meanIntensity( const Mat& image, const Mat& integral,
                               const float kp_x,
                               const float kp_y,
                               const unsigned int scale,
                               const unsigned int rot,
-                              const unsigned int point)
+                              const unsigned int point) const
 {
-    Mat image = _image.getMat(), integral = _integral.getMat();
     // get point position in image
     const PatternPoint& FreakPoint = patternLookup[scale*FREAK_NB_ORIENTATION*FREAK_NB_POINTS + rot*FREAK_NB_POINTS + point];
     const float xf = FreakPoint.x+kp_x;
@@ -85,6 +85,15 @@ public:
         // Initialize the neighbor of left grid
         mGridNeighborLeft = Mat::zeros(mGridNumberLeft, 9, CV_32SC1);
         initalizeNeighbors(mGridNeighborLeft, mGridSizeLeft);
+
+        // Left cells of every match for the 4 shifted grids, they do not depend on rotation or scale
+        for (int gridType = 1; gridType <= 4; gridType++)
+        {
+            vector<int>& cells = mvLeftCells[gridType - 1];
+            cells.resize(mNumberMatches);
+            for (size_t i = 0; i < mNumberMatches; i++)
+                cells[i] = getGridIndexLeft(mvP1[mvMatches[i].first], gridType);
+        }
     }
 
     ~GMSMatcher() {}
@@ -95,6 +104,16 @@ public:
 
 
 private:
+    // Right grid of one of the 5 scale ratios
+    struct RightGrid
+    {
+        Size size;
+        int number;
+        Mat neighbor;
+        // right cell of every match
+        vector<int> cells;
+    };
+
     // Normalized Points
     vector<Point2f> mvP1, mvP2;
 
@@ -104,46 +123,20 @@ private:
     // Number of Matches
     size_t mNumberMatches;
 
-    // Grid Size
-    Size mGridSizeLeft, mGridSizeRight;
+    // Left grid
+    Size mGridSizeLeft;
     int mGridNumberLeft;
-    int mGridNumberRight;
-
-    // x      : left grid idx
-    // y      : right grid idx
-    // value  : how many matches from idx_left to idx_right
-    Mat mMotionStatistics;
-
-    //
-    vector<int> mNumberPointsInPerCellLeft;
-
-    // Inldex  : grid_idx_left
-    // Value   : grid_idx_right
-    vector<int> mCellPairs;
-
-    // Every Matches has a cell-pair
-    // first  : grid_idx_left
-    // second : grid_idx_right
-    vector<pair<int, int> > mvMatchPairs;
-
-    // Inlier Mask for output
-    vector<bool> mvbInlierMask;
-
-    //
     Mat mGridNeighborLeft;
-    Mat mGridNeighborRight;
+
+    // Left cell of every match, for each of the 4 grid types
+    vector<int> mvLeftCells[4];
 
     double mThresholdFactor;
 
 
-    // Assign Matches to Cell Pairs
-    void assignMatchPairs(const int GridType);
-
     void convertMatches(const vector<DMatch> &vDMatches, vector<pair<int, int> > &vMatches);
 
-    int getGridIndexLeft(const Point2f &pt, const int type);
-
-    int getGridIndexRight(const Point2f &pt);
+    int getGridIndexLeft(const Point2f &pt, const int type) const;
 
     vector<int> getNB9(const int idx, const Size& GridSize);
 
@@ -151,41 +144,14 @@ private:
 
     void normalizePoints(const vector<KeyPoint> &kp, const Size &size, vector<Point2f> &npts);
 
-    // Run
-    int run(const int rotationType);
-
-    void setScale(const int scale);
+    void setScale(const int scale, RightGrid& grid);
 
-    // Verify Cell Pairs
-    void verifyCellPairs(const int rotationType);
+    // Motion statistics of one grid type, then cell pair verification and inlier marking for
+    // every requested rotation (the statistics do not depend on the rotation)
+    void run(const int gridType, const RightGrid& grid, const vector<int>& rotationTypes,
+             vector<vector<uchar> >& inlierMasks) const;
 };
 
-void GMSMatcher::assignMatchPairs(const int gridType)
-{
-    for (size_t i = 0; i < mNumberMatches; i++)
-    {
-        Point2f &lp = mvP1[mvMatches[i].first];
-        Point2f &rp = mvP2[mvMatches[i].second];
-
-        int lgidx = mvMatchPairs[i].first = getGridIndexLeft(lp, gridType);
-        int rgidx = -1;
-
-        if (gridType == 1)
-        {
-            rgidx = mvMatchPairs[i].second = getGridIndexRight(rp);
-        }
-        else
-        {
-            rgidx = mvMatchPairs[i].second;
-        }
-
-        if (lgidx < 0 || rgidx < 0) continue;
-
-        mMotionStatistics.at<int>(lgidx, rgidx)++;
-        mNumberPointsInPerCellLeft[lgidx]++;
-    }
-}
-
 // Convert OpenCV DMatch to Match (pair<int, int>)
 void GMSMatcher::convertMatches(const vector<DMatch> &vDMatches, vector<pair<int, int> > &vMatches)
 {
@@ -194,7 +160,7 @@ void GMSMatcher::convertMatches(const vector<DMatch> &vDMatches, vector<pair<int
         vMatches[i] = pair<int, int>(vDMatches[i].queryIdx, vDMatches[i].trainIdx);
 }
 
-int GMSMatcher::getGridIndexLeft(const Point2f &pt, const int type)
+int GMSMatcher::getGridIndexLeft(const Point2f &pt, const int type) const
 {
     int x = 0, y = 0;
 
@@ -225,76 +191,64 @@ int GMSMatcher::getGridIndexLeft(const Point2f &pt, const int type)
     return x + y * mGridSizeLeft.width;
 }
 
-int GMSMatcher::getGridIndexRight(const Point2f &pt)
-{
-    int x = cvFloor(pt.x * mGridSizeRight.width);
-    int y = cvFloor(pt.y * mGridSizeRight.height);
-
-    return x + y * mGridSizeRight.width;
-}
-
 int GMSMatcher::getInlierMask(vector<bool> &vbInliers, const bool withRotation, const bool withScale)
 {
-    int max_inlier = 0;
-
-    if (!withScale && !withRotation)
+    vector<int> scales, rotationTypes;
+    for (int scale = 0; scale < (withScale ? 5 : 1); scale++)
+        scales.push_back(scale);
+    for (int rotationType = 1; rotationType <= (withRotation ? 8 : 1); rotationType++)
+        rotationTypes.push_back(rotationType);
+
+    const int nScales = (int)scales.size(), nRotations = (int)rotationTypes.size();
+
+    vector<RightGrid> grids(nScales);
+    for (int s = 0; s < nScales; s++)
+        setScale(scales[s], grids[s]);
+
+    // every (scale, grid type) pair is independent, evaluate them concurrently
+    // masks[(s*4 + gridType-1)][r] marks the matches kept by that grid for rotation r
+    vector<vector<vector<uchar> > > masks(nScales * 4);
+    parallel_for_(Range(0, nScales * 4), [&](const Range& range)
     {
-        setScale(0);
-        max_inlier = run(1);
-        vbInliers = mvbInlierMask;
-        return max_inlier;
-    }
+        for (int t = range.start; t < range.end; t++)
+            run(t % 4 + 1, grids[t / 4], rotationTypes, masks[t]);
+    });
 
-    if (withRotation && withScale)
+    // a match is an inlier of a (scale, rotation) variant when any of the 4 grids keeps it
+    vector<int> numInliers(nScales * nRotations, 0);
+    parallel_for_(Range(0, nScales * nRotations), [&](const Range& range)
     {
-        for (int scale = 0; scale < 5; scale++)
+        for (int v = range.start; v < range.end; v++)
         {
-            setScale(scale);
-            for (int rotationType = 1; rotationType <= 8; rotationType++)
-            {
-                int num_inlier = run(rotationType);
-
-                if (num_inlier > max_inlier)
-                {
-                    vbInliers = mvbInlierMask;
-                    max_inlier = num_inlier;
-                }
-            }
+            const int s = v / nRotations, r = v % nRotations;
+            int count = 0;
+            for (size_t i = 0; i < mNumberMatches; i++)
+                count += (masks[s*4][r][i] | masks[s*4 + 1][r][i] | masks[s*4 + 2][r][i] | masks[s*4 + 3][r][i]) != 0;
+            numInliers[v] = count;
         }
-        return max_inlier;
-    }
+    });
 
-    if (withRotation && !withScale)
+    // pick the first variant with the largest number of inliers, in the scale-major order
+    int max_inlier = 0, best = -1;
+    for (int v = 0; v < nScales * nRotations; v++)
     {
-        setScale(0);
-        for (int rotationType = 1; rotationType <= 8; rotationType++)
+        if (numInliers[v] > max_inlier)
         {
-            int num_inlier = run(rotationType);
-
-            if (num_inlier > max_inlier)
-            {
-                vbInliers = mvbInlierMask;
-                max_inlier = num_inlier;
-            }
+            max_inlier = numInliers[v];
+            best = v;
         }
-        return max_inlier;
     }
 
-    if (!withRotation && withScale)
-    {
-        for (int scale = 0; scale < 5; scale++)
-        {
-            setScale(scale);
-            int num_inlier = run(1);
-
-            if (num_inlier > max_inlier)
-            {
-                vbInliers = mvbInlierMask;
-                max_inlier = num_inlier;
-            }
+    // without rotation and scale the single variant is always reported
+    if (best < 0 && !withScale && !withRotation)
+        best = 0;
 
-        }
-        return max_inlier;
+    if (best >= 0)
+    {
+        const int s = best / nRotations, r = best % nRotations;
+        vbInliers.assign(mNumberMatches, false);
+        for (size_t i = 0; i < mNumberMatches; i++)
+            vbInliers[i] = (masks[s*4][r][i] | masks[s*4 + 1][r][i] | masks[s*4 + 2][r][i] | masks[s*4 + 3][r][i]) != 0;
     }
 
     return max_inlier;
@@ -349,95 +303,137 @@ void GMSMatcher::normalizePoints(const vector<KeyPoint> &kp, const Size &size, v
     }
 }
 
-int GMSMatcher::run(const int rotationType)
+void GMSMatcher::run(const int gridType, const RightGrid& grid, const vector<int>& rotationTypes,
+                     vector<vector<uchar> >& inlierMasks) const
 {
-    mvbInlierMask.assign(mNumberMatches, false);
+    const vector<int>& leftCells = mvLeftCells[gridType - 1];
+    const int nRotations = (int)rotationTypes.size();
 
-    // Initialize Motion Statisctics
-    mMotionStatistics = Mat::zeros(mGridNumberLeft, mGridNumberRight, CV_32SC1);
-    mvMatchPairs.assign(mNumberMatches, pair<int, int>(0, 0));
-
-    for (int gridType = 1; gridType <= 4; gridType++)
+    // Assign Matches to Cell Pairs
+    // sparse motion statistics: the matches are bucketed by left cell, then the right cells of every
+    // bucket are sorted and run-length encoded into (right grid idx, number of matches) pairs stored in
+    // binCells/binCounts[binStart[left grid idx], binEnd[left grid idx])
+    vector<int> numberPointsInPerCellLeft(mGridNumberLeft, 0);
+    for (size_t i = 0; i < mNumberMatches; i++)
     {
-        // initialize
-        mMotionStatistics.setTo(0);
-        mCellPairs.assign(mGridNumberLeft, -1);
-        mNumberPointsInPerCellLeft.assign(mGridNumberLeft, 0);
+        if (leftCells[i] >= 0 && grid.cells[i] >= 0)
+            numberPointsInPerCellLeft[leftCells[i]]++;
+    }
 
-        assignMatchPairs(gridType);
-        verifyCellPairs(rotationType);
+    vector<int> binStart(mGridNumberLeft + 1, 0);
+    for (int i = 0; i < mGridNumberLeft; i++)
+        binStart[i + 1] = binStart[i] + numberPointsInPerCellLeft[i];
 
-        // Mark inliers
-        for (size_t i = 0; i < mNumberMatches; i++)
+    vector<int> binCells(binStart[mGridNumberLeft]), binCounts(binStart[mGridNumberLeft]);
+    vector<int> binEnd(binStart.begin(), binStart.end() - 1);
+    for (size_t i = 0; i < mNumberMatches; i++)
+    {
+        const int lgidx = leftCells[i], rgidx = grid.cells[i];
+        if (lgidx >= 0 && rgidx >= 0)
+            binCells[binEnd[lgidx]++] = rgidx;
+    }
+
+    // the most voted right cell of every left cell, ties go to the lowest right cell index
+    vector<int> bestCell(mGridNumberLeft, -1);
+    for (int i = 0; i < mGridNumberLeft; i++)
+    {
+        std::sort(binCells.begin() + binStart[i], binCells.begin() + binEnd[i]);
+        int end = binStart[i], bestNumber = 0;
+        for (int k = binStart[i]; k < binEnd[i]; )
         {
-            if (mvMatchPairs[i].first >= 0 && mCellPairs[mvMatchPairs[i].first] == mvMatchPairs[i].second)
-                mvbInlierMask[i] = true;
+            int next = k + 1;
+            while (next < binEnd[i] && binCells[next] == binCells[k])
+                next++;
+            binCells[end] = binCells[k];
+            binCounts[end] = next - k;
+            if (binCounts[end] > bestNumber)
+            {
+                bestNumber = binCounts[end];
+                bestCell[i] = binCells[end];
+            }
+            end++;
+            k = next;
         }
+        binEnd[i] = end;
     }
 
-    return (int) count(mvbInlierMask.begin(), mvbInlierMask.end(), true); //number of inliers
-}
-
-void GMSMatcher::setScale(const int scale)
-{
-    // Set Scale
-    mGridSizeRight.width = cvRound(mGridSizeLeft.width  * mScaleRatios[scale]);
-    mGridSizeRight.height = cvRound(mGridSizeLeft.height * mScaleRatios[scale]);
-    mGridNumberRight = mGridSizeRight.width * mGridSizeRight.height;
-
-    // Initialize the neighbor of right grid
-    mGridNeighborRight = Mat::zeros(mGridNumberRight, 9, CV_32SC1);
-    initalizeNeighbors(mGridNeighborRight, mGridSizeRight);
-}
-
-void GMSMatcher::verifyCellPairs(const int rotationType)
-{
-    const int *CurrentRP = mRotationPatterns[rotationType - 1];
+    // number of matches from idx_left to idx_right
+    auto motionStatistics = [&](int ll, int rr)
+    {
+        const vector<int>::const_iterator first = binCells.begin() + binStart[ll], last = binCells.begin() + binEnd[ll];
+        const vector<int>::const_iterator it = std::lower_bound(first, last, rr);
+        return it != last && *it == rr ? binCounts[it - binCells.begin()] : 0;
+    };
 
+    // Verify Cell Pairs
+    // cellPairs[r][left grid idx] : right grid idx, -1 for empty cells, -2 for rejected pairs
+    vector<vector<int> > cellPairs(nRotations, vector<int>(mGridNumberLeft, -1));
     for (int i = 0; i < mGridNumberLeft; i++)
     {
-        if (sum(mMotionStatistics.row(i))[0] == 0)
-        {
-            mCellPairs[i] = -1;
+        if (numberPointsInPerCellLeft[i] == 0)
             continue;
-        }
 
-        int max_number = 0;
-        for (int j = 0; j < mGridNumberRight; j++)
+        const int idx_grid_rt = bestCell[i];
+        const int *NB9_lt = mGridNeighborLeft.ptr<int>(i);
+        const int *NB9_rt = grid.neighbor.ptr<int>(idx_grid_rt);
+
+        for (int r = 0; r < nRotations; r++)
         {
-            int *value = mMotionStatistics.ptr<int>(i);
-            if (value[j] > max_number)
+            const int *CurrentRP = mRotationPatterns[rotationTypes[r] - 1];
+
+            int score = 0;
+            double thresh = 0;
+            int numpair = 0;
+
+            for (size_t j = 0; j < 9; j++)
             {
-                mCellPairs[i] = j;
-                max_number = value[j];
+                int ll = NB9_lt[j];
+                int rr = NB9_rt[CurrentRP[j] - 1];
+                if (ll == -1 || rr == -1)
+                    continue;
+
+                score += motionStatistics(ll, rr);
+                thresh += numberPointsInPerCellLeft[ll];
+                numpair++;
             }
-        }
-
-        int idx_grid_rt = mCellPairs[i];
 
-        const int *NB9_lt = mGridNeighborLeft.ptr<int>(i);
-        const int *NB9_rt = mGridNeighborRight.ptr<int>(idx_grid_rt);
+            thresh = mThresholdFactor * std::sqrt(thresh / numpair);
 
-        int score = 0;
-        double thresh = 0;
-        int numpair = 0;
+            cellPairs[r][i] = score < thresh ? -2 : idx_grid_rt;
+        }
+    }
 
-        for (size_t j = 0; j < 9; j++)
+    // Mark inliers
+    inlierMasks.resize(nRotations);
+    for (int r = 0; r < nRotations; r++)
+    {
+        vector<uchar>& mask = inlierMasks[r];
+        mask.assign(mNumberMatches, 0);
+        for (size_t i = 0; i < mNumberMatches; i++)
         {
-            int ll = NB9_lt[j];
-            int rr = NB9_rt[CurrentRP[j] - 1];
-            if (ll == -1 || rr == -1)
-                continue;
-
-            score += mMotionStatistics.at<int>(ll, rr);
-            thresh += mNumberPointsInPerCellLeft[ll];
-            numpair++;
+            if (leftCells[i] >= 0 && cellPairs[r][leftCells[i]] == grid.cells[i])
+                mask[i] = 1;
         }
+    }
+}
 
-        thresh = mThresholdFactor * std::sqrt(thresh / numpair);
+void GMSMatcher::setScale(const int scale, RightGrid& grid)
+{
+    // Set Scale
+    grid.size.width = cvRound(mGridSizeLeft.width  * mScaleRatios[scale]);
+    grid.size.height = cvRound(mGridSizeLeft.height * mScaleRatios[scale]);
+    grid.number = grid.size.width * grid.size.height;
+
+    // Initialize the neighbor of right grid
+    grid.neighbor = Mat::zeros(grid.number, 9, CV_32SC1);
+    initalizeNeighbors(grid.neighbor, grid.size);
 
-        if (score < thresh)
-            mCellPairs[i] = -2;
+    // Right cell of every match
+    grid.cells.resize(mNumberMatches);
+    for (size_t i = 0; i < mNumberMatches; i++)
+    {
+        const Point2f &rp = mvP2[mvMatches[i].second];
+        grid.cells[i] = cvFloor(rp.x * grid.size.width) + cvFloor(rp.y * grid.size.height) * grid.size.width;
     }
 }
 
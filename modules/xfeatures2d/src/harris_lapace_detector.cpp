@@ -3,6 +3,7 @@
 // of this distribution and at http://opencv.org/license.html
 
 #include "precomp.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 
 namespace {
 
@@ -40,6 +41,7 @@ private:
     std::vector<Octave> octaves;
     std::vector<DOGOctave> DOG_octaves;
     void build(const Mat& img, bool DOG);
+    static std::vector<Mat> buildDOGLayers(const std::vector<Mat>& layers);
 public:
     class Params
     {
@@ -107,7 +109,7 @@ void Pyramid::build(const Mat& img, bool DOG)
     int octave, layer;
     double sigmaN = 0.5;
 
-    std::vector<Mat> layers, DOG_layers;
+    std::vector<Mat> layers;
     /* standard deviation of current layer*/
     float sigma_curr = sigma;
     /* standard deviation of previous layer*/
@@ -127,29 +129,23 @@ void Pyramid::build(const Mat& img, bool DOG)
         {
             sigma_curr = getSigma(layer);
             sigma = sqrt(powf(sigma_curr, 2) - powf(sigma_prev, 2));
-            Mat prev_lay = layers[layer - 1], curr_lay, DOG_lay;
+            Mat prev_lay = layers[layer - 1], curr_lay;
             /* smoothing is applied on previous layer so sigma_curr^2 = sigma^2 + sigma_prev^2 */
             gsize = int(ceil(sigma * 3)) * 2 + 1;
             GaussianBlur(prev_lay, curr_lay, Size(gsize,gsize), sigma);
             layers.push_back(curr_lay);
-            if (DOG)
-            {
-                absdiff(curr_lay, prev_lay, DOG_lay);
-                DOG_layers.push_back(DOG_lay);
-            }
             sigma_prev = sigma_curr;
 
         }
         Octave tmp_oct(layers);
         octaves.push_back(tmp_oct);
-        layers.clear();
 
         if (DOG)
         {
-            DOGOctave tmp_DOG_Oct(DOG_layers);
+            DOGOctave tmp_DOG_Oct(buildDOGLayers(layers));
             DOG_octaves.push_back(tmp_DOG_Oct);
-            DOG_layers.clear();
         }
+        layers.clear();
 
     }
 
@@ -175,16 +171,10 @@ void Pyramid::build(const Mat& img, bool DOG)
             sigma_curr = getSigma(layer);
             sigma = sqrt(powf(sigma_curr, 2) - powf(sigma_prev, 2));
 
-            Mat prev_lay = layers[layer - 1], curr_lay, DOG_lay;
+            Mat prev_lay = layers[layer - 1], curr_lay;
             gsize = int(ceil(sigma * 3)) * 2 + 1;
             GaussianBlur(prev_lay, curr_lay, Size(gsize,gsize), sigma);
             layers.push_back(curr_lay);
-
-            if (DOG)
-            {
-                absdiff(curr_lay, prev_lay, DOG_lay);
-                DOG_layers.push_back(DOG_lay);
-            }
             sigma_prev = sigma_curr;
         }
 
@@ -195,9 +185,8 @@ void Pyramid::build(const Mat& img, bool DOG)
         octaves.push_back(tmp_oct);
         if (DOG)
         {
-            DOGOctave tmp_DOG_Oct(DOG_layers);
+            DOGOctave tmp_DOG_Oct(buildDOGLayers(layers));
             DOG_octaves.push_back(tmp_DOG_Oct);
-            DOG_layers.clear();
         }
         sigma_curr = sigma_prev = sigma0;
         layers.clear();
@@ -207,6 +196,21 @@ void Pyramid::build(const Mat& img, bool DOG)
 
 }
 
+/**
+ * Differences of adjacent gaussian layers of one octave, computed concurrently
+ * (the gaussian chain itself is sequential since each layer smooths the previous one)
+ */
+std::vector<Mat> Pyramid::buildDOGLayers(const std::vector<Mat>& layers)
+{
+    std::vector<Mat> DOG_layers(layers.size() > 0 ? layers.size() - 1 : 0);
+    parallel_for_(Range(0, (int)DOG_layers.size()), [&](const Range& range)
+    {
+        for (int layer = range.start; layer < range.end; layer++)
+            absdiff(layers[layer + 1], layers[layer], DOG_layers[layer]);
+    });
+    return DOG_layers;
+}
+
 /**
  * Return layer at indicated octave and layer numbers
  */
@@ -330,6 +334,8 @@ public:
 
 protected:
     void detect( InputArray image, std::vector<KeyPoint>& keypoints, InputArray mask=noArray() ) CV_OVERRIDE;
+    void detectOnScale( Pyramid& pyr, int octave, int layer, Size imageSize, const Mat& mask,
+                        std::vector<KeyPoint>& keypoints ) const;
 
     int numOctaves;
     float corn_thresh;
@@ -383,161 +389,192 @@ void HarrisLaplaceFeatureDetector_Impl::write (FileStorage& fs) const
 }
 
 /*
- * Detect method
- * The method detect Harris corners on scale space as described in
- * "K. Mikolajczyk and C. Schmid.
- * Scale & affine invariant interest point detectors.
- * International Journal of Computer Vision, 2004"
+ * Harris corners of one pyramid scale which are also DoG maxima across the neighbouring layers
  */
-void HarrisLaplaceFeatureDetector_Impl::detect(InputArray img, std::vector<KeyPoint>& keypoints, InputArray msk )
+void HarrisLaplaceFeatureDetector_Impl::detectOnScale(Pyramid& pyr, int octave, int layer, Size imageSize,
+                                                      const Mat& mask, std::vector<KeyPoint>& keypoints) const
 {
-    Mat image = img.getMat();
-    if( image.empty() )
-    {
-        keypoints.clear();
-        return;
-    }
-    Mat mask = msk.getMat();
-    if( !mask.empty() )
-    {
-        CV_Assert(mask.type() == CV_8UC1);
-        CV_Assert(mask.size == image.size);
-    }
-    Mat_<float> dx2, dy2, dxy;
     Mat Lx, Ly;
-    float si, sd;
-    int gsize;
-    Mat fimage;
-    image.convertTo(fimage, CV_32F, 1.f/255);
-    /*Build gaussian pyramid*/
-    Pyramid pyr(fimage, numOctaves, num_layers, 1, -1, true);
-    keypoints = std::vector<KeyPoint> (0);
+    Mat Lxm2smooth, Lxmysmooth, Lym2smooth;
 
-    /*Find Harris corners on each layer*/
-    //Use pyr.params.octavesN instead of numOctaves. See issue #1513
-    for (int octave = 0; octave <= pyr.params.octavesN; octave++)
+    float si = powf(2.f, layer / (float) num_layers);
+    float sd = si * 0.7f;
+
+    Mat curr_layer;
+    if (num_layers == 4)
     {
-        for (int layer = 1; layer <= num_layers; layer++)
+        if (layer == 1)
         {
-            if (octave == 0)
-                layer = num_layers;
+            Mat tmp = pyr.getLayer(octave - 1, num_layers - 1);
+            resize(tmp, curr_layer, Size(0, 0), 0.5, 0.5, INTER_AREA);
 
-            Mat Lxm2smooth, Lxmysmooth, Lym2smooth;
+        } else
+            curr_layer = pyr.getLayer(octave, layer - 2);
+    } else /*if num_layer==2*/
+    {
 
-            si = powf(2.f, layer / (float) num_layers);
-            sd = si * 0.7f;
+        curr_layer = pyr.getLayer(octave, layer - 1);
+    }
 
-            Mat curr_layer;
-            if (num_layers == 4)
-            {
-                if (layer == 1)
-                {
-                    Mat tmp = pyr.getLayer(octave - 1, num_layers - 1);
-                    resize(tmp, curr_layer, Size(0, 0), 0.5, 0.5, INTER_AREA);
+    /*Calculates second moment matrix*/
 
-                } else
-                    curr_layer = pyr.getLayer(octave, layer - 2);
-            } else /*if num_layer==2*/
-            {
+    /*Derivatives*/
+    Sobel(curr_layer, Lx, CV_32F, 1, 0, 1);
+    Sobel(curr_layer, Ly, CV_32F, 0, 1, 1);
 
-                curr_layer = pyr.getLayer(octave, layer - 1);
-            }
+    /*Normalization*/
+    Lx = Lx * sd;
+    Ly = Ly * sd;
 
-            /*Calculates second moment matrix*/
+    Mat Lxm2 = Lx.mul(Lx);
+    Mat Lym2 = Ly.mul(Ly);
+    Mat Lxmy = Lx.mul(Ly);
 
-            /*Derivatives*/
-            Sobel(curr_layer, Lx, CV_32F, 1, 0, 1);
-            Sobel(curr_layer, Ly, CV_32F, 0, 1, 1);
+    int gsize = int(ceil(si * 3)) * 2 + 1;
 
-            /*Normalization*/
-            Lx = Lx * sd;
-            Ly = Ly * sd;
+    /*Convolution*/
+    GaussianBlur(Lxm2, Lxm2smooth, Size(gsize, gsize), si, si, BORDER_REPLICATE);
+    GaussianBlur(Lym2, Lym2smooth, Size(gsize, gsize), si, si, BORDER_REPLICATE);
+    GaussianBlur(Lxmy, Lxmysmooth, Size(gsize, gsize), si, si, BORDER_REPLICATE);
 
-            Mat Lxm2 = Lx.mul(Lx);
-            Mat Lym2 = Ly.mul(Ly);
-            Mat Lxmy = Lx.mul(Ly);
+    Mat cornern_mat(curr_layer.size(), CV_32F);
 
-            gsize = int(ceil(si * 3)) * 2 + 1;
+    /*Calculates cornerness in each pixel of the image*/
+    for (int row = 0; row < curr_layer.rows; row++)
+    {
+        const float* dx2 = Lxm2smooth.ptr<float>(row);
+        const float* dy2 = Lym2smooth.ptr<float>(row);
+        const float* dxy = Lxmysmooth.ptr<float>(row);
+        float* corn = cornern_mat.ptr<float>(row);
+        int col = 0;
+#if CV_SIMD128
+        const v_float32x4 v_k = v_setall_f32(0.04f);
+        for (; col <= curr_layer.cols - 4; col += 4)
+        {
+            v_float32x4 dx2f = v_load(dx2 + col), dy2f = v_load(dy2 + col), dxyf = v_load(dxy + col);
+            v_float32x4 det = dx2f * dy2f - dxyf * dxyf;
+            v_float32x4 tr = dx2f + dy2f;
+            v_store(corn + col, det - v_k * tr * tr);
+        }
+#endif
+        for (; col < curr_layer.cols; col++)
+        {
+            float det = dx2[col] * dy2[col] - dxy[col] * dxy[col];
+            float tr = dx2[col] + dy2[col];
+            corn[col] = det - (0.04f * tr * tr);
+        }
+    }
 
-            /*Convolution*/
-            GaussianBlur(Lxm2, Lxm2smooth, Size(gsize, gsize), si, si, BORDER_REPLICATE);
-            GaussianBlur(Lym2, Lym2smooth, Size(gsize, gsize), si, si, BORDER_REPLICATE);
-            GaussianBlur(Lxmy, Lxmysmooth, Size(gsize, gsize), si, si, BORDER_REPLICATE);
+    double maxVal = 0;
+    Mat corn_dilate;
 
-            Mat cornern_mat(curr_layer.size(), CV_32F);
+    /*Find max cornerness value and rejects all corners that are lower than a threshold*/
+    minMaxLoc(cornern_mat, 0, &maxVal, 0, 0);
+    threshold(cornern_mat, cornern_mat, maxVal * corn_thresh, 0, THRESH_TOZERO);
+    dilate(cornern_mat, corn_dilate, Mat());
 
-            /*Calculates cornerness in each pixel of the image*/
-            for (int row = 0; row < curr_layer.rows; row++)
-            {
-                for (int col = 0; col < curr_layer.cols; col++)
-                {
-                    float dx2f = Lxm2smooth.at<float> (row, col);
-                    float dy2f = Lym2smooth.at<float> (row, col);
-                    float dxyf = Lxmysmooth.at<float> (row, col);
-                    float det = dx2f * dy2f - dxyf * dxyf;
-                    float tr = dx2f + dy2f;
-                    float cornerness = det - (0.04f * tr * tr);
-                    cornern_mat.at<float> (row, col) = cornerness;
-                }
-            }
+    Size imgsize = curr_layer.size();
 
-            double maxVal = 0;
-            Mat corn_dilate;
+    /*Verify for each of the initial points whether the DoG attains a maximum at the scale of the point*/
+    Mat prevDOG, curDOG, succDOG;
+    prevDOG = pyr.getDOGLayer(octave, layer - 1);
+    curDOG = pyr.getDOGLayer(octave, layer);
+    succDOG = pyr.getDOGLayer(octave, layer + 1);
 
-            /*Find max cornerness value and rejects all corners that are lower than a threshold*/
-            minMaxLoc(cornern_mat, 0, &maxVal, 0, 0);
-            threshold(cornern_mat, cornern_mat, maxVal * corn_thresh, 0, THRESH_TOZERO);
-            dilate(cornern_mat, corn_dilate, Mat());
+    const float octaveScale = powf(2.0f, (float) octave - 1);
 
-            Size imgsize = curr_layer.size();
+    for (int y = 1; y < imgsize.height - 1; y++)
+    {
+        const float* corn = cornern_mat.ptr<float>(y);
+        const float* cornMax = corn_dilate.ptr<float>(y);
+        for (int x = 1; x < imgsize.width - 1; x++)
+        {
+            float val = corn[x];
+            if (val != 0 && val == cornMax[x])
+            {
 
-            /*Verify for each of the initial points whether the DoG attains a maximum at the scale of the point*/
-            Mat prevDOG, curDOG, succDOG;
-            prevDOG = pyr.getDOGLayer(octave, layer - 1);
-            curDOG = pyr.getDOGLayer(octave, layer);
-            succDOG = pyr.getDOGLayer(octave, layer + 1);
+                float curVal = curDOG.at<float> (y, x);
+                float prevVal =  prevDOG.at<float> (y, x);
+                float succVal = succDOG.at<float> (y, x);
 
-            for (int y = 1; y < imgsize.height - 1; y++)
-            {
-                for (int x = 1; x < imgsize.width - 1; x++)
+                KeyPoint kp(
+                        Point2f(x * octaveScale + octaveScale / 2,
+                                y * octaveScale + octaveScale / 2),
+                        3 * octaveScale * si * 2, 0, val, octave);
+
+                if(!mask.empty() && mask.at<unsigned char>(int(kp.pt.y), int(kp.pt.x)) == 0)
                 {
-                    float val = cornern_mat.at<float> (y, x);
-                    if (val != 0 && val == corn_dilate.at<float> (y, x))
-                    {
-
-                        float curVal = curDOG.at<float> (y, x);
-                        float prevVal =  prevDOG.at<float> (y, x);
-                        float succVal = succDOG.at<float> (y, x);
-
-                        KeyPoint kp(
-                                Point2f(x * powf(2.0f, (float) octave - 1) + powf(2.0f, (float) octave - 1) / 2,
-                                        y * powf(2.0f, (float) octave - 1) + powf(2.0f, (float) octave - 1) / 2),
-                                3 * powf(2.0f, (float) octave - 1) * si * 2, 0, val, octave);
-
-                        if(!mask.empty() && mask.at<unsigned char>(int(kp.pt.y), int(kp.pt.x)) == 0)
-                        {
-                            // ignore keypoints where mask is zero
-                            continue;
-                        }
-
-                        /*Check whether keypoint size is inside the image*/
-                        float start_kp_x = kp.pt.x - kp.size / 2;
-                        float start_kp_y = kp.pt.y - kp.size / 2;
-                        float end_kp_x = start_kp_x + kp.size;
-                        float end_kp_y = start_kp_y + kp.size;
-
-                        if (curVal > prevVal && curVal > succVal && curVal >= DOG_thresh
-                                && start_kp_x > 0 && start_kp_y > 0 && end_kp_x < image.cols
-                                && end_kp_y < image.rows)
-                            keypoints.push_back(kp);
-
-                    }
+                    // ignore keypoints where mask is zero
+                    continue;
                 }
-            }
 
+                /*Check whether keypoint size is inside the image*/
+                float start_kp_x = kp.pt.x - kp.size / 2;
+                float start_kp_y = kp.pt.y - kp.size / 2;
+                float end_kp_x = start_kp_x + kp.size;
+                float end_kp_y = start_kp_y + kp.size;
+
+                if (curVal > prevVal && curVal > succVal && curVal >= DOG_thresh
+                        && start_kp_x > 0 && start_kp_y > 0 && end_kp_x < imageSize.width
+                        && end_kp_y < imageSize.height)
+                    keypoints.push_back(kp);
+
+            }
         }
+    }
+}
 
+/*
+ * Detect method
+ * The method detect Harris corners on scale space as described in
+ * "K. Mikolajczyk and C. Schmid.
+ * Scale & affine invariant interest point detectors.
+ * International Journal of Computer Vision, 2004"
+ */
+void HarrisLaplaceFeatureDetector_Impl::detect(InputArray img, std::vector<KeyPoint>& keypoints, InputArray msk )
+{
+    Mat image = img.getMat();
+    if( image.empty() )
+    {
+        keypoints.clear();
+        return;
+    }
+    Mat mask = msk.getMat();
+    if( !mask.empty() )
+    {
+        CV_Assert(mask.type() == CV_8UC1);
+        CV_Assert(mask.size == image.size);
     }
+    Mat fimage;
+    image.convertTo(fimage, CV_32F, 1.f/255);
+    /*Build gaussian pyramid*/
+    Pyramid pyr(fimage, numOctaves, num_layers, 1, -1, true);
+    keypoints = std::vector<KeyPoint> (0);
+
+    /*List the (octave, layer) scales to process, octave 0 only contributes its last layer*/
+    //Use pyr.params.octavesN instead of numOctaves. See issue #1513
+    std::vector<Point> scales;
+    for (int octave = 0; octave <= pyr.params.octavesN; octave++)
+    {
+        for (int layer = (octave == 0 ? num_layers : 1); layer <= num_layers; layer++)
+            scales.push_back(Point(layer, octave));
+    }
+
+    /*Find Harris corners on each layer, scales are independent once the pyramid is built*/
+    std::vector<std::vector<KeyPoint> > scaleKeypoints(scales.size());
+    parallel_for_(Range(0, (int)scales.size()), [&](const Range& range)
+    {
+        for (int s = range.start; s < range.end; s++)
+            detectOnScale(pyr, scales[s].y, scales[s].x, image.size(), mask, scaleKeypoints[s]);
+    });
+
+    /*Gather in the scale order to keep the result independent of the scheduling*/
+    size_t total = 0;
+    for (size_t s = 0; s < scaleKeypoints.size(); s++)
+        total += scaleKeypoints[s].size();
+    keypoints.reserve(total);
+    for (size_t s = 0; s < scaleKeypoints.size(); s++)
+        keypoints.insert(keypoints.end(), scaleKeypoints[s].begin(), scaleKeypoints[s].end());
 
     /*Sort keypoints in decreasing cornerness order*/
     sort(keypoints.begin(), keypoints.end(), sort_func);
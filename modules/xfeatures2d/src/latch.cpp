@@ -44,6 +44,7 @@
 //M*/
 
 #include "precomp.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 #include <algorithm>
 #include <vector>
 
@@ -94,220 +95,120 @@ namespace cv
         void CalcuateSums(int count, const std::vector<int> &points, bool rotationInvariance, const Mat &grayImage, const KeyPoint &pt, int &suma, int &sumc, float cos_theta, float sin_theta, int half_ssd_size);
 
 
-        static void pixelTests1(const Mat& grayImage, const std::vector<KeyPoint>& keypoints, OutputArray _descriptors, const std::vector<int> &points, bool rotationInvariance, int half_ssd_size)
+        static void pixelTests(const Mat& grayImage, const std::vector<KeyPoint>& keypoints, OutputArray _descriptors, const std::vector<int> &points, bool rotationInvariance, int half_ssd_size, int bytes)
         {
             Mat descriptors = _descriptors.getMat();
-            for (int i = 0; i < (int)keypoints.size(); ++i)
+            parallel_for_(Range(0, (int)keypoints.size()), [&](const Range& range)
             {
-                uchar* desc = descriptors.ptr(i);
-                const KeyPoint& pt = keypoints[i];
-                int count = 0;
-
-                //handling keypoint orientation
-                float angle = pt.angle;
-                angle *= (float)(CV_PI / 180.f);
-                float cos_theta = cos(angle);
-                float sin_theta = sin(angle);
-                for (int ix = 0; ix < 1; ix++){
-                    desc[ix] = 0;
-                    for (int j = 7; j >= 0; j--){
-
-                        int suma = 0;
-                        int sumc = 0;
-
-                        CalcuateSums(count, points, rotationInvariance, grayImage, pt, suma, sumc, cos_theta, sin_theta, half_ssd_size);
-                        desc[ix] += (uchar)((suma < sumc) << j);
-
-                        count += 6;
+                for (int i = range.start; i < range.end; ++i)
+                {
+                    uchar* desc = descriptors.ptr(i);
+                    const KeyPoint& pt = keypoints[i];
+                    int count = 0;
+
+                    //handling keypoint orientation
+                    float angle = pt.angle;
+                    angle *= (float)(CV_PI / 180.f);
+                    float cos_theta = cos(angle);
+                    float sin_theta = sin(angle);
+                    for (int ix = 0; ix < bytes; ix++){
+                        desc[ix] = 0;
+                        for (int j = 7; j >= 0; j--){
+
+                            int suma = 0;
+                            int sumc = 0;
+
+                            CalcuateSums(count, points, rotationInvariance, grayImage, pt, suma, sumc, cos_theta, sin_theta, half_ssd_size);
+                            desc[ix] += (uchar)((suma < sumc) << j);
+
+                            count += 6;
+                        }
                     }
                 }
-            }
+            });
         }
 
 
-        static void pixelTests2(const Mat& grayImage, const std::vector<KeyPoint>& keypoints, OutputArray _descriptors, const std::vector<int> &points, bool rotationInvariance, int half_ssd_size)
+        static void pixelTests1(const Mat& grayImage, const std::vector<KeyPoint>& keypoints, OutputArray _descriptors, const std::vector<int> &points, bool rotationInvariance, int half_ssd_size)
         {
-            Mat descriptors = _descriptors.getMat();
-            for (int i = 0; i < (int)keypoints.size(); ++i)
-            {
-                uchar* desc = descriptors.ptr(i);
-                const KeyPoint& pt = keypoints[i];
-                int count = 0;
-
-                //handling keypoint orientation
-                float angle = pt.angle;
-                angle *= (float)(CV_PI / 180.f);
-                float cos_theta = cos(angle);
-                float sin_theta = sin(angle);
-                for (int ix = 0; ix < 2; ix++){
-                    desc[ix] = 0;
-                    for (int j = 7; j >= 0; j--){
-
-                        int suma = 0;
-                        int sumc = 0;
-
-                        CalcuateSums(count, points, rotationInvariance, grayImage, pt, suma, sumc, cos_theta, sin_theta, half_ssd_size);
-                        desc[ix] += (uchar)((suma < sumc) << j);
-
-                        count += 6;
-                    }
-                }
-            }
+            pixelTests(grayImage, keypoints, _descriptors, points, rotationInvariance, half_ssd_size, 1);
         }
 
+        static void pixelTests2(const Mat& grayImage, const std::vector<KeyPoint>& keypoints, OutputArray _descriptors, const std::vector<int> &points, bool rotationInvariance, int half_ssd_size)
+        {
+            pixelTests(grayImage, keypoints, _descriptors, points, rotationInvariance, half_ssd_size, 2);
+        }
 
         static void pixelTests4(const Mat& grayImage, const std::vector<KeyPoint>& keypoints, OutputArray _descriptors, const std::vector<int> &points, bool rotationInvariance, int half_ssd_size)
         {
-            Mat descriptors = _descriptors.getMat();
-            for (int i = 0; i < (int)keypoints.size(); ++i)
-            {
-                uchar* desc = descriptors.ptr(i);
-                const KeyPoint& pt = keypoints[i];
-                int count = 0;
-
-                //handling keypoint orientation
-                float angle = pt.angle;
-                angle *= (float)(CV_PI / 180.f);
-                float cos_theta = cos(angle);
-                float sin_theta = sin(angle);
-                for (int ix = 0; ix < 4; ix++){
-                    desc[ix] = 0;
-                    for (int j = 7; j >= 0; j--){
-
-                        int suma = 0;
-                        int sumc = 0;
-
-                        CalcuateSums(count, points, rotationInvariance, grayImage, pt, suma, sumc, cos_theta, sin_theta, half_ssd_size);
-                        desc[ix] += (uchar)((suma < sumc) << j);
-
-                        count += 6;
-                    }
-                }
-            }
+            pixelTests(grayImage, keypoints, _descriptors, points, rotationInvariance, half_ssd_size, 4);
         }
 
-
-
         static void pixelTests8(const Mat& grayImage, const std::vector<KeyPoint>& keypoints, OutputArray _descriptors, const std::vector<int> &points, bool rotationInvariance, int half_ssd_size)
         {
-            Mat descriptors = _descriptors.getMat();
-            for (int i = 0; i < (int)keypoints.size(); ++i)
-            {
-                uchar* desc = descriptors.ptr(i);
-                const KeyPoint& pt = keypoints[i];
-                int count = 0;
-
-                //handling keypoint orientation
-                float angle = pt.angle;
-                angle *= (float)(CV_PI / 180.f);
-                float cos_theta = cos(angle);
-                float sin_theta = sin(angle);
-                for (int ix = 0; ix < 8; ix++){
-                    desc[ix] = 0;
-                    for (int j = 7; j >= 0; j--){
-
-                        int suma = 0;
-                        int sumc = 0;
-
-                        CalcuateSums(count, points, rotationInvariance, grayImage, pt, suma, sumc, cos_theta, sin_theta, half_ssd_size);
-                        desc[ix] += (uchar)((suma < sumc) << j);
-
-                        count += 6;
-                    }
-                }
-            }
+            pixelTests(grayImage, keypoints, _descriptors, points, rotationInvariance, half_ssd_size, 8);
         }
 
-
         static void pixelTests16(const Mat& grayImage, const std::vector<KeyPoint>& keypoints, OutputArray _descriptors, const std::vector<int> &points, bool rotationInvariance, int half_ssd_size)
         {
-            Mat descriptors = _descriptors.getMat();
-            for (int i = 0; i < (int)keypoints.size(); ++i)
-            {
-                uchar* desc = descriptors.ptr(i);
-                const KeyPoint& pt = keypoints[i];
-                int count = 0;
-
-                //handling keypoint orientation
-                float angle = pt.angle;
-                angle *= (float)(CV_PI / 180.f);
-                float cos_theta = cos(angle);
-                float sin_theta = sin(angle);
-                for (int ix = 0; ix < 16; ix++){
-                    desc[ix] = 0;
-                    for (int j = 7; j >= 0; j--){
-
-                        int suma = 0;
-                        int sumc = 0;
-
-                        CalcuateSums(count, points, rotationInvariance, grayImage, pt, suma, sumc, cos_theta, sin_theta, half_ssd_size);
-                        desc[ix] += (uchar)((suma < sumc) << j);
-
-                        count += 6;
-                    }
-                }
-            }
+            pixelTests(grayImage, keypoints, _descriptors, points, rotationInvariance, half_ssd_size, 16);
         }
 
-
         static void pixelTests32(const Mat& grayImage, const std::vector<KeyPoint>& keypoints, OutputArray _descriptors, const std::vector<int> &points, bool rotationInvariance, int half_ssd_size)
         {
-            Mat descriptors = _descriptors.getMat();
-            for (int i = 0; i < (int)keypoints.size(); ++i)
-            {
-                uchar* desc = descriptors.ptr(i);
-                const KeyPoint& pt = keypoints[i];
-                int count = 0;
-
-                float angle = pt.angle;
-                angle *= (float)(CV_PI / 180.f);
-                float cos_theta = cos(angle);
-                float sin_theta = sin(angle);
-                for (int ix = 0; ix < 32; ix++){
-                    desc[ix] = 0;
-                    for (int j = 7; j >= 0; j--){
-
-                        int suma = 0;
-                        int sumc = 0;
-
-                        CalcuateSums(count, points, rotationInvariance, grayImage, pt, suma, sumc, cos_theta, sin_theta, half_ssd_size);
-                        desc[ix] += (uchar)((suma < sumc) << j);
-
-                        count += 6;
-                    }
-                }
-            }
+            pixelTests(grayImage, keypoints, _descriptors, points, rotationInvariance, half_ssd_size, 32);
         }
 
-
         static void pixelTests64(const Mat& grayImage, const std::vector<KeyPoint>& keypoints, OutputArray _descriptors, const std::vector<int> &points, bool rotationInvariance, int half_ssd_size)
         {
-            Mat descriptors = _descriptors.getMat();
-            for (int i = 0; i < (int)keypoints.size(); ++i)
+            pixelTests(grayImage, keypoints, _descriptors, points, rotationInvariance, half_ssd_size, 64);
+        }
+
+        // sums of squared differences of the a-b and c-b patch pairs of one triplet,
+        // the rows are expected to be readable up to 7 bytes past the patch end
+        static inline void tripletSSD(const uchar* pa, const uchar* pb, const uchar* pc, size_t step, int half_ssd_size, int &suma, int &sumc)
+        {
+            const int width = 2 * half_ssd_size + 1;
+#if CV_SIMD128
+            const int tail = width & 7;
+            const v_int16x8 v_tail_mask(tail > 0 ? -1 : 0, tail > 1 ? -1 : 0, tail > 2 ? -1 : 0, tail > 3 ? -1 : 0,
+                                        tail > 4 ? -1 : 0, tail > 5 ? -1 : 0, tail > 6 ? -1 : 0, 0);
+            v_int32x4 v_suma = v_setzero_s32(), v_sumc = v_setzero_s32();
+            for (int iy = 0; iy < width; iy++, pa += step, pb += step, pc += step)
             {
-                uchar* desc = descriptors.ptr(i);
-                const KeyPoint& pt = keypoints[i];
-                int count = 0;
-
-                //handling keypoint orientation
-                float angle = pt.angle;
-                angle *= (float)(CV_PI / 180.f);
-                float cos_theta = cos(angle);
-                float sin_theta = sin(angle);
-                for (int ix = 0; ix < 64; ix++){
-                    desc[ix] = 0;
-                    for (int j = 7; j >= 0; j--){
-
-                        int suma = 0;
-                        int sumc = 0;
-
-                        CalcuateSums(count, points, rotationInvariance, grayImage, pt, suma, sumc, cos_theta, sin_theta, half_ssd_size);
-                        desc[ix] += (uchar)((suma < sumc) << j);
-
-                        count += 6;
-                    }
+                int ix = 0;
+                for (; ix <= width - 8; ix += 8)
+                {
+                    v_int16x8 b = v_reinterpret_as_s16(v_load_expand(pb + ix));
+                    v_int16x8 difa = v_reinterpret_as_s16(v_load_expand(pa + ix)) - b;
+                    v_int16x8 difc = v_reinterpret_as_s16(v_load_expand(pc + ix)) - b;
+                    v_suma += v_dotprod(difa, difa);
+                    v_sumc += v_dotprod(difc, difc);
+                }
+                if (ix < width)
+                {
+                    v_int16x8 b = v_reinterpret_as_s16(v_load_expand(pb + ix));
+                    v_int16x8 difa = (v_reinterpret_as_s16(v_load_expand(pa + ix)) - b) & v_tail_mask;
+                    v_int16x8 difc = (v_reinterpret_as_s16(v_load_expand(pc + ix)) - b) & v_tail_mask;
+                    v_suma += v_dotprod(difa, difa);
+                    v_sumc += v_dotprod(difc, difc);
+                }
+            }
+            suma += v_reduce_sum(v_suma);
+            sumc += v_reduce_sum(v_sumc);
+#else
+            for (int iy = 0; iy < width; iy++, pa += step, pb += step, pc += step)
+            {
+                for (int ix = 0; ix < width; ix++)
+                {
+                    int difa = pa[ix] - pb[ix];
+                    suma += difa*difa;
+
+                    int difc = pc[ix] - pb[ix];
+                    sumc += difc*difc;
                 }
             }
+#endif
         }
 
         void CalcuateSums(int count, const std::vector<int> &points, bool rotationInvariance, const Mat &grayImage, const KeyPoint &pt, int &suma, int &sumc, float cos_theta, float sin_theta, int half_ssd_size)
@@ -384,22 +285,10 @@ namespace cv
 
 
             int K = half_ssd_size;
-            for (int iy = -K; iy <= K; iy++)
-            {
-                const uchar * Mi_a = grayImage.ptr<uchar>(ay2 + iy);
-                const uchar * Mi_b = grayImage.ptr<uchar>(by2 + iy);
-                const uchar * Mi_c = grayImage.ptr<uchar>(cy2 + iy);
-
-                for (int ix = -K; ix <= K; ix++)
-                {
-                    double difa = Mi_a[ax2 + ix] - Mi_b[bx2 + ix];
-                    suma += (int)((difa)*(difa));
-
-                    double difc = Mi_c[cx2 + ix] - Mi_b[bx2 + ix];
-                    sumc += (int)((difc)*(difc));
-                }
-            }
-
+            tripletSSD(grayImage.ptr<uchar>(ay2 - K) + ax2 - K,
+                       grayImage.ptr<uchar>(by2 - K) + bx2 - K,
+                       grayImage.ptr<uchar>(cy2 - K) + cx2 - K,
+                       grayImage.step, K, suma, sumc);
         }
 
 
@@ -521,6 +410,15 @@ namespace cv
             if (sigma_ != 0.)
                 GaussianBlur(grayImage, grayImage, cv::Size(3, 3), sigma_, sigma_);
 
+#if CV_SIMD128
+            // pad the right border so that the vectorized SSD can read whole 8-pixel chunks past the patch end
+            {
+                Mat padded;
+                copyMakeBorder(grayImage, padded, 0, 0, 0, 8, BORDER_CONSTANT, Scalar::all(0));
+                grayImage = padded(Rect(0, 0, grayImage.cols, grayImage.rows));
+            }
+#endif
+
             //Remove keypoints very close to the border
             KeyPointsFilter::runByImageBorder(keypoints, image.size(), PATCH_SIZE / 2 + half_ssd_size_);
 
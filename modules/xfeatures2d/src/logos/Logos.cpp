@@ -25,11 +25,134 @@
  * SOFTWARE.
  */
 #include <cmath>
+#include <algorithm>
+#include <queue>
+#include <map>
 #include "Logos.hpp"
 #include <opencv2/core.hpp>
+#include <opencv2/core/utility.hpp>
 
 namespace logos
 {
+namespace
+{
+// Exact k nearest neighbours of the flagged points of vP, using a uniform grid over the point
+// bounding box searched in growing rings of cells around the query point.
+// Neighbours are ordered by squared distance, then by index.
+void findNearestNeighbours(const std::vector<Point*>& vP, const std::vector<uchar>& needed, int N)
+{
+    const int n = static_cast<int>(vP.size());
+    N = std::min(N, n - 1);
+    if (N <= 0)
+    {
+        return;
+    }
+
+    float minx = vP[0]->getx(), maxx = minx, miny = vP[0]->gety(), maxy = miny;
+    for (int i = 1; i < n; i++)
+    {
+        minx = std::min(minx, vP[i]->getx()); maxx = std::max(maxx, vP[i]->getx());
+        miny = std::min(miny, vP[i]->gety()); maxy = std::max(maxy, vP[i]->gety());
+    }
+
+    // about two points per cell, at most 1024 cells along a side
+    const float w = maxx - minx, h = maxy - miny;
+    float cellSize = (w > 0 && h > 0) ? std::sqrt(w*h*2/n) : std::max(w, h)*2/n;
+    cellSize = std::max(cellSize, std::max(w, h)/1024);
+    if (!(cellSize > 0))
+    {
+        cellSize = 1;
+    }
+    const int gw = cvFloor(w/cellSize) + 1, gh = cvFloor(h/cellSize) + 1;
+
+    // points of every cell, stored contiguously in ascending index order
+    std::vector<int> cellOf(n), cellStart(gw*gh + 1, 0), cellPoints(n);
+    for (int i = 0; i < n; i++)
+    {
+        int cx = std::min(cvFloor((vP[i]->getx() - minx)/cellSize), gw - 1);
+        int cy = std::min(cvFloor((vP[i]->gety() - miny)/cellSize), gh - 1);
+        cellOf[i] = cy*gw + cx;
+        cellStart[cellOf[i] + 1]++;
+    }
+    for (int c = 0; c < gw*gh; c++)
+    {
+        cellStart[c + 1] += cellStart[c];
+    }
+    std::vector<int> fill(cellStart.begin(), cellStart.end() - 1);
+    for (int i = 0; i < n; i++)
+    {
+        cellPoints[fill[cellOf[i]]++] = i;
+    }
+
+    cv::parallel_for_(cv::Range(0, n), [&](const cv::Range& range)
+    {
+        typedef std::pair<float, int> Candidate;
+        std::vector<Point*> nnv;
+        for (int i = range.start; i < range.end; i++)
+        {
+            if (!needed[i])
+            {
+                continue;
+            }
+            Point* p = vP[i];
+            const int cx = cellOf[i] % gw, cy = cellOf[i] / gw;
+
+            // max-heap of the best candidates found so far
+            std::priority_queue<Candidate> heap;
+            for (int r = 0; r < std::max(gw, gh); r++)
+            {
+                for (int y = std::max(cy - r, 0); y <= std::min(cy + r, gh - 1); y++)
+                {
+                    // inner rows only have the two cells on the ring border
+                    const bool border = (y == cy - r || y == cy + r);
+                    const int step = border ? 1 : std::max(2*r, 1);
+                    for (int x = cx - r; x <= cx + r; x += step)
+                    {
+                        if (x < 0 || x >= gw)
+                        {
+                            continue;
+                        }
+                        const int c = y*gw + x;
+                        for (int k = cellStart[c]; k < cellStart[c + 1]; k++)
+                        {
+                            const int j = cellPoints[k];
+                            if (j == i)
+                            {
+                                continue;
+                            }
+                            Candidate cand(p->squareDist(p->getx(), p->gety(), vP[j]->getx(), vP[j]->gety()), j);
+                            if (static_cast<int>(heap.size()) < N)
+                            {
+                                heap.push(cand);
+                            }
+                            else if (cand < heap.top())
+                            {
+                                heap.pop();
+                                heap.push(cand);
+                            }
+                        }
+                    }
+                }
+                // points outside the visited rings are at least r cells away
+                const float bound = r*cellSize;
+                if (static_cast<int>(heap.size()) == N && heap.top().first < bound*bound)
+                {
+                    break;
+                }
+            }
+
+            nnv.resize(heap.size());
+            for (size_t k = heap.size(); k > 0; k--)
+            {
+                nnv[k - 1] = vP[static_cast<size_t>(heap.top().second)];
+                heap.pop();
+            }
+            p->setNNVector(nnv);
+        }
+    });
+}
+}
+
 Logos::Logos()
 {
     LogosParameters defaultParams;
@@ -55,55 +178,85 @@ int Logos::estimateMatches(std::vector<Point*> vP1, std::vector<Point*> vP2, std
 {
     matches.clear();
 
-    // for each point
-    int count1 = 0;
+    // possible matches in Image 2 of every label, in ascending position order
+    std::map<int, std::vector<int> > labelPoints2;
+    for (size_t count2 = 0; count2 < vP2.size(); count2++)
+    {
+        labelPoints2[vP2[count2]->getLabel()].push_back(static_cast<int>(count2));
+    }
 
-    for (std::vector<Point*>::iterator pit1 = vP1.begin(); pit1 != vP1.end(); ++pit1, count1++)
+    // nearest neighbours of every point of Image 1 and of the points of Image 2 that can be matched
+    std::vector<uchar> needed1(vP1.size(), 1), needed2(vP2.size(), 0);
+    for (size_t count1 = 0; count1 < vP1.size(); count1++)
     {
-        (*pit1)->nearestNeighbours(vP1, count1, getNum1());
-        int count2 = 0;
+        std::map<int, std::vector<int> >::const_iterator lit = labelPoints2.find(vP1[count1]->getLabel());
+        if (lit == labelPoints2.end())
+        {
+            continue;
+        }
+        for (size_t k = 0; k < lit->second.size(); k++)
+        {
+            needed2[static_cast<size_t>(lit->second[k])] = 1;
+        }
+    }
+    findNearestNeighbours(vP1, needed1, getNum1());
+    findNearestNeighbours(vP2, needed2, getNum2());
 
-        // find possible matches
-        for (std::vector<Point*>::iterator pit2 = vP2.begin(); pit2 != vP2.end(); ++pit2, count2++)
+    // local support of every possible match, each point of Image 1 is processed independently
+    std::vector<std::vector<PointPair*> > supported(vP1.size());
+    cv::parallel_for_(cv::Range(0, static_cast<int>(vP1.size())), [&](const cv::Range& range)
+    {
+        std::vector<PointPair*> pp;
+        for (int count1 = range.start; count1 < range.end; count1++)
         {
-            if ((*pit1)->getLabel() != (*pit2)->getLabel())
+            std::map<int, std::vector<int> >::const_iterator lit = labelPoints2.find(vP1[count1]->getLabel());
+            if (lit == labelPoints2.end())
             {
                 continue;
             }
-            // this is a possible match in Image 2
-            // get nearest neighbours
-            (*pit2)->nearestNeighbours(vP2, count2, getNum2());
-
-            PointPair* ptpr = new PointPair(*pit1, *pit2);
-            ptpr->addPositions(count1, count2);
-            ptpr->computeLocalSupport(pp, getNum2());
 
-            // calc matches
-            int support = 0;
-            for (std::vector<PointPair*>::const_iterator it = pp.begin(); it < pp.end(); ++it)
+            for (size_t k = 0; k < lit->second.size(); k++)
             {
-                Match m(ptpr, *it);
-                if (evaluateMatch(m))
+                const int count2 = lit->second[k];
+                PointPair* ptpr = new PointPair(vP1[static_cast<size_t>(count1)], vP2[static_cast<size_t>(count2)]);
+                ptpr->addPositions(count1, count2);
+                ptpr->computeLocalSupport(pp, getNum2());
+
+                // calc matches
+                int support = 0;
+                for (std::vector<PointPair*>::const_iterator it = pp.begin(); it < pp.end(); ++it)
                 {
-                    support++;
+                    Match m(ptpr, *it);
+                    if (evaluateMatch(m))
+                    {
+                        support++;
+                    }
+                }
+                for (size_t i = 0; i < pp.size(); i++)
+                {
+                    delete pp[i];
+                }
+                pp.clear();
+                if (support > 0)
+                {
+                    ptpr->setSupport(support);
+                    supported[static_cast<size_t>(count1)].push_back(ptpr);
+                }
+                else
+                {
+                    delete ptpr;
+                    ptpr = NULL;
                 }
             }
-            for (size_t i = 0; i < pp.size(); i++)
-            {
-                delete pp[i];
-            }
-            pp.clear();
-            if (support > 0)
-            {
-                ptpr->setSupport(support);
-                matches.push_back(ptpr);
-                updateBin(ptpr->getRelOri());
-            }
-            else
-            {
-                delete ptpr;
-                ptpr = NULL;
-            }
+        }
+    });
+
+    for (size_t count1 = 0; count1 < supported.size(); count1++)
+    {
+        for (size_t k = 0; k < supported[count1].size(); k++)
+        {
+            matches.push_back(supported[count1][k]);
+            updateBin(supported[count1][k]->getRelOri());
         }
     }
 
@@ -51,7 +51,6 @@ struct LogosParameters
 class Logos
 {
 private:
-    std::vector<PointPair*> pp;
     std::vector<PointPair*> matches;
 
     LogosParameters logosParams;
@@ -64,6 +64,7 @@ public:
     inline void setLabel(int label_) { label = label_; }
 
     inline void getNNVector(std::vector<Point*>& nnv) const { nnv = nnVector; }
+    inline void setNNVector(const std::vector<Point*>& nnv) { nnVector = nnv; nnFound = true; }
     void matchLabel(int label, std::vector<Point*>& mNN);
 
     void nearestNeighbours(const std::vector<Point*>& vP, int index, int N);
@@ -47,6 +47,7 @@ the use of this software, even if advised of the possibility of such damage.
 */
 
 #include "precomp.hpp"
+#include <algorithm>
 
 namespace cv {
     namespace xfeatures2d {
@@ -110,38 +111,45 @@ namespace cv {
                 src_input = _src.getMat();
             }
 
+            if (!_desc.needed())
+                return;
+
             Mat_<Vec3b> src;
 
             blur(src_input, src, cv::Size(b_kernel, b_kernel));
 
-            int x, y, j, d, p, m = (l_kernel*2+1)*(l_kernel*2+1)*3, width = src.cols, height = src.rows, r, c;
+            const int side = l_kernel*2+1, m = side*side*3, width = src.cols, height = src.rows;
 
-            Mat_<uchar> desc(static_cast<int>(keypoints.size()), m);
+            _desc.create(static_cast<int>(keypoints.size()), m, CV_8UC1);
+            Mat desc = _desc.getMat();
 
-            for (std::size_t i = 0; i < keypoints.size(); ++i) {
-                x = static_cast<int>(keypoints[i].pt.x)-l_kernel, y = static_cast<int>(keypoints[i].pt.y)-l_kernel, d = x+2*l_kernel, p = y+2*l_kernel, j = x, r = static_cast<int>(i), c = 0;
+            parallel_for_(Range(0, static_cast<int>(keypoints.size())), [&](const Range& range) {
+                for (int i = range.start; i < range.end; ++i) {
+                    const int x0 = static_cast<int>(keypoints[i].pt.x)-l_kernel, y0 = static_cast<int>(keypoints[i].pt.y)-l_kernel;
+                    uchar* d = desc.ptr<uchar>(i);
 
-                while (x <= d) {
-                    Vec3b &pix = src((y < 0 ? height+y : y >= height ? y-height : y), (x < 0 ? width+x : x >= width ? x-width : x));
+                    for (int y = y0; y < y0+side; ++y, d += side*3) {
+                        const Vec3b* row = src[y < 0 ? height+y : y >= height ? y-height : y];
 
-                    desc(r, c++) = pix[0];
-                    desc(r, c++) = pix[1];
-                    desc(r, c++) = pix[2];
+                        // whole patch row inside the image: copy it at once, otherwise wrap around per pixel
+                        if (x0 >= 0 && x0+side <= width)
+                            memcpy(d, row+x0, side*3);
+                        else {
+                            for (int c = 0, x = x0; c < side; ++c, ++x) {
+                                const Vec3b &pix = row[x < 0 ? width+x : x >= width ? x-width : x];
 
-                    ++x;
-                    if (x > d) {
-                        if (y < p) {
-                            ++y;
-                            x = j;
+                                d[c*3] = pix[0];
+                                d[c*3+1] = pix[1];
+                                d[c*3+2] = pix[2];
+                            }
                         }
-                        else
-                            break;
                     }
-                }
-            }
 
-            if (_desc.needed())
-                sort(desc, _desc, SORT_EVERY_ROW | SORT_ASCENDING);
+                    // same as sort(desc, desc, SORT_EVERY_ROW | SORT_ASCENDING), but done while the row is hot
+                    uchar* r = desc.ptr<uchar>(i);
+                    std::sort(r, r+m);
+                }
+            });
         }
     }
 } // END NAMESPACE CV
@@ -167,7 +167,7 @@ StarDetectorComputeResponses( const Mat& img, Mat& responses, Mat& sizes,
     StarFeature f[MAX_PATTERN];
 
     Mat sum, tilted, flatTilted;
-    int y, rows = img.rows, cols = img.cols;
+    int rows = img.rows, cols = img.cols;
     int border, npatterns=0, maxIdx=0;
 
     responses.create( img.size(), CV_32F );
@@ -251,7 +251,7 @@ StarDetectorComputeResponses( const Mat& img, Mat& responses, Mat& sizes,
     }
 #endif
 
-    for( y = 0; y < border; y++ )
+    for( int y = 0; y < border; y++ )
     {
         float* r_ptr = responses.ptr<float>(y);
         float* r_ptr2 = responses.ptr<float>(rows - 1 - y);
@@ -264,92 +264,96 @@ StarDetectorComputeResponses( const Mat& img, Mat& responses, Mat& sizes,
         memset( s_ptr2, 0, cols*sizeof(s_ptr2[0]));
     }
 
-    for( y = border; y < rows - border; y++ )
+    // rows are independent, each reads the shared integral images only
+    parallel_for_(Range(border, std::max(rows - border, border)), [&](const Range& range)
     {
-        int x = border;
-        float* r_ptr = responses.ptr<float>(y);
-        short* s_ptr = sizes.ptr<short>(y);
+        for( int y = range.start; y < range.end; y++ )
+        {
+            int x = border;
+            float* r_ptr = responses.ptr<float>(y);
+            short* s_ptr = sizes.ptr<short>(y);
 
-        memset( r_ptr, 0, border*sizeof(r_ptr[0]));
-        memset( s_ptr, 0, border*sizeof(s_ptr[0]));
-        memset( r_ptr + cols - border, 0, border*sizeof(r_ptr[0]));
-        memset( s_ptr + cols - border, 0, border*sizeof(s_ptr[0]));
+            memset( r_ptr, 0, border*sizeof(r_ptr[0]));
+            memset( s_ptr, 0, border*sizeof(s_ptr[0]));
+            memset( r_ptr + cols - border, 0, border*sizeof(r_ptr[0]));
+            memset( s_ptr + cols - border, 0, border*sizeof(s_ptr[0]));
 
 #if CV_SSE2
-        if( useSIMD )
-        {
-            __m128 absmask4 = _mm_set1_ps(absmask.f);
-            for( ; x <= cols - border - 4; x += 4 )
+            if( useSIMD )
+            {
+                __m128 absmask4 = _mm_set1_ps(absmask.f);
+                for( ; x <= cols - border - 4; x += 4 )
+                {
+                    int ofs = y*step + x;
+                    __m128 vals[MAX_PATTERN];
+                    __m128 bestResponse = _mm_setzero_ps();
+                    __m128 bestSize = _mm_setzero_ps();
+
+                    for(int i = 0; i <= maxIdx; i++ )
+                    {
+                        const iiMatType** p = (const iiMatType**)f[i].p;
+                        __m128i r0 = _mm_sub_epi32(_mm_loadu_si128((const __m128i*)(p[0]+ofs)),
+                                                   _mm_loadu_si128((const __m128i*)(p[1]+ofs)));
+                        __m128i r1 = _mm_sub_epi32(_mm_loadu_si128((const __m128i*)(p[3]+ofs)),
+                                                   _mm_loadu_si128((const __m128i*)(p[2]+ofs)));
+                        __m128i r2 = _mm_sub_epi32(_mm_loadu_si128((const __m128i*)(p[4]+ofs)),
+                                                   _mm_loadu_si128((const __m128i*)(p[5]+ofs)));
+                        __m128i r3 = _mm_sub_epi32(_mm_loadu_si128((const __m128i*)(p[7]+ofs)),
+                                                   _mm_loadu_si128((const __m128i*)(p[6]+ofs)));
+                        r0 = _mm_add_epi32(_mm_add_epi32(r0,r1), _mm_add_epi32(r2,r3));
+                        _mm_store_ps((float*)&vals[i], _mm_cvtepi32_ps(r0));
+                    }
+
+                    for(int i = 0; i < npatterns; i++ )
+                    {
+                        __m128 inner_sum = vals[pairs[i][1]];
+                        __m128 outer_sum = _mm_sub_ps(vals[pairs[i][0]], inner_sum);
+                        __m128 response = _mm_sub_ps(_mm_mul_ps(inner_sum, invSizes4[i][1]),
+                            _mm_mul_ps(outer_sum, invSizes4[i][0]));
+                        __m128 swapmask = _mm_cmpgt_ps(_mm_and_ps(response,absmask4),
+                            _mm_and_ps(bestResponse,absmask4));
+                        bestResponse = _mm_xor_ps(bestResponse,
+                            _mm_and_ps(_mm_xor_ps(response,bestResponse), swapmask));
+                        bestSize = _mm_xor_ps(bestSize,
+                            _mm_and_ps(_mm_xor_ps(sizes1_4[pairs[i][0]], bestSize), swapmask));
+                    }
+
+                    _mm_storeu_ps(r_ptr + x, bestResponse);
+                    _mm_storel_epi64((__m128i*)(s_ptr + x),
+                        _mm_packs_epi32(_mm_cvtps_epi32(bestSize),_mm_setzero_si128()));
+                }
+            }
+#endif
+            for( ; x < cols - border; x++ )
             {
                 int ofs = y*step + x;
-                __m128 vals[MAX_PATTERN];
-                __m128 bestResponse = _mm_setzero_ps();
-                __m128 bestSize = _mm_setzero_ps();
+                int vals[MAX_PATTERN];
+                float bestResponse = 0;
+                int bestSize = 0;
 
                 for(int i = 0; i <= maxIdx; i++ )
                 {
                     const iiMatType** p = (const iiMatType**)f[i].p;
-                    __m128i r0 = _mm_sub_epi32(_mm_loadu_si128((const __m128i*)(p[0]+ofs)),
-                                               _mm_loadu_si128((const __m128i*)(p[1]+ofs)));
-                    __m128i r1 = _mm_sub_epi32(_mm_loadu_si128((const __m128i*)(p[3]+ofs)),
-                                               _mm_loadu_si128((const __m128i*)(p[2]+ofs)));
-                    __m128i r2 = _mm_sub_epi32(_mm_loadu_si128((const __m128i*)(p[4]+ofs)),
-                                               _mm_loadu_si128((const __m128i*)(p[5]+ofs)));
-                    __m128i r3 = _mm_sub_epi32(_mm_loadu_si128((const __m128i*)(p[7]+ofs)),
-                                               _mm_loadu_si128((const __m128i*)(p[6]+ofs)));
-                    r0 = _mm_add_epi32(_mm_add_epi32(r0,r1), _mm_add_epi32(r2,r3));
-                    _mm_store_ps((float*)&vals[i], _mm_cvtepi32_ps(r0));
+                    vals[i] = (int)(p[0][ofs] - p[1][ofs] - p[2][ofs] + p[3][ofs] +
+                        p[4][ofs] - p[5][ofs] - p[6][ofs] + p[7][ofs]);
                 }
-
                 for(int i = 0; i < npatterns; i++ )
                 {
-                    __m128 inner_sum = vals[pairs[i][1]];
-                    __m128 outer_sum = _mm_sub_ps(vals[pairs[i][0]], inner_sum);
-                    __m128 response = _mm_sub_ps(_mm_mul_ps(inner_sum, invSizes4[i][1]),
-                        _mm_mul_ps(outer_sum, invSizes4[i][0]));
-                    __m128 swapmask = _mm_cmpgt_ps(_mm_and_ps(response,absmask4),
-                        _mm_and_ps(bestResponse,absmask4));
-                    bestResponse = _mm_xor_ps(bestResponse,
-                        _mm_and_ps(_mm_xor_ps(response,bestResponse), swapmask));
-                    bestSize = _mm_xor_ps(bestSize,
-                        _mm_and_ps(_mm_xor_ps(sizes1_4[pairs[i][0]], bestSize), swapmask));
+                    int inner_sum = vals[pairs[i][1]];
+                    int outer_sum = vals[pairs[i][0]] - inner_sum;
+                    float response = inner_sum*invSizes[i][1] - outer_sum*invSizes[i][0];
+                    if( fabs(response) > fabs(bestResponse) )
+                    {
+                        bestResponse = response;
+                        bestSize = sizes1[pairs[i][0]];
+                    }
                 }
 
-                _mm_storeu_ps(r_ptr + x, bestResponse);
-                _mm_storel_epi64((__m128i*)(s_ptr + x),
-                    _mm_packs_epi32(_mm_cvtps_epi32(bestSize),_mm_setzero_si128()));
-            }
-        }
-#endif
-        for( ; x < cols - border; x++ )
-        {
-            int ofs = y*step + x;
-            int vals[MAX_PATTERN];
-            float bestResponse = 0;
-            int bestSize = 0;
-
-            for(int i = 0; i <= maxIdx; i++ )
-            {
-                const iiMatType** p = (const iiMatType**)f[i].p;
-                vals[i] = (int)(p[0][ofs] - p[1][ofs] - p[2][ofs] + p[3][ofs] +
-                    p[4][ofs] - p[5][ofs] - p[6][ofs] + p[7][ofs]);
-            }
-            for(int i = 0; i < npatterns; i++ )
-            {
-                int inner_sum = vals[pairs[i][1]];
-                int outer_sum = vals[pairs[i][0]] - inner_sum;
-                float response = inner_sum*invSizes[i][1] - outer_sum*invSizes[i][0];
-                if( fabs(response) > fabs(bestResponse) )
-                {
-                    bestResponse = response;
-                    bestSize = sizes1[pairs[i][0]];
-                }
+                r_ptr[x] = bestResponse;
+                s_ptr[x] = (short)bestSize;
             }
-
-            r_ptr[x] = bestResponse;
-            s_ptr[x] = (short)bestSize;
         }
-    }
+    });
 
     return border;
 }
@@ -401,79 +405,94 @@ StarDetectorSuppressNonmax( const Mat& responses, const Mat& sizes,
                             int lineThresholdBinarized,
                             int suppressNonmaxSize )
 {
-    int x, y, x1, y1, delta = suppressNonmaxSize/2;
+    int delta = suppressNonmaxSize/2;
     int rows = responses.rows, cols = responses.cols;
     const float* r_ptr = responses.ptr<float>();
     int rstep = (int)(responses.step/sizeof(r_ptr[0]));
     const short* s_ptr = sizes.ptr<short>();
     int sstep = (int)(sizes.step/sizeof(s_ptr[0]));
-    short featureSize = 0;
 
-    for( y = border; y < rows - border; y += delta+1 )
-        for( x = border; x < cols - border; x += delta+1 )
+    // each row of tiles is processed independently, the keypoints are then gathered in the row order
+    int ntileRows = std::max(rows - 2*border + delta, 0)/(delta+1);
+    std::vector<std::vector<KeyPoint> > rowKeypoints(ntileRows);
+
+    parallel_for_(Range(0, ntileRows), [&](const Range& range)
+    {
+        for( int tileRow = range.start; tileRow < range.end; tileRow++ )
         {
-            float maxResponse = (float)responseThreshold;
-            float minResponse = (float)-responseThreshold;
-            Point maxPt(-1, -1), minPt(-1, -1);
-            int tileEndY = MIN(y + delta, rows - border - 1);
-            int tileEndX = MIN(x + delta, cols - border - 1);
-
-            for( y1 = y; y1 <= tileEndY; y1++ )
-                for( x1 = x; x1 <= tileEndX; x1++ )
-                {
-                    float val = r_ptr[y1*rstep + x1];
-                    if( maxResponse < val )
-                    {
-                        maxResponse = val;
-                        maxPt = Point(x1, y1);
-                    }
-                    else if( minResponse > val )
-                    {
-                        minResponse = val;
-                        minPt = Point(x1, y1);
-                    }
-                }
+            std::vector<KeyPoint>& kpts = rowKeypoints[tileRow];
+            int y = border + tileRow*(delta+1), x1, y1;
+            short featureSize = 0;
 
-            if( maxPt.x >= 0 )
+            for( int x = border; x < cols - border; x += delta+1 )
             {
-                for( y1 = maxPt.y - delta; y1 <= maxPt.y + delta; y1++ )
-                    for( x1 = maxPt.x - delta; x1 <= maxPt.x + delta; x1++ )
+                float maxResponse = (float)responseThreshold;
+                float minResponse = (float)-responseThreshold;
+                Point maxPt(-1, -1), minPt(-1, -1);
+                int tileEndY = MIN(y + delta, rows - border - 1);
+                int tileEndX = MIN(x + delta, cols - border - 1);
+
+                for( y1 = y; y1 <= tileEndY; y1++ )
+                    for( x1 = x; x1 <= tileEndX; x1++ )
                     {
                         float val = r_ptr[y1*rstep + x1];
-                        if( val >= maxResponse && (y1 != maxPt.y || x1 != maxPt.x))
-                            goto skip_max;
+                        if( maxResponse < val )
+                        {
+                            maxResponse = val;
+                            maxPt = Point(x1, y1);
+                        }
+                        else if( minResponse > val )
+                        {
+                            minResponse = val;
+                            minPt = Point(x1, y1);
+                        }
                     }
 
-                if( (featureSize = s_ptr[maxPt.y*sstep + maxPt.x]) >= 4 &&
-                    !StarDetectorSuppressLines( responses, sizes, maxPt, lineThresholdProjected,
-                                                lineThresholdBinarized ))
+                if( maxPt.x >= 0 )
                 {
-                    KeyPoint kpt((float)maxPt.x, (float)maxPt.y, featureSize, -1, maxResponse);
-                    keypoints.push_back(kpt);
-                }
-            }
-        skip_max:
-            if( minPt.x >= 0 )
-            {
-                for( y1 = minPt.y - delta; y1 <= minPt.y + delta; y1++ )
-                    for( x1 = minPt.x - delta; x1 <= minPt.x + delta; x1++ )
+                    for( y1 = maxPt.y - delta; y1 <= maxPt.y + delta; y1++ )
+                        for( x1 = maxPt.x - delta; x1 <= maxPt.x + delta; x1++ )
+                        {
+                            float val = r_ptr[y1*rstep + x1];
+                            if( val >= maxResponse && (y1 != maxPt.y || x1 != maxPt.x))
+                                goto skip_max;
+                        }
+
+                    if( (featureSize = s_ptr[maxPt.y*sstep + maxPt.x]) >= 4 &&
+                        !StarDetectorSuppressLines( responses, sizes, maxPt, lineThresholdProjected,
+                                                    lineThresholdBinarized ))
                     {
-                        float val = r_ptr[y1*rstep + x1];
-                        if( val <= minResponse && (y1 != minPt.y || x1 != minPt.x))
-                            goto skip_min;
+                        KeyPoint kpt((float)maxPt.x, (float)maxPt.y, featureSize, -1, maxResponse);
+                        kpts.push_back(kpt);
                     }
-
-                if( (featureSize = s_ptr[minPt.y*sstep + minPt.x]) >= 4 &&
-                    !StarDetectorSuppressLines( responses, sizes, minPt,
-                                               lineThresholdProjected, lineThresholdBinarized))
+                }
+            skip_max:
+                if( minPt.x >= 0 )
                 {
-                    KeyPoint kpt((float)minPt.x, (float)minPt.y, featureSize, -1, maxResponse);
-                    keypoints.push_back(kpt);
+                    for( y1 = minPt.y - delta; y1 <= minPt.y + delta; y1++ )
+                        for( x1 = minPt.x - delta; x1 <= minPt.x + delta; x1++ )
+                        {
+                            float val = r_ptr[y1*rstep + x1];
+                            if( val <= minResponse && (y1 != minPt.y || x1 != minPt.x))
+                                goto skip_min;
+                        }
+
+                    if( (featureSize = s_ptr[minPt.y*sstep + minPt.x]) >= 4 &&
+                        !StarDetectorSuppressLines( responses, sizes, minPt,
+                                                   lineThresholdProjected, lineThresholdBinarized))
+                    {
+                        KeyPoint kpt((float)minPt.x, (float)minPt.y, featureSize, -1, maxResponse);
+                        kpts.push_back(kpt);
+                    }
                 }
+            skip_min:
+                ;
             }
-        skip_min:
-            ;
         }
+    });
+
+    for( size_t i = 0; i < rowKeypoints.size(); i++ )
+        keypoints.insert(keypoints.end(), rowKeypoints[i].begin(), rowKeypoints[i].end());
 }
 
 StarDetectorImpl::StarDetectorImpl(int _maxSize, int _responseThreshold,
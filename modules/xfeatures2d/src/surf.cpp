@@ -109,6 +109,7 @@ Modifications by Ian Mahon
 */
 #include "precomp.hpp"
 #include "surf.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 
 namespace cv
 {
@@ -139,14 +140,88 @@ struct SurfHF
     SurfHF(): p0(0), p1(0), p2(0), p3(0), w(0) {}
 };
 
+/*
+ * The integral image of a large image overflows 32 bits, but the box sums are computed
+ * modulo 2^32 and a box sum itself fits in 32 bits, so they are still exact
+ */
+static inline int calcBoxSum( const int* origin, const SurfHF& f )
+{
+    return (int)((unsigned)origin[f.p0] + (unsigned)origin[f.p3] -
+                 (unsigned)origin[f.p1] - (unsigned)origin[f.p2]);
+}
+
+/*
+ * Integral image modulo 2^32 for calcBoxSum(). cv::integral into CV_32S would overflow
+ * signed ints once the sum of the image exceeds INT_MAX, while unsigned sums wrap around
+ */
+static void integralModulo32( const Mat& img, Mat& sum )
+{
+    CV_Assert( img.type() == CV_8U );
+    sum.create( img.rows + 1, img.cols + 1, CV_32S );
+    memset( sum.ptr(), 0, sum.cols*sizeof(int) );
+    for( int y = 0; y < img.rows; y++ )
+    {
+        const uchar* src = img.ptr<uchar>(y);
+        const unsigned* prev = sum.ptr<unsigned>(y);
+        unsigned* dst = sum.ptr<unsigned>(y + 1);
+        unsigned rowSum = 0;
+        dst[0] = 0;
+        for( int x = 0; x < img.cols; x++ )
+        {
+            rowSum += src[x];
+            dst[x + 1] = prev[x + 1] + rowSum;
+        }
+    }
+}
+
 inline float calcHaarPattern( const int* origin, const SurfHF* f, int n )
 {
     double d = 0;
     for( int k = 0; k < n; k++ )
-        d += (origin[f[k].p0] + origin[f[k].p3] - origin[f[k].p1] - origin[f[k].p2])*f[k].w;
+        d += calcBoxSum( origin, f[k] )*f[k].w;
     return (float)d;
 }
 
+#if CV_SIMD128
+/* Loads the integral image values of 4 consecutive samples, 'step' elements apart */
+static inline v_int32x4 loadSamples( const int* ptr, int step )
+{
+    return step == 1 ? v_load( ptr ) : v_int32x4( ptr[0], ptr[step], ptr[2*step], ptr[3*step] );
+}
+
+/*
+ * Same as calcHaarPattern for 4 consecutive samples. With CV_SIMD128_64F the
+ * weighted box sums are accumulated in double and rounded like calcHaarPattern;
+ * without it they are accumulated in float and may differ in the last bits
+ */
+static inline v_float32x4 calcHaarPattern4( const int* origin, const SurfHF* f, int n, int step )
+{
+#if CV_SIMD128_64F
+    v_float64x2 d0 = v_setzero_f64(), d1 = v_setzero_f64();
+#else
+    v_float32x4 d = v_setzero_f32();
+#endif
+    for( int k = 0; k < n; k++ )
+    {
+        // lane arithmetic wraps around like calcBoxSum
+        v_int32x4 box = loadSamples( origin + f[k].p0, step ) + loadSamples( origin + f[k].p3, step ) -
+                        loadSamples( origin + f[k].p1, step ) - loadSamples( origin + f[k].p2, step );
+        v_float32x4 t = v_cvt_f32( box ) * v_setall_f32( f[k].w );
+#if CV_SIMD128_64F
+        d0 += v_cvt_f64( t );
+        d1 += v_cvt_f64_high( t );
+#else
+        d += t;
+#endif
+    }
+#if CV_SIMD128_64F
+    return v_cvt_f32( d0, d1 );
+#else
+    return d;
+#endif
+}
+#endif
+
 static void
 resizeHaarPattern( const int src[][5], SurfHF* dst, int n, int oldSize, int newSize, int widthStep )
 {
@@ -167,7 +242,7 @@ resizeHaarPattern( const int src[][5], SurfHF* dst, int n, int oldSize, int newS
 
 /*
  * Calculate the determinant and trace of the Hessian for a layer of the
- * scale-space pyramid
+ * scale-space pyramid.
  */
 static void calcLayerDetAndTrace( const Mat& sum, int size, int sampleStep,
                                   Mat& det, Mat& trace )
@@ -182,9 +257,10 @@ static void calcLayerDetAndTrace( const Mat& sum, int size, int sampleStep,
     if( size > sum.rows-1 || size > sum.cols-1 )
        return;
 
-    resizeHaarPattern( dx_s , Dx , NX , 9, size, sum.cols );
-    resizeHaarPattern( dy_s , Dy , NY , 9, size, sum.cols );
-    resizeHaarPattern( dxy_s, Dxy, NXY, 9, size, sum.cols );
+    const int sum_step = (int)(sum.step/sum.elemSize());
+    resizeHaarPattern( dx_s , Dx , NX , 9, size, sum_step );
+    resizeHaarPattern( dy_s , Dy , NY , 9, size, sum_step );
+    resizeHaarPattern( dxy_s, Dxy, NXY, 9, size, sum_step );
 
     /* The integral image 'sum' is one pixel bigger than the source image */
     int samples_i = 1+(sum.rows-1-size)/sampleStep;
@@ -198,7 +274,20 @@ static void calcLayerDetAndTrace( const Mat& sum, int size, int sampleStep,
         const int* sum_ptr = sum.ptr<int>(i*sampleStep);
         float* det_ptr = &det.at<float>(i+margin, margin);
         float* trace_ptr = &trace.at<float>(i+margin, margin);
-        for( int j = 0; j < samples_j; j++ )
+        int j = 0;
+#if CV_SIMD128
+        const v_float32x4 v_081 = v_setall_f32( 0.81f );
+        for( ; j <= samples_j - 4; j += 4 )
+        {
+            v_float32x4 dx  = calcHaarPattern4( sum_ptr, Dx , 3, sampleStep );
+            v_float32x4 dy  = calcHaarPattern4( sum_ptr, Dy , 3, sampleStep );
+            v_float32x4 dxy = calcHaarPattern4( sum_ptr, Dxy, 4, sampleStep );
+            sum_ptr += 4*sampleStep;
+            v_store( det_ptr + j, dx*dy - v_081*dxy*dxy );
+            v_store( trace_ptr + j, dx + dy );
+        }
+#endif
+        for( ; j < samples_j; j++ )
         {
             float dx  = calcHaarPattern( sum_ptr, Dx , 3 );
             float dy  = calcHaarPattern( sum_ptr, Dy , 3 );
@@ -279,7 +368,9 @@ struct SURFBuildInvoker : ParallelLoopBody
     void operator()(const Range& range) const CV_OVERRIDE
     {
         for( int i=range.start; i<range.end; i++ )
+        {
             calcLayerDetAndTrace( *sum, (*sizes)[i], (*sampleSteps)[i], (*dets)[i], (*traces)[i] );
+        }
     }
 
     const Mat *sum;
@@ -289,17 +380,36 @@ struct SURFBuildInvoker : ParallelLoopBody
     std::vector<Mat>* traces;
 };
 
+struct KeypointGreater
+{
+    inline bool operator()(const KeyPoint& kp1, const KeyPoint& kp2) const
+    {
+        if(kp1.response > kp2.response) return true;
+        if(kp1.response < kp2.response) return false;
+        if(kp1.size > kp2.size) return true;
+        if(kp1.size < kp2.size) return false;
+        if(kp1.octave > kp2.octave) return true;
+        if(kp1.octave < kp2.octave) return false;
+        if(kp1.pt.y < kp2.pt.y) return false;
+        if(kp1.pt.y > kp2.pt.y) return true;
+        return kp1.pt.x < kp2.pt.x;
+    }
+};
+
+static bool isKeypointKept( const KeyPoint& kp, const Mat& sum, const Mat& mask, bool upright );
+
 // Multi-threaded search of the scale-space pyramid for keypoints
 struct SURFFindInvoker : ParallelLoopBody
 {
-    SURFFindInvoker( const Mat& _sum, const Mat& _mask_sum,
+    SURFFindInvoker( const Mat& _sum, const Mat& _mask_sum, const Mat& _mask,
                      const std::vector<Mat>& _dets, const std::vector<Mat>& _traces,
                      const std::vector<int>& _sizes, const std::vector<int>& _sampleSteps,
                      const std::vector<int>& _middleIndices, std::vector<KeyPoint>& _keypoints,
-                     int _nOctaveLayers, float _hessianThreshold )
+                     int _nOctaveLayers, float _hessianThreshold, int _maxKeypoints, bool _upright )
     {
         sum = &_sum;
         mask_sum = &_mask_sum;
+        mask = &_mask;
         dets = &_dets;
         traces = &_traces;
         sizes = &_sizes;
@@ -308,27 +418,36 @@ struct SURFFindInvoker : ParallelLoopBody
         keypoints = &_keypoints;
         nOctaveLayers = _nOctaveLayers;
         hessianThreshold = _hessianThreshold;
+        maxKeypoints = _maxKeypoints;
+        upright = _upright;
     }
 
-    static void findMaximaInLayer( const Mat& sum, const Mat& mask_sum,
+    static void findMaximaInLayer( const Mat& sum, const Mat& mask_sum, const Mat& mask,
                    const std::vector<Mat>& dets, const std::vector<Mat>& traces,
                    const std::vector<int>& sizes, std::vector<KeyPoint>& keypoints,
-                   int octave, int layer, float hessianThreshold, int sampleStep );
+                   int octave, int layer, float hessianThreshold, int sampleStep,
+                   int maxKeypoints, bool upright );
 
     void operator()(const Range& range) const CV_OVERRIDE
     {
+        std::vector<KeyPoint> layerKeypoints;
         for( int i=range.start; i<range.end; i++ )
         {
             int layer = (*middleIndices)[i];
             int octave = i / nOctaveLayers;
-            findMaximaInLayer( *sum, *mask_sum, *dets, *traces, *sizes,
-                               *keypoints, octave, layer, hessianThreshold,
-                               (*sampleSteps)[layer] );
+            layerKeypoints.clear();
+            findMaximaInLayer( *sum, *mask_sum, *mask, *dets, *traces, *sizes,
+                               layerKeypoints, octave, layer, hessianThreshold,
+                               (*sampleSteps)[layer], maxKeypoints, upright );
+
+            cv::AutoLock lock(findMaximaInLayer_m);
+            keypoints->insert(keypoints->end(), layerKeypoints.begin(), layerKeypoints.end());
         }
     }
 
     const Mat *sum;
     const Mat *mask_sum;
+    const Mat *mask;
     const std::vector<Mat>* dets;
     const std::vector<Mat>* traces;
     const std::vector<int>* sizes;
@@ -337,6 +456,8 @@ struct SURFFindInvoker : ParallelLoopBody
     std::vector<KeyPoint>* keypoints;
     int nOctaveLayers;
     float hessianThreshold;
+    int maxKeypoints;
+    bool upright;
 
     static Mutex findMaximaInLayer_m;
 };
@@ -346,12 +467,17 @@ Mutex SURFFindInvoker::findMaximaInLayer_m;
 
 /*
  * Find the maxima in the determinant of the Hessian in a layer of the
- * scale-space pyramid
+ * scale-space pyramid. With maxKeypoints > 0 only the strongest maxKeypoints
+ * maxima are kept; once that many are found, the threshold rises to the
+ * weakest one kept, so weaker candidates are rejected without further work.
+ * The maxima that detectAndCompute would drop later (masked out or without
+ * gradient samples) do not take a place among the kept ones
  */
-void SURFFindInvoker::findMaximaInLayer( const Mat& sum, const Mat& mask_sum,
+void SURFFindInvoker::findMaximaInLayer( const Mat& sum, const Mat& mask_sum, const Mat& mask,
                    const std::vector<Mat>& dets, const std::vector<Mat>& traces,
                    const std::vector<int>& sizes, std::vector<KeyPoint>& keypoints,
-                   int octave, int layer, float hessianThreshold, int sampleStep )
+                   int octave, int layer, float hessianThreshold, int sampleStep,
+                   int maxKeypoints, bool upright )
 {
     // Wavelet Data
     const int NM=1;
@@ -381,6 +507,11 @@ void SURFFindInvoker::findMaximaInLayer( const Mat& sum, const Mat& mask_sum,
             float val0 = det_ptr[j];
             if( val0 > hessianThreshold )
             {
+                // keypoints is a min-heap of the strongest maxima when it is bounded
+                if( maxKeypoints > 0 && (int)keypoints.size() >= maxKeypoints &&
+                    val0 < keypoints.front().response )
+                    continue;
+
                 /* Coordinates for the start of the wavelet in the sum image. There
                    is some integer division involved, so don't try to simplify this
                    (cancel out sampleStep) without checking the result is the same */
@@ -438,8 +569,21 @@ void SURFFindInvoker::findMaximaInLayer( const Mat& sum, const Mat& mask_sum,
                     if( interp_ok  )
                     {
                         /*printf( "KeyPoint %f %f %d\n", point.pt.x, point.pt.y, point.size );*/
-                        cv::AutoLock lock(findMaximaInLayer_m);
-                        keypoints.push_back(kpt);
+                        if( maxKeypoints <= 0 )
+                            keypoints.push_back(kpt);
+                        else if( !isKeypointKept(kpt, sum, mask, upright) )
+                            continue;
+                        else if( (int)keypoints.size() < maxKeypoints )
+                        {
+                            keypoints.push_back(kpt);
+                            std::push_heap(keypoints.begin(), keypoints.end(), KeypointGreater());
+                        }
+                        else if( KeypointGreater()(kpt, keypoints.front()) )
+                        {
+                            std::pop_heap(keypoints.begin(), keypoints.end(), KeypointGreater());
+                            keypoints.back() = kpt;
+                            std::push_heap(keypoints.begin(), keypoints.end(), KeypointGreater());
+                        }
                     }
                 }
             }
@@ -447,25 +591,10 @@ void SURFFindInvoker::findMaximaInLayer( const Mat& sum, const Mat& mask_sum,
     }
 }
 
-struct KeypointGreater
-{
-    inline bool operator()(const KeyPoint& kp1, const KeyPoint& kp2) const
-    {
-        if(kp1.response > kp2.response) return true;
-        if(kp1.response < kp2.response) return false;
-        if(kp1.size > kp2.size) return true;
-        if(kp1.size < kp2.size) return false;
-        if(kp1.octave > kp2.octave) return true;
-        if(kp1.octave < kp2.octave) return false;
-        if(kp1.pt.y < kp2.pt.y) return false;
-        if(kp1.pt.y > kp2.pt.y) return true;
-        return kp1.pt.x < kp2.pt.x;
-    }
-};
 
 
-static void fastHessianDetector( const Mat& sum, const Mat& mask_sum, std::vector<KeyPoint>& keypoints,
-                                 int nOctaves, int nOctaveLayers, float hessianThreshold )
+static void fastHessianDetector( const Mat& sum, const Mat& mask_sum, const Mat& mask, std::vector<KeyPoint>& keypoints,
+                                 int nOctaves, int nOctaveLayers, float hessianThreshold, int maxKeypoints, bool upright )
 {
     /* Sampling step along image x and y axes at first octave. This is doubled
        for each additional octave. WARNING: Increasing this improves speed,
@@ -509,9 +638,9 @@ static void fastHessianDetector( const Mat& sum, const Mat& mask_sum, std::vecto
 
     // Find maxima in the determinant of the hessian
     parallel_for_( Range(0, nMiddleLayers),
-                   SURFFindInvoker(sum, mask_sum, dets, traces, sizes,
+                   SURFFindInvoker(sum, mask_sum, mask, dets, traces, sizes,
                                    sampleSteps, middleIndices, keypoints,
-                                   nOctaveLayers, hessianThreshold) );
+                                   nOctaveLayers, hessianThreshold, maxKeypoints, upright) );
 
     std::sort(keypoints.begin(), keypoints.end(), KeypointGreater());
 }
@@ -868,6 +997,41 @@ struct SURFInvoker : ParallelLoopBody
     std::vector<float> DW;
 };
 
+/*
+ * Whether detectAndCompute returns a detected keypoint: it must be inside the
+ * mask and SURFInvoker must not mark it for deletion, i.e. its gradient wavelet
+ * fits in the image and, unless upright, at least one orientation sample does.
+ * The arithmetic is the one of SURFInvoker
+ */
+static bool isKeypointKept( const KeyPoint& kp, const Mat& sum, const Mat& mask, bool upright )
+{
+    if( !mask.empty() && mask.at<uchar>(Point(kp.pt)) == 0 )
+        return false;
+
+    float s = kp.size*1.2f/9.0f;
+    int grad_wav_size = 2*cvRound( 2*s );
+    if( sum.rows < grad_wav_size || sum.cols < grad_wav_size )
+        return false;
+    if( upright )
+        return true;
+
+    const int r = SURFInvoker::ORI_RADIUS;
+    for( int i = -r; i <= r; i++ )
+    {
+        for( int j = -r; j <= r; j++ )
+        {
+            if( i*i + j*j > r*r )
+                continue;
+            int x = cvRound( kp.pt.x + i*s - (float)(grad_wav_size-1)/2 );
+            int y = cvRound( kp.pt.y + j*s - (float)(grad_wav_size-1)/2 );
+            if( y >= 0 && y < sum.rows - grad_wav_size &&
+                x >= 0 && x < sum.cols - grad_wav_size )
+                return true;
+        }
+    }
+    return false;
+}
+
 
 SURF_Impl::SURF_Impl(double _threshold, int _nOctaves, int _nOctaveLayers, bool _extended, bool _upright)
 {
@@ -876,6 +1040,7 @@ SURF_Impl::SURF_Impl(double _threshold, int _nOctaves, int _nOctaveLayers, bool
     upright = _upright;
     nOctaves = _nOctaves;
     nOctaveLayers = _nOctaveLayers;
+    maxKeypoints = 0;
 }
 
 int SURF_Impl::descriptorSize() const { return extended ? 128 : 64; }
@@ -895,7 +1060,8 @@ void SURF_Impl::detectAndCompute(InputArray _img, InputArray _mask,
     CV_Assert(_descriptors.needed() || !useProvidedKeypoints);
 
 #ifdef HAVE_OPENCL
-    if( ocl::useOpenCL() && _img.isUMat())
+    // the OpenCL detector has no keypoint budget
+    if( ocl::useOpenCL() && _img.isUMat() && maxKeypoints <= 0 )
     {
         SURF_OCL ocl_surf;
         UMat gpu_kpt;
@@ -933,7 +1099,12 @@ void SURF_Impl::detectAndCompute(InputArray _img, InputArray _mask,
     CV_Assert(nOctaves > 0);
     CV_Assert(nOctaveLayers > 0);
 
-    integral(img, sum, CV_32S);
+    // the box sums are exact modulo 2^32 (see calcBoxSum), so the integral image stays 32-bit for
+    // large images too, it is only computed with wrap-around once the image sum can exceed INT_MAX
+    if( (double)img.total()*255 <= INT_MAX )
+        integral(img, sum, CV_32S);
+    else
+        integralModulo32(img, sum);
 
     // Compute keypoints only if we are not asked for evaluating the descriptors are some given locations:
     if( !useProvidedKeypoints )
@@ -941,9 +1112,10 @@ void SURF_Impl::detectAndCompute(InputArray _img, InputArray _mask,
         if( !mask.empty() )
         {
             cv::min(mask, 1, mask1);
+            // at most one per pixel, this one does not overflow
             integral(mask1, msum, CV_32S);
         }
-        fastHessianDetector( sum, msum, keypoints, nOctaves, nOctaveLayers, (float)hessianThreshold );
+        fastHessianDetector( sum, msum, mask, keypoints, nOctaves, nOctaveLayers, (float)hessianThreshold, maxKeypoints, upright );
         if (!mask.empty())
         {
             for (size_t i = 0; i < keypoints.size(); )
@@ -957,6 +1129,10 @@ void SURF_Impl::detectAndCompute(InputArray _img, InputArray _mask,
                 i++;
             }
         }
+        // keypoints are sorted by decreasing response, and with a budget all of them pass the mask
+        // and get a descriptor, so the strongest maxKeypoints are the ones returned
+        if( maxKeypoints > 0 && (int)keypoints.size() > maxKeypoints )
+            keypoints.resize(maxKeypoints);
     }
 
     int i, j, N = (int)keypoints.size();
@@ -984,7 +1160,21 @@ void SURF_Impl::detectAndCompute(InputArray _img, InputArray _mask,
 
         // we call SURFInvoker in any case, even if we do not need descriptors,
         // since it computes orientation of each feature.
-        parallel_for_(Range(0, N), SURFInvoker(img, sum, keypoints, descriptors, extended, upright) );
+        // upright keypoints without descriptors only need the size check
+        if( upright && !doDescriptors )
+        {
+            for( i = 0; i < N; i++ )
+            {
+                float s = keypoints[i].size*1.2f/9.0f;
+                int grad_wav_size = 2*cvRound( 2*s );
+                if( sum.rows < grad_wav_size || sum.cols < grad_wav_size )
+                    keypoints[i].size = -1;
+                else
+                    keypoints[i].angle = 360.f - 90.f;
+            }
+        }
+        else
+            parallel_for_(Range(0, N), SURFInvoker(img, sum, keypoints, descriptors, extended, upright) );
 
         // remove keypoints that were marked for deletion
         for( i = j = 0; i < N; i++ )
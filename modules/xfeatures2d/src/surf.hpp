@@ -57,11 +57,15 @@ public:
     void setUpright(bool upright_) CV_OVERRIDE { upright = upright_; }
     bool getUpright() const CV_OVERRIDE { return upright; }
 
+    void setMaxKeypoints(int maxKeypoints_) CV_OVERRIDE { maxKeypoints = maxKeypoints_; }
+    int getMaxKeypoints() const CV_OVERRIDE { return maxKeypoints; }
+
     double hessianThreshold;
     int nOctaves;
     int nOctaveLayers;
     bool extended;
     bool upright;
+    int maxKeypoints;
 };
 
 #ifdef HAVE_OPENCL
@@ -86,10 +86,62 @@ class TBMR_Impl CV_FINAL : public TBMR
             return parent[p] = zfindroot(parent, parent[p]);
     }
 
+    // component tree representation (parent,S): see
+    // https://ieeexplore.ieee.org/document/6850018
+    // one set per concurrently processed (scale, polarity) tree, kept
+    // between calls to reuse the allocations
+    struct TreeBuffers
+    {
+        Mat parent;
+        Mat S;
+        // moments: compound type of: (area, x, y, xy, xx, yy)
+        Mat imaAttributes;
+    };
+
+    // Sort the pixel indices of an 8-bit image by increasing (or decreasing)
+    // gray level with a counting sort, which is linear in the image size
+    static void sortPixels(const Mat &ima, Mat &S, bool descending)
+    {
+        CV_Assert(ima.type() == CV_8UC1 && ima.isContinuous());
+        uint imSize = (uint)ima.total();
+        S.create(1, (int)imSize, CV_32S);
+
+        uint hist[256] = { 0 };
+        const uchar *ima_ptr = ima.ptr<uchar>();
+        for (uint p = 0; p < imSize; ++p)
+            hist[ima_ptr[p]]++;
+
+        uint pos[256];
+        uint acc = 0;
+        for (int v = 0; v < 256; ++v)
+        {
+            int level = descending ? 255 - v : v;
+            pos[level] = acc;
+            acc += hist[level];
+        }
+
+        uint *S_ptr = S.ptr<uint>();
+        if (!descending)
+        {
+            for (uint p = 0; p < imSize; ++p)
+                S_ptr[pos[ima_ptr[p]]++] = p;
+        }
+        else
+        {
+            // reversed order of the ascending sort, as the former flip(S)
+            for (uint p = imSize; p-- > 0;)
+                S_ptr[pos[ima_ptr[p]]++] = p;
+        }
+    }
+
     // Calculate the Component tree. Based on the order of S, it will be a
     // min or max tree.
-    void calcMinMaxTree(Mat ima)
+    void calcMinMaxTree(Mat ima, TreeBuffers &buf)
     {
+        Mat &parent = buf.parent;
+        const Mat &S = buf.S;
+        Mat &imaAttributes = buf.imaAttributes;
+
         int rs = ima.rows;
         int cs = ima.cols;
         uint imSize = (uint)rs * cs;
@@ -187,8 +239,13 @@ class TBMR_Impl CV_FINAL : public TBMR
     }
 
     void calculateTBMRs(const Mat &image, std::vector<Elliptic_KeyPoint> &tbmrs,
-                        const Mat &mask, float scale, int octave)
+                        const Mat &mask, float scale, int octave,
+                        TreeBuffers &buf)
     {
+        Mat &parent = buf.parent;
+        const Mat &S = buf.S;
+        Mat &imaAttributes = buf.imaAttributes;
+
         uint imSize = image.cols * image.rows;
         uint maxArea =
             static_cast<uint>(params.maxAreaRelative * imSize * scale);
@@ -200,7 +257,7 @@ class TBMR_Impl CV_FINAL : public TBMR
         if (imaAttributes.empty() || imaAttributes.size != image.size)
             imaAttributes = Mat(image.rows, image.cols, CV_32SC(6));
 
-        calcMinMaxTree(image);
+        calcMinMaxTree(image, buf);
 
         const Vec<uint, 6> *imaAttribute =
             imaAttributes.ptr<const Vec<uint, 6>>();
@@ -453,12 +510,7 @@ class TBMR_Impl CV_FINAL : public TBMR
 
     Mat tempsrc;
 
-    // component tree representation (parent,S): see
-    // https://ieeexplore.ieee.org/document/6850018
-    Mat parent;
-    Mat S;
-    // moments: compound type of: (area, x, y, xy, xx, yy)
-    Mat imaAttributes;
+    std::vector<TreeBuffers> trees;
 
     Params params;
 };
@@ -517,20 +569,33 @@ void TBMR_Impl::detect(InputArray _image,
     MSDImagePyramid scaleSpacer(src, m_cur_n_scales, m_scale_factor);
     pyr = scaleSpacer.getImPyr();
 
-    int oct = 0;
-    for (auto &s : pyr)
+    // the max and min trees of every scale are independent: build and
+    // analyze them concurrently, each with its own tree buffers
+    int ntrees = (int)pyr.size() * 2;
+    if ((int)trees.size() < ntrees)
+        trees.resize(ntrees);
+    std::vector<std::vector<Elliptic_KeyPoint>> treeKpts(ntrees);
+
+    parallel_for_(Range(0, ntrees), [&](const Range &range)
     {
-        float scale = ((float)s.cols) / pyr.begin()->cols;
-        std::vector<Elliptic_KeyPoint> kpts;
+        for (int t = range.start; t < range.end; ++t)
+        {
+            int oct = t / 2;
+            const Mat &s = pyr[oct];
+            float scale = ((float)s.cols) / pyr.begin()->cols;
 
-        // append max tree tbmrs
-        sortIdx(s.reshape(1, 1), S,
-                SortFlags::SORT_ASCENDING | SortFlags::SORT_EVERY_ROW);
-        calculateTBMRs(s, kpts, mask, scale, oct);
+            // even trees are max trees, odd ones min trees (reverse order)
+            sortPixels(s, trees[t].S, (t % 2) != 0);
+            calculateTBMRs(s, treeKpts[t], mask, scale, oct, trees[t]);
+        }
+    });
 
-        // reverse instead of sort
-        flip(S, S, -1);
-        calculateTBMRs(s, kpts, mask, scale, oct);
+    for (int oct = 0; oct < (int)pyr.size(); oct++)
+    {
+        // append max tree tbmrs, then min tree tbmrs
+        std::vector<Elliptic_KeyPoint> &kpts = treeKpts[oct * 2];
+        kpts.insert(kpts.end(), treeKpts[oct * 2 + 1].begin(),
+                    treeKpts[oct * 2 + 1].end());
 
         if (oct == 0)
         {
@@ -556,8 +621,6 @@ void TBMR_Impl::detect(InputArray _image,
                 }
             }
         }
-
-        oct++;
     }
 }
 
@@ -126,6 +126,45 @@ TEST( Features2d_DescriptorExtractor_SURF_OCL, regression )
     cv::ocl::setUseOpenCL(useOCL);
 }
 #endif
+
+TEST( Features2d_Detector_SURF, max_keypoints )
+{
+    Mat image = imread(cvtest::TS::ptr()->get_data_path() + "shared/lena.png", IMREAD_GRAYSCALE);
+    ASSERT_FALSE(image.empty());
+
+    // the budget is applied to the keypoints that pass the mask and get a descriptor
+    Mat mask = Mat::zeros(image.size(), CV_8U);
+    mask(Rect(0, 0, image.cols/2, image.rows)).setTo(255);
+    const Mat masks[] = { Mat(), mask };
+
+    for (int upright = 0; upright <= 1; upright++)
+    for (int m = 0; m < 2; m++)
+    {
+        Ptr<SURF> surf = SURF::create(50);
+        surf->setUpright(upright != 0);
+        vector<KeyPoint> all, strongest;
+        Mat descriptors;
+        surf->detectAndCompute(image, masks[m], all, descriptors);
+
+        const int maxKeypoints = 300;
+        ASSERT_GT((int)all.size(), maxKeypoints);
+        surf->setMaxKeypoints(maxKeypoints);
+        surf->detectAndCompute(image, masks[m], strongest, descriptors);
+
+        // the budgeted detection returns the strongest keypoints of the full detection
+        ASSERT_EQ(maxKeypoints, (int)strongest.size()) << "upright=" << upright << ", mask=" << m;
+        EXPECT_EQ(maxKeypoints, descriptors.rows);
+        const float weakest = all[maxKeypoints - 1].response;
+        for (size_t i = 0; i < strongest.size(); i++)
+        {
+            EXPECT_GE(strongest[i].response, weakest);
+            bool found = false;
+            for (size_t j = 0; j < all.size() && !found; j++)
+                found = all[j].pt == strongest[i].pt && all[j].response == strongest[i].response;
+            EXPECT_TRUE(found) << "keypoint " << i << ", upright=" << upright << ", mask=" << m;
+        }
+    }
+}
 #endif // NONFREE
 
 TEST( Features2d_DescriptorExtractor_DAISY, regression )
@@ -135,6 +174,34 @@ TEST( Features2d_DescriptorExtractor_DAISY, regression )
     test.safe_run();
 }
 
+TEST( Features2d_DescriptorExtractor_DAISY, bands_match_full_image )
+{
+    Mat image(200, 160, CV_8UC1);
+    randu(image, Scalar::all(0), Scalar::all(256));
+    GaussianBlur(image, image, Size(5, 5), 1.5);
+
+    Ptr<DAISY> daisy = DAISY::create();
+    Mat full;
+    daisy->compute(image, full);
+
+    // small budget to force several bands
+    Mat banded(full.size(), full.type(), Scalar::all(-1));
+    int nextRow = 0, nbands = 0;
+    daisy->compute(image, [&](const Rect& band, const Mat& descriptors)
+    {
+        ASSERT_EQ(nextRow, band.y);
+        ASSERT_EQ(image.cols, band.width);
+        ASSERT_EQ(band.area(), descriptors.rows);
+        descriptors.copyTo(banded.rowRange(band.y*image.cols, (band.y + band.height)*image.cols));
+        nextRow += band.height;
+        nbands++;
+    }, (size_t)24 << 20);
+
+    EXPECT_EQ(image.rows, nextRow);
+    EXPECT_GT(nbands, 1);
+    EXPECT_LE(cvtest::norm(full, banded, NORM_INF), 1e-4);
+}
+
 TEST( Features2d_DescriptorExtractor_FREAK, regression )
 {
     CV_DescriptorExtractorTest<Hamming> test("descriptor-freak", (CV_DescriptorExtractorTest<Hamming>::DistanceType)12.f,
@@ -82,11 +82,12 @@ public:
 protected:
     int match_num;
     int w, h;
-    //internal buffers:
-    vector<node>* g;
+    //internal buffers, kept between calls to avoid reallocation for frames of the same size:
+    vector<vector<node> > g;
     Mat NNlabels;
     Mat NNdistances;
     Mat labels;
+    Mat geodesicDistances;
     Mat costMap;
     //tunable parameters:
     float lambda;
@@ -99,6 +100,9 @@ protected:
     // static parameters:
     static const int ransac_interpolation_num_iter = 1;
     static const int distance_transform_num_iter = 1;
+    // skewed tiles of the parallel distance transform, the tile width must exceed the band height
+    static const int distance_transform_band_rows = 32;
+    static const int distance_transform_tile_cols = 128;
     float regularization_coef;
     static const int ransac_num_stripes = 4;
     RNG rngs[ransac_num_stripes];
@@ -106,6 +110,7 @@ protected:
     void init();
     void preprocessData(Mat& src, vector<SparseMatch>& matches);
     void geodesicDistanceTransform(Mat& distances, Mat& cost_map);
+    void geodesicDistanceTile(Mat& distances, Mat& cost_map, int band, int tile, bool forward);
     void buildGraph(Mat& distances, Mat& cost_map);
     void ransacInterpolation(vector<SparseMatch>& matches, Mat& dst_dense_flow);
 
@@ -204,13 +209,16 @@ void EdgeAwareInterpolatorImpl::interpolate(InputArray from_image, InputArray fr
     CV_Assert(match_num<SHRT_MAX);
 
     Mat src = from_image.getMat();
-    labels = Mat(h,w,CV_32S);
+    labels.create(h,w,CV_32S);
     labels = Scalar(-1);
-    NNlabels = Mat(match_num,k,CV_32S);
+    NNlabels.create(match_num,k,CV_32S);
     NNlabels = Scalar(-1);
-    NNdistances = Mat(match_num,k,CV_32F);
+    NNdistances.create(match_num,k,CV_32F);
     NNdistances = Scalar(0.0f);
-    g = new vector<node>[match_num];
+    if((int)g.size()<match_num)
+        g.resize(match_num);
+    for(int i=0;i<match_num;i++)
+        g[i].clear();
 
     preprocessData(src,matches_vector);
 
@@ -221,13 +229,12 @@ void EdgeAwareInterpolatorImpl::interpolate(InputArray from_image, InputArray fr
         fastGlobalSmootherFilter(src,dst,dst,fgs_lambda,fgs_sigma);
 
     costMap.release();
-    delete[] g;
 }
 
 void EdgeAwareInterpolatorImpl::preprocessData(Mat& src, vector<SparseMatch>& matches)
 {
-    Mat distances(h,w,CV_32F);
-    distances = Scalar(INF);
+    geodesicDistances.create(h,w,CV_32F);
+    geodesicDistances = Scalar(INF);
 
     int x,y;
     for(unsigned int i=0;i<matches.size();i++)
@@ -235,7 +242,7 @@ void EdgeAwareInterpolatorImpl::preprocessData(Mat& src, vector<SparseMatch>& ma
         x = min((int)(matches[i].reference_image_pos.x+0.5f),w-1);
         y = min((int)(matches[i].reference_image_pos.y+0.5f),h-1);
 
-        distances.at<float>(y,x) = 0.0f;
+        geodesicDistances.at<float>(y,x) = 0.0f;
         labels.at<int>(y,x) = (int)i;
     }
 
@@ -247,21 +254,52 @@ void EdgeAwareInterpolatorImpl::preprocessData(Mat& src, vector<SparseMatch>& ma
     else
         CV_Assert(costMap.cols == w && costMap.rows == h);
     costMap = (1000.0f-lambda) + lambda* costMap;
-    geodesicDistanceTransform(distances, costMap);
-    buildGraph(distances, costMap);
+    geodesicDistanceTransform(geodesicDistances, costMap);
+    buildGraph(geodesicDistances, costMap);
     parallel_for_(Range(0,getNumThreads()),GetKNNMatches_ParBody(*this,getNumThreads()));
 }
 
 void EdgeAwareInterpolatorImpl::geodesicDistanceTransform(Mat& distances, Mat& cost_map)
 {
-    float c1 = 1.0f / 2.0f;
-    float c2 = sqrt(2.0f) / 2.0f;
+    // Both raster passes are run as a wavefront over bands of rows cut into tiles. Row s of a band is
+    // shifted left by s pixels, so the causal neighbours of a pixel lie in its own tile, in the tile to
+    // its left or in the two tiles above it, and tiles on the same wave can be processed concurrently.
+    // Every pixel is relaxed in the same order as in a serial scan, the result does not depend on the
+    // number of threads.
+    const int num_bands = (h + distance_transform_band_rows - 1) / distance_transform_band_rows;
+    const int num_tiles = (w + distance_transform_band_rows - 2) / distance_transform_tile_cols + 1;
+    const int num_waves = 2 * (num_bands - 1) + num_tiles;
+
+    for (int it = 0; it < distance_transform_num_iter; it++)
+    {
+        for (int pass = 0; pass < 2; pass++)
+        {
+            //first pass (left-to-right, top-to-bottom), second pass (right-to-left, bottom-to-top):
+            const bool forward = pass == 0;
+            for (int wave = 0; wave < num_waves; wave++)
+            {
+                // tile (band, wave - 2*band) must be a valid tile index
+                const int first_band = std::max(0, (wave - num_tiles + 2) / 2);
+                const int last_band  = std::min(num_bands - 1, wave / 2);
+                parallel_for_(Range(first_band, last_band + 1), [&](const Range& range)
+                {
+                    for (int band = range.start; band < range.end; band++)
+                        geodesicDistanceTile(distances, cost_map, band, wave - 2 * band, forward);
+                });
+            }
+        }
+    }
+}
+
+void EdgeAwareInterpolatorImpl::geodesicDistanceTile(Mat& distances, Mat& cost_map, int band, int tile, bool forward)
+{
+    const float c1 = 1.0f / 2.0f;
+    const float c2 = sqrt(2.0f) / 2.0f;
     float d = 0.0f;
-    int i, j;
-    float *dist_row, *cost_row;
-    float *dist_row_prev, *cost_row_prev;
-    int *label_row;
-    int *label_row_prev;
+    // scan coordinates (si, sj) are mirrored for the backward pass, neighbours are at offsets -s in scan order
+    const int s = forward ? 1 : -1;
+    const int row_start = band * distance_transform_band_rows;
+    const int row_end = std::min(row_start + distance_transform_band_rows, h);
 
 #define CHECK(cur_dist,cur_label,cur_cost,prev_dist,prev_label,prev_cost,coef)\
 {\
@@ -271,74 +309,44 @@ void EdgeAwareInterpolatorImpl::geodesicDistanceTransform(Mat& distances, Mat& c
         cur_label = prev_label;}\
 }
 
-    for (int it = 0; it < distance_transform_num_iter; it++)
+    for (int si = row_start; si < row_end; si++)
     {
-        //first pass (left-to-right, top-to-bottom):
-        dist_row = distances.ptr<float>(0);
-        label_row = labels.ptr<int>(0);
-        cost_row = cost_map.ptr<float>(0);
-        for (j = 1; j < w; j++)
-            CHECK(dist_row[j], label_row[j], cost_row[j], dist_row[j - 1], label_row[j - 1], cost_row[j - 1], c1);
-
-        for (i = 1; i < h; i++)
-        {
-            dist_row = distances.ptr<float>(i);
-            dist_row_prev = distances.ptr<float>(i - 1);
-
-            label_row = labels.ptr<int>(i);
-            label_row_prev = labels.ptr<int>(i - 1);
+        const int skew = si - row_start;
+        const int sj_start = std::max(tile * distance_transform_tile_cols - skew, 0);
+        const int sj_end = std::min((tile + 1) * distance_transform_tile_cols - skew, w);
+        if (sj_start >= sj_end)
+            continue;
 
-            cost_row = cost_map.ptr<float>(i);
-            cost_row_prev = cost_map.ptr<float>(i - 1);
+        const int i = forward ? si : h - 1 - si;
+        float* dist_row = distances.ptr<float>(i);
+        int* label_row = labels.ptr<int>(i);
+        float* cost_row = cost_map.ptr<float>(i);
 
-            j = 0;
-            CHECK(dist_row[j], label_row[j], cost_row[j], dist_row_prev[j], label_row_prev[j], cost_row_prev[j], c1);
-            CHECK(dist_row[j], label_row[j], cost_row[j], dist_row_prev[j + 1], label_row_prev[j + 1], cost_row_prev[j + 1], c2);
-            j++;
-            for (; j < w - 1; j++)
+        if (si == 0)
+        {
+            for (int sj = std::max(sj_start, 1); sj < sj_end; sj++)
             {
-                CHECK(dist_row[j], label_row[j], cost_row[j], dist_row[j - 1], label_row[j - 1], cost_row[j - 1], c1);
-                CHECK(dist_row[j], label_row[j], cost_row[j], dist_row_prev[j - 1], label_row_prev[j - 1], cost_row_prev[j - 1], c2);
-                CHECK(dist_row[j], label_row[j], cost_row[j], dist_row_prev[j], label_row_prev[j], cost_row_prev[j], c1);
-                CHECK(dist_row[j], label_row[j], cost_row[j], dist_row_prev[j + 1], label_row_prev[j + 1], cost_row_prev[j + 1], c2);
+                const int j = forward ? sj : w - 1 - sj;
+                CHECK(dist_row[j], label_row[j], cost_row[j], dist_row[j - s], label_row[j - s], cost_row[j - s], c1);
             }
-            CHECK(dist_row[j], label_row[j], cost_row[j], dist_row[j - 1], label_row[j - 1], cost_row[j - 1], c1);
-            CHECK(dist_row[j], label_row[j], cost_row[j], dist_row_prev[j - 1], label_row_prev[j - 1], cost_row_prev[j - 1], c2);
-            CHECK(dist_row[j], label_row[j], cost_row[j], dist_row_prev[j], label_row_prev[j], cost_row_prev[j], c1);
+            continue;
         }
 
-        //second pass (right-to-left, bottom-to-top):
-        dist_row = distances.ptr<float>(h - 1);
-        label_row = labels.ptr<int>(h - 1);
-        cost_row = cost_map.ptr<float>(h - 1);
-        for (j = w - 2; j >= 0; j--)
-            CHECK(dist_row[j], label_row[j], cost_row[j], dist_row[j + 1], label_row[j + 1], cost_row[j + 1], c1);
+        float* dist_row_prev = distances.ptr<float>(i - s);
+        int* label_row_prev = labels.ptr<int>(i - s);
+        float* cost_row_prev = cost_map.ptr<float>(i - s);
 
-        for (i = h - 2; i >= 0; i--)
+        for (int sj = sj_start; sj < sj_end; sj++)
         {
-            dist_row = distances.ptr<float>(i);
-            dist_row_prev = distances.ptr<float>(i + 1);
-
-            label_row = labels.ptr<int>(i);
-            label_row_prev = labels.ptr<int>(i + 1);
-
-            cost_row = cost_map.ptr<float>(i);
-            cost_row_prev = cost_map.ptr<float>(i + 1);
-
-            j = w - 1;
-            CHECK(dist_row[j], label_row[j], cost_row[j], dist_row_prev[j], label_row_prev[j], cost_row_prev[j], c1);
-            CHECK(dist_row[j], label_row[j], cost_row[j], dist_row_prev[j - 1], label_row_prev[j - 1], cost_row_prev[j - 1], c2);
-            j--;
-            for (; j > 0; j--)
+            const int j = forward ? sj : w - 1 - sj;
+            if (sj > 0)
             {
-                CHECK(dist_row[j], label_row[j], cost_row[j], dist_row[j + 1], label_row[j + 1], cost_row[j + 1], c1);
-                CHECK(dist_row[j], label_row[j], cost_row[j], dist_row_prev[j + 1], label_row_prev[j + 1], cost_row_prev[j + 1], c2);
-                CHECK(dist_row[j], label_row[j], cost_row[j], dist_row_prev[j], label_row_prev[j], cost_row_prev[j], c1);
-                CHECK(dist_row[j], label_row[j], cost_row[j], dist_row_prev[j - 1], label_row_prev[j - 1], cost_row_prev[j - 1], c2);
+                CHECK(dist_row[j], label_row[j], cost_row[j], dist_row[j - s], label_row[j - s], cost_row[j - s], c1);
+                CHECK(dist_row[j], label_row[j], cost_row[j], dist_row_prev[j - s], label_row_prev[j - s], cost_row_prev[j - s], c2);
             }
-            CHECK(dist_row[j], label_row[j], cost_row[j], dist_row[j + 1], label_row[j + 1], cost_row[j + 1], c1);
-            CHECK(dist_row[j], label_row[j], cost_row[j], dist_row_prev[j + 1], label_row_prev[j + 1], cost_row_prev[j + 1], c2);
             CHECK(dist_row[j], label_row[j], cost_row[j], dist_row_prev[j], label_row_prev[j], cost_row_prev[j], c1);
+            if (sj < w - 1)
+                CHECK(dist_row[j], label_row[j], cost_row[j], dist_row_prev[j + s], label_row_prev[j + s], cost_row_prev[j + s], c2);
         }
     }
 #undef CHECK
@@ -869,18 +877,19 @@ void EdgeAwareInterpolatorImpl::ransacInterpolation(vector<SparseMatch>& matches
     parallel_for_(Range(0,ransac_num_stripes),RansacInterpolation_ParBody(*this,transforms,weighted_inlier_nums,eps,&matches.front(),ransac_num_stripes,-1));
 
     //construct the final piecewise-affine interpolation:
-    int* label_row;
-    float* tr;
-    for(int i=0;i<h;i++)
+    parallel_for_(Range(0,h),[&](const Range& range)
     {
-        label_row = labels.ptr<int>(i);
-        Point2f* dst_row = dst_dense_flow.ptr<Point2f>(i);
-        for(int j=0;j<w;j++)
+        for(int i=range.start;i<range.end;i++)
         {
-            tr = transforms[label_row[j]].ptr<float>(0);
-            dst_row[j] = Point2f(tr[0]*j+tr[1]*i+tr[2],tr[3]*j+tr[4]*i+tr[5]) - Point2f((float)j,(float)i);
+            const int* label_row = labels.ptr<int>(i);
+            Point2f* dst_row = dst_dense_flow.ptr<Point2f>(i);
+            for(int j=0;j<w;j++)
+            {
+                const float* tr = transforms[label_row[j]].ptr<float>(0);
+                dst_row[j] = Point2f(tr[0]*j+tr[1]*i+tr[2],tr[3]*j+tr[4]*i+tr[5]) - Point2f((float)j,(float)i);
+            }
         }
-    }
+    });
 
     delete[] transforms;
     delete[] weighted_inlier_nums;
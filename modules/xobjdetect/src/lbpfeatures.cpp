@@ -108,17 +108,24 @@ CvLBPEvaluator::Feature::Feature( int offset, int x, int y, int _blockWidth, int
 
 void CvLBPEvaluator::Feature::calcPoints(int offset)
 {
-    Rect tr = rect = Rect(x_, y_, block_w_, block_h_);
-    CV_SUM_OFFSETS( p[0], p[1], p[4], p[5], tr, offset )
-    tr.x += 2*rect.width;
-    CV_SUM_OFFSETS( p[2], p[3], p[6], p[7], tr, offset )
-    tr.y +=2*rect.height;
-    CV_SUM_OFFSETS( p[10], p[11], p[14], p[15], tr, offset )
-    tr.x -= 2*rect.width;
-    CV_SUM_OFFSETS( p[8], p[9], p[12], p[13], tr, offset )
+    rect = Rect(x_, y_, block_w_, block_h_);
+    getPoints(offset, p);
     offset_ = offset;
 }
 
+void CvLBPEvaluator::Feature::getPoints(int offset, int points[16]) const
+{
+    const Rect block(x_, y_, block_w_, block_h_);
+    Rect tr = block;
+    CV_SUM_OFFSETS( points[0], points[1], points[4], points[5], tr, offset )
+    tr.x += 2*block.width;
+    CV_SUM_OFFSETS( points[2], points[3], points[6], points[7], tr, offset )
+    tr.y +=2*block.height;
+    CV_SUM_OFFSETS( points[10], points[11], points[14], points[15], tr, offset )
+    tr.x -= 2*block.width;
+    CV_SUM_OFFSETS( points[8], points[9], points[12], points[13], tr, offset )
+}
+
 void CvLBPEvaluator::Feature::write(FileStorage &fs) const
 {
     fs << CC_RECT << "[:" << rect.x << rect.y << rect.width << rect.height << "]";
@@ -71,6 +71,13 @@ public:
     virtual float operator()(int featureIdx) CV_OVERRIDE
     { return (float)features[featureIdx].calc( cur_sum ); }
     virtual void writeFeatures( cv::FileStorage &fs, const cv::Mat& featureMap ) const CV_OVERRIDE;
+
+    // sum offsets of a feature for an integral image with the given row step,
+    // unlike setImage() it does not change the evaluator state
+    void getFeaturePoints( int featureIdx, int step, int points[16] ) const
+    { features[featureIdx].getPoints( step, points ); }
+    // LBP code of the feature with the given sum offsets at psum
+    static uchar calcLBP( const int* psum, const int* p );
 protected:
     virtual void generateFeatures() CV_OVERRIDE;
 
@@ -87,6 +94,7 @@ protected:
 
         int x_, y_, block_w_, block_h_, offset_;
         void calcPoints(int offset);
+        void getPoints(int offset, int points[16]) const;
     };
     std::vector<Feature> features;
 
@@ -94,10 +102,8 @@ protected:
     int offset_;
 };
 
-inline uchar CvLBPEvaluator::Feature::calc(const cv::Mat &_sum)
+inline uchar CvLBPEvaluator::calcLBP(const int* psum, const int* p)
 {
-    const int* psum = _sum.ptr<int>();
-
     int cval = psum[p[5]] - psum[p[6]] - psum[p[9]] + psum[p[10]];
 
     return (uchar)((psum[p[0]] - psum[p[1]] - psum[p[4]] + psum[p[5]] >= cval ? 128 : 0) |   // 0
@@ -110,6 +116,11 @@ inline uchar CvLBPEvaluator::Feature::calc(const cv::Mat &_sum)
         (psum[p[4]] - psum[p[5]] - psum[p[8]] + psum[p[9]] >= cval ? 1 : 0));     // 3
 }
 
+inline uchar CvLBPEvaluator::Feature::calc(const cv::Mat &_sum)
+{
+    return calcLBP(_sum.ptr<int>(), p);
+}
+
 }
 }
 
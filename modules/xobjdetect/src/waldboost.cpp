@@ -43,6 +43,7 @@ the use of this software, even if advised of the possibility of such damage.
 */
 
 #include "precomp.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 
 namespace cv {
 namespace xobjdetect {
@@ -118,35 +119,158 @@ std::vector<int> WaldBoost::get_feature_indices()
     return feature_indices_;
 }
 
-void WaldBoost::detect(Ptr<CvFeatureEvaluator> eval,
+#if CV_SIMD128
+// LBP codes of 4 windows, s holds the sums at the 16 feature points,
+// same layout as CvLBPEvaluator::calcLBP
+static inline v_int32x4 v_calc_lbp(const v_int32x4* s)
+{
+    v_int32x4 cval = s[5] - s[6] - s[9] + s[10];
+
+    v_int32x4 code = ((s[0] - s[1] - s[4] + s[5]) >= cval) & v_setall_s32(128);
+    code = code | (((s[1] - s[2] - s[5] + s[6]) >= cval) & v_setall_s32(64));
+    code = code | (((s[2] - s[3] - s[6] + s[7]) >= cval) & v_setall_s32(32));
+    code = code | (((s[6] - s[7] - s[10] + s[11]) >= cval) & v_setall_s32(16));
+    code = code | (((s[10] - s[11] - s[14] + s[15]) >= cval) & v_setall_s32(8));
+    code = code | (((s[9] - s[10] - s[13] + s[14]) >= cval) & v_setall_s32(4));
+    code = code | (((s[8] - s[9] - s[12] + s[13]) >= cval) & v_setall_s32(2));
+    code = code | (((s[4] - s[5] - s[8] + s[9]) >= cval) & v_setall_s32(1));
+    return code;
+}
+#endif
+
+void WaldBoost::detect_windows(Ptr<CvFeatureEvaluator> eval,
             const Mat& img, const std::vector<float>& scales,
-            std::vector<Rect>& bboxes, Mat1f& confidences)
+            std::vector<Rect>& bboxes, std::vector<float>& confidences)
 {
-    bboxes.clear();
-    confidences.release();
+    const int step = 4;
+    Ptr<CvLBPEvaluator> lbp = eval.dynamicCast<CvLBPEvaluator>();
+    if (!lbp) {
+        Mat resized_img;
+        float h;
+        for (size_t i = 0; i < scales.size(); ++i) {
+            float scale = scales[i];
+            resize(img, resized_img, Size(), scale, scale, INTER_LINEAR_EXACT);
+            eval->setImage(resized_img, 0, 0, feature_indices_);
+            int n_rows = (int)(24 / scale);
+            int n_cols = (int)(24 / scale);
+            for (int r = 0; r + 24 < resized_img.rows; r += step) {
+                for (int c = 0; c + 24 < resized_img.cols; c += step) {
+                    eval->setWindow(Point(c, r));
+                    if (predict(eval, &h) == +1) {
+                        int row = (int)(r / scale);
+                        int col = (int)(c / scale);
+                        bboxes.push_back(Rect(col, row, n_cols, n_rows));
+                        confidences.push_back(h);
+                    }
+                }
+            }
+        }
+        return;
+    }
 
-    Mat resized_img;
-    int step = 4;
-    float h;
-    for (size_t i = 0; i < scales.size(); ++i) {
-        float scale = scales[i];
-        resize(img, resized_img, Size(), scale, scale, INTER_LINEAR_EXACT);
-        eval->setImage(resized_img, 0, 0, feature_indices_);
-        int n_rows = (int)(24 / scale);
-        int n_cols = (int)(24 / scale);
-        for (int r = 0; r + 24 < resized_img.rows; r += step) {
-            for (int c = 0; c + 24 < resized_img.cols; c += step) {
-                //eval->setImage(resized_img(Rect(c, r, 24, 24)), 0, 0);
-                eval->setWindow(Point(c, r));
-                if (predict(eval, &h) == +1) {
-                    int row = (int)(r / scale);
-                    int col = (int)(c / scale);
-                    bboxes.push_back(Rect(col, row, n_cols, n_rows));
-                    confidences.push_back(h);
+    // integral image and feature sum offsets of every scale, shared by all
+    // the windows of the scale
+    const int n_scales = (int)scales.size();
+    std::vector<Mat> sums(n_scales);
+    std::vector<Size> sizes(n_scales);
+    std::vector< std::vector<int> > points(n_scales);
+    parallel_for_(Range(0, n_scales), [&](const Range& range) {
+        Mat resized_img;
+        for (int i = range.start; i < range.end; ++i) {
+            resize(img, resized_img, Size(), scales[i], scales[i], INTER_LINEAR_EXACT);
+            integral(resized_img, sums[i]);
+            sizes[i] = resized_img.size();
+            points[i].resize(16 * weak_count_);
+            for (int k = 0; k < weak_count_; ++k)
+                lbp->getFeaturePoints(feature_indices_[k], (int)sums[i].step1(), &points[i][16 * k]);
+        }
+    });
+
+    // window rows of all the scales are evaluated concurrently, the
+    // detections are gathered in the sequential order
+    std::vector<Point> rows;
+    for (int i = 0; i < n_scales; ++i)
+        for (int r = 0; r + 24 < sizes[i].height; r += step)
+            rows.push_back(Point(i, r));
+    std::vector< std::vector<Rect> > row_bboxes(rows.size());
+    std::vector< std::vector<float> > row_confidences(rows.size());
+
+    parallel_for_(Range(0, (int)rows.size()), [&](const Range& range) {
+        for (int t = range.start; t < range.end; ++t) {
+            const int i = rows[t].x, r = rows[t].y;
+            const float scale = scales[i];
+            const int cols = sizes[i].width;
+            const int *pts = points[i].data();
+            const int *psum = sums[i].ptr<int>(r);
+            int n_rows = (int)(24 / scale);
+            int n_cols = (int)(24 / scale);
+            float h;
+            int c = 0;
+#if CV_SIMD128
+            // the first weak classifiers reject most of the windows, they are
+            // evaluated for 4 neighbouring windows at once. With a step of 4,
+            // deinterleaving 16 sums picks the same feature point of the 4
+            // windows, the loads read up to 3 sums past the last window.
+            const int n_vec = std::min(weak_count_, 8);
+            for (; c + 3 * step + 24 + 2 < cols; c += 4 * step) {
+                v_float32x4 res = v_setzero_f32();
+                v_float32x4 alive = v_reinterpret_as_f32(v_setall_s32(-1));
+                int k = 0;
+                for (; k < n_vec; ++k) {
+                    const int *p = pts + 16 * k;
+                    v_int32x4 s[16], t1, t2, t3;
+                    for (int j = 0; j < 16; ++j)
+                        v_load_deinterleave(psum + c + p[j], s[j], t1, t2, t3);
+                    v_float32x4 val = v_cvt_f32(v_calc_lbp(s));
+                    v_float32x4 diff = v_setall_f32((float)polarities_[k]) * (val - v_setall_f32(thresholds_[k]));
+                    v_float32x4 label = v_select(diff > v_setzero_f32(), v_setall_f32(1.f), v_setall_f32(-1.f));
+                    res += v_setall_f32(alphas_[k]) * label;
+                    alive = alive & (res >= v_setall_f32(cascade_thresholds_[k]));
+                    if (!v_check_any(alive))
+                        break;
+                }
+                if (k < n_vec)
+                    continue;
+
+                float lane_res[4];
+                int lane_alive[4];
+                v_store(lane_res, res);
+                v_store(lane_alive, v_reinterpret_as_s32(alive));
+                for (int w = 0; w < 4; ++w) {
+                    int cw = c + w * step;
+                    if (lane_alive[w] && predict(psum + cw, pts, k, lane_res[w], &h) == +1) {
+                        row_bboxes[t].push_back(Rect((int)(cw / scale), (int)(r / scale), n_cols, n_rows));
+                        row_confidences[t].push_back(h);
+                    }
+                }
+            }
+#endif
+            for (; c + 24 < cols; c += step) {
+                if (predict(psum + c, pts, 0, 0.f, &h) == +1) {
+                    row_bboxes[t].push_back(Rect((int)(c / scale), (int)(r / scale), n_cols, n_rows));
+                    row_confidences[t].push_back(h);
                 }
             }
         }
+    });
+
+    for (size_t t = 0; t < rows.size(); ++t) {
+        bboxes.insert(bboxes.end(), row_bboxes[t].begin(), row_bboxes[t].end());
+        confidences.insert(confidences.end(), row_confidences[t].begin(), row_confidences[t].end());
     }
+}
+
+void WaldBoost::detect(Ptr<CvFeatureEvaluator> eval,
+            const Mat& img, const std::vector<float>& scales,
+            std::vector<Rect>& bboxes, Mat1f& confidences)
+{
+    bboxes.clear();
+    confidences.release();
+
+    std::vector<float> window_confidences;
+    detect_windows(eval, img, scales, bboxes, window_confidences);
+    for (size_t i = 0; i < window_confidences.size(); ++i)
+        confidences.push_back(window_confidences[i]);
     groupRectangles(bboxes, 3, 0.7);
 }
 
@@ -157,27 +281,9 @@ void WaldBoost::detect(Ptr<CvFeatureEvaluator> eval,
     bboxes.clear();
     confidences.clear();
 
-    Mat resized_img;
-    int step = 4;
-    float h;
-    for (size_t i = 0; i < scales.size(); ++i) {
-        float scale = scales[i];
-        resize(img, resized_img, Size(), scale, scale, INTER_LINEAR_EXACT);
-        eval->setImage(resized_img, 0, 0, feature_indices_);
-        int n_rows = (int)(24 / scale);
-        int n_cols = (int)(24 / scale);
-        for (int r = 0; r + 24 < resized_img.rows; r += step) {
-            for (int c = 0; c + 24 < resized_img.cols; c += step) {
-                eval->setWindow(Point(c, r));
-                if (predict(eval, &h) == +1) {
-                    int row = (int)(r / scale);
-                    int col = (int)(c / scale);
-                    bboxes.push_back(Rect(col, row, n_cols, n_rows));
-                    confidences.push_back(h);
-                }
-            }
-        }
-    }
+    std::vector<float> window_confidences;
+    detect_windows(eval, img, scales, bboxes, window_confidences);
+    confidences.assign(window_confidences.begin(), window_confidences.end());
     std::vector<int> levels(bboxes.size(), 0);
     groupRectangles(bboxes, levels, confidences, 3, 0.7);
 }
@@ -370,6 +476,21 @@ int WaldBoost::predict(Ptr<CvFeatureEvaluator> eval, float *h) const
     return res > cascade_thresholds_[count - 1] ? +1 : -1;
 }
 
+int WaldBoost::predict(const int *psum, const int *points, int start, float res, float *h) const
+{
+    int count = weak_count_;
+    for (int i = start; i < count; ++i) {
+        float val = (float)CvLBPEvaluator::calcLBP(psum, points + 16 * i);
+        int label = polarities_[i] * (val - thresholds_[i]) > 0 ? +1: -1;
+        res += alphas_[i] * label;
+        if (res < cascade_thresholds_[i]) {
+            return -1;
+        }
+    }
+    *h = res;
+    return res > cascade_thresholds_[count - 1] ? +1 : -1;
+}
+
 void WaldBoost::write(FileStorage &fs) const
 {
     fs << "{";
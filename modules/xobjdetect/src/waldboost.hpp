@@ -80,6 +80,15 @@ public:
     ~WaldBoost();
 
 private:
+    // windows accepted by the cascade, before grouping
+    void detect_windows(Ptr<CvFeatureEvaluator> eval,
+                        const Mat& img,
+                        const std::vector<float>& scales,
+                        std::vector<Rect>& bboxes,
+                        std::vector<float>& confidences);
+    // cascade from weak classifier start on, over precomputed LBP sum offsets
+    int predict(const int *psum, const int *points, int start, float res, float *h) const;
+
     int weak_count_;
     std::vector<float> thresholds_;
     std::vector<float> alphas_;